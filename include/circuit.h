@@ -0,0 +1,89 @@
+#ifndef CIRCUIT_H
+#define CIRCUIT_H
+
+#include "matrix.h"
+#include "statevector.h"
+#include <stdlib.h>
+
+/* a recorded sequence of gates, compiled into a plan that fuses them into
+ * fewer, wider gates so running it takes fewer passes over the state */
+typedef struct Circuit Circuit;
+
+/* most qubits `circuit_compile` fuses into one gate unless told otherwise */
+#define CIRCUIT_FUSE_DEFAULT 3
+
+/**
+ * Record the 2^`count` x 2^`count` `gate` on the `count` distinct `qubits`,
+ * indexed as in `statevector_apply_kq`. The gate is copied.
+ * Return 0 on success, -1 on failure.
+ */
+int circuit_add(Circuit *circuit, Matrix *gate, const size_t *qubits,
+                size_t count);
+
+/**
+ * Record the 2x2 `gate` on qubit `target`.
+ * Return 0 on success, -1 on failure.
+ */
+int circuit_add_1q(Circuit *circuit, Matrix *gate, size_t target);
+
+/**
+ * Record the 2x2 `gate` on qubit `target`, applied where qubit `control`
+ * is 1.
+ * Return 0 on success, -1 on failure.
+ */
+int circuit_add_controlled_1q(Circuit *circuit, Matrix *gate, size_t control,
+                              size_t target);
+
+/**
+ * Record the 4x4 `gate` on qubits `high` and `low`, indexed as in
+ * `statevector_apply_2q`.
+ * Return 0 on success, -1 on failure.
+ */
+int circuit_add_2q(Circuit *circuit, Matrix *gate, size_t high, size_t low);
+
+/**
+ * Fuse the recorded gates into a plan of gates on at most `max_qubits`
+ * qubits each (0 for `CIRCUIT_FUSE_DEFAULT`); wider recorded gates stay as
+ * they are. A gate joins the fused gate being built if it fits and shares no
+ * qubit with a gate passed over since, so gates are only moved past gates
+ * they commute with.
+ * Recording another gate discards the plan.
+ * Return 0 on success, -1 on failure.
+ */
+int circuit_compile(Circuit *circuit, size_t max_qubits);
+
+/**
+ * Apply the circuit to `state`, which must have as many qubits as the
+ * circuit: the compiled plan if there is one, else the recorded gates one by
+ * one.
+ */
+void circuit_run(Circuit *circuit, StateVector *state);
+
+/**
+ * Get the number of qubits the circuit acts on.
+ */
+size_t circuit_qubits(Circuit *circuit);
+
+/**
+ * Get the number of gates recorded.
+ */
+size_t circuit_gates(Circuit *circuit);
+
+/**
+ * Get the number of passes over the state `circuit_run` makes: one per gate
+ * of the plan, or per recorded gate before compiling.
+ */
+size_t circuit_passes(Circuit *circuit);
+
+/**
+ * Create an empty circuit on `qubits` qubits.
+ * Return NULL on failure.
+ */
+Circuit *circuit_create(size_t qubits);
+
+/**
+ * Destroy a circuit.
+ */
+void circuit_destroy(Circuit *circuit);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef DENSITYMATRIX_H
+#define DENSITYMATRIX_H
+
+#include "mat_t.h"
+#include "matrix.h"
+#include "statevector.h"
+#include <stdlib.h>
+
+/* the density matrix of a mixed state of qubits, updated in place by gates
+ * and noise channels */
+typedef struct DensityMatrix DensityMatrix;
+
+/**
+ * Get the number of qubits in the state.
+ */
+size_t densitymatrix_qubits(DensityMatrix *rho);
+
+/**
+ * Get the number of rows (and columns) of the matrix (2 ^ qubits).
+ */
+size_t densitymatrix_size(DensityMatrix *rho);
+
+/**
+ * Get entry (`row`, `column`).
+ * Basis states are 0-indexed, and bit `k` of an index is the value of qubit
+ * `k`, as in `statevector_get`.
+ */
+mat_t densitymatrix_get(DensityMatrix *rho, size_t row, size_t column);
+
+/**
+ * Get the trace of the matrix, 1 for a normalized state.
+ */
+mat_t densitymatrix_trace(DensityMatrix *rho);
+
+/**
+ * Replace rho with U rho U^H for the 2x2 `gate` U on qubit `target`.
+ */
+void densitymatrix_apply_1q(DensityMatrix *rho, Matrix *gate, size_t target);
+
+/**
+ * Replace rho with U rho U^H for the 4x4 `gate` U on qubits `high` and `low`,
+ * indexed as in `statevector_apply_2q`.
+ */
+void densitymatrix_apply_2q(DensityMatrix *rho, Matrix *gate, size_t high,
+                            size_t low);
+
+/**
+ * Replace rho with the sum of K rho K^H over the `count` 2x2 Kraus
+ * `operators` K on qubit `target`.
+ * Return 0 on success, -1 on failure.
+ */
+int densitymatrix_apply_kraus_1q(DensityMatrix *rho, Matrix **operators,
+                                 size_t count, size_t target);
+
+/**
+ * Apply the depolarizing channel on qubit `target`, which replaces rho with
+ * X rho X, Y rho Y or Z rho Z with probability `p` / 3 each.
+ */
+void densitymatrix_depolarize(DensityMatrix *rho, double p, size_t target);
+
+/**
+ * Apply the amplitude damping channel on qubit `target`, which decays |1> to
+ * |0> with probability `gamma`.
+ */
+void densitymatrix_amplitude_damp(DensityMatrix *rho, double gamma,
+                                  size_t target);
+
+/**
+ * Set `dest` to the partial trace of `rho` over its `count` distinct
+ * `traced` qubits. The remaining qubits of `rho`, in increasing order, are
+ * the qubits of `dest`, which must have that many.
+ */
+void densitymatrix_partial_trace(DensityMatrix *dest, DensityMatrix *rho,
+                                 const size_t *traced, size_t count);
+
+/**
+ * Create the state of `qubits` qubits, all 0.
+ * Return NULL on failure.
+ */
+DensityMatrix *densitymatrix_create(size_t qubits);
+
+/**
+ * Create the pure state |psi><psi| of `state`.
+ * Return NULL on failure.
+ */
+DensityMatrix *densitymatrix_create_from_state(StateVector *state);
+
+/**
+ * Destroy a DensityMatrix.
+ */
+void densitymatrix_destroy(DensityMatrix *rho);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef DISKSTATE_H
+#define DISKSTATE_H
+
+#include "circuit.h"
+#include "mat_t.h"
+#include "threadpool.h"
+#include <stdlib.h>
+
+/* a state vector kept in a file rather than in memory, for states a few
+ * times larger than RAM; circuits run over it in passes of whole chunks */
+typedef struct DiskState DiskState;
+
+/**
+ * Get the number of qubits in the state.
+ */
+size_t diskstate_qubits(DiskState *state);
+
+/**
+ * Get the number of qubits within a chunk: a chunk holds
+ * 2 ^ `diskstate_chunk_qubits` amplitudes.
+ */
+size_t diskstate_chunk_qubits(DiskState *state);
+
+/**
+ * Read the amplitude of basis state `index` into `value`, with bit `k` of
+ * the index the value of qubit `k` as in `statevector_get`.
+ * Return 0 on success, -1 on failure.
+ */
+int diskstate_get(DiskState *state, size_t index, mat_t *value);
+
+/**
+ * Apply `circuit`, which must have as many qubits as the state, as
+ * `circuit_run` does.
+ * Consecutive gates on qubits within a chunk are applied in one pass over the
+ * file, reading the next chunk while the current one is worked on. Before a
+ * gate on a qubit that is not within a chunk, a swap pass exchanges it with
+ * the chunk qubit whose next use is furthest away, so qubits move between
+ * the file's bit positions; `diskstate_get` follows them.
+ * Return 0 on success, -1 on failure, which leaves the state undefined.
+ */
+int diskstate_run(DiskState *state, Circuit *circuit);
+
+/**
+ * Swap qubits back to their own bit positions, so the file reads as a
+ * `statevector_save` file of the state.
+ * Return 0 on success, -1 on failure.
+ */
+int diskstate_reorder(DiskState *state);
+
+/**
+ * Get the bytes read from the file by the last `diskstate_run` or
+ * `diskstate_reorder`.
+ */
+size_t diskstate_bytes_read(DiskState *state);
+
+/**
+ * Get the bytes written to the file by the last `diskstate_run` or
+ * `diskstate_reorder`.
+ */
+size_t diskstate_bytes_written(DiskState *state);
+
+/**
+ * Get the number of passes over the file made by the last `diskstate_run` or
+ * `diskstate_reorder`, including `diskstate_swap_passes`.
+ */
+size_t diskstate_passes(DiskState *state);
+
+/**
+ * Get the number of those passes that swapped qubits.
+ */
+size_t diskstate_swap_passes(DiskState *state);
+
+/**
+ * Create the state of `qubits` qubits, all 0, in a new matrix file at `path`
+ * (replacing any file there), with chunks of 2 ^ `chunk_qubits` amplitudes.
+ * Gates are split across the workers of `pool`, which may be NULL.
+ * Two chunks are held in memory while gates run, and up to
+ * 2 ^ `STATEVECTOR_GATE_QUBITS` while qubits are swapped; `chunk_qubits`
+ * must be at least the width of the widest gate run.
+ * Return NULL on failure.
+ */
+DiskState *diskstate_create(const char *path, size_t qubits,
+                            size_t chunk_qubits, ThreadPool *pool);
+
+/**
+ * Destroy a DiskState, closing its file, which is left in place.
+ */
+void diskstate_destroy(DiskState *state);
+
+#endif
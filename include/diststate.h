@@ -0,0 +1,77 @@
+#ifndef DISTSTATE_H
+#define DISTSTATE_H
+
+#include "circuit.h"
+#include "statevector.h"
+#include "threadpool.h"
+#include "transport.h"
+#include <stdlib.h>
+
+/* a state vector split evenly across the ranks of a Transport, each holding
+ * its share as a StateVector; the highest qubits select the rank */
+typedef struct DistState DistState;
+
+/**
+ * Get the number of qubits in the whole state.
+ */
+size_t diststate_qubits(DistState *state);
+
+/**
+ * Get the number of qubits within each rank's share: a rank holds
+ * 2 ^ `diststate_local_qubits` amplitudes.
+ */
+size_t diststate_local_qubits(DistState *state);
+
+/**
+ * Apply `circuit`, which must have as many qubits as the state, as
+ * `circuit_run` does. Every rank calls it with the same circuit.
+ * Before a gate on a qubit that selects the rank, the pairs of ranks that
+ * differ in it exchange half their shares to swap it with the local qubit
+ * whose next use is furthest away. The exchange goes in blocks, the gates up
+ * to the next such gate running on each block once it has arrived while the
+ * next block is in flight.
+ * Return 0 on success, -1 on failure, which leaves the state undefined.
+ */
+int diststate_run(DistState *state, Circuit *circuit);
+
+/**
+ * Collect the whole state into `full`, a StateVector of
+ * `diststate_qubits` qubits, on rank 0; the other ranks pass NULL. Every
+ * rank calls it.
+ * Return 0 on success, -1 on failure.
+ */
+int diststate_gather(DistState *state, StateVector *full);
+
+/**
+ * Get the bytes this rank sent to apply gate `gate` of the last
+ * `diststate_run`, counting the gates as `circuit_passes` does.
+ */
+size_t diststate_gate_bytes(DistState *state, size_t gate);
+
+/**
+ * Get the bytes this rank sent during the last `diststate_run`.
+ */
+size_t diststate_bytes_sent(DistState *state);
+
+/**
+ * Get the number of qubit swaps between ranks made by the last
+ * `diststate_run`.
+ */
+size_t diststate_swaps(DistState *state);
+
+/**
+ * Create this rank's share of the state of `qubits` qubits, all 0, across
+ * the ranks of `transport`, whose number must be a power of 2 less than the
+ * state's size. Gates are split across the workers of `pool`,
+ * which may be NULL. The transport is not owned.
+ * Return NULL on failure.
+ */
+DistState *diststate_create(Transport *transport, size_t qubits,
+                            ThreadPool *pool);
+
+/**
+ * Destroy a DistState.
+ */
+void diststate_destroy(DistState *state);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef EIGEN_H
+#define EIGEN_H
+
+#include "matrix.h"
+
+/**
+ * Calculate the eigenvalues of the Hermitian (real symmetric, for real
+ * `mat_t`) `matrix` in ascending order into `eigenvalues`, which must hold
+ * `matrix_width(matrix)` values.
+ * If `eigenvectors` is not NULL, it must be the same size as `matrix`, and
+ * its columns are set to the matching orthonormal eigenvectors. Passing NULL
+ * skips all eigenvector work, which more than halves the time taken.
+ * Only the lower triangle of `matrix` is read, and `matrix` is not modified.
+ * Return 0 on success, -1 on failure.
+ */
+int eigen_hermitian(Matrix *matrix, double *eigenvalues, Matrix *eigenvectors);
+
+#endif
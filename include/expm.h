@@ -0,0 +1,51 @@
+#ifndef EXPM_H
+#define EXPM_H
+
+#include "mat_t.h"
+#include "matvec.h"
+#include <stdlib.h>
+
+/* Krylov workspace for applying exponentials of a Hermitian operator to
+ * vectors, reusable across calls */
+typedef struct Expm Expm;
+
+/**
+ * Overwrite `psi` with exp(`rate` * `t` * H) `psi`, where H is the Hermitian
+ * operator `matvec`, without forming the exponential.
+ * Pass `rate` = -i (`MAT_T_I` negated) for Schrodinger evolution over time
+ * `t`; with real `mat_t`, `rate` = -1 gives imaginary-time evolution.
+ * `t` is split into as many Krylov steps as keep the estimated error within
+ * `tolerance` times the norm of `psi`.
+ * Return 0 on success, -1 on failure.
+ */
+int expm_multiply(Expm *expm, MatVec matvec, void *context, mat_t rate,
+                  double t, mat_t *psi, double tolerance);
+
+/**
+ * Get the number of steps the last `expm_multiply` took.
+ */
+size_t expm_steps(Expm *expm);
+
+/**
+ * Get the number of step sizes the last `expm_multiply` tried and rejected.
+ */
+size_t expm_rejections(Expm *expm);
+
+/**
+ * Get the number of times the last `expm_multiply` applied the operator.
+ */
+size_t expm_matvecs(Expm *expm);
+
+/**
+ * Create a workspace for `size` x `size` operators, with Krylov subspaces
+ * of up to `basis` vectors of `size` values (0 for a default).
+ * Return NULL on failure.
+ */
+Expm *expm_create(size_t size, size_t basis);
+
+/**
+ * Destroy a workspace.
+ */
+void expm_destroy(Expm *expm);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef EXPONENTIALCACHE_H
+#define EXPONENTIALCACHE_H
+
+#include "mat_t.h"
+#include "matrix.h"
+#include <stdlib.h>
+
+/* exponentials exp(t A) of one square matrix A, remembered for the most
+ * recently used values of t */
+typedef struct ExponentialCache ExponentialCache;
+
+/**
+ * Set `dest` to exp(`t` * A), reusing the result of an earlier call with the
+ * same `t`, and the powers of A from any earlier call.
+ * `dest` must be the same size as A.
+ * Return 0 on success, -1 on failure.
+ */
+int exponentialcache_get(ExponentialCache *cache, Matrix *dest, mat_t t);
+
+/**
+ * Get the number of `exponentialcache_get` calls answered from the cache.
+ */
+size_t exponentialcache_hits(ExponentialCache *cache);
+
+/**
+ * Get the number of `exponentialcache_get` calls that computed their result.
+ */
+size_t exponentialcache_misses(ExponentialCache *cache);
+
+/**
+ * Create a cache of up to `capacity` exponentials of a copy of the square
+ * `matrix`, which may be destroyed afterward.
+ * Return NULL on failure.
+ */
+ExponentialCache *exponentialcache_create(Matrix *matrix, size_t capacity);
+
+/**
+ * Destroy the ExponentialCache.
+ */
+void exponentialcache_destroy(ExponentialCache *cache);
+
+#endif
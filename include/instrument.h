@@ -0,0 +1,137 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* the public functions whose calls, FLOPs, allocated bytes and wall time are
+ * counted when the library is built with LIBQUANT_INSTRUMENT defined: those
+ * doing work proportional to their operands, not getters, constructors other
+ * than `matrix_create` and `lufactor_create`, or destructors */
+typedef enum {
+    INSTRUMENT_MATRIX_CREATE,
+    INSTRUMENT_MATRIX_MULTIPLY,
+    INSTRUMENT_MATRIX_MULTIPLY_ACCUMULATE,
+    INSTRUMENT_MATRIX_KRON,
+    INSTRUMENT_MATRIX_EXPONENTIAL,
+    INSTRUMENT_MATRIX_DETERMINANT,
+    INSTRUMENT_MATRIX_DETERMINANT_IN,
+    INSTRUMENT_MATRIX_DIAGONALIZE,
+    INSTRUMENT_MATRIX_SVD,
+    INSTRUMENT_MATRIX_QR,
+    INSTRUMENT_LUFACTOR_CREATE,
+    INSTRUMENT_LUFACTOR_SOLVE,
+    INSTRUMENT_LUFACTOR_INVERSE,
+    INSTRUMENT_EIGEN_HERMITIAN,
+    INSTRUMENT_LANCZOS_SOLVE,
+    INSTRUMENT_EXPM_MULTIPLY,
+    INSTRUMENT_SPARSEMATRIX_MULTIPLY_VECTOR,
+    INSTRUMENT_SPARSEMATRIX_MULTIPLY_VECTOR_PARALLEL,
+    INSTRUMENT_SPARSEMATRIX_MULTIPLY_DENSE,
+    INSTRUMENT_KRONOPERATOR_MULTIPLY_VECTOR,
+    INSTRUMENT_STATEVECTOR_APPLY_1Q,
+    INSTRUMENT_STATEVECTOR_APPLY_CONTROLLED_1Q,
+    INSTRUMENT_STATEVECTOR_APPLY_2Q,
+    INSTRUMENT_STATEVECTOR_APPLY_CONTROLLED_2Q,
+    INSTRUMENT_STATEVECTOR_APPLY_KQ,
+    INSTRUMENT_STATEVECTOR_NORM,
+    INSTRUMENT_STATEVECTOR_EXPECTATION_1Q,
+    INSTRUMENT_CIRCUIT_RUN,
+    INSTRUMENT_DISKSTATE_RUN,
+    INSTRUMENT_DISKSTATE_REORDER,
+    INSTRUMENT_DISTSTATE_RUN,
+    INSTRUMENT_DISTSTATE_GATHER,
+    INSTRUMENT_DENSITYMATRIX_APPLY_1Q,
+    INSTRUMENT_DENSITYMATRIX_APPLY_2Q,
+    INSTRUMENT_DENSITYMATRIX_APPLY_KRAUS_1Q,
+    INSTRUMENT_DENSITYMATRIX_DEPOLARIZE,
+    INSTRUMENT_DENSITYMATRIX_AMPLITUDE_DAMP,
+    INSTRUMENT_DENSITYMATRIX_PARTIAL_TRACE,
+    INSTRUMENT_MPS_APPLY_2Q,
+    INSTRUMENT_TABLEAU_H,
+    INSTRUMENT_TABLEAU_S,
+    INSTRUMENT_TABLEAU_CNOT,
+    INSTRUMENT_TABLEAU_X,
+    INSTRUMENT_TABLEAU_Y,
+    INSTRUMENT_TABLEAU_Z,
+    INSTRUMENT_TABLEAU_MEASURE,
+    INSTRUMENT_SAMPLER_SAMPLE,
+    INSTRUMENT_SAMPLER_HISTOGRAM,
+    INSTRUMENT_FUNCTIONS
+} InstrumentFunction;
+
+/* the counters of every thread, merged at one point in time */
+typedef struct InstrumentSnapshot InstrumentSnapshot;
+
+/**
+ * Get whether the library was built with instrumentation.
+ * Without it every counter stays 0.
+ */
+bool instrument_enabled(void);
+
+/**
+ * Get the name of the public function `function` counts, e.g.
+ * "matrix_multiply".
+ */
+const char *instrument_function_name(InstrumentFunction function);
+
+/**
+ * Zero the counters of every thread.
+ * Calls in progress on other threads may be partly counted.
+ */
+void instrument_reset(void);
+
+/**
+ * Get the number of calls to `function` that have returned.
+ */
+unsigned long instrumentsnapshot_calls(InstrumentSnapshot *snapshot,
+                                       InstrumentFunction function);
+
+/**
+ * Get the floating point operations done by the calls to `function`,
+ * including those of the library functions it calls.
+ */
+double instrumentsnapshot_flops(InstrumentSnapshot *snapshot,
+                                InstrumentFunction function);
+
+/**
+ * Get the bytes allocated by the calls to `function`, including those of
+ * the library functions it calls.
+ */
+double instrumentsnapshot_bytes(InstrumentSnapshot *snapshot,
+                                InstrumentFunction function);
+
+/**
+ * Get the wall time in seconds spent in the calls to `function`, including
+ * the library functions it calls.
+ */
+double instrumentsnapshot_seconds(InstrumentSnapshot *snapshot,
+                                  InstrumentFunction function);
+
+/**
+ * Get the number of rows swapped while pivoting by matrix_diagonalize,
+ * matrix_determinant and lufactor_create, including the LU factorization
+ * within matrix_exponential.
+ */
+unsigned long instrumentsnapshot_pivot_swaps(InstrumentSnapshot *snapshot);
+
+/**
+ * Write the snapshot to `file` as one JSON object, with an entry for every
+ * function.
+ * Return 0 on success, -1 on failure.
+ */
+int instrumentsnapshot_dump(InstrumentSnapshot *snapshot, FILE *file);
+
+/**
+ * Merge the counters of every thread, including threads that have exited.
+ * Return NULL on failure.
+ */
+InstrumentSnapshot *instrumentsnapshot_create(void);
+
+/**
+ * Destroy an InstrumentSnapshot.
+ */
+void instrumentsnapshot_destroy(InstrumentSnapshot *snapshot);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef KRONOPERATOR_H
+#define KRONOPERATOR_H
+
+#include "mat_t.h"
+#include "matrix.h"
+#include <stdlib.h>
+
+/* the Kronecker product of square factors, applied to vectors one factor at
+ * a time without forming it */
+typedef struct KronOperator KronOperator;
+
+/**
+ * Set `y` to the product of the factors times `x`. `x` and `y` hold
+ * `kronoperator_size(kron)` values and must not overlap.
+ * Each factor other than an identity costs one pass over the vector.
+ */
+void kronoperator_multiply_vector(KronOperator *kron, const mat_t *x,
+                                  mat_t *y);
+
+/**
+ * Get the height (and width) of the product: the product of the sizes of
+ * the factors.
+ */
+size_t kronoperator_size(KronOperator *kron);
+
+/**
+ * Create the Kronecker product of the `count` square matrices `factors`,
+ * the first of them outermost, as `matrix_kron` orders them. The factors
+ * are copied, and may be destroyed afterward.
+ * Return NULL on failure.
+ */
+KronOperator *kronoperator_create(Matrix **factors, size_t count);
+
+/**
+ * Destroy the KronOperator.
+ */
+void kronoperator_destroy(KronOperator *kron);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef LANCZOS_H
+#define LANCZOS_H
+
+#include "mat_t.h"
+#include "matvec.h"
+#include <stdlib.h>
+
+/* a thick-restart Lanczos solver for the smallest eigenpairs of a Hermitian
+ * operator, reusable across solves */
+typedef struct Lanczos Lanczos;
+
+/**
+ * Find the smallest eigenpairs of the Hermitian operator `matvec`, until the
+ * residual of each is within `tolerance` times the larger of 1 and its
+ * eigenvalue, or `max_iterations` restart cycles have run.
+ * A single Krylov sequence sees one direction per eigenspace, so a
+ * degenerate eigenvalue is usually found once rather than once per vector.
+ * Return 0 on convergence, -1 on failure or if it did not converge (the
+ * results are then the best estimates found).
+ */
+int lanczos_solve(Lanczos *lanczos, MatVec matvec, void *context,
+                  double tolerance, size_t max_iterations);
+
+/**
+ * Get eigenvalue `index` (0-indexed, ascending) from the last solve.
+ */
+double lanczos_eigenvalue(Lanczos *lanczos, size_t index);
+
+/**
+ * Get the normalized eigenvector for eigenvalue `index` from the last
+ * solve. It is overwritten by the next solve.
+ */
+const mat_t *lanczos_eigenvector(Lanczos *lanczos, size_t index);
+
+/**
+ * Get the residual norm |A v - lambda v| of eigenpair `index` from the last
+ * solve.
+ */
+double lanczos_residual(Lanczos *lanczos, size_t index);
+
+/**
+ * Get the number of restart cycles the last solve ran.
+ */
+size_t lanczos_iterations(Lanczos *lanczos);
+
+/**
+ * Get the number of times the last solve applied the operator.
+ */
+size_t lanczos_matvecs(Lanczos *lanczos);
+
+/**
+ * Create a solver for the `count` smallest eigenpairs of `size` x `size`
+ * operators, keeping up to `basis` Krylov vectors of `size` values (0 for a
+ * default). A larger basis converges in fewer restarts but uses more memory
+ * and more orthogonalization per step.
+ * Return NULL on failure.
+ */
+Lanczos *lanczos_create(size_t size, size_t count, size_t basis);
+
+/**
+ * Destroy a solver.
+ */
+void lanczos_destroy(Lanczos *lanczos);
+
+#endif
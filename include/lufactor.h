@@ -0,0 +1,53 @@
+#ifndef LUFACTOR_H
+#define LUFACTOR_H
+
+#include "mat_t.h"
+#include "matrix.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef struct LUFactor LUFactor;
+
+/**
+ * Get the number of rows (and columns) of the factored matrix.
+ */
+size_t lufactor_width(LUFactor *factor);
+
+/**
+ * Return `true` iff the factored matrix is singular.
+ */
+bool lufactor_is_singular(LUFactor *factor);
+
+/**
+ * Calculate the determinant of the factored matrix.
+ */
+mat_t lufactor_determinant(LUFactor *factor);
+
+/**
+ * Overwrite each column of `rhs` with the solution x of A x = column, where A
+ * is the factored matrix.
+ * `rhs` must have `lufactor_width(factor)` rows.
+ * Return 0 on success, -1 if the factored matrix is singular.
+ */
+int lufactor_solve(LUFactor *factor, Matrix *rhs);
+
+/**
+ * Create the inverse of the factored matrix.
+ * Return NULL on failure, or if the factored matrix is singular.
+ */
+Matrix *lufactor_inverse(LUFactor *factor);
+
+/**
+ * Factor the square `matrix` as P A = L U with partial pivoting, for reuse by
+ * the other lufactor functions.
+ * `matrix` is not modified, and may be destroyed afterward.
+ * Return NULL on failure.
+ */
+LUFactor *lufactor_create(Matrix *matrix);
+
+/**
+ * Destroy the LUFactor.
+ */
+void lufactor_destroy(LUFactor *factor);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef MAT2_H
+#define MAT2_H
+
+#include "mat_t.h"
+#include "matrix.h"
+
+/* a 2x2 matrix held by value, for single-qubit gates on hot paths where a
+ * heap-allocated `Matrix` costs more than the arithmetic */
+typedef struct Mat2 {
+    /* row-major and 0-indexed: entry (i, j) is values[2 * i + j] */
+    mat_t values[4];
+} Mat2;
+
+/**
+ * Set `dest` to the identity.
+ */
+void mat2_identity(Mat2 *dest);
+
+/**
+ * Set `dest` to `a` * `b`, the gate `b` followed by the gate `a`.
+ * `dest` may be `a` or `b`.
+ */
+void mat2_multiply(Mat2 *dest, const Mat2 *a, const Mat2 *b);
+
+/**
+ * Set `dest` to the conjugate transpose of `a`.
+ * `dest` may be `a`.
+ */
+void mat2_adjoint(Mat2 *dest, const Mat2 *a);
+
+/**
+ * Get the determinant of `a`.
+ */
+mat_t mat2_determinant(const Mat2 *a);
+
+/**
+ * Set `dest` to the inverse of `a`.
+ * `dest` may be `a`.
+ * Return 0 on success, -1 if `a` is singular (`dest` is then unchanged).
+ */
+int mat2_inverse(Mat2 *dest, const Mat2 *a);
+
+/**
+ * Copy the 2x2 `matrix` into `dest`.
+ */
+void mat2_from_matrix(Mat2 *dest, Matrix *matrix);
+
+/**
+ * Copy `a` into the 2x2 `dest`.
+ */
+void mat2_to_matrix(Matrix *dest, const Mat2 *a);
+
+#endif
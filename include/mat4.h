@@ -0,0 +1,82 @@
+#ifndef MAT4_H
+#define MAT4_H
+
+#include "mat2.h"
+#include "mat_t.h"
+#include "matrix.h"
+
+/* a 4x4 matrix held by value, for two-qubit gates on hot paths where a
+ * heap-allocated `Matrix` costs more than the arithmetic.
+ * Rows and columns are indexed by 2 * (qubit `high`) + (qubit `low`), as in
+ * `statevector_apply_2q`. */
+typedef struct Mat4 {
+    /* row-major and 0-indexed: entry (i, j) is values[4 * i + j] */
+    mat_t values[16];
+} Mat4;
+
+/**
+ * Set `dest` to the identity.
+ */
+void mat4_identity(Mat4 *dest);
+
+/**
+ * Set `dest` to `a` * `b`, the gate `b` followed by the gate `a`.
+ * `dest` may be `a` or `b`.
+ */
+void mat4_multiply(Mat4 *dest, const Mat4 *a, const Mat4 *b);
+
+/**
+ * Set `dest` to the conjugate transpose of `a`.
+ * `dest` may be `a`.
+ */
+void mat4_adjoint(Mat4 *dest, const Mat4 *a);
+
+/**
+ * Get the determinant of `a`.
+ */
+mat_t mat4_determinant(const Mat4 *a);
+
+/**
+ * Set `dest` to the inverse of `a`.
+ * `dest` may be `a`.
+ * Return 0 on success, -1 if `a` is singular (`dest` is then unchanged).
+ */
+int mat4_inverse(Mat4 *dest, const Mat4 *a);
+
+/**
+ * Set `dest` to `high` (x) `low`, the single-qubit gates `high` and `low`
+ * applied side by side.
+ */
+void mat4_kron(Mat4 *dest, const Mat2 *high, const Mat2 *low);
+
+/**
+ * Set `dest` to the gate that applies `gate` to qubit `low` when qubit
+ * `high` is 1.
+ */
+void mat4_controlled(Mat4 *dest, const Mat2 *gate);
+
+/**
+ * Set `dest` to (`gate` (x) I) `a`, the gate `a` followed by `gate` on qubit
+ * `high`, without forming the Kronecker product.
+ * `dest` may be `a`.
+ */
+void mat4_apply_high(Mat4 *dest, const Mat2 *gate, const Mat4 *a);
+
+/**
+ * Set `dest` to (I (x) `gate`) `a`, the gate `a` followed by `gate` on qubit
+ * `low`, without forming the Kronecker product.
+ * `dest` may be `a`.
+ */
+void mat4_apply_low(Mat4 *dest, const Mat2 *gate, const Mat4 *a);
+
+/**
+ * Copy the 4x4 `matrix` into `dest`.
+ */
+void mat4_from_matrix(Mat4 *dest, Matrix *matrix);
+
+/**
+ * Copy `a` into the 4x4 `dest`.
+ */
+void mat4_to_matrix(Matrix *dest, const Mat4 *a);
+
+#endif
@@ -1,6 +1,88 @@
 #ifndef MAT_T_H
 #define MAT_T_H
 
+#include <math.h>
+#include <stdbool.h>
+
+/* build with -DMAT_T_COMPLEX (`make MAT_T=complex`) for complex values */
+#ifdef MAT_T_COMPLEX
+
+#ifdef __GNUC__
+#define MAT_T_INLINE static __inline__
+#else
+#define MAT_T_INLINE static
+#endif
+
+#define MAT_T_PRECISION 1e-10
+
+/* arrays of mat_t are interleaved (re, im) pairs of doubles */
+typedef struct {
+    double re;
+    double im;
+} mat_t;
+
+MAT_T_INLINE mat_t mat_t_complex(double re, double im) {
+    mat_t result;
+    result.re = re;
+    result.im = im;
+    return result;
+}
+
+MAT_T_INLINE mat_t mat_t_add(mat_t a, mat_t b) {
+    return mat_t_complex(a.re + b.re, a.im + b.im);
+}
+
+MAT_T_INLINE mat_t mat_t_sub(mat_t a, mat_t b) {
+    return mat_t_complex(a.re - b.re, a.im - b.im);
+}
+
+MAT_T_INLINE mat_t mat_t_mul(mat_t a, mat_t b) {
+    return mat_t_complex(a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re);
+}
+
+MAT_T_INLINE mat_t mat_t_div(mat_t a, mat_t b) {
+    const double denominator = b.re * b.re + b.im * b.im;
+    return mat_t_complex((a.re * b.re + a.im * b.im) / denominator,
+                         (a.im * b.re - a.re * b.im) / denominator);
+}
+
+MAT_T_INLINE mat_t mat_t_conj(mat_t a) { return mat_t_complex(a.re, -a.im); }
+
+MAT_T_INLINE double mat_t_abs2(mat_t a) { return a.re * a.re + a.im * a.im; }
+
+MAT_T_INLINE mat_t mat_t_exp(mat_t a) {
+    const double magnitude = exp(a.re);
+    return mat_t_complex(magnitude * cos(a.im), magnitude * sin(a.im));
+}
+
+MAT_T_INLINE bool mat_t_eq(mat_t a, mat_t b) {
+    return a.re + MAT_T_PRECISION > b.re && b.re > a.re - MAT_T_PRECISION
+           && a.im + MAT_T_PRECISION > b.im && b.im > a.im - MAT_T_PRECISION;
+}
+
+#define MAT_T_0 mat_t_complex(0.0, 0.0)
+#define MAT_T_1 mat_t_complex(1.0, 0.0)
+#define MAT_T_I mat_t_complex(0.0, 1.0)
+
+#define MAT_T(n) mat_t_complex((double)(n), 0.0)
+
+#define MAT_T_ADD(a, b) mat_t_add(a, b)
+#define MAT_T_SUB(a, b) mat_t_sub(a, b)
+#define MAT_T_MUL(a, b) mat_t_mul(a, b)
+#define MAT_T_DIV(a, b) mat_t_div(a, b)
+
+#define MAT_T_CONJ(a) mat_t_conj(a)
+#define MAT_T_REAL(a) ((a).re)
+#define MAT_T_IMAG(a) ((a).im)
+#define MAT_T_ABS2(a) mat_t_abs2(a)
+#define MAT_T_EXP(a) mat_t_exp(a)
+
+#define MAT_T_EQ(a, b) mat_t_eq(a, b)
+
+#define MAT_T_PRINT(m) printf("%.3f%+.3fi", (m).re, (m).im)
+
+#else
+
 typedef double mat_t;
 
 #define MAT_T_0 0.0
@@ -14,6 +96,12 @@ typedef double mat_t;
 #define MAT_T_MUL(a, b) (a * b)
 #define MAT_T_DIV(a, b) (a / b)
 
+#define MAT_T_CONJ(a) (a)
+#define MAT_T_REAL(a) (a)
+#define MAT_T_IMAG(a) 0.0
+#define MAT_T_ABS2(a) ((a) * (a))
+#define MAT_T_EXP(a) exp(a)
+
 #define MAT_T_PRECISION 1e-10
 
 #define MAT_T_EQ(a, b) (a + MAT_T_PRECISION > b && b > a - MAT_T_PRECISION)
@@ -21,3 +109,5 @@ typedef double mat_t;
 #define MAT_T_PRINT(m) printf("%.3f", m)
 
 #endif
+
+#endif
@@ -2,6 +2,7 @@
 #define MATRIX_H
 
 #include "mat_t.h"
+#include "matrixarena.h"
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -29,11 +30,85 @@ void matrix_set(Matrix *matrix, size_t i, size_t j, mat_t value);
  */
 mat_t matrix_get(Matrix *matrix, size_t i, size_t j);
 
+/**
+ * Get the number of values between the starts of consecutive rows: the
+ * width, or more for a view into a wider matrix.
+ */
+size_t matrix_stride(Matrix *matrix);
+
+/**
+ * Get the `matrix_width(matrix)` contiguous values of row `i` (1-indexed),
+ * for loops that skip the bounds checks of `matrix_get`.
+ * The pointer is valid while the storage of the matrix is.
+ */
+mat_t *matrix_row(Matrix *matrix, size_t i);
+
+/**
+ * Get the first value of column `j` (1-indexed); each value below it is
+ * `matrix_stride(matrix)` values further on.
+ * The pointer is valid while the storage of the matrix is.
+ */
+mat_t *matrix_column(Matrix *matrix, size_t j);
+
+/**
+ * Overwrite the matrix with `matrix_height(matrix)` * `matrix_width(matrix)`
+ * values from `buffer`, row-first.
+ */
+void matrix_copy_from_buffer(Matrix *matrix, const mat_t *buffer);
+
+/**
+ * Copy the matrix into `buffer` as `matrix_height(matrix)` *
+ * `matrix_width(matrix)` values, row-first.
+ */
+void matrix_copy_to_buffer(Matrix *matrix, mat_t *buffer);
+
+/**
+ * Multiply `a` by `b`, storing the result in `dest`.
+ * `dest` must be `matrix_height(a)` by `matrix_width(b)` and must not be `a`
+ * or `b`.
+ * Return 0 on success, -1 on failure.
+ */
+int matrix_multiply(Matrix *dest, Matrix *a, Matrix *b);
+
+/**
+ * Add `alpha` * `a` * `b` to `dest`.
+ * `dest` must be `matrix_height(a)` by `matrix_width(b)` and must not be `a`
+ * or `b`.
+ * Return 0 on success, -1 on failure.
+ */
+int matrix_multiply_accumulate(Matrix *dest, mat_t alpha, Matrix *a,
+                               Matrix *b);
+
+/**
+ * Set `dest` to the Kronecker product of `a` and `b`, in which block (i, j)
+ * is a[i][j] * `b`.
+ * `dest` must be `matrix_height(a)` * `matrix_height(b)` by
+ * `matrix_width(a)` * `matrix_width(b)`, and must not overlap `a` or `b`.
+ * A KronOperator applies a product of many factors without forming it.
+ */
+void matrix_kron(Matrix *dest, Matrix *a, Matrix *b);
+
+/**
+ * Set `dest` to exp(`t` * `matrix`) for a square `matrix`, by scaling and
+ * squaring a Pade approximant.
+ * `dest` must be the same size as `matrix`, and may be `matrix`.
+ * An ExponentialCache saves work when exponentiating one matrix for several
+ * `t`.
+ * Return 0 on success, -1 on failure.
+ */
+int matrix_exponential(Matrix *dest, Matrix *matrix, mat_t t);
+
 /**
  * Calculate the determinant of a matrix.
  */
 mat_t matrix_determinant(Matrix *matrix);
 
+/**
+ * Calculate the determinant of a matrix as `matrix_determinant` does, taking
+ * scratch memory from `arena` instead of the heap.
+ */
+mat_t matrix_determinant_in(MatrixArena *arena, Matrix *matrix);
+
 /**
  * Return `true` iff `matrix` is diagonal.
  */
@@ -43,12 +118,46 @@ bool matrix_is_diagonal(Matrix *matrix);
  * Diagonalize the matrix.
  */
 void matrix_diagonalize(Matrix *matrix);
+
+/**
+ * Factor an m x n `matrix` as U S V^H by one-sided Jacobi rotations, with
+ * k = min(m, n) singular values.
+ * `u` must be m x k and `v` n x k; their columns are set to the singular
+ * vectors, which are orthonormal except that the columns of `u` (of `v` if
+ * n > m) for zero singular values are zero.
+ * `singular_values` must hold k values, which are stored largest first.
+ * Either of `u` and `v` may be NULL to skip it; leaving out the one for the
+ * shorter side skips accumulating the rotations, the bulk of the work.
+ * Return 0 on success, -1 on failure.
+ */
+int matrix_svd(Matrix *u, double *singular_values, Matrix *v, Matrix *matrix);
+
+/**
+ * Factor an m x n `matrix` as Q R by blocked Householder reflections, with
+ * k = min(m, n).
+ * `q` must be m x k, and is set to orthonormal columns, or may be NULL to
+ * skip forming them. `r` must be k x n, and is set upper triangular.
+ * Return 0 on success, -1 on failure.
+ */
+int matrix_qr(Matrix *q, Matrix *r, Matrix *matrix);
 /**
  * Create an identity matrix.
  * Return NULL on failure.
  */
 Matrix *matrix_create_identity(size_t width);
 
+/**
+ * Create a copy of the Matrix.
+ * Return NULL on failure.
+ */
+Matrix *matrix_clone(Matrix *matrix);
+
+/**
+ * Create a copy of the Matrix in `arena`.
+ * Return NULL on failure.
+ */
+Matrix *matrix_clone_in(MatrixArena *arena, Matrix *matrix);
+
 /**
  * Create a Matrix filled with all zeroes.
  * Return NULL on failure.
@@ -56,10 +165,53 @@ Matrix *matrix_create_identity(size_t width);
 Matrix *matrix_create(size_t height, size_t width);
 
 /**
- * Destroy the Matrix.
+ * Create a Matrix filled with all zeroes in `arena`, as one allocation with
+ * its values aligned to `MATRIXARENA_ALIGNMENT`. It lives until the arena is
+ * reset or destroyed; `matrix_destroy` on it does nothing.
+ * Return NULL on failure.
+ */
+Matrix *matrix_create_in(MatrixArena *arena, size_t height, size_t width);
+
+/**
+ * Create a `height` x `width` view of `matrix` with its top-left value at row
+ * `i`, column `j` (1-indexed). The view shares storage with `matrix`, so
+ * writes through either show in both, and it works with every other Matrix
+ * function. `matrix` must outlive the view.
+ * Return NULL on failure.
+ */
+Matrix *matrix_create_view(Matrix *matrix, size_t i, size_t j, size_t height,
+                           size_t width);
+
+/**
+ * Create a Matrix from a file written by `matrix_save` or a MatrixWriter,
+ * converting the values to this machine's byte order and, for real values
+ * read into complex matrices, to complex.
+ * Return NULL on failure.
+ */
+Matrix *matrix_load(const char *path);
+
+/**
+ * Create a read-only Matrix whose values are the file at `path`, written by
+ * `matrix_save` or a MatrixWriter, mapped into memory rather than read.
+ * Pages are read on first access, so opening takes the same time for any
+ * size. The file must hold this build's element type in this machine's byte
+ * order. Writing to the matrix, or passing it as a destination, crashes.
+ * Return NULL on failure.
+ */
+Matrix *matrix_map(const char *path);
+
+/**
+ * Destroy the Matrix. Destroying a view leaves its storage alone.
  */
 void matrix_destroy(Matrix *matrix);
 
+/**
+ * Write the Matrix to the file at `path` in the binary format read by
+ * `matrix_load` and `matrix_map`, which keeps every bit of the values.
+ * Return 0 on success, -1 on failure.
+ */
+int matrix_save(Matrix *matrix, const char *path);
+
 /**
  * Print the Matrix.
  */
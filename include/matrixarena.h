@@ -0,0 +1,49 @@
+#ifndef MATRIXARENA_H
+#define MATRIXARENA_H
+
+#include <stdlib.h>
+
+/* a region that hands out memory by bumping an offset and takes it all back
+ * at once, for matrices and scratch that live for one pass of a loop */
+typedef struct MatrixArena MatrixArena;
+
+/* alignment of everything allocated from an arena, in bytes */
+#define MATRIXARENA_ALIGNMENT 64
+
+/**
+ * Allocate `bytes` from the arena, aligned to `MATRIXARENA_ALIGNMENT`.
+ * The memory is not zeroed, and stays valid until the next reset.
+ * Return NULL on failure.
+ */
+void *matrixarena_allocate(MatrixArena *arena, size_t bytes);
+
+/**
+ * Take back everything allocated from the arena. Memory it had to add since
+ * the last reset is merged into one block, so a loop that allocates the same
+ * amount each pass settles into a single block.
+ * Return 0 on success, -1 if merging failed (the arena is still usable).
+ */
+int matrixarena_reset(MatrixArena *arena);
+
+/**
+ * Get the number of bytes allocated since the last reset, with padding.
+ */
+size_t matrixarena_used(MatrixArena *arena);
+
+/**
+ * Get the number of bytes the arena holds.
+ */
+size_t matrixarena_capacity(MatrixArena *arena);
+
+/**
+ * Create an arena holding `capacity` bytes to start with (0 for a default).
+ * Return NULL on failure.
+ */
+MatrixArena *matrixarena_create(size_t capacity);
+
+/**
+ * Destroy the arena, and with it everything allocated from it.
+ */
+void matrixarena_destroy(MatrixArena *arena);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef MATRIXFILE_H
+#define MATRIXFILE_H
+
+#include "mat_t.h"
+#include <stdlib.h>
+
+/* version of the matrix file format written; a 64 byte header (magic,
+ * version, element type, byte order, value offset, height and width) then
+ * the values, row-first, starting at a 64 byte aligned offset */
+#define MATRIXFILE_VERSION 1
+
+/* byte offset of the values in the files this version writes */
+#define MATRIXFILE_OFFSET 64
+
+/* a matrix file read a few rows at a time, for matrices and states too large
+ * to hold twice in memory */
+typedef struct MatrixReader MatrixReader;
+
+/* a matrix file written a few rows at a time, for matrices and states too
+ * large to hold in memory at once */
+typedef struct MatrixWriter MatrixWriter;
+
+/**
+ * Get the height of the matrix in the file.
+ */
+size_t matrixreader_height(MatrixReader *reader);
+
+/**
+ * Get the width of the matrix in the file.
+ */
+size_t matrixreader_width(MatrixReader *reader);
+
+/**
+ * Get the number of rows read so far.
+ */
+size_t matrixreader_rows(MatrixReader *reader);
+
+/**
+ * Read the next `rows` rows into `values`, row-first and contiguous,
+ * converting them to this machine's byte order and, for real values read
+ * into a complex build, to complex.
+ * Return 0 on success, -1 on failure.
+ */
+int matrixreader_read(MatrixReader *reader, mat_t *values, size_t rows);
+
+/**
+ * Open the matrix file at `path` and check its header.
+ * Return NULL on failure.
+ */
+MatrixReader *matrixreader_create(const char *path);
+
+/**
+ * Destroy a MatrixReader, closing its file.
+ */
+void matrixreader_destroy(MatrixReader *reader);
+
+/**
+ * Get the number of rows written so far.
+ */
+size_t matrixwriter_rows(MatrixWriter *writer);
+
+/**
+ * Append `rows` rows, stored row-first and contiguous at `values`.
+ * Return 0 on success, -1 on failure.
+ */
+int matrixwriter_write(MatrixWriter *writer, const mat_t *values, size_t rows);
+
+/**
+ * Flush and close the file once every row is written.
+ * Return 0 on success, -1 on failure.
+ */
+int matrixwriter_finish(MatrixWriter *writer);
+
+/**
+ * Create the file at `path` for a `height` x `width` matrix of this build's
+ * element type, replacing any file there, and write its header.
+ * Return NULL on failure.
+ */
+MatrixWriter *matrixwriter_create(const char *path, size_t height,
+                                  size_t width);
+
+/**
+ * Destroy a MatrixWriter, closing its file if `matrixwriter_finish` was not
+ * called; such a file is incomplete and is rejected when read.
+ */
+void matrixwriter_destroy(MatrixWriter *writer);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef MATVEC_H
+#define MATVEC_H
+
+#include "mat_t.h"
+
+/* an operator given only by its action: set `y` to the operator times `x`,
+ * where `x` and `y` do not overlap */
+typedef void (*MatVec)(void *context, const mat_t *x, mat_t *y);
+
+/**
+ * Set `y` to the square dense Matrix `matrix` times `x`.
+ * Usable as a MatVec with the Matrix as context.
+ */
+void matvec_dense(void *matrix, const mat_t *x, mat_t *y);
+
+/**
+ * Set `y` to the SparseMatrix `sparse` times `x`.
+ * Usable as a MatVec with the SparseMatrix as context.
+ */
+void matvec_sparse(void *sparse, const mat_t *x, mat_t *y);
+
+/**
+ * Set `y` to the KronOperator `kron` times `x`.
+ * Usable as a MatVec with the KronOperator as context.
+ */
+void matvec_kron(void *kron, const mat_t *x, mat_t *y);
+
+#endif
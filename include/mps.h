@@ -0,0 +1,68 @@
+#ifndef MPS_H
+#define MPS_H
+
+#include "mat_t.h"
+#include "matrix.h"
+#include <stdlib.h>
+
+/* a state of a chain of qubits as a matrix product state, whose memory and
+ * gate cost grow with entanglement rather than with 2 ^ qubits */
+typedef struct Mps Mps;
+
+/**
+ * Get the number of qubits in the state.
+ */
+size_t mps_qubits(Mps *mps);
+
+/**
+ * Get the dimension of bond `bond`, between qubits `bond` and `bond` + 1.
+ */
+size_t mps_bond_dimension(Mps *mps, size_t bond);
+
+/**
+ * Get the largest bond dimension in the state.
+ */
+size_t mps_max_bond_dimension(Mps *mps);
+
+/**
+ * Get the total weight of the singular values truncated so far, each
+ * truncation counted as a fraction of the norm squared before it.
+ */
+double mps_discarded_weight(Mps *mps);
+
+/**
+ * Get the amplitude of basis state `index`, whose bit `k` is the value of
+ * qubit `k` as in `statevector_get`.
+ */
+mat_t mps_get(Mps *mps, size_t index);
+
+/**
+ * Apply the 2x2 `gate` to qubit `target`.
+ */
+void mps_apply_1q(Mps *mps, Matrix *gate, size_t target);
+
+/**
+ * Apply the 4x4 `gate` to qubits `high` and `low`, indexed as in
+ * `statevector_apply_2q`. Qubits that are not neighbours are first brought
+ * together by swaps, which are undone afterwards.
+ * Each bond the gate changes is truncated to the largest singular values
+ * allowed by `mps_create`, and the state renormalized.
+ * Return 0 on success, -1 on failure.
+ */
+int mps_apply_2q(Mps *mps, Matrix *gate, size_t high, size_t low);
+
+/**
+ * Create the state of `qubits` qubits, all 0.
+ * Bonds keep at most `max_bond` singular values (no limit if 0), and drop
+ * the smallest as long as the weight dropped stays within `threshold` of the
+ * total.
+ * Return NULL on failure.
+ */
+Mps *mps_create(size_t qubits, size_t max_bond, double threshold);
+
+/**
+ * Destroy an Mps.
+ */
+void mps_destroy(Mps *mps);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "statevector.h"
+#include "threadpool.h"
+#include <stdlib.h>
+
+/* an alias table over the basis states of a StateVector, built once, from
+ * which each measurement shot is drawn in constant time */
+typedef struct Sampler Sampler;
+
+/* shots drawn from each random stream: shot `i` always comes from stream
+ * `i` / `SAMPLER_BLOCK`, so results do not depend on the thread count */
+#define SAMPLER_BLOCK 65536
+
+/**
+ * Get the number of basis states sampled from (2 ^ qubits).
+ */
+size_t sampler_size(Sampler *sampler);
+
+/**
+ * Draw `shots` measurements of every qubit, storing the basis state of shot
+ * `i` in `results[i]`.
+ * The same `seed` always draws the same shots, however many threads `pool`
+ * has; `pool` may be NULL to run serially.
+ */
+void sampler_sample(Sampler *sampler, size_t *results, size_t shots,
+                    unsigned long seed, ThreadPool *pool);
+
+/**
+ * Draw `shots` measurements as `sampler_sample` does, but only count how many
+ * land on each basis state, in the `sampler_size(sampler)` entries of
+ * `counts`.
+ * Return 0 on success, -1 on failure.
+ */
+int sampler_histogram(Sampler *sampler, size_t *counts, size_t shots,
+                      unsigned long seed, ThreadPool *pool);
+
+/**
+ * Create a sampler of the measurement outcomes of `state`, which need not be
+ * normalized.
+ * Return NULL on failure.
+ */
+Sampler *sampler_create(StateVector *state);
+
+/**
+ * Destroy a Sampler.
+ */
+void sampler_destroy(Sampler *sampler);
+
+#endif
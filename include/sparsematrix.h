@@ -0,0 +1,108 @@
+#ifndef SPARSEMATRIX_H
+#define SPARSEMATRIX_H
+
+#include "mat_t.h"
+#include "matrix.h"
+#include "threadpool.h"
+#include <stdlib.h>
+
+/* compressed sparse rows; immutable once created */
+typedef struct SparseMatrix SparseMatrix;
+
+/* unordered (row, column, value) entries to build a SparseMatrix from */
+typedef struct SparseMatrixBuilder SparseMatrixBuilder;
+
+/**
+ * Add `value` at `row`, `column` (1-indexed) of the matrix being built.
+ * Values added at the same position are summed.
+ * Return 0 on success, -1 on failure.
+ */
+int sparsematrixbuilder_add(SparseMatrixBuilder *builder, size_t row,
+                            size_t column, mat_t value);
+
+/**
+ * Get the number of entries added to the builder so far.
+ */
+size_t sparsematrixbuilder_entries(SparseMatrixBuilder *builder);
+
+/**
+ * Create a builder for a `height` x `width` sparse matrix, with room for
+ * `capacity` entries before it has to grow.
+ * Return NULL on failure.
+ */
+SparseMatrixBuilder *sparsematrixbuilder_create(size_t height, size_t width,
+                                                size_t capacity);
+
+/**
+ * Destroy a builder.
+ */
+void sparsematrixbuilder_destroy(SparseMatrixBuilder *builder);
+
+/**
+ * Get the number of rows in the matrix.
+ */
+size_t sparsematrix_height(SparseMatrix *sparse);
+
+/**
+ * Get the number of columns in the matrix.
+ */
+size_t sparsematrix_width(SparseMatrix *sparse);
+
+/**
+ * Get the number of stored values in the matrix.
+ */
+size_t sparsematrix_nonzeros(SparseMatrix *sparse);
+
+/**
+ * Get the value at `row`, `column` (1-indexed) of the matrix.
+ */
+mat_t sparsematrix_get(SparseMatrix *sparse, size_t row, size_t column);
+
+/**
+ * Set `y` to the matrix times `x`.
+ * `x` must hold `sparsematrix_width(sparse)` values and `y`
+ * `sparsematrix_height(sparse)`, and they must not overlap.
+ */
+void sparsematrix_multiply_vector(SparseMatrix *sparse, const mat_t *x,
+                                  mat_t *y);
+
+/**
+ * Set `y` to the matrix times `x`, splitting the rows between the threads
+ * of `pool` (serially if `pool` is NULL).
+ * `x` must hold `sparsematrix_width(sparse)` values and `y`
+ * `sparsematrix_height(sparse)`, and they must not overlap.
+ */
+void sparsematrix_multiply_vector_parallel(SparseMatrix *sparse,
+                                           const mat_t *x, mat_t *y,
+                                           ThreadPool *pool);
+
+/**
+ * Set the dense `dest` to the sparse `a` times the dense `b`.
+ */
+void sparsematrix_multiply_dense(Matrix *dest, SparseMatrix *a, Matrix *b);
+
+/**
+ * Create a dense copy of the matrix.
+ * Return NULL on failure.
+ */
+Matrix *sparsematrix_to_dense(SparseMatrix *sparse);
+
+/**
+ * Create a sparse matrix from the entries of `builder`, which is left
+ * unchanged.
+ * Return NULL on failure.
+ */
+SparseMatrix *sparsematrix_create(SparseMatrixBuilder *builder);
+
+/**
+ * Create a sparse copy of the nonzero values of the dense `matrix`.
+ * Return NULL on failure.
+ */
+SparseMatrix *sparsematrix_create_from_dense(Matrix *matrix);
+
+/**
+ * Destroy a sparse matrix.
+ */
+void sparsematrix_destroy(SparseMatrix *sparse);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef STATEVECTOR_H
+#define STATEVECTOR_H
+
+#include "mat_t.h"
+#include "matrix.h"
+#include "threadpool.h"
+#include <stdlib.h>
+
+typedef struct StateVector StateVector;
+
+/* most qubits a single `statevector_apply_kq` gate may act on */
+#define STATEVECTOR_GATE_QUBITS 6
+
+/**
+ * Get the number of qubits in the state.
+ */
+size_t statevector_qubits(StateVector *state);
+
+/**
+ * Get the number of amplitudes in the state (2 ^ qubits).
+ */
+size_t statevector_size(StateVector *state);
+
+/**
+ * Set the amplitude of basis state `index` to `value`.
+ * Basis states are 0-indexed, and bit `k` of `index` is the value of qubit
+ * `k`.
+ */
+void statevector_set(StateVector *state, size_t index, mat_t value);
+
+/**
+ * Get the amplitude of basis state `index`.
+ * Basis states are 0-indexed, and bit `k` of `index` is the value of qubit
+ * `k`.
+ */
+mat_t statevector_get(StateVector *state, size_t index);
+
+/**
+ * Apply the 2x2 `gate` to qubit `target` in place.
+ */
+void statevector_apply_1q(StateVector *state, Matrix *gate, size_t target);
+
+/**
+ * Apply the 2x2 `gate` to qubit `target` in place, on the amplitudes where
+ * qubit `control` is 1.
+ */
+void statevector_apply_controlled_1q(StateVector *state, Matrix *gate,
+                                     size_t control, size_t target);
+
+/**
+ * Apply the 4x4 `gate` to qubits `high` and `low` in place.
+ * Rows and columns of `gate` are indexed by 2 * (qubit `high`) + (qubit
+ * `low`).
+ */
+void statevector_apply_2q(StateVector *state, Matrix *gate, size_t high,
+                          size_t low);
+
+/**
+ * Apply the 4x4 `gate` to qubits `high` and `low` in place, on the amplitudes
+ * where qubit `control` is 1.
+ * Rows and columns of `gate` are indexed by 2 * (qubit `high`) + (qubit
+ * `low`).
+ */
+void statevector_apply_controlled_2q(StateVector *state, Matrix *gate,
+                                     size_t control, size_t high, size_t low);
+
+/**
+ * Apply the 2^`count` x 2^`count` `gate` to the `count` distinct `qubits` in
+ * place, in one pass over the state.
+ * Rows and columns of `gate` are indexed by the values of `qubits` read as a
+ * binary number, `qubits[0]` being the most significant bit, so
+ * `statevector_apply_2q(state, gate, high, low)` is this with `qubits` =
+ * {`high`, `low`}.
+ * `count` must be at most `STATEVECTOR_GATE_QUBITS`.
+ */
+void statevector_apply_kq(StateVector *state, Matrix *gate,
+                          const size_t *qubits, size_t count);
+
+/**
+ * Get the norm of the state.
+ */
+double statevector_norm(StateVector *state);
+
+/**
+ * Get the expectation value of the 2x2 `observable` on qubit `target`.
+ */
+mat_t statevector_expectation_1q(StateVector *state, Matrix *observable,
+                                 size_t target);
+
+/**
+ * Write the amplitudes to the file at `path` as a 2^qubits x 1 matrix, in the
+ * format of `matrix_save`.
+ * Return 0 on success, -1 on failure.
+ */
+int statevector_save(StateVector *state, const char *path);
+
+/**
+ * Create a state of `qubits` qubits, all 0.
+ * Return NULL on failure.
+ */
+StateVector *statevector_create(size_t qubits);
+
+/**
+ * Create a state of `qubits` qubits, all 0, whose operations are split across
+ * the workers of `pool`.
+ * The amplitudes are first touched by the workers that later update them, so
+ * on NUMA machines each block lands in memory local to its worker.
+ * `pool` must outlive the state, and may be NULL to run serially.
+ * Return NULL on failure.
+ */
+StateVector *statevector_create_parallel(size_t qubits, ThreadPool *pool);
+
+/**
+ * Create a state from the file at `path` written by `statevector_save`, or
+ * any 2^n x 1 matrix file, reading straight into the amplitudes. `pool` is as
+ * in `statevector_create_parallel`.
+ * Return NULL on failure.
+ */
+StateVector *statevector_load(const char *path, ThreadPool *pool);
+
+/**
+ * Destroy the StateVector.
+ */
+void statevector_destroy(StateVector *state);
+
+#endif
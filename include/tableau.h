@@ -0,0 +1,65 @@
+#ifndef TABLEAU_H
+#define TABLEAU_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* a stabilizer state as an Aaronson-Gottesman tableau, for Clifford circuits
+ * on thousands of qubits */
+typedef struct Tableau Tableau;
+
+/**
+ * Apply a Hadamard gate to `qubit`.
+ */
+void tableau_h(Tableau *tableau, size_t qubit);
+
+/**
+ * Apply a phase gate (diag(1, i)) to `qubit`.
+ */
+void tableau_s(Tableau *tableau, size_t qubit);
+
+/**
+ * Apply a controlled-NOT gate from `control` to `target`.
+ */
+void tableau_cnot(Tableau *tableau, size_t control, size_t target);
+
+/**
+ * Apply a Pauli X gate to `qubit`.
+ */
+void tableau_x(Tableau *tableau, size_t qubit);
+
+/**
+ * Apply a Pauli Y gate to `qubit`.
+ */
+void tableau_y(Tableau *tableau, size_t qubit);
+
+/**
+ * Apply a Pauli Z gate to `qubit`.
+ */
+void tableau_z(Tableau *tableau, size_t qubit);
+
+/**
+ * Measure `qubit` in the computational basis, collapsing the state.
+ * If `deterministic` is not NULL, set it to whether the outcome was certain.
+ * Return the outcome, 0 or 1.
+ */
+int tableau_measure(Tableau *tableau, size_t qubit, bool *deterministic);
+
+/**
+ * Get the number of qubits in the state.
+ */
+size_t tableau_qubits(Tableau *tableau);
+
+/**
+ * Create the state of `qubits` qubits, all 0, drawing random measurement
+ * outcomes from a generator seeded with `seed`.
+ * Return NULL on failure.
+ */
+Tableau *tableau_create(size_t qubits, unsigned long seed);
+
+/**
+ * Destroy a tableau.
+ */
+void tableau_destroy(Tableau *tableau);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stdlib.h>
+
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * Work run by `threadpool_parallel_for` on the indices [`begin`, `end`).
+ * `worker` is in [0, `threadpool_threads(pool)`), and each worker runs at most
+ * one range per call.
+ */
+typedef void (*ThreadPoolTask)(void *context, size_t worker, size_t begin,
+                               size_t end);
+
+/**
+ * Get the number of threads work is split across, including the caller.
+ */
+size_t threadpool_threads(ThreadPool *pool);
+
+/**
+ * Split [0, `count`) into one contiguous range per thread, with boundaries on
+ * multiples of `grain`, and run `task` on each range in parallel.
+ * The caller runs the first range, and returns once every range is done.
+ * A given `count` and `grain` always produce the same split, so data first
+ * touched by one call stays local to the worker that touches it in the next.
+ * `pool` may be NULL, in which case `task` runs on the caller as worker 0.
+ * Must not be called from within a task.
+ */
+void threadpool_parallel_for(ThreadPool *pool, size_t count, size_t grain,
+                             ThreadPoolTask task, void *context);
+
+/**
+ * Create a pool of `threads` threads, counting the caller.
+ * `threads` of 0 uses one thread per online processor.
+ * Return NULL on failure.
+ */
+ThreadPool *threadpool_create(size_t threads);
+
+/**
+ * Stop and join the workers, and destroy the ThreadPool.
+ */
+void threadpool_destroy(ThreadPool *pool);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdlib.h>
+
+/* send `send_bytes` bytes from `send` to rank `peer` while receiving
+ * `receive_bytes` bytes from it into `receive`, either of which may be 0;
+ * both ranks call it with matching sizes
+ * Return 0 on success, -1 on failure. */
+typedef int (*TransportExchange)(void *context, size_t peer, const void *send,
+                                 size_t send_bytes, void *receive,
+                                 size_t receive_bytes);
+
+/* the ranks of a distributed computation and how this one reaches the
+ * others: forked local processes, or a caller's MPI-like exchange */
+typedef struct Transport Transport;
+
+/**
+ * Get this process's rank, from 0.
+ */
+size_t transport_rank(Transport *transport);
+
+/**
+ * Get the number of ranks.
+ */
+size_t transport_ranks(Transport *transport);
+
+/**
+ * Exchange bytes with rank `peer`, as a TransportExchange.
+ * Return 0 on success, -1 on failure.
+ */
+int transport_exchange(Transport *transport, size_t peer, const void *send,
+                       size_t send_bytes, void *receive,
+                       size_t receive_bytes);
+
+/**
+ * Get the bytes this rank has sent through the transport.
+ */
+size_t transport_bytes_sent(Transport *transport);
+
+/**
+ * Create the transport of rank `rank` of `ranks`, which exchanges through
+ * `exchange` with `context`. The context is not owned.
+ * Return NULL on failure.
+ */
+Transport *transport_create(size_t rank, size_t ranks,
+                            TransportExchange exchange, void *context);
+
+/**
+ * Fork `ranks` - 1 processes, connected to this one and each other by Unix
+ * sockets, and return each its transport; this process is rank 0.
+ * Forked ranks hold one thread, so this must be called before creating a
+ * ThreadPool, and they should `_exit` once done rather than return.
+ * Return NULL on failure, in this process only.
+ */
+Transport *transport_create_local(size_t ranks);
+
+/**
+ * Destroy a Transport, closing its sockets; rank 0 of a local transport
+ * also waits for the other ranks to exit.
+ */
+void transport_destroy(Transport *transport);
+
+#endif
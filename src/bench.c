@@ -0,0 +1,1018 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench_internal.h"
+#include "circuit.h"
+#include "densitymatrix.h"
+#include "mat_t.h"
+#include "matrix.h"
+#include "matrixarena.h"
+#include "mps.h"
+#include "sampler.h"
+#include "statevector.h"
+#include "tableau.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* real floating point operations in one multiply-add of mat_t values */
+#ifdef MAT_T_COMPLEX
+#define BENCH_FMA_FLOPS 8.0
+#define BENCH_MAT_T_NAME "complex"
+#else
+#define BENCH_FMA_FLOPS 2.0
+#define BENCH_MAT_T_NAME "real"
+#endif
+
+/* a case is run this many times in a row per timing, doubling until one
+ * timing takes at least `BENCH_MIN_SECONDS` */
+#define BENCH_MIN_SECONDS 0.01
+#define BENCH_MAX_ITERATIONS (1UL << 24)
+
+/**
+ * Output formats of the suite.
+ */
+typedef enum BenchFormat { BENCH_TEXT, BENCH_CSV, BENCH_JSON } BenchFormat;
+
+/**
+ * Operands of a benchmark case at one size, built by its setup. Whatever the
+ * setup leaves NULL is unused, and everything else is destroyed after.
+ */
+typedef struct BenchData {
+    size_t n;
+    Matrix *a;
+    Matrix *b;
+    Matrix *c;
+    mat_t *buffer;
+    double *values;
+    MatrixArena *arena;
+    StateVector *state;
+    Circuit *circuit;
+    Tableau *tableau;
+    DensityMatrix *rho;
+    Mps *mps;
+    Sampler *sampler;
+    size_t *counts;
+    /* results stored so the work that makes them is not optimized out */
+    mat_t sink;
+} BenchData;
+
+/**
+ * An operation timed at each of a list of sizes. To cover a new path, write
+ * a setup and a run and add a row to `bench_cases`.
+ */
+typedef struct BenchCase {
+    const char *name;
+    /* sizes to run at, ending in 0, and the largest run unless the command
+     * line sets another */
+    const size_t *sizes;
+    size_t max_size;
+    /* build the operands for size `n`; return 0 on success, -1 on failure */
+    int (*setup)(BenchData *data, size_t n);
+    /* the operation timed */
+    void (*run)(BenchData *data);
+    /* real floating point operations in one run, or NULL if not fixed */
+    double (*flops)(size_t n);
+} BenchCase;
+
+/**
+ * Timings of one case at one size.
+ */
+typedef struct BenchResult {
+    size_t iterations;
+    size_t repeats;
+    double mean_ns;
+    double stddev_ns;
+    double min_ns;
+    /* negative for cases that do not count their operations */
+    double gflops;
+    double bytes;
+} BenchResult;
+
+/* bytes requested from the allocator since the start, counted by wrapping
+ * malloc, calloc and realloc at link time */
+static size_t bench_allocated = 0;
+static pthread_mutex_t bench_allocated_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *pointer, size_t size);
+
+/**
+ * Add `bytes` to the bytes allocated.
+ */
+static void bench_count_allocation(size_t bytes);
+
+/**
+ * Get the bytes allocated so far.
+ */
+static size_t bench_allocated_bytes(void);
+
+/**
+ * Set up only the size.
+ */
+static int bench_setup_size(BenchData *data, size_t n);
+
+/**
+ * Set up a random `n` x `n` `a`.
+ */
+static int bench_setup_square(BenchData *data, size_t n);
+
+/**
+ * Set up an `n` x `n` identity `a`, which a scan for off-diagonal values
+ * reads in full.
+ */
+static int bench_setup_identity(BenchData *data, size_t n);
+
+/**
+ * Set up a random `n` x `n` `a` and a copy of its values in `buffer`.
+ */
+static int bench_setup_buffer(BenchData *data, size_t n);
+
+/**
+ * Set up random `n` x `n` `a` and `b`, and an `n` x `n` `c` for results.
+ */
+static int bench_setup_product(BenchData *data, size_t n);
+
+/**
+ * Set up a random `n` x `n` `a`, a 2 x 2 `b`, and a 2`n` x 2`n` `c` for
+ * their Kronecker product.
+ */
+static int bench_setup_kron(BenchData *data, size_t n);
+
+/**
+ * Set up a random `n` x `n` `a`, `n` x `n` `b` and `c` for its factors, and
+ * `n` `values`.
+ */
+static int bench_setup_factor(BenchData *data, size_t n);
+
+/**
+ * Set up a random `n` x `n` `a` and an `arena` with room to work on it.
+ */
+static int bench_setup_arena(BenchData *data, size_t n);
+
+/**
+ * Set up an `n` qubit `state`, a 2 x 2 unitary `a` and a 4 x 4 CNOT `b`.
+ */
+static int bench_setup_state(BenchData *data, size_t n);
+
+/**
+ * Set up an `n` qubit `state` and a `circuit` of 4 layers of rotations and
+ * CNOTs, compiled with the default fusion.
+ */
+static int bench_setup_circuit(BenchData *data, size_t n);
+
+/**
+ * Set up an `n` qubit `tableau`.
+ */
+static int bench_setup_tableau(BenchData *data, size_t n);
+
+/**
+ * Set up an `n` qubit `rho` and a 2 x 2 unitary `a`.
+ */
+static int bench_setup_densitymatrix(BenchData *data, size_t n);
+
+/**
+ * Set up an `n` qubit `mps` with bonds capped at 16, entangled by a few
+ * layers of gates, a 2 x 2 unitary `a` and a 4 x 4 CNOT `b`.
+ */
+static int bench_setup_mps(BenchData *data, size_t n);
+
+/**
+ * Set up a `sampler` of an `n` qubit state and `counts` for its histogram.
+ */
+static int bench_setup_sampler(BenchData *data, size_t n);
+
+/**
+ * Set `gate` to the rotation by `angle` and `cnot` to a CNOT.
+ */
+static void bench_gates(Matrix *gate, Matrix *cnot, double angle);
+
+/**
+ * Destroy whatever a setup built.
+ */
+static void bench_teardown(BenchData *data);
+
+/**
+ * Create and destroy an `n` x `n` matrix.
+ */
+static void bench_run_create(BenchData *data);
+
+/**
+ * Create an `n` x `n` matrix in `arena`, and reset it.
+ */
+static void bench_run_create_in(BenchData *data);
+
+/**
+ * Clone `a` and destroy the clone.
+ */
+static void bench_run_clone(BenchData *data);
+
+/**
+ * Create and destroy a view of the top left quarter of `a`.
+ */
+static void bench_run_create_view(BenchData *data);
+
+/**
+ * Read every value of `a` with `matrix_get`.
+ */
+static void bench_run_get(BenchData *data);
+
+/**
+ * Write every value of `a` with `matrix_set`.
+ */
+static void bench_run_set(BenchData *data);
+
+/**
+ * Copy `a` into `buffer`.
+ */
+static void bench_run_copy_to_buffer(BenchData *data);
+
+/**
+ * Copy `buffer` into `a`.
+ */
+static void bench_run_copy_from_buffer(BenchData *data);
+
+/**
+ * Check whether `a` is diagonal.
+ */
+static void bench_run_is_diagonal(BenchData *data);
+
+/**
+ * Multiply `a` by `b` into `c`.
+ */
+static void bench_run_multiply(BenchData *data);
+
+/**
+ * Add `a` times `b` to `c`.
+ */
+static void bench_run_multiply_accumulate(BenchData *data);
+
+/**
+ * Set `c` to the Kronecker product of `a` and `b`.
+ */
+static void bench_run_kron(BenchData *data);
+
+/**
+ * Exponentiate `a` into `c`.
+ */
+static void bench_run_exponential(BenchData *data);
+
+/**
+ * Take the determinant of `a`.
+ */
+static void bench_run_determinant(BenchData *data);
+
+/**
+ * Take the determinant of `a` with scratch memory from `arena`.
+ */
+static void bench_run_determinant_in(BenchData *data);
+
+/**
+ * Restore `a` from `buffer` and diagonalize it.
+ */
+static void bench_run_diagonalize(BenchData *data);
+
+/**
+ * Factor `a` into Q `b` and R `c`.
+ */
+static void bench_run_qr(BenchData *data);
+
+/**
+ * Factor `a` into U `b`, `values` and V `c`.
+ */
+static void bench_run_svd(BenchData *data);
+
+/**
+ * Apply `a` to the middle qubit of `state`.
+ */
+static void bench_run_apply_1q(BenchData *data);
+
+/**
+ * Apply `b` to the two middle qubits of `state`.
+ */
+static void bench_run_apply_2q(BenchData *data);
+
+/**
+ * Run `circuit` on `state`.
+ */
+static void bench_run_circuit(BenchData *data);
+
+/**
+ * Apply 1000 pseudo-random H, S and CNOT gates to `tableau`.
+ */
+static void bench_run_tableau(BenchData *data);
+
+/**
+ * Apply `a` to the middle qubit of `rho`.
+ */
+static void bench_run_densitymatrix(BenchData *data);
+
+/**
+ * Apply `a` to every qubit of `mps` and `b` across every bond.
+ */
+static void bench_run_mps(BenchData *data);
+
+/**
+ * Draw a histogram of 100000 shots from `sampler`.
+ */
+static void bench_run_sampler(BenchData *data);
+
+/**
+ * Floating point operations of an `n` x `n` matrix product.
+ */
+static double bench_flops_multiply(size_t n);
+
+/**
+ * Floating point operations of LU eliminating an `n` x `n` matrix.
+ */
+static double bench_flops_determinant(size_t n);
+
+/**
+ * Floating point operations of a Householder Q R of an `n` x `n` matrix,
+ * forming Q.
+ */
+static double bench_flops_qr(size_t n);
+
+/**
+ * Floating point operations of a one-qubit gate on `n` qubits.
+ */
+static double bench_flops_apply_1q(size_t n);
+
+/**
+ * Floating point operations of a two-qubit gate on `n` qubits.
+ */
+static double bench_flops_apply_2q(size_t n);
+
+/**
+ * Floating point operations of a one-qubit gate on an `n` qubit density
+ * matrix.
+ */
+static double bench_flops_densitymatrix(size_t n);
+
+/**
+ * Time `bench_case` at size `n`, `repeats` times, into `result`.
+ * Return 0 on success, -1 if its setup failed.
+ */
+static int bench_measure(const BenchCase *bench_case, size_t n,
+                         size_t repeats, BenchResult *result);
+
+/**
+ * Print `result` of `bench_case` at size `n` in `format`; `first` is whether
+ * it is the first result printed.
+ */
+static void bench_print(BenchFormat format, const BenchCase *bench_case,
+                        size_t n, const BenchResult *result, bool first);
+
+/**
+ * Print how to run the suite to stderr.
+ */
+static void bench_usage(const char *program);
+
+static const size_t bench_matrix_sizes[] = {4, 16, 64, 256, 1024, 4096, 0};
+static const size_t bench_qubit_sizes[] = {10, 14, 18, 22, 0};
+static const size_t bench_density_sizes[] = {4, 6, 8, 10, 0};
+static const size_t bench_chain_sizes[] = {10, 30, 100, 0};
+static const size_t bench_tableau_sizes[] = {100, 1000, 5000, 0};
+static const size_t bench_sampler_sizes[] = {10, 16, 20, 0};
+
+/* every operation the suite times; cubic ones stop at smaller sizes by
+ * default */
+static const BenchCase bench_cases[] = {
+    {"matrix_create", bench_matrix_sizes, 4096, bench_setup_size,
+     bench_run_create, NULL},
+    {"matrix_create_in", bench_matrix_sizes, 4096, bench_setup_arena,
+     bench_run_create_in, NULL},
+    {"matrix_clone", bench_matrix_sizes, 4096, bench_setup_square,
+     bench_run_clone, NULL},
+    {"matrix_create_view", bench_matrix_sizes, 4096, bench_setup_square,
+     bench_run_create_view, NULL},
+    {"matrix_get", bench_matrix_sizes, 4096, bench_setup_square,
+     bench_run_get, NULL},
+    {"matrix_set", bench_matrix_sizes, 4096, bench_setup_square,
+     bench_run_set, NULL},
+    {"matrix_copy_to_buffer", bench_matrix_sizes, 4096, bench_setup_buffer,
+     bench_run_copy_to_buffer, NULL},
+    {"matrix_copy_from_buffer", bench_matrix_sizes, 4096, bench_setup_buffer,
+     bench_run_copy_from_buffer, NULL},
+    {"matrix_is_diagonal", bench_matrix_sizes, 4096, bench_setup_identity,
+     bench_run_is_diagonal, NULL},
+    {"matrix_multiply", bench_matrix_sizes, 1024, bench_setup_product,
+     bench_run_multiply, bench_flops_multiply},
+    {"matrix_multiply_accumulate", bench_matrix_sizes, 1024,
+     bench_setup_product, bench_run_multiply_accumulate, bench_flops_multiply},
+    {"matrix_kron", bench_matrix_sizes, 1024, bench_setup_kron,
+     bench_run_kron, NULL},
+    {"matrix_exponential", bench_matrix_sizes, 256, bench_setup_product,
+     bench_run_exponential, NULL},
+    {"matrix_determinant", bench_matrix_sizes, 1024, bench_setup_square,
+     bench_run_determinant, bench_flops_determinant},
+    {"matrix_determinant_in", bench_matrix_sizes, 64, bench_setup_arena,
+     bench_run_determinant_in, bench_flops_determinant},
+    {"matrix_diagonalize", bench_matrix_sizes, 256, bench_setup_buffer,
+     bench_run_diagonalize, NULL},
+    {"matrix_qr", bench_matrix_sizes, 1024, bench_setup_factor, bench_run_qr,
+     bench_flops_qr},
+    {"matrix_svd", bench_matrix_sizes, 256, bench_setup_factor,
+     bench_run_svd, NULL},
+    {"statevector_apply_1q", bench_qubit_sizes, 22, bench_setup_state,
+     bench_run_apply_1q, bench_flops_apply_1q},
+    {"statevector_apply_2q", bench_qubit_sizes, 22, bench_setup_state,
+     bench_run_apply_2q, bench_flops_apply_2q},
+    {"circuit_run", bench_qubit_sizes, 22, bench_setup_circuit,
+     bench_run_circuit, NULL},
+    {"tableau_gates", bench_tableau_sizes, 5000, bench_setup_tableau,
+     bench_run_tableau, NULL},
+    {"densitymatrix_apply_1q", bench_density_sizes, 10,
+     bench_setup_densitymatrix, bench_run_densitymatrix,
+     bench_flops_densitymatrix},
+    {"mps_apply_2q", bench_chain_sizes, 100, bench_setup_mps, bench_run_mps,
+     NULL},
+    {"sampler_histogram", bench_sampler_sizes, 20, bench_setup_sampler,
+     bench_run_sampler, NULL}};
+
+void *__wrap_malloc(size_t size) {
+    bench_count_allocation(size);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    bench_count_allocation(count * size);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+    bench_count_allocation(size);
+    return __real_realloc(pointer, size);
+}
+
+static void bench_count_allocation(size_t bytes) {
+    pthread_mutex_lock(&bench_allocated_mutex);
+    bench_allocated += bytes;
+    pthread_mutex_unlock(&bench_allocated_mutex);
+}
+
+static size_t bench_allocated_bytes(void) {
+    size_t bytes;
+
+    pthread_mutex_lock(&bench_allocated_mutex);
+    bytes = bench_allocated;
+    pthread_mutex_unlock(&bench_allocated_mutex);
+    return bytes;
+}
+
+double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void bench_fill(Matrix *matrix, unsigned long seed) {
+    size_t i, j;
+    for (i = 1; i <= matrix_height(matrix); i++) {
+        for (j = 1; j <= matrix_width(matrix); j++) {
+            seed = seed * 1103515245UL + 12345UL;
+            matrix_set(matrix, i, j,
+                       MAT_T((double)((seed >> 16) & 0x7fff) / 16384.0 - 1.0));
+        }
+    }
+}
+
+static int bench_setup_size(BenchData *data, size_t n) {
+    data->n = n;
+    return 0;
+}
+
+static int bench_setup_square(BenchData *data, size_t n) {
+    data->n = n;
+    data->a = matrix_create(n, n);
+    if (data->a == NULL)
+        return -1;
+    bench_fill(data->a, 1);
+    return 0;
+}
+
+static int bench_setup_identity(BenchData *data, size_t n) {
+    data->n = n;
+    data->a = matrix_create_identity(n);
+    return data->a == NULL ? -1 : 0;
+}
+
+static int bench_setup_buffer(BenchData *data, size_t n) {
+    if (bench_setup_square(data, n) != 0)
+        return -1;
+    data->buffer = malloc(n * n * sizeof(mat_t));
+    if (data->buffer == NULL)
+        return -1;
+    matrix_copy_to_buffer(data->a, data->buffer);
+    return 0;
+}
+
+static int bench_setup_product(BenchData *data, size_t n) {
+    if (bench_setup_square(data, n) != 0)
+        return -1;
+    data->b = matrix_create(n, n);
+    data->c = matrix_create(n, n);
+    if (data->b == NULL || data->c == NULL)
+        return -1;
+    bench_fill(data->b, 2);
+    return 0;
+}
+
+static int bench_setup_kron(BenchData *data, size_t n) {
+    if (bench_setup_square(data, n) != 0)
+        return -1;
+    data->b = matrix_create(2, 2);
+    data->c = matrix_create(2 * n, 2 * n);
+    if (data->b == NULL || data->c == NULL)
+        return -1;
+    bench_fill(data->b, 2);
+    return 0;
+}
+
+static int bench_setup_factor(BenchData *data, size_t n) {
+    if (bench_setup_product(data, n) != 0)
+        return -1;
+    data->values = malloc(n * sizeof(double));
+    return data->values == NULL ? -1 : 0;
+}
+
+static int bench_setup_arena(BenchData *data, size_t n) {
+    if (bench_setup_square(data, n) != 0)
+        return -1;
+    /* room for a copy of the matrix and its headers, twice over */
+    data->arena = matrixarena_create(2 * n * n * sizeof(mat_t) + 4096);
+    return data->arena == NULL ? -1 : 0;
+}
+
+static void bench_gates(Matrix *gate, Matrix *cnot, double angle) {
+    matrix_set(gate, 1, 1, MAT_T(cos(angle)));
+    matrix_set(gate, 1, 2, MAT_T(-sin(angle)));
+    matrix_set(gate, 2, 1, MAT_T(sin(angle)));
+    matrix_set(gate, 2, 2, MAT_T(cos(angle)));
+    matrix_set(cnot, 1, 1, MAT_T_1);
+    matrix_set(cnot, 2, 2, MAT_T_1);
+    matrix_set(cnot, 3, 4, MAT_T_1);
+    matrix_set(cnot, 4, 3, MAT_T_1);
+}
+
+static int bench_setup_state(BenchData *data, size_t n) {
+    data->n = n;
+    data->state = statevector_create(n);
+    data->a = matrix_create(2, 2);
+    data->b = matrix_create(4, 4);
+    if (data->state == NULL || data->a == NULL || data->b == NULL)
+        return -1;
+    bench_gates(data->a, data->b, 0.3);
+    return 0;
+}
+
+static int bench_setup_circuit(BenchData *data, size_t n) {
+    size_t layer, i;
+
+    if (bench_setup_state(data, n) != 0)
+        return -1;
+    data->circuit = circuit_create(n);
+    if (data->circuit == NULL)
+        return -1;
+    for (layer = 0; layer < 4; layer++) {
+        for (i = 0; i < n; i++) {
+            if (circuit_add_1q(data->circuit, data->a, i) != 0)
+                return -1;
+        }
+        for (i = layer % 2; i + 1 < n; i += 2) {
+            if (circuit_add_2q(data->circuit, data->b, i, i + 1) != 0)
+                return -1;
+        }
+    }
+    return circuit_compile(data->circuit, 0);
+}
+
+static int bench_setup_tableau(BenchData *data, size_t n) {
+    data->n = n;
+    data->tableau = tableau_create(n, 1);
+    return data->tableau == NULL ? -1 : 0;
+}
+
+static int bench_setup_densitymatrix(BenchData *data, size_t n) {
+    data->n = n;
+    data->rho = densitymatrix_create(n);
+    data->a = matrix_create(2, 2);
+    data->b = matrix_create(4, 4);
+    if (data->rho == NULL || data->a == NULL || data->b == NULL)
+        return -1;
+    bench_gates(data->a, data->b, 0.3);
+    return 0;
+}
+
+static int bench_setup_mps(BenchData *data, size_t n) {
+    size_t layer;
+
+    data->n = n;
+    data->mps = mps_create(n, 16, 0);
+    data->a = matrix_create(2, 2);
+    data->b = matrix_create(4, 4);
+    if (data->mps == NULL || data->a == NULL || data->b == NULL)
+        return -1;
+    bench_gates(data->a, data->b, 0.3);
+    for (layer = 0; layer < 4; layer++) {
+        bench_run_mps(data);
+    }
+    return 0;
+}
+
+static int bench_setup_sampler(BenchData *data, size_t n) {
+    size_t i;
+
+    if (bench_setup_state(data, n) != 0)
+        return -1;
+    for (i = 0; i < n; i++) {
+        statevector_apply_1q(data->state, data->a, i);
+    }
+    data->sampler = sampler_create(data->state);
+    data->counts = malloc(((size_t)1 << n) * sizeof(size_t));
+    return data->sampler == NULL || data->counts == NULL ? -1 : 0;
+}
+
+static void bench_teardown(BenchData *data) {
+    matrix_destroy(data->a);
+    matrix_destroy(data->b);
+    matrix_destroy(data->c);
+    free(data->buffer);
+    free(data->values);
+    matrixarena_destroy(data->arena);
+    statevector_destroy(data->state);
+    circuit_destroy(data->circuit);
+    tableau_destroy(data->tableau);
+    densitymatrix_destroy(data->rho);
+    mps_destroy(data->mps);
+    sampler_destroy(data->sampler);
+    free(data->counts);
+}
+
+static void bench_run_create(BenchData *data) {
+    matrix_destroy(matrix_create(data->n, data->n));
+}
+
+static void bench_run_create_in(BenchData *data) {
+    matrix_create_in(data->arena, data->n, data->n);
+    matrixarena_reset(data->arena);
+}
+
+static void bench_run_clone(BenchData *data) {
+    matrix_destroy(matrix_clone(data->a));
+}
+
+static void bench_run_create_view(BenchData *data) {
+    matrix_destroy(
+        matrix_create_view(data->a, 1, 1, data->n / 2, data->n / 2));
+}
+
+static void bench_run_get(BenchData *data) {
+    mat_t sum = MAT_T_0;
+    size_t i, j;
+
+    for (i = 1; i <= data->n; i++) {
+        for (j = 1; j <= data->n; j++) {
+            sum = MAT_T_ADD(sum, matrix_get(data->a, i, j));
+        }
+    }
+    data->sink = sum;
+}
+
+static void bench_run_set(BenchData *data) {
+    size_t i, j;
+
+    for (i = 1; i <= data->n; i++) {
+        for (j = 1; j <= data->n; j++) {
+            matrix_set(data->a, i, j, data->sink);
+        }
+    }
+}
+
+static void bench_run_copy_to_buffer(BenchData *data) {
+    matrix_copy_to_buffer(data->a, data->buffer);
+}
+
+static void bench_run_copy_from_buffer(BenchData *data) {
+    matrix_copy_from_buffer(data->a, data->buffer);
+}
+
+static void bench_run_is_diagonal(BenchData *data) {
+    data->sink = matrix_is_diagonal(data->a) ? MAT_T_1 : MAT_T_0;
+}
+
+static void bench_run_multiply(BenchData *data) {
+    matrix_multiply(data->c, data->a, data->b);
+}
+
+static void bench_run_multiply_accumulate(BenchData *data) {
+    matrix_multiply_accumulate(data->c, MAT_T_1, data->a, data->b);
+}
+
+static void bench_run_kron(BenchData *data) {
+    matrix_kron(data->c, data->a, data->b);
+}
+
+static void bench_run_exponential(BenchData *data) {
+    matrix_exponential(data->c, data->a, MAT_T(0.01));
+}
+
+static void bench_run_determinant(BenchData *data) {
+    data->sink = matrix_determinant(data->a);
+}
+
+static void bench_run_determinant_in(BenchData *data) {
+    data->sink = matrix_determinant_in(data->arena, data->a);
+    matrixarena_reset(data->arena);
+}
+
+static void bench_run_diagonalize(BenchData *data) {
+    matrix_copy_from_buffer(data->a, data->buffer);
+    matrix_diagonalize(data->a);
+}
+
+static void bench_run_qr(BenchData *data) {
+    matrix_qr(data->b, data->c, data->a);
+}
+
+static void bench_run_svd(BenchData *data) {
+    matrix_svd(data->b, data->values, data->c, data->a);
+}
+
+static void bench_run_apply_1q(BenchData *data) {
+    statevector_apply_1q(data->state, data->a, data->n / 2);
+}
+
+static void bench_run_apply_2q(BenchData *data) {
+    statevector_apply_2q(data->state, data->b, data->n / 2,
+                         data->n / 2 - 1);
+}
+
+static void bench_run_circuit(BenchData *data) {
+    circuit_run(data->circuit, data->state);
+}
+
+static void bench_run_tableau(BenchData *data) {
+    unsigned long seed = 1;
+    size_t i, a, b;
+
+    for (i = 0; i < 1000; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        a = (size_t)((seed >> 16) & 0x7fff) % data->n;
+        seed = seed * 1103515245UL + 12345UL;
+        b = (size_t)((seed >> 16) & 0x7fff) % data->n;
+        switch (i % 3) {
+        case 0:
+            tableau_h(data->tableau, a);
+            break;
+        case 1:
+            tableau_s(data->tableau, a);
+            break;
+        default:
+            tableau_cnot(data->tableau, a, a == b ? (a + 1) % data->n : b);
+        }
+    }
+}
+
+static void bench_run_densitymatrix(BenchData *data) {
+    densitymatrix_apply_1q(data->rho, data->a, data->n / 2);
+}
+
+static void bench_run_mps(BenchData *data) {
+    size_t i;
+
+    for (i = 0; i < data->n; i++) {
+        mps_apply_1q(data->mps, data->a, i);
+    }
+    for (i = 0; i + 1 < data->n; i++) {
+        mps_apply_2q(data->mps, data->b, i, i + 1);
+    }
+}
+
+static void bench_run_sampler(BenchData *data) {
+    sampler_histogram(data->sampler, data->counts, 100000, 1, NULL);
+}
+
+static double bench_flops_multiply(size_t n) {
+    return BENCH_FMA_FLOPS * (double)n * (double)n * (double)n;
+}
+
+static double bench_flops_determinant(size_t n) {
+    return BENCH_FMA_FLOPS * (double)n * (double)n * (double)n / 3;
+}
+
+static double bench_flops_qr(size_t n) {
+    return BENCH_FMA_FLOPS * (double)n * (double)n * (double)n * 4 / 3;
+}
+
+static double bench_flops_apply_1q(size_t n) {
+    return BENCH_FMA_FLOPS * 2 * (double)((size_t)1 << n);
+}
+
+static double bench_flops_apply_2q(size_t n) {
+    return BENCH_FMA_FLOPS * 4 * (double)((size_t)1 << n);
+}
+
+static double bench_flops_densitymatrix(size_t n) {
+    return BENCH_FMA_FLOPS * 4 * (double)((size_t)1 << n)
+           * (double)((size_t)1 << n);
+}
+
+static int bench_measure(const BenchCase *bench_case, size_t n,
+                         size_t repeats, BenchResult *result) {
+    BenchData data;
+    double start, elapsed, sum = 0, squares = 0, mean;
+    size_t bytes, i, r;
+    int status = -1;
+
+    memset(&data, 0, sizeof(data));
+    if (bench_case->setup(&data, n) != 0)
+        goto bench_measure_cleanup;
+
+    /* warm up, then double the run length until it can be timed */
+    bench_case->run(&data);
+    result->iterations = 1;
+    for (;;) {
+        start = bench_now();
+        for (i = 0; i < result->iterations; i++) {
+            bench_case->run(&data);
+        }
+        elapsed = bench_now() - start;
+        if (elapsed >= BENCH_MIN_SECONDS
+            || result->iterations >= BENCH_MAX_ITERATIONS)
+            break;
+        result->iterations *= 2;
+    }
+
+    result->repeats = repeats;
+    result->min_ns = 0;
+    bytes = bench_allocated_bytes();
+    for (r = 0; r < repeats; r++) {
+        start = bench_now();
+        for (i = 0; i < result->iterations; i++) {
+            bench_case->run(&data);
+        }
+        elapsed = 1e9 * (bench_now() - start) / (double)result->iterations;
+        sum += elapsed;
+        squares += elapsed * elapsed;
+        if (r == 0 || elapsed < result->min_ns) {
+            result->min_ns = elapsed;
+        }
+    }
+    bytes = bench_allocated_bytes() - bytes;
+
+    mean = sum / (double)repeats;
+    result->mean_ns = mean;
+    result->stddev_ns =
+        repeats > 1 ? sqrt(fabs(squares - sum * mean) / (double)(repeats - 1))
+                    : 0;
+    result->gflops =
+        bench_case->flops != NULL ? bench_case->flops(n) / mean : -1;
+    result->bytes =
+        (double)bytes / ((double)repeats * (double)result->iterations);
+    status = 0;
+
+bench_measure_cleanup:
+    bench_teardown(&data);
+    return status;
+}
+
+static void bench_print(BenchFormat format, const BenchCase *bench_case,
+                        size_t n, const BenchResult *result, bool first) {
+    char gflops[32];
+
+    switch (format) {
+    case BENCH_CSV:
+        printf("%s,%s,%lu,%lu,%lu,%.1f,%.1f,%.1f,", BENCH_MAT_T_NAME,
+               bench_case->name, (unsigned long)n,
+               (unsigned long)result->iterations,
+               (unsigned long)result->repeats, result->mean_ns,
+               result->stddev_ns, result->min_ns);
+        if (result->gflops >= 0) {
+            printf("%.3f", result->gflops);
+        }
+        printf(",%.0f\n", result->bytes);
+        break;
+    case BENCH_JSON:
+        if (result->gflops >= 0) {
+            sprintf(gflops, "%.3f", result->gflops);
+        } else {
+            strcpy(gflops, "null");
+        }
+        printf("%s\n    {\"case\": \"%s\", \"size\": %lu, "
+               "\"iterations\": %lu, \"repeats\": %lu, \"ns_per_op\": %.1f, "
+               "\"stddev_ns\": %.1f, \"min_ns\": %.1f, \"gflops\": %s, "
+               "\"bytes_per_op\": %.0f}",
+               first ? "" : ",", bench_case->name, (unsigned long)n,
+               (unsigned long)result->iterations,
+               (unsigned long)result->repeats, result->mean_ns,
+               result->stddev_ns, result->min_ns, gflops, result->bytes);
+        break;
+    default:
+        if (result->gflops >= 0) {
+            sprintf(gflops, "%9.3f GFLOP/s", result->gflops);
+        } else {
+            strcpy(gflops, "");
+        }
+        printf("%-28s %6lu %14.1f ns/op %6.1f%% %17s %12.0f B/op\n",
+               bench_case->name, (unsigned long)n, result->mean_ns,
+               result->mean_ns > 0
+                   ? 100 * result->stddev_ns / result->mean_ns
+                   : 0,
+               gflops, result->bytes);
+    }
+}
+
+static void bench_usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [-f text|csv|json] [-r repeats] [-n max size] "
+            "[-c case]\n"
+            "       %s compare [max size] [naive limit] [qubits] [threads] "
+            "[sites]\n",
+            program, program);
+}
+
+int main(int argc, char **argv) {
+    BenchFormat format = BENCH_TEXT;
+    const char *filter = NULL;
+    size_t repeats = 5;
+    size_t max_size = 0;
+    const size_t count = sizeof(bench_cases) / sizeof(bench_cases[0]);
+    const BenchCase *bench_case;
+    BenchResult result;
+    bool first = true;
+    size_t i, k, limit;
+    int arg;
+
+    if (argc > 1 && strcmp(argv[1], "compare") == 0) {
+        return bench_compare(argc - 1, argv + 1);
+    }
+    for (arg = 1; arg < argc; arg++) {
+        if (arg + 1 >= argc) {
+            bench_usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[arg], "-f") == 0) {
+            arg++;
+            if (strcmp(argv[arg], "csv") == 0) {
+                format = BENCH_CSV;
+            } else if (strcmp(argv[arg], "json") == 0) {
+                format = BENCH_JSON;
+            } else if (strcmp(argv[arg], "text") != 0) {
+                bench_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[arg], "-r") == 0) {
+            repeats = (size_t)strtoul(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "-n") == 0) {
+            max_size = (size_t)strtoul(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "-c") == 0) {
+            filter = argv[++arg];
+        } else {
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (repeats == 0) {
+        repeats = 1;
+    }
+
+    if (format == BENCH_CSV) {
+        printf("mat_t,case,size,iterations,repeats,ns_per_op,stddev_ns,"
+               "min_ns,gflops,bytes_per_op\n");
+    } else if (format == BENCH_JSON) {
+        printf("{\"mat_t\": \"%s\", \"results\": [", BENCH_MAT_T_NAME);
+    }
+    for (i = 0; i < count; i++) {
+        bench_case = &bench_cases[i];
+        if (filter != NULL && strstr(bench_case->name, filter) == NULL)
+            continue;
+        limit = max_size > 0 ? max_size : bench_case->max_size;
+        for (k = 0; bench_case->sizes[k] != 0; k++) {
+            if (bench_case->sizes[k] > limit)
+                break;
+            if (bench_measure(bench_case, bench_case->sizes[k], repeats,
+                              &result)
+                != 0) {
+                fprintf(stderr, "%s %lu: could not set up\n",
+                        bench_case->name, (unsigned long)bench_case->sizes[k]);
+                continue;
+            }
+            bench_print(format, bench_case, bench_case->sizes[k], &result,
+                        first);
+            first = false;
+            fflush(stdout);
+        }
+    }
+    if (format == BENCH_JSON) {
+        printf("\n]}\n");
+    }
+    return 0;
+}
@@ -0,0 +1,1207 @@
+#include "bench_internal.h"
+#include "circuit.h"
+#include "densitymatrix.h"
+#include "eigen.h"
+#include "exponentialcache.h"
+#include "expm.h"
+#include "kronoperator.h"
+#include "lanczos.h"
+#include "lufactor.h"
+#include "mat2.h"
+#include "mat4.h"
+#include "matrix.h"
+#include "mps.h"
+#include "sampler.h"
+#include "sparsematrix.h"
+#include "statevector.h"
+#include "tableau.h"
+#include "threadpool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Context for multiplying by a SparseMatrix on a ThreadPool.
+ */
+typedef struct BenchSparseJob {
+    SparseMatrix *sparse;
+    ThreadPool *pool;
+} BenchSparseJob;
+
+/**
+ * Multiply `a` by `b` into `dest` with the textbook triple loop over
+ * `matrix_get` and `matrix_set`.
+ */
+static void bench_naive_multiply(Matrix *dest, Matrix *a, Matrix *b);
+
+/**
+ * Benchmark `matrix_multiply` against the naive loop on `n` x `n` operands.
+ * The naive loop is skipped above `naive_limit`.
+ */
+static void bench_matrix_multiply(size_t n, size_t naive_limit);
+
+/**
+ * Benchmark `eigen_hermitian` with and without eigenvectors against the
+ * elimination in `matrix_diagonalize` on an `n` x `n` symmetric matrix.
+ * The elimination is skipped above `elimination_limit`.
+ */
+static void bench_eigen_hermitian(size_t n, size_t elimination_limit);
+
+/**
+ * Benchmark `matrix_qr` of an `n` x `n` matrix with and without Q, against
+ * the LU elimination of `matrix_determinant`, and up to `limit` also against
+ * `matrix_diagonalize` and `matrix_svd` with and without vectors.
+ */
+static void bench_matrix_qr(size_t n, size_t limit);
+
+/**
+ * Benchmark `matrix_exponential` of an `n` x `n` matrix for `count` values of
+ * t, against an ExponentialCache computing then repeating them.
+ */
+static void bench_matrix_exponential(size_t n, size_t count);
+
+/**
+ * Benchmark `matrix_kron` of two `n` x `n` matrices against setting each
+ * value of the product with `matrix_set`.
+ */
+static void bench_matrix_kron(size_t n);
+
+/**
+ * Benchmark `calls` determinants of fresh `n` x `n` matrices: through a
+ * LUFactor, with `matrix_determinant`, and in a MatrixArena reset after each.
+ */
+static void bench_determinant_arena(size_t n, size_t calls);
+
+/**
+ * Benchmark `calls` fusions of a Hadamard on the high qubit and a CNOT into
+ * a 4 x 4 gate, with `matrix_kron` and `matrix_multiply` and with `Mat4`.
+ */
+static void bench_mat4_compose(size_t calls);
+
+/**
+ * Benchmark `depth` layers of a Hadamard on every one of `qubits` qubits then
+ * a brickwork of CNOTs, run gate by gate and compiled with fusion up to 2 to
+ * 5 qubits, reporting passes over the state.
+ */
+static void bench_circuit(size_t qubits, size_t depth);
+
+/**
+ * Benchmark `gates` random H, S and CNOT gates on a Tableau of `qubits`
+ * qubits, then measuring every qubit.
+ */
+static void bench_tableau(size_t qubits, size_t gates);
+
+/**
+ * Benchmark a one-qubit gate on a `qubits` qubit DensityMatrix against
+ * conjugating a dense matrix by the gate expanded to the full space.
+ */
+static void bench_densitymatrix(size_t qubits);
+
+/**
+ * Benchmark `depth` layers of rotations and neighbouring CNOTs on an Mps of
+ * `qubits` qubits with bonds capped at `max_bond`.
+ */
+static void bench_mps(size_t qubits, size_t depth, size_t max_bond);
+
+/**
+ * Benchmark a KronOperator of `qubits` 2 x 2 factors on a vector of
+ * 2^`qubits` values.
+ */
+static void bench_kronoperator(size_t qubits);
+
+/**
+ * Build the Heisenberg Hamiltonian of a periodic chain of `sites` spins.
+ * Return NULL on failure.
+ */
+static SparseMatrix *bench_heisenberg_chain(size_t sites);
+
+/**
+ * Benchmark `sparsematrix_multiply_vector_parallel` on a Heisenberg chain of
+ * `sites` spins, for 1 up to `max_threads` threads.
+ */
+static void bench_sparsematrix_threads(size_t sites, size_t max_threads);
+
+/**
+ * Multiply by the SparseMatrix of a BenchSparseJob on its ThreadPool.
+ */
+static void bench_sparse_matvec(void *context, const mat_t *x, mat_t *y);
+
+/**
+ * Benchmark finding the ground state of a Heisenberg chain of `sites` spins
+ * with `lanczos_solve`, multiplying on `threads` threads.
+ */
+static void bench_lanczos_chain(size_t sites, size_t threads);
+
+/**
+ * Benchmark evolving a Neel state of a Heisenberg chain of `sites` spins with
+ * `expm_multiply` (in imaginary time for real `mat_t`), multiplying on
+ * `threads` threads.
+ */
+static void bench_expm_chain(size_t sites, size_t threads);
+
+/**
+ * Benchmark applying a one-qubit gate to every qubit of a `qubits` qubit
+ * state, for 1 up to `max_threads` threads.
+ */
+static void bench_statevector_threads(size_t qubits, size_t max_threads);
+
+/**
+ * Benchmark drawing `shots` measurements of a `qubits` qubit state with a
+ * Sampler on 1 and `max_threads` threads, against a linear scan of the
+ * probabilities per shot.
+ */
+static void bench_sampler(size_t qubits, size_t shots, size_t max_threads);
+
+static void bench_naive_multiply(Matrix *dest, Matrix *a, Matrix *b) {
+    size_t i, j, k;
+    mat_t sum;
+    for (i = 1; i <= matrix_height(a); i++) {
+        for (j = 1; j <= matrix_width(b); j++) {
+            sum = MAT_T_0;
+            for (k = 1; k <= matrix_width(a); k++) {
+                sum = MAT_T_ADD(sum, MAT_T_MUL(matrix_get(a, i, k),
+                                               matrix_get(b, k, j)));
+            }
+            matrix_set(dest, i, j, sum);
+        }
+    }
+}
+
+static void bench_matrix_multiply(size_t n, size_t naive_limit) {
+#ifdef MAT_T_COMPLEX
+    /* a complex multiply-add is 8 real flops */
+    const double flops = 8.0 * (double)n * (double)n * (double)n;
+#else
+    const double flops = 2.0 * (double)n * (double)n * (double)n;
+#endif
+    Matrix *a = matrix_create(n, n);
+    Matrix *b = matrix_create(n, n);
+    Matrix *c = matrix_create(n, n);
+    double start, elapsed;
+
+    if (a == NULL || b == NULL || c == NULL) {
+        printf("matrix_multiply %5lu: could not allocate\n", (unsigned long)n);
+        goto bench_matrix_multiply_cleanup;
+    }
+    bench_fill(a, 1);
+    bench_fill(b, 2);
+
+    start = bench_now();
+    matrix_multiply(c, a, b);
+    elapsed = bench_now() - start;
+    printf("matrix_multiply %5lu: %8.3f s %8.2f GFLOP/s", (unsigned long)n,
+           elapsed, flops / elapsed * 1e-9);
+
+    if (n <= naive_limit) {
+        start = bench_now();
+        bench_naive_multiply(c, a, b);
+        elapsed = bench_now() - start;
+        printf("   naive: %8.3f s %8.2f GFLOP/s", elapsed,
+               flops / elapsed * 1e-9);
+    }
+    printf("\n");
+
+bench_matrix_multiply_cleanup:
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(c);
+}
+
+static void bench_eigen_hermitian(size_t n, size_t elimination_limit) {
+    Matrix *a = matrix_create(n, n);
+    Matrix *vectors = matrix_create(n, n);
+    Matrix *clone = NULL;
+    double *eigenvalues = malloc(n * sizeof(double));
+    double start, elapsed;
+    size_t i, j;
+
+    if (a == NULL || vectors == NULL || eigenvalues == NULL) {
+        printf("eigen_hermitian %5lu: could not allocate\n", (unsigned long)n);
+        goto bench_eigen_hermitian_cleanup;
+    }
+    bench_fill(a, 3);
+    for (i = 1; i <= n; i++) {
+        for (j = 1; j < i; j++) {
+            matrix_set(a, j, i, matrix_get(a, i, j));
+        }
+    }
+
+    start = bench_now();
+    if (eigen_hermitian(a, eigenvalues, NULL) != 0) {
+        printf("eigen_hermitian %5lu: did not converge\n", (unsigned long)n);
+        goto bench_eigen_hermitian_cleanup;
+    }
+    elapsed = bench_now() - start;
+    printf("eigen_hermitian %5lu: values %8.3f s", (unsigned long)n, elapsed);
+
+    start = bench_now();
+    if (eigen_hermitian(a, eigenvalues, vectors) != 0) {
+        printf("\n");
+        goto bench_eigen_hermitian_cleanup;
+    }
+    elapsed = bench_now() - start;
+    printf("   vectors %8.3f s", elapsed);
+
+    if (n <= elimination_limit) {
+        clone = matrix_clone(a);
+        if (clone != NULL) {
+            start = bench_now();
+            matrix_diagonalize(clone);
+            elapsed = bench_now() - start;
+            printf("   elimination: %8.3f s", elapsed);
+        }
+    }
+    printf("\n");
+
+bench_eigen_hermitian_cleanup:
+    matrix_destroy(a);
+    matrix_destroy(vectors);
+    matrix_destroy(clone);
+    free(eigenvalues);
+}
+
+static void bench_matrix_qr(size_t n, size_t limit) {
+    Matrix *a = matrix_create(n, n);
+    Matrix *q = matrix_create(n, n);
+    Matrix *r = matrix_create(n, n);
+    Matrix *v = matrix_create(n, n);
+    Matrix *clone = NULL;
+    double *values = malloc(n * sizeof(double));
+    double start, elapsed;
+
+    if (a == NULL || q == NULL || r == NULL || v == NULL || values == NULL) {
+        printf("matrix_qr %5lu: could not allocate\n", (unsigned long)n);
+        goto bench_matrix_qr_cleanup;
+    }
+    bench_fill(a, 5);
+
+    start = bench_now();
+    if (matrix_qr(NULL, r, a) != 0)
+        goto bench_matrix_qr_cleanup;
+    elapsed = bench_now() - start;
+    printf("matrix_qr %5lu: R %8.3f s", (unsigned long)n, elapsed);
+    start = bench_now();
+    if (matrix_qr(q, r, a) != 0) {
+        printf("\n");
+        goto bench_matrix_qr_cleanup;
+    }
+    elapsed = bench_now() - start;
+    printf("   Q R %8.3f s", elapsed);
+
+    start = bench_now();
+    matrix_determinant(a);
+    elapsed = bench_now() - start;
+    printf("   LU %8.3f s", elapsed);
+
+    if (n <= limit) {
+        clone = matrix_clone(a);
+        if (clone != NULL) {
+            start = bench_now();
+            matrix_diagonalize(clone);
+            elapsed = bench_now() - start;
+            printf("   elimination %8.3f s", elapsed);
+        }
+        start = bench_now();
+        if (matrix_svd(NULL, values, NULL, a) == 0) {
+            elapsed = bench_now() - start;
+            printf("   svd values %8.3f s", elapsed);
+        }
+        start = bench_now();
+        if (matrix_svd(q, values, v, a) == 0) {
+            elapsed = bench_now() - start;
+            printf("   vectors %8.3f s", elapsed);
+        }
+    }
+    printf("\n");
+
+bench_matrix_qr_cleanup:
+    matrix_destroy(a);
+    matrix_destroy(q);
+    matrix_destroy(r);
+    matrix_destroy(v);
+    matrix_destroy(clone);
+    free(values);
+}
+
+static void bench_matrix_exponential(size_t n, size_t count) {
+    Matrix *a = matrix_create(n, n);
+    Matrix *result = matrix_create(n, n);
+    ExponentialCache *cache = NULL;
+    double start, elapsed;
+    size_t k, pass;
+
+    if (a == NULL || result == NULL) {
+        printf("matrix_exponential %5lu: could not allocate\n",
+               (unsigned long)n);
+        goto bench_matrix_exponential_cleanup;
+    }
+    bench_fill(a, 5);
+    cache = exponentialcache_create(a, count);
+    if (cache == NULL) {
+        printf("matrix_exponential %5lu: could not allocate\n",
+               (unsigned long)n);
+        goto bench_matrix_exponential_cleanup;
+    }
+
+    start = bench_now();
+    for (k = 0; k < count; k++) {
+        if (matrix_exponential(result, a, MAT_T(0.01 * (double)(k + 1)))
+            != 0) {
+            printf("matrix_exponential %5lu: failed\n", (unsigned long)n);
+            goto bench_matrix_exponential_cleanup;
+        }
+    }
+    elapsed = bench_now() - start;
+    printf("matrix_exponential %5lu: %8.3f ms/call", (unsigned long)n,
+           1e3 * elapsed / (double)count);
+
+    /* the first pass reuses the powers of A, the second whole results */
+    for (pass = 0; pass < 2; pass++) {
+        start = bench_now();
+        for (k = 0; k < count; k++) {
+            if (exponentialcache_get(cache, result,
+                                     MAT_T(0.01 * (double)(k + 1)))
+                != 0) {
+                printf("\n");
+                goto bench_matrix_exponential_cleanup;
+            }
+        }
+        elapsed = bench_now() - start;
+        printf("   cached %s t: %8.3f ms/call", pass == 0 ? "new" : "repeated",
+               1e3 * elapsed / (double)count);
+    }
+    printf("\n");
+
+bench_matrix_exponential_cleanup:
+    matrix_destroy(a);
+    matrix_destroy(result);
+    exponentialcache_destroy(cache);
+}
+
+static void bench_matrix_kron(size_t n) {
+    Matrix *a = matrix_create(n, n);
+    Matrix *b = matrix_create(n, n);
+    Matrix *dest = matrix_create(n * n, n * n);
+    double start, elapsed;
+    size_t i, j, k, l;
+
+    if (a == NULL || b == NULL || dest == NULL) {
+        printf("matrix_kron %5lu: could not allocate\n", (unsigned long)n);
+        goto bench_matrix_kron_cleanup;
+    }
+    bench_fill(a, 6);
+    bench_fill(b, 7);
+
+    start = bench_now();
+    matrix_kron(dest, a, b);
+    elapsed = bench_now() - start;
+    printf("matrix_kron %5lu: %8.3f ms", (unsigned long)n, 1e3 * elapsed);
+
+    start = bench_now();
+    for (i = 1; i <= n; i++) {
+        for (j = 1; j <= n; j++) {
+            for (k = 1; k <= n; k++) {
+                for (l = 1; l <= n; l++) {
+                    matrix_set(dest, (i - 1) * n + k, (j - 1) * n + l,
+                               MAT_T_MUL(matrix_get(a, i, j),
+                                         matrix_get(b, k, l)));
+                }
+            }
+        }
+    }
+    elapsed = bench_now() - start;
+    printf("   matrix_set: %8.3f ms\n", 1e3 * elapsed);
+
+bench_matrix_kron_cleanup:
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(dest);
+}
+
+static void bench_determinant_arena(size_t n, size_t calls) {
+    Matrix *source = matrix_create(n, n);
+    mat_t *values = malloc(n * n * sizeof(mat_t));
+    MatrixArena *arena = matrixarena_create(0);
+    Matrix *matrix;
+    LUFactor *factor;
+    double start, elapsed;
+    size_t i;
+
+    if (source == NULL || values == NULL || arena == NULL) {
+        printf("determinant %2lu: could not allocate\n", (unsigned long)n);
+        goto bench_determinant_arena_cleanup;
+    }
+    bench_fill(source, 9);
+    matrix_copy_to_buffer(source, values);
+
+    start = bench_now();
+    for (i = 0; i < calls; i++) {
+        matrix = matrix_create(n, n);
+        if (matrix == NULL)
+            goto bench_determinant_arena_cleanup;
+        matrix_copy_from_buffer(matrix, values);
+        factor = lufactor_create(matrix);
+        if (factor == NULL) {
+            matrix_destroy(matrix);
+            goto bench_determinant_arena_cleanup;
+        }
+        lufactor_determinant(factor);
+        lufactor_destroy(factor);
+        matrix_destroy(matrix);
+    }
+    elapsed = bench_now() - start;
+    printf("determinant %2lu x %lu: lufactor %6.1f ns/call", (unsigned long)n,
+           (unsigned long)calls, 1e9 * elapsed / (double)calls);
+
+    start = bench_now();
+    for (i = 0; i < calls; i++) {
+        matrix = matrix_create(n, n);
+        if (matrix == NULL)
+            goto bench_determinant_arena_cleanup;
+        matrix_copy_from_buffer(matrix, values);
+        matrix_determinant(matrix);
+        matrix_destroy(matrix);
+    }
+    elapsed = bench_now() - start;
+    printf("   heap %6.1f ns/call", 1e9 * elapsed / (double)calls);
+
+    start = bench_now();
+    for (i = 0; i < calls; i++) {
+        matrix = matrix_create_in(arena, n, n);
+        if (matrix == NULL)
+            goto bench_determinant_arena_cleanup;
+        matrix_copy_from_buffer(matrix, values);
+        matrix_determinant_in(arena, matrix);
+        matrixarena_reset(arena);
+    }
+    elapsed = bench_now() - start;
+    printf("   arena %6.1f ns/call\n", 1e9 * elapsed / (double)calls);
+
+bench_determinant_arena_cleanup:
+    matrix_destroy(source);
+    free(values);
+    matrixarena_destroy(arena);
+}
+
+static void bench_mat4_compose(size_t calls) {
+    const double root = 0.70710678118654752;
+    Matrix *hadamard = matrix_create(2, 2);
+    Matrix *identity = matrix_create(2, 2);
+    Matrix *cnot = matrix_create(4, 4);
+    Matrix *kron = matrix_create(4, 4);
+    Matrix *product = matrix_create(4, 4);
+    Matrix *fused = matrix_create(4, 4);
+    Mat2 h;
+    Mat4 c, f;
+    double start, elapsed, difference, largest = 0.0;
+    size_t i;
+
+    if (hadamard == NULL || identity == NULL || cnot == NULL || kron == NULL
+        || product == NULL || fused == NULL) {
+        printf("mat4 compose: could not allocate\n");
+        goto bench_mat4_compose_cleanup;
+    }
+    matrix_set(hadamard, 1, 1, MAT_T(root));
+    matrix_set(hadamard, 1, 2, MAT_T(root));
+    matrix_set(hadamard, 2, 1, MAT_T(root));
+    matrix_set(hadamard, 2, 2, MAT_T(-root));
+    matrix_set(identity, 1, 1, MAT_T_1);
+    matrix_set(identity, 2, 2, MAT_T_1);
+    matrix_set(cnot, 1, 1, MAT_T_1);
+    matrix_set(cnot, 2, 2, MAT_T_1);
+    matrix_set(cnot, 3, 4, MAT_T_1);
+    matrix_set(cnot, 4, 3, MAT_T_1);
+    matrix_set(fused, 1, 1, MAT_T_1);
+    matrix_set(fused, 2, 2, MAT_T_1);
+    matrix_set(fused, 3, 3, MAT_T_1);
+    matrix_set(fused, 4, 4, MAT_T_1);
+
+    start = bench_now();
+    for (i = 0; i < calls; i++) {
+        matrix_kron(kron, hadamard, identity);
+        if (matrix_multiply(product, kron, fused) != 0
+            || matrix_multiply(fused, cnot, product) != 0)
+            goto bench_mat4_compose_cleanup;
+    }
+    elapsed = bench_now() - start;
+    printf("mat4 compose %lu: matrix %6.1f ns/call", (unsigned long)calls,
+           1e9 * elapsed / (double)calls);
+
+    mat2_from_matrix(&h, hadamard);
+    mat4_from_matrix(&c, cnot);
+    mat4_identity(&f);
+    start = bench_now();
+    for (i = 0; i < calls; i++) {
+        mat4_apply_high(&f, &h, &f);
+        mat4_multiply(&f, &c, &f);
+    }
+    elapsed = bench_now() - start;
+    for (i = 0; i < 16; i++) {
+        difference = sqrt(MAT_T_ABS2(MAT_T_SUB(
+            f.values[i], matrix_get(fused, i / 4 + 1, i % 4 + 1))));
+        largest = difference > largest ? difference : largest;
+    }
+    printf("   mat4 %6.1f ns/call (difference %.1e)\n",
+           1e9 * elapsed / (double)calls, largest);
+
+bench_mat4_compose_cleanup:
+    matrix_destroy(hadamard);
+    matrix_destroy(identity);
+    matrix_destroy(cnot);
+    matrix_destroy(kron);
+    matrix_destroy(product);
+    matrix_destroy(fused);
+}
+
+static void bench_circuit(size_t qubits, size_t depth) {
+    const double root = 0.70710678118654752;
+    Circuit *circuit = circuit_create(qubits);
+    StateVector *state = statevector_create(qubits);
+    Matrix *hadamard = matrix_create(2, 2);
+    Matrix *pauli_x = matrix_create(2, 2);
+    double start, elapsed;
+    size_t layer, q, fuse;
+
+    if (circuit == NULL || state == NULL || hadamard == NULL
+        || pauli_x == NULL) {
+        printf("circuit %2lu qubits: could not allocate\n",
+               (unsigned long)qubits);
+        goto bench_circuit_cleanup;
+    }
+    matrix_set(hadamard, 1, 1, MAT_T(root));
+    matrix_set(hadamard, 1, 2, MAT_T(root));
+    matrix_set(hadamard, 2, 1, MAT_T(root));
+    matrix_set(hadamard, 2, 2, MAT_T(-root));
+    matrix_set(pauli_x, 1, 2, MAT_T_1);
+    matrix_set(pauli_x, 2, 1, MAT_T_1);
+    for (layer = 0; layer < depth; layer++) {
+        for (q = 0; q < qubits; q++) {
+            if (circuit_add_1q(circuit, hadamard, q) != 0)
+                goto bench_circuit_cleanup;
+        }
+        for (q = layer % 2; q + 1 < qubits; q += 2) {
+            if (circuit_add_controlled_1q(circuit, pauli_x, q, q + 1) != 0)
+                goto bench_circuit_cleanup;
+        }
+    }
+
+    start = bench_now();
+    circuit_run(circuit, state);
+    elapsed = bench_now() - start;
+    printf("circuit %2lu qubits %4lu gates: unfused %4lu passes %8.3f s\n",
+           (unsigned long)qubits, (unsigned long)circuit_gates(circuit),
+           (unsigned long)circuit_passes(circuit), elapsed);
+
+    for (fuse = 2; fuse <= 5; fuse++) {
+        start = bench_now();
+        if (circuit_compile(circuit, fuse) != 0)
+            goto bench_circuit_cleanup;
+        elapsed = bench_now() - start;
+        printf("circuit %2lu qubits %4lu gates: fused %lu %4lu passes "
+               "(compile %6.3f s)",
+               (unsigned long)qubits, (unsigned long)circuit_gates(circuit),
+               (unsigned long)fuse, (unsigned long)circuit_passes(circuit),
+               elapsed);
+        start = bench_now();
+        circuit_run(circuit, state);
+        elapsed = bench_now() - start;
+        printf(" %8.3f s\n", elapsed);
+    }
+
+bench_circuit_cleanup:
+    circuit_destroy(circuit);
+    statevector_destroy(state);
+    matrix_destroy(hadamard);
+    matrix_destroy(pauli_x);
+}
+
+static void bench_tableau(size_t qubits, size_t gates) {
+    Tableau *tableau = tableau_create(qubits, 1);
+    unsigned long seed = 1;
+    double start, elapsed;
+    size_t random = 0;
+    size_t i, a, b;
+    bool deterministic;
+
+    if (tableau == NULL) {
+        printf("tableau %4lu qubits: could not allocate\n",
+               (unsigned long)qubits);
+        return;
+    }
+
+    start = bench_now();
+    for (i = 0; i < gates; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        a = (size_t)((seed >> 16) & 0x7fff) % qubits;
+        seed = seed * 1103515245UL + 12345UL;
+        b = (size_t)((seed >> 16) & 0x7fff) % qubits;
+        seed = seed * 1103515245UL + 12345UL;
+        switch ((seed >> 16) % 3) {
+        case 0:
+            tableau_h(tableau, a);
+            break;
+        case 1:
+            tableau_s(tableau, a);
+            break;
+        default:
+            tableau_cnot(tableau, a, a == b ? (a + 1) % qubits : b);
+        }
+    }
+    elapsed = bench_now() - start;
+    printf("tableau %4lu qubits: %lu gates %8.3f s %6.2f Mgates/s",
+           (unsigned long)qubits, (unsigned long)gates, elapsed,
+           1e-6 * (double)gates / elapsed);
+
+    start = bench_now();
+    for (i = 0; i < qubits; i++) {
+        tableau_measure(tableau, i, &deterministic);
+        random += deterministic ? 0 : 1;
+    }
+    elapsed = bench_now() - start;
+    printf("   measure %8.1f us/qubit (%lu random)\n",
+           1e6 * elapsed / (double)qubits, (unsigned long)random);
+
+    tableau_destroy(tableau);
+}
+
+static void bench_densitymatrix(size_t qubits) {
+    const size_t size = (size_t)1 << qubits;
+    const size_t repeats = 64;
+    DensityMatrix *rho = densitymatrix_create(qubits);
+    Matrix *gate = matrix_create(2, 2);
+    Matrix *identity = matrix_create_identity(size / 2);
+    Matrix *full = matrix_create(size, size);
+    Matrix *adjoint = matrix_create(size, size);
+    Matrix *dense = matrix_create(size, size);
+    Matrix *product = matrix_create(size, size);
+    double start, fast, slow;
+    size_t i, j;
+
+    if (rho == NULL || gate == NULL || identity == NULL || full == NULL
+        || adjoint == NULL || dense == NULL || product == NULL) {
+        printf("densitymatrix %2lu qubits: could not allocate\n",
+               (unsigned long)qubits);
+        goto bench_densitymatrix_cleanup;
+    }
+    bench_fill(gate, 23);
+    bench_fill(dense, 29);
+
+    start = bench_now();
+    for (i = 0; i < repeats; i++) {
+        densitymatrix_apply_1q(rho, gate, i % qubits);
+    }
+    fast = (bench_now() - start) / (double)repeats;
+
+    /* qubit 0 is the low bit, so the full gate is I (x) U */
+    start = bench_now();
+    matrix_kron(full, identity, gate);
+    for (i = 1; i <= size; i++) {
+        for (j = 1; j <= size; j++) {
+            matrix_set(adjoint, j, i, MAT_T_CONJ(matrix_get(full, i, j)));
+        }
+    }
+    matrix_multiply(product, full, dense);
+    matrix_multiply(dense, product, adjoint);
+    slow = bench_now() - start;
+
+    printf("densitymatrix %2lu qubits: apply_1q %10.3f ms   dense U rho U^H "
+           "%10.3f ms   %8.1fx\n",
+           (unsigned long)qubits, 1e3 * fast, 1e3 * slow, slow / fast);
+
+bench_densitymatrix_cleanup:
+    densitymatrix_destroy(rho);
+    matrix_destroy(gate);
+    matrix_destroy(identity);
+    matrix_destroy(full);
+    matrix_destroy(adjoint);
+    matrix_destroy(dense);
+    matrix_destroy(product);
+}
+
+static void bench_mps(size_t qubits, size_t depth, size_t max_bond) {
+    Mps *mps = mps_create(qubits, max_bond, 0);
+    Matrix *rotation = matrix_create(2, 2);
+    Matrix *cnot = matrix_create(4, 4);
+    double start, elapsed, angle;
+    size_t layer, i, gates = 0;
+
+    if (mps == NULL || rotation == NULL || cnot == NULL) {
+        printf("mps %3lu qubits: could not allocate\n", (unsigned long)qubits);
+        goto bench_mps_cleanup;
+    }
+    matrix_set(cnot, 1, 1, MAT_T_1);
+    matrix_set(cnot, 2, 2, MAT_T_1);
+    matrix_set(cnot, 3, 4, MAT_T_1);
+    matrix_set(cnot, 4, 3, MAT_T_1);
+
+    start = bench_now();
+    for (layer = 0; layer < depth; layer++) {
+        angle = 0.3 + 0.1 * (double)layer;
+        matrix_set(rotation, 1, 1, MAT_T(cos(angle)));
+        matrix_set(rotation, 1, 2, MAT_T(-sin(angle)));
+        matrix_set(rotation, 2, 1, MAT_T(sin(angle)));
+        matrix_set(rotation, 2, 2, MAT_T(cos(angle)));
+        for (i = 0; i < qubits; i++) {
+            mps_apply_1q(mps, rotation, i);
+        }
+        /* a brickwork of CNOTs, alternating between even and odd bonds */
+        for (i = layer % 2; i + 1 < qubits; i += 2) {
+            if (mps_apply_2q(mps, cnot, i, i + 1) != 0)
+                goto bench_mps_cleanup;
+            gates++;
+        }
+    }
+    elapsed = bench_now() - start;
+    printf("mps %3lu qubits: %lu layers %8.3f s %8.1f us/CNOT   max bond %3lu"
+           " (cap %lu)   discarded weight %.3e\n",
+           (unsigned long)qubits, (unsigned long)depth, elapsed,
+           1e6 * elapsed / (double)gates,
+           (unsigned long)mps_max_bond_dimension(mps), (unsigned long)max_bond,
+           mps_discarded_weight(mps));
+
+bench_mps_cleanup:
+    mps_destroy(mps);
+    matrix_destroy(rotation);
+    matrix_destroy(cnot);
+}
+
+static void bench_kronoperator(size_t qubits) {
+    Matrix **factors = calloc(qubits, sizeof(Matrix *));
+    KronOperator *kron = NULL;
+    mat_t *x = NULL;
+    mat_t *y = NULL;
+    double start, elapsed;
+    size_t size = (size_t)1 << qubits, i;
+
+    if (factors == NULL) {
+        printf("kronoperator %2lu: could not allocate\n",
+               (unsigned long)qubits);
+        goto bench_kronoperator_cleanup;
+    }
+    for (i = 0; i < qubits; i++) {
+        factors[i] = matrix_create(2, 2);
+        if (factors[i] == NULL) {
+            printf("kronoperator %2lu: could not allocate\n",
+                   (unsigned long)qubits);
+            goto bench_kronoperator_cleanup;
+        }
+        bench_fill(factors[i], 8 + i);
+    }
+    kron = kronoperator_create(factors, qubits);
+    x = malloc(size * sizeof(mat_t));
+    y = malloc(size * sizeof(mat_t));
+    if (kron == NULL || x == NULL || y == NULL) {
+        printf("kronoperator %2lu: could not allocate\n",
+               (unsigned long)qubits);
+        goto bench_kronoperator_cleanup;
+    }
+    for (i = 0; i < size; i++) {
+        x[i] = MAT_T(1.0);
+    }
+
+    start = bench_now();
+    kronoperator_multiply_vector(kron, x, y);
+    elapsed = bench_now() - start;
+    /* the formed product would hold size^2 values */
+    printf("kronoperator %2lu factors: %8.3f ms/matvec (formed: %.3g GB)\n",
+           (unsigned long)qubits, 1e3 * elapsed,
+           (double)size * (double)size * (double)sizeof(mat_t) / 1e9);
+
+bench_kronoperator_cleanup:
+    if (factors != NULL) {
+        for (i = 0; i < qubits; i++) {
+            matrix_destroy(factors[i]);
+        }
+    }
+    free(factors);
+    kronoperator_destroy(kron);
+    free(x);
+    free(y);
+}
+
+static SparseMatrix *bench_heisenberg_chain(size_t sites) {
+    const size_t size = (size_t)1 << sites;
+    SparseMatrixBuilder *builder;
+    SparseMatrix *sparse = NULL;
+    double diagonal;
+    size_t state, site, next, flipped;
+
+    builder = sparsematrixbuilder_create(size, size, size * (sites + 1));
+    if (builder == NULL)
+        return NULL;
+
+    /* S.S between neighbours: +-1/4 on the diagonal, and 1/2 swapping the
+     * spins where they differ */
+    for (state = 0; state < size; state++) {
+        diagonal = 0.0;
+        for (site = 0; site < sites; site++) {
+            next = (site + 1) % sites;
+            if (((state >> site) & 1) == ((state >> next) & 1)) {
+                diagonal += 0.25;
+            } else {
+                diagonal -= 0.25;
+                flipped = state ^ ((size_t)1 << site) ^ ((size_t)1 << next);
+                if (sparsematrixbuilder_add(builder, state + 1, flipped + 1,
+                                            MAT_T(0.5))
+                    != 0)
+                    goto bench_heisenberg_chain_cleanup;
+            }
+        }
+        if (sparsematrixbuilder_add(builder, state + 1, state + 1,
+                                    MAT_T(diagonal))
+            != 0)
+            goto bench_heisenberg_chain_cleanup;
+    }
+    sparse = sparsematrix_create(builder);
+
+bench_heisenberg_chain_cleanup:
+    sparsematrixbuilder_destroy(builder);
+    return sparse;
+}
+
+static void bench_sparsematrix_threads(size_t sites, size_t max_threads) {
+    const size_t repeats = 10;
+    SparseMatrix *sparse;
+    ThreadPool *pool;
+    mat_t *x = NULL;
+    mat_t *y = NULL;
+    double start, elapsed, bytes, serial = 0.0;
+    size_t size, threads, i;
+
+    start = bench_now();
+    sparse = bench_heisenberg_chain(sites);
+    elapsed = bench_now() - start;
+    if (sparse == NULL) {
+        printf("sparsematrix %2lu sites: could not allocate\n",
+               (unsigned long)sites);
+        return;
+    }
+    size = sparsematrix_height(sparse);
+    printf("sparsematrix %2lu sites: %lu nonzeros (dense would be %.0f GB) "
+           "built in %.3f s\n",
+           (unsigned long)sites, (unsigned long)sparsematrix_nonzeros(sparse),
+           (double)size * (double)size * sizeof(mat_t) * 1e-9, elapsed);
+
+    x = malloc(size * sizeof(mat_t));
+    y = malloc(size * sizeof(mat_t));
+    if (x == NULL || y == NULL) {
+        printf("sparsematrix %2lu sites: could not allocate\n",
+               (unsigned long)sites);
+        goto bench_sparsematrix_threads_cleanup;
+    }
+    for (i = 0; i < size; i++) {
+        x[i] = MAT_T(1.0);
+    }
+
+    /* each product streams the values, column indices, row offsets and
+     * both vectors once */
+    bytes = (double)sparsematrix_nonzeros(sparse)
+                * (sizeof(mat_t) + sizeof(size_t))
+            + (double)size * (2 * sizeof(mat_t) + sizeof(size_t));
+
+    for (threads = 1; threads <= max_threads;
+         threads = threads == max_threads || threads * 2 < max_threads
+                       ? threads * 2
+                       : max_threads) {
+        pool = threadpool_create(threads);
+        if (pool == NULL) {
+            printf("sparsematrix %2lu sites %3lu threads: could not "
+                   "allocate\n",
+                   (unsigned long)sites, (unsigned long)threads);
+            break;
+        }
+
+        start = bench_now();
+        for (i = 0; i < repeats; i++) {
+            sparsematrix_multiply_vector_parallel(sparse, x, y, pool);
+        }
+        elapsed = (bench_now() - start) / (double)repeats;
+        if (threads == 1) {
+            serial = elapsed;
+        }
+        printf("sparsematrix %2lu sites %3lu threads: %8.4f s %8.2f GB/s "
+               "%6.2fx\n",
+               (unsigned long)sites, (unsigned long)threads, elapsed,
+               bytes / elapsed * 1e-9, serial / elapsed);
+
+        threadpool_destroy(pool);
+    }
+
+bench_sparsematrix_threads_cleanup:
+    sparsematrix_destroy(sparse);
+    free(x);
+    free(y);
+}
+
+static void bench_sparse_matvec(void *context, const mat_t *x, mat_t *y) {
+    BenchSparseJob *job = context;
+    sparsematrix_multiply_vector_parallel(job->sparse, x, y, job->pool);
+}
+
+static void bench_lanczos_chain(size_t sites, size_t threads) {
+    BenchSparseJob job;
+    Lanczos *lanczos = NULL;
+    double start, elapsed;
+    int status;
+
+    job.sparse = bench_heisenberg_chain(sites);
+    job.pool = threadpool_create(threads);
+    if (job.sparse == NULL || job.pool == NULL) {
+        printf("lanczos %2lu sites: could not allocate\n",
+               (unsigned long)sites);
+        goto bench_lanczos_chain_cleanup;
+    }
+    lanczos = lanczos_create(sparsematrix_height(job.sparse), 1, 0);
+    if (lanczos == NULL) {
+        printf("lanczos %2lu sites: could not allocate\n",
+               (unsigned long)sites);
+        goto bench_lanczos_chain_cleanup;
+    }
+
+    start = bench_now();
+    status = lanczos_solve(lanczos, bench_sparse_matvec, &job, 1e-10, 100);
+    elapsed = bench_now() - start;
+    printf("lanczos %2lu sites %3lu threads: %8.3f s %s E0/site %.10f "
+           "residual %.1e, %lu iterations, %lu matvecs\n",
+           (unsigned long)sites, (unsigned long)threads, elapsed,
+           status == 0 ? "converged" : "NOT converged",
+           lanczos_eigenvalue(lanczos, 0) / (double)sites,
+           lanczos_residual(lanczos, 0),
+           (unsigned long)lanczos_iterations(lanczos),
+           (unsigned long)lanczos_matvecs(lanczos));
+
+bench_lanczos_chain_cleanup:
+    sparsematrix_destroy(job.sparse);
+    threadpool_destroy(job.pool);
+    lanczos_destroy(lanczos);
+}
+
+static void bench_expm_chain(size_t sites, size_t threads) {
+#ifdef MAT_T_COMPLEX
+    const mat_t rate = MAT_T_MUL(MAT_T(-1.0), MAT_T_I);
+#else
+    const mat_t rate = MAT_T(-1.0);
+#endif
+    BenchSparseJob job;
+    Expm *expm = NULL;
+    mat_t *psi = NULL;
+    double start, elapsed, norm = 0.0;
+    size_t size, i, neel = 0;
+    int status;
+
+    job.sparse = bench_heisenberg_chain(sites);
+    job.pool = threadpool_create(threads);
+    if (job.sparse == NULL || job.pool == NULL) {
+        printf("expm %2lu sites: could not allocate\n", (unsigned long)sites);
+        goto bench_expm_chain_cleanup;
+    }
+    size = sparsematrix_height(job.sparse);
+    expm = expm_create(size, 0);
+    psi = calloc(size, sizeof(mat_t));
+    if (expm == NULL || psi == NULL) {
+        printf("expm %2lu sites: could not allocate\n", (unsigned long)sites);
+        goto bench_expm_chain_cleanup;
+    }
+    for (i = 0; i < sites; i += 2) {
+        neel |= (size_t)1 << i;
+    }
+    psi[neel] = MAT_T_1;
+
+    start = bench_now();
+    status = expm_multiply(expm, bench_sparse_matvec, &job, rate, 1.0, psi,
+                           1e-10);
+    elapsed = bench_now() - start;
+    for (i = 0; i < size; i++) {
+        norm += MAT_T_ABS2(psi[i]);
+    }
+    printf("expm %2lu sites %3lu threads: %8.3f s %s |psi|^2 %.12f, "
+           "%lu steps, %lu rejections, %lu matvecs\n",
+           (unsigned long)sites, (unsigned long)threads, elapsed,
+           status == 0 ? "done" : "FAILED", norm,
+           (unsigned long)expm_steps(expm),
+           (unsigned long)expm_rejections(expm),
+           (unsigned long)expm_matvecs(expm));
+
+bench_expm_chain_cleanup:
+    sparsematrix_destroy(job.sparse);
+    threadpool_destroy(job.pool);
+    expm_destroy(expm);
+    free(psi);
+}
+
+static void bench_statevector_threads(size_t qubits, size_t max_threads) {
+    const double hadamard = 0.70710678118654752;
+    Matrix *gate = matrix_create(2, 2);
+    ThreadPool *pool = NULL;
+    StateVector *state = NULL;
+    double start, elapsed, bytes, serial = 0.0;
+    size_t threads, i;
+
+    if (gate == NULL) {
+        printf("statevector threads: could not allocate\n");
+        return;
+    }
+    matrix_set(gate, 1, 1, MAT_T(hadamard));
+    matrix_set(gate, 1, 2, MAT_T(hadamard));
+    matrix_set(gate, 2, 1, MAT_T(hadamard));
+    matrix_set(gate, 2, 2, MAT_T(-hadamard));
+
+    /* every gate reads and writes every amplitude once */
+    bytes = 2.0 * (double)((size_t)1 << qubits) * sizeof(mat_t)
+            * (double)qubits;
+
+    /* powers of two, then `max_threads` itself */
+    for (threads = 1; threads <= max_threads;
+         threads = threads == max_threads || threads * 2 < max_threads
+                       ? threads * 2
+                       : max_threads) {
+        pool = threadpool_create(threads);
+        state = statevector_create_parallel(qubits, pool);
+        if (pool == NULL || state == NULL) {
+            printf("statevector %2lu qubits %3lu threads: could not "
+                   "allocate\n",
+                   (unsigned long)qubits, (unsigned long)threads);
+            statevector_destroy(state);
+            threadpool_destroy(pool);
+            break;
+        }
+
+        start = bench_now();
+        for (i = 0; i < qubits; i++) {
+            statevector_apply_1q(state, gate, i);
+        }
+        elapsed = bench_now() - start;
+        if (threads == 1) {
+            serial = elapsed;
+        }
+        printf("statevector %2lu qubits %3lu threads: %8.3f s %8.2f GB/s "
+               "%6.2fx\n",
+               (unsigned long)qubits, (unsigned long)threads, elapsed,
+               bytes / elapsed * 1e-9, serial / elapsed);
+
+        statevector_destroy(state);
+        threadpool_destroy(pool);
+    }
+
+    matrix_destroy(gate);
+}
+
+static void bench_sampler(size_t qubits, size_t shots, size_t max_threads) {
+    const size_t scans = 1000;
+    StateVector *state = statevector_create(qubits);
+    Matrix *gate = matrix_create(2, 2);
+    Sampler *sampler = NULL;
+    ThreadPool *pool = NULL;
+    double *probabilities = NULL;
+    size_t *counts = NULL;
+    double start, scan, build, serial, parallel, u, total = 0;
+    unsigned long seed = 1;
+    size_t size = (size_t)1 << qubits;
+    size_t i, j;
+
+    probabilities = malloc(size * sizeof(double));
+    counts = malloc(size * sizeof(size_t));
+    pool = threadpool_create(max_threads);
+    if (state == NULL || gate == NULL || probabilities == NULL
+        || counts == NULL || pool == NULL) {
+        printf("sampler %2lu qubits: could not allocate\n",
+               (unsigned long)qubits);
+        goto bench_sampler_cleanup;
+    }
+    bench_fill(gate, 31);
+    for (i = 0; i < qubits; i++) {
+        statevector_apply_1q(state, gate, i);
+    }
+
+    /* probabilities, then a linear scan of them per shot */
+    start = bench_now();
+    for (i = 0; i < size; i++) {
+        probabilities[i] = MAT_T_ABS2(statevector_get(state, i));
+        total += probabilities[i];
+    }
+    for (j = 0; j < scans; j++) {
+        seed = seed * 1103515245UL + 12345UL;
+        u = total * (double)((seed >> 16) & 0x7fff) / 32768.0;
+        for (i = 0; i + 1 < size && u >= probabilities[i]; i++) {
+            u -= probabilities[i];
+        }
+        counts[j % size] = i;
+    }
+    scan = (bench_now() - start) / (double)scans;
+
+    start = bench_now();
+    sampler = sampler_create(state);
+    build = bench_now() - start;
+    if (sampler == NULL) {
+        printf("sampler %2lu qubits: could not allocate\n",
+               (unsigned long)qubits);
+        goto bench_sampler_cleanup;
+    }
+    start = bench_now();
+    if (sampler_histogram(sampler, counts, shots, 1, NULL) != 0)
+        goto bench_sampler_cleanup;
+    serial = (bench_now() - start) / (double)shots;
+    start = bench_now();
+    if (sampler_histogram(sampler, counts, shots, 1, pool) != 0)
+        goto bench_sampler_cleanup;
+    parallel = (bench_now() - start) / (double)shots;
+
+    printf("sampler %2lu qubits: scan %10.1f ns/shot   alias build %8.3f ms"
+           "   %lu shots %6.1f ns/shot (1 thread) %6.1f ns/shot (%lu)\n",
+           (unsigned long)qubits, 1e9 * scan, 1e3 * build,
+           (unsigned long)shots, 1e9 * serial, 1e9 * parallel,
+           (unsigned long)threadpool_threads(pool));
+
+bench_sampler_cleanup:
+    sampler_destroy(sampler);
+    threadpool_destroy(pool);
+    statevector_destroy(state);
+    matrix_destroy(gate);
+    free(probabilities);
+    free(counts);
+}
+
+int bench_compare(int argc, char **argv) {
+    size_t max_size = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : 1024;
+    size_t naive_limit = argc > 2 ? (size_t)strtoul(argv[2], NULL, 10) : 512;
+    size_t qubits = argc > 3 ? (size_t)strtoul(argv[3], NULL, 10) : 24;
+    size_t max_threads = argc > 4 ? (size_t)strtoul(argv[4], NULL, 10) : 0;
+    size_t sites = argc > 5 ? (size_t)strtoul(argv[5], NULL, 10) : 20;
+    ThreadPool *pool;
+    size_t n;
+
+    for (n = 256; n <= max_size; n *= 2) {
+        bench_matrix_multiply(n, naive_limit);
+    }
+    for (n = 256; n <= max_size; n *= 2) {
+        bench_eigen_hermitian(n, naive_limit);
+    }
+    for (n = 512; n <= 2048; n *= 4) {
+        bench_matrix_qr(n, naive_limit);
+    }
+    for (n = 16; n <= max_size && n <= 256; n *= 4) {
+        bench_matrix_exponential(n, 8);
+    }
+    bench_matrix_kron(32);
+    bench_determinant_arena(4, 1000000);
+    bench_mat4_compose(1000000);
+    bench_kronoperator(qubits);
+    bench_circuit(qubits < 20 ? qubits : 20, 8);
+    bench_tableau(5000, 1000000);
+    for (n = 6; n <= 10 && n <= qubits; n += 2) {
+        bench_densitymatrix(n);
+    }
+    bench_mps(100, 10, 16);
+    bench_mps(100, 10, 32);
+
+    if (max_threads == 0) {
+        pool = threadpool_create(0);
+        max_threads = threadpool_threads(pool);
+        threadpool_destroy(pool);
+    }
+    bench_statevector_threads(qubits, max_threads);
+    bench_sparsematrix_threads(sites, max_threads);
+    bench_lanczos_chain(sites, max_threads);
+    bench_expm_chain(sites, max_threads);
+    bench_sampler(qubits < 20 ? qubits : 20, 10000000, max_threads);
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef BENCH_INTERNAL_H
+#define BENCH_INTERNAL_H
+
+#include "matrix.h"
+
+/* helpers shared by the benchmark suite and the side-by-side comparisons */
+
+/**
+ * Get the current monotonic time in seconds.
+ */
+double bench_now(void);
+
+/**
+ * Fill `matrix` with deterministic pseudo-random values in [-1, 1).
+ */
+void bench_fill(Matrix *matrix, unsigned long seed);
+
+/**
+ * Run the side-by-side comparisons of each optimized path against the one it
+ * replaced, printing a line for each. `argv[1]` to `argv[5]`, all optional,
+ * are the largest matrix size, the largest size for the naive paths, the
+ * qubits for state vector runs, the most threads and the spin chain length.
+ * Return 0.
+ */
+int bench_compare(int argc, char **argv);
+
+#endif
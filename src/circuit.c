@@ -0,0 +1,394 @@
+#include "circuit.h"
+#include "circuit_internal.h"
+#include "instrument_internal.h"
+#include "mat2.h"
+#include "mat4.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <stdbool.h>
+
+/* recorded gates the circuit first makes room for */
+#define CIRCUIT_CAPACITY 16
+
+struct Circuit {
+    size_t qubits;
+
+    CircuitGate *gates;
+    size_t gate_ct;
+    size_t capacity;
+
+    /* fused gates in the order to run them, NULL until compiled */
+    CircuitGate *plan;
+    size_t plan_ct;
+};
+
+/**
+ * Destroy the compiled plan, if any.
+ */
+static void circuit_clear_plan(Circuit *circuit);
+
+/**
+ * Get the mask with bit `q` set for each qubit `q` of `gate`.
+ */
+static size_t circuit_mask(const CircuitGate *gate);
+
+/**
+ * Count the bits set in `mask`.
+ */
+static size_t circuit_count_bits(size_t mask);
+
+/**
+ * Write `gate` into `dest` as a gate on the `count` `qubits`, a superset of
+ * its own: its entries where the other qubits agree, 0 elsewhere.
+ */
+static void circuit_embed(Matrix *dest, const CircuitGate *gate,
+                          const size_t *qubits, size_t count);
+
+/**
+ * Fuse the `member_ct` recorded gates `members`, in order, into `fused`, a
+ * gate on the qubits in `mask`.
+ * Return 0 on success, -1 on failure.
+ */
+static int circuit_fuse(Circuit *circuit, const size_t *members,
+                        size_t member_ct, size_t mask, CircuitGate *fused);
+
+static void circuit_clear_plan(Circuit *circuit) {
+    size_t i;
+
+    if (circuit->plan != NULL) {
+        for (i = 0; i < circuit->plan_ct; i++) {
+            matrix_destroy(circuit->plan[i].matrix);
+        }
+        free(circuit->plan);
+    }
+    circuit->plan = NULL;
+    circuit->plan_ct = 0;
+}
+
+static size_t circuit_mask(const CircuitGate *gate) {
+    size_t mask = 0;
+    size_t i;
+
+    for (i = 0; i < gate->count; i++) {
+        mask |= (size_t)1 << gate->qubits[i];
+    }
+    return mask;
+}
+
+static size_t circuit_count_bits(size_t mask) {
+    size_t count = 0;
+
+    for (; mask != 0; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+}
+
+static void circuit_embed(Matrix *dest, const CircuitGate *gate,
+                          const size_t *qubits, size_t count) {
+    const size_t dimension = (size_t)1 << count;
+    const Matrix *source = gate->matrix;
+    /* the bit of a fused index holding each of the gate's qubits */
+    size_t positions[STATEVECTOR_GATE_QUBITS];
+    size_t covered = 0;
+    size_t row, column, i, j, k;
+
+    for (k = 0; k < gate->count; k++) {
+        i = 0;
+        while (qubits[i] != gate->qubits[k]) {
+            i++;
+        }
+        positions[k] = count - 1 - i;
+        covered |= (size_t)1 << positions[k];
+    }
+
+    for (i = 0; i < dimension; i++) {
+        for (j = 0; j < dimension; j++) {
+            if (((i ^ j) & ~covered) != 0) {
+                dest->values[i * dest->stride + j] = MAT_T_0;
+                continue;
+            }
+            row = 0;
+            column = 0;
+            for (k = 0; k < gate->count; k++) {
+                row = (row << 1) | ((i >> positions[k]) & 1);
+                column = (column << 1) | ((j >> positions[k]) & 1);
+            }
+            dest->values[i * dest->stride + j]
+                = source->values[row * source->stride + column];
+        }
+    }
+}
+
+static int circuit_fuse(Circuit *circuit, const size_t *members,
+                        size_t member_ct, size_t mask, CircuitGate *fused) {
+    Matrix *embedded = NULL;
+    Matrix *product = NULL;
+    Matrix *swap;
+    size_t dimension, q, i;
+
+    /* a gate fused with nothing keeps its own qubit order */
+    if (member_ct == 1) {
+        *fused = circuit->gates[members[0]];
+        fused->matrix = matrix_clone(fused->matrix);
+        return fused->matrix == NULL ? -1 : 0;
+    }
+
+    fused->count = 0;
+    for (q = circuit->qubits; q-- > 0;) {
+        if ((mask >> q) & 1) {
+            fused->qubits[fused->count++] = q;
+        }
+    }
+    dimension = (size_t)1 << fused->count;
+
+    fused->matrix = matrix_create_identity(dimension);
+    if (fused->matrix == NULL)
+        goto circuit_fuse_fail;
+    embedded = matrix_create(dimension, dimension);
+    if (embedded == NULL)
+        goto circuit_fuse_fail;
+    product = matrix_create(dimension, dimension);
+    if (product == NULL)
+        goto circuit_fuse_fail;
+
+    for (i = 0; i < member_ct; i++) {
+        circuit_embed(embedded, &circuit->gates[members[i]], fused->qubits,
+                      fused->count);
+        if (matrix_multiply(product, embedded, fused->matrix) != 0)
+            goto circuit_fuse_fail;
+        swap = fused->matrix;
+        fused->matrix = product;
+        product = swap;
+    }
+
+    matrix_destroy(embedded);
+    matrix_destroy(product);
+    return 0;
+circuit_fuse_fail:
+    matrix_destroy(fused->matrix);
+    fused->matrix = NULL;
+    matrix_destroy(embedded);
+    matrix_destroy(product);
+    return -1;
+}
+
+int circuit_add(Circuit *circuit, Matrix *gate, const size_t *qubits,
+                size_t count) {
+    CircuitGate *gates;
+    CircuitGate *added;
+    size_t i, j;
+
+    if (count == 0 || count > STATEVECTOR_GATE_QUBITS) {
+        report_logic_error("gate must act on 1 to STATEVECTOR_GATE_QUBITS "
+                           "qubits");
+    }
+    if (gate->height != (size_t)1 << count
+        || gate->width != (size_t)1 << count) {
+        report_logic_error("gate on k qubits must be 2^k x 2^k");
+    }
+    for (i = 0; i < count; i++) {
+        if (qubits[i] >= circuit->qubits) {
+            report_logic_error("qubit out of bounds");
+        }
+        for (j = 0; j < i; j++) {
+            if (qubits[j] == qubits[i]) {
+                report_logic_error("gate qubits must be distinct");
+            }
+        }
+    }
+
+    if (circuit->gate_ct == circuit->capacity) {
+        gates = realloc(circuit->gates,
+                        2 * circuit->capacity * sizeof(CircuitGate));
+        if (gates == NULL)
+            return -1;
+        circuit->gates = gates;
+        circuit->capacity *= 2;
+    }
+    added = &circuit->gates[circuit->gate_ct];
+    added->matrix = matrix_clone(gate);
+    if (added->matrix == NULL)
+        return -1;
+    for (i = 0; i < count; i++) {
+        added->qubits[i] = qubits[i];
+    }
+    added->count = count;
+    circuit->gate_ct++;
+
+    circuit_clear_plan(circuit);
+    return 0;
+}
+
+int circuit_add_1q(Circuit *circuit, Matrix *gate, size_t target) {
+    return circuit_add(circuit, gate, &target, 1);
+}
+
+int circuit_add_controlled_1q(Circuit *circuit, Matrix *gate, size_t control,
+                              size_t target) {
+    Matrix *controlled = matrix_create(4, 4);
+    size_t qubits[2];
+    Mat2 small;
+    Mat4 large;
+    int result;
+
+    if (controlled == NULL)
+        return -1;
+    mat2_from_matrix(&small, gate);
+    mat4_controlled(&large, &small);
+    mat4_to_matrix(controlled, &large);
+    qubits[0] = control;
+    qubits[1] = target;
+
+    result = circuit_add(circuit, controlled, qubits, 2);
+    matrix_destroy(controlled);
+    return result;
+}
+
+int circuit_add_2q(Circuit *circuit, Matrix *gate, size_t high, size_t low) {
+    size_t qubits[2];
+
+    qubits[0] = high;
+    qubits[1] = low;
+    return circuit_add(circuit, gate, qubits, 2);
+}
+
+int circuit_compile(Circuit *circuit, size_t max_qubits) {
+    const size_t all = ((size_t)1 << circuit->qubits) - 1;
+    bool *scheduled = NULL;
+    size_t *members = NULL;
+    size_t member_ct, block, blocked, mask, first, i;
+
+    if (max_qubits == 0) {
+        max_qubits = CIRCUIT_FUSE_DEFAULT;
+    }
+    if (max_qubits > STATEVECTOR_GATE_QUBITS) {
+        report_logic_error("cannot fuse gates wider than "
+                           "STATEVECTOR_GATE_QUBITS");
+    }
+
+    circuit_clear_plan(circuit);
+    circuit->plan = malloc((circuit->gate_ct + 1) * sizeof(CircuitGate));
+    if (circuit->plan == NULL)
+        goto circuit_compile_fail;
+    scheduled = calloc(circuit->gate_ct + 1, sizeof(bool));
+    if (scheduled == NULL)
+        goto circuit_compile_fail;
+    members = malloc((circuit->gate_ct + 1) * sizeof(size_t));
+    if (members == NULL)
+        goto circuit_compile_fail;
+
+    /* grow a fused gate from the first gate not yet run; a later gate can
+     * move up into it only past gates on other qubits, which it commutes
+     * with, so the qubits of every gate passed over are blocked */
+    for (first = 0; first < circuit->gate_ct; first++) {
+        if (scheduled[first]) {
+            continue;
+        }
+        member_ct = 0;
+        block = 0;
+        blocked = 0;
+        for (i = first; i < circuit->gate_ct && blocked != all; i++) {
+            if (scheduled[i]) {
+                continue;
+            }
+            mask = circuit_mask(&circuit->gates[i]);
+            if ((mask & blocked) == 0
+                && (member_ct == 0
+                    || circuit_count_bits(block | mask) <= max_qubits)) {
+                members[member_ct++] = i;
+                block |= mask;
+                scheduled[i] = true;
+            } else {
+                blocked |= mask;
+            }
+        }
+        if (circuit_fuse(circuit, members, member_ct, block,
+                         &circuit->plan[circuit->plan_ct])
+            != 0)
+            goto circuit_compile_fail;
+        circuit->plan_ct++;
+    }
+
+    free(scheduled);
+    free(members);
+    return 0;
+circuit_compile_fail:
+    circuit_clear_plan(circuit);
+    free(scheduled);
+    free(members);
+    return -1;
+}
+
+void circuit_run(Circuit *circuit, StateVector *state) {
+    const CircuitGate *gates = circuit_schedule(circuit);
+    const size_t count = circuit_passes(circuit);
+    size_t i;
+
+    if (statevector_qubits(state) != circuit->qubits) {
+        report_logic_error("state and circuit have different qubit counts");
+    }
+    INSTRUMENT_BEGIN(INSTRUMENT_CIRCUIT_RUN);
+    for (i = 0; i < count; i++) {
+        if (gates[i].count == 1) {
+            statevector_apply_1q(state, gates[i].matrix, gates[i].qubits[0]);
+        } else if (gates[i].count == 2) {
+            statevector_apply_2q(state, gates[i].matrix, gates[i].qubits[0],
+                                 gates[i].qubits[1]);
+        } else {
+            statevector_apply_kq(state, gates[i].matrix, gates[i].qubits,
+                                 gates[i].count);
+        }
+    }
+    INSTRUMENT_END();
+}
+
+const CircuitGate *circuit_schedule(Circuit *circuit) {
+    return circuit->plan != NULL ? circuit->plan : circuit->gates;
+}
+
+size_t circuit_qubits(Circuit *circuit) { return circuit->qubits; }
+
+size_t circuit_gates(Circuit *circuit) { return circuit->gate_ct; }
+
+size_t circuit_passes(Circuit *circuit) {
+    return circuit->plan != NULL ? circuit->plan_ct : circuit->gate_ct;
+}
+
+Circuit *circuit_create(size_t qubits) {
+    Circuit *circuit;
+
+    if (qubits >= sizeof(size_t) * 8) {
+        report_logic_error("too many qubits for this platform");
+    }
+
+    circuit = calloc(1, sizeof(Circuit));
+    if (circuit == NULL)
+        goto circuit_create_fail;
+    circuit->qubits = qubits;
+
+    circuit->gates = malloc(CIRCUIT_CAPACITY * sizeof(CircuitGate));
+    if (circuit->gates == NULL)
+        goto circuit_create_fail;
+    circuit->capacity = CIRCUIT_CAPACITY;
+
+    return circuit;
+circuit_create_fail:
+    circuit_destroy(circuit);
+    return NULL;
+}
+
+void circuit_destroy(Circuit *circuit) {
+    size_t i;
+
+    if (circuit != NULL) {
+        circuit_clear_plan(circuit);
+        if (circuit->gates != NULL) {
+            for (i = 0; i < circuit->gate_ct; i++) {
+                matrix_destroy(circuit->gates[i].matrix);
+            }
+        }
+        free(circuit->gates);
+        free(circuit);
+    }
+}
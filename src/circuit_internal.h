@@ -0,0 +1,24 @@
+#ifndef CIRCUIT_INTERNAL_H
+#define CIRCUIT_INTERNAL_H
+
+#include "circuit.h"
+#include "matrix.h"
+#include "statevector.h"
+#include <stdlib.h>
+
+/**
+ * A gate and the qubits it acts on, most significant first.
+ */
+typedef struct CircuitGate {
+    Matrix *matrix;
+    size_t qubits[STATEVECTOR_GATE_QUBITS];
+    size_t count;
+} CircuitGate;
+
+/**
+ * Get the `circuit_passes` gates `circuit_run` applies, in order: the
+ * compiled plan if there is one, else the recorded gates.
+ */
+const CircuitGate *circuit_schedule(Circuit *circuit);
+
+#endif
@@ -0,0 +1,385 @@
+#include "densitymatrix.h"
+#include "instrument_internal.h"
+#include "mat2.h"
+#include "mat4.h"
+#include "reporter.h"
+#include <math.h>
+#include <stdlib.h>
+
+struct DensityMatrix {
+    size_t qubits;
+    size_t size;
+
+    /* row-major, `size` x `size` */
+    mat_t *values;
+};
+
+/**
+ * Check that `qubit` is in the state.
+ */
+static void densitymatrix_check(DensityMatrix *rho, size_t qubit);
+
+/**
+ * Insert a 0 bit into `index` at each of the `count` positions in `bits`,
+ * which must be sorted in increasing order.
+ */
+static size_t densitymatrix_insert_zero_bits(size_t index, const size_t *bits,
+                                             size_t count);
+
+/**
+ * Copy the 2x2 block of rows `i` and `i | bit` and columns `j` and `j | bit`
+ * into `block`.
+ */
+static void densitymatrix_load_block(DensityMatrix *rho, size_t i, size_t j,
+                                     size_t bit, Mat2 *block);
+
+/**
+ * Copy `block` back to where `densitymatrix_load_block` found it.
+ */
+static void densitymatrix_store_block(DensityMatrix *rho, size_t i, size_t j,
+                                      size_t bit, const Mat2 *block);
+
+static void densitymatrix_check(DensityMatrix *rho, size_t qubit) {
+    if (qubit >= rho->qubits) {
+        report_logic_error("qubit out of bounds");
+    }
+}
+
+static size_t densitymatrix_insert_zero_bits(size_t index, const size_t *bits,
+                                             size_t count) {
+    size_t i, low_mask;
+    for (i = 0; i < count; i++) {
+        low_mask = ((size_t)1 << bits[i]) - 1;
+        index = ((index & ~low_mask) << 1) | (index & low_mask);
+    }
+    return index;
+}
+
+static void densitymatrix_load_block(DensityMatrix *rho, size_t i, size_t j,
+                                     size_t bit, Mat2 *block) {
+    const mat_t *row0 = rho->values + i * rho->size;
+    const mat_t *row1 = row0 + bit * rho->size;
+
+    block->values[0] = row0[j];
+    block->values[1] = row0[j | bit];
+    block->values[2] = row1[j];
+    block->values[3] = row1[j | bit];
+}
+
+static void densitymatrix_store_block(DensityMatrix *rho, size_t i, size_t j,
+                                      size_t bit, const Mat2 *block) {
+    mat_t *row0 = rho->values + i * rho->size;
+    mat_t *row1 = row0 + bit * rho->size;
+
+    row0[j] = block->values[0];
+    row0[j | bit] = block->values[1];
+    row1[j] = block->values[2];
+    row1[j | bit] = block->values[3];
+}
+
+size_t densitymatrix_qubits(DensityMatrix *rho) { return rho->qubits; }
+
+size_t densitymatrix_size(DensityMatrix *rho) { return rho->size; }
+
+mat_t densitymatrix_get(DensityMatrix *rho, size_t row, size_t column) {
+    if (row >= rho->size || column >= rho->size) {
+        report_logic_error("index out of bounds");
+    }
+    return rho->values[row * rho->size + column];
+}
+
+mat_t densitymatrix_trace(DensityMatrix *rho) {
+    mat_t sum = MAT_T_0;
+    size_t i;
+
+    for (i = 0; i < rho->size; i++) {
+        sum = MAT_T_ADD(sum, rho->values[i * rho->size + i]);
+    }
+    return sum;
+}
+
+void densitymatrix_apply_1q(DensityMatrix *rho, Matrix *gate, size_t target) {
+    const size_t bit = (size_t)1 << target;
+    const size_t half = rho->size >> 1;
+    Mat2 u, adjoint, block;
+    size_t i, j, row, column;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_DENSITYMATRIX_APPLY_1Q);
+    densitymatrix_check(rho, target);
+    mat2_from_matrix(&u, gate);
+    mat2_adjoint(&adjoint, &u);
+
+    /* U rho U^H only mixes the entries of each 2x2 block of rows and
+     * columns that differ in bit `target` */
+    for (i = 0; i < half; i++) {
+        row = densitymatrix_insert_zero_bits(i, &target, 1);
+        for (j = 0; j < half; j++) {
+            column = densitymatrix_insert_zero_bits(j, &target, 1);
+            densitymatrix_load_block(rho, row, column, bit, &block);
+            mat2_multiply(&block, &u, &block);
+            mat2_multiply(&block, &block, &adjoint);
+            densitymatrix_store_block(rho, row, column, bit, &block);
+        }
+    }
+    /* two 2x2 products per block */
+    INSTRUMENT_FLOPS(16.0 * half * half * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+}
+
+void densitymatrix_apply_2q(DensityMatrix *rho, Matrix *gate, size_t high,
+                            size_t low) {
+    const size_t quarter = rho->size >> 2;
+    const size_t size = rho->size;
+    size_t offsets[4];
+    size_t bits[2];
+    Mat4 u, adjoint, block;
+    size_t i, j, row, column, r, c;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_DENSITYMATRIX_APPLY_2Q);
+    densitymatrix_check(rho, high);
+    densitymatrix_check(rho, low);
+    if (high == low) {
+        report_logic_error("two-qubit gate needs two distinct qubits");
+    }
+    mat4_from_matrix(&u, gate);
+    mat4_adjoint(&adjoint, &u);
+    offsets[0] = 0;
+    offsets[1] = (size_t)1 << low;
+    offsets[2] = (size_t)1 << high;
+    offsets[3] = offsets[1] | offsets[2];
+    bits[0] = high < low ? high : low;
+    bits[1] = high < low ? low : high;
+
+    for (i = 0; i < quarter; i++) {
+        row = densitymatrix_insert_zero_bits(i, bits, 2);
+        for (j = 0; j < quarter; j++) {
+            column = densitymatrix_insert_zero_bits(j, bits, 2);
+            for (r = 0; r < 4; r++) {
+                for (c = 0; c < 4; c++) {
+                    block.values[4 * r + c]
+                        = rho->values[(row | offsets[r]) * size
+                                      + (column | offsets[c])];
+                }
+            }
+            mat4_multiply(&block, &u, &block);
+            mat4_multiply(&block, &block, &adjoint);
+            for (r = 0; r < 4; r++) {
+                for (c = 0; c < 4; c++) {
+                    rho->values[(row | offsets[r]) * size
+                                + (column | offsets[c])]
+                        = block.values[4 * r + c];
+                }
+            }
+        }
+    }
+    /* two 4x4 products per block */
+    INSTRUMENT_FLOPS(128.0 * quarter * quarter * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+}
+
+int densitymatrix_apply_kraus_1q(DensityMatrix *rho, Matrix **operators,
+                                 size_t count, size_t target) {
+    const size_t bit = (size_t)1 << target;
+    const size_t half = rho->size >> 1;
+    Mat2 *kraus;
+    Mat2 block, term, sum;
+    size_t i, j, k, l, row, column;
+
+    densitymatrix_check(rho, target);
+    if (count == 0) {
+        report_logic_error("channel needs at least one Kraus operator");
+    }
+    INSTRUMENT_BEGIN(INSTRUMENT_DENSITYMATRIX_APPLY_KRAUS_1Q);
+    kraus = malloc(2 * count * sizeof(Mat2));
+    if (kraus == NULL) {
+        INSTRUMENT_END();
+        return -1;
+    }
+    INSTRUMENT_BYTES(2 * count * sizeof(Mat2));
+    for (k = 0; k < count; k++) {
+        mat2_from_matrix(&kraus[2 * k], operators[k]);
+        mat2_adjoint(&kraus[2 * k + 1], &kraus[2 * k]);
+    }
+
+    for (i = 0; i < half; i++) {
+        row = densitymatrix_insert_zero_bits(i, &target, 1);
+        for (j = 0; j < half; j++) {
+            column = densitymatrix_insert_zero_bits(j, &target, 1);
+            densitymatrix_load_block(rho, row, column, bit, &block);
+            for (l = 0; l < 4; l++) {
+                sum.values[l] = MAT_T_0;
+            }
+            for (k = 0; k < count; k++) {
+                mat2_multiply(&term, &kraus[2 * k], &block);
+                mat2_multiply(&term, &term, &kraus[2 * k + 1]);
+                for (l = 0; l < 4; l++) {
+                    sum.values[l] = MAT_T_ADD(sum.values[l], term.values[l]);
+                }
+            }
+            densitymatrix_store_block(rho, row, column, bit, &sum);
+        }
+    }
+
+    free(kraus);
+    INSTRUMENT_FLOPS(16.0 * count * half * half * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+    return 0;
+}
+
+void densitymatrix_depolarize(DensityMatrix *rho, double p, size_t target) {
+    const size_t bit = (size_t)1 << target;
+    const size_t half = rho->size >> 1;
+    /* (X B X + Y B Y + Z B Z) / 3 swaps weight between the diagonal entries
+     * of each block and negates the off-diagonal ones */
+    const mat_t keep = MAT_T(1.0 - 2.0 * p / 3.0);
+    const mat_t move = MAT_T(2.0 * p / 3.0);
+    const mat_t shrink = MAT_T(1.0 - 4.0 * p / 3.0);
+    Mat2 block;
+    mat_t a, d;
+    size_t i, j, row, column;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_DENSITYMATRIX_DEPOLARIZE);
+    densitymatrix_check(rho, target);
+    for (i = 0; i < half; i++) {
+        row = densitymatrix_insert_zero_bits(i, &target, 1);
+        for (j = 0; j < half; j++) {
+            column = densitymatrix_insert_zero_bits(j, &target, 1);
+            densitymatrix_load_block(rho, row, column, bit, &block);
+            a = block.values[0];
+            d = block.values[3];
+            block.values[0] = MAT_T_ADD(MAT_T_MUL(keep, a), MAT_T_MUL(move, d));
+            block.values[1] = MAT_T_MUL(shrink, block.values[1]);
+            block.values[2] = MAT_T_MUL(shrink, block.values[2]);
+            block.values[3] = MAT_T_ADD(MAT_T_MUL(keep, d), MAT_T_MUL(move, a));
+            densitymatrix_store_block(rho, row, column, bit, &block);
+        }
+    }
+    INSTRUMENT_FLOPS(6.0 * half * half * INSTRUMENT_MUL_FLOPS);
+    INSTRUMENT_END();
+}
+
+void densitymatrix_amplitude_damp(DensityMatrix *rho, double gamma,
+                                  size_t target) {
+    const size_t bit = (size_t)1 << target;
+    const size_t half = rho->size >> 1;
+    /* Kraus operators [[1, 0], [0, sqrt(1 - gamma)]] and
+     * [[0, sqrt(gamma)], [0, 0]], summed over in closed form */
+    const mat_t decay = MAT_T(gamma);
+    const mat_t remain = MAT_T(1.0 - gamma);
+    const mat_t shrink = MAT_T(sqrt(1.0 - gamma));
+    Mat2 block;
+    size_t i, j, row, column;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_DENSITYMATRIX_AMPLITUDE_DAMP);
+    densitymatrix_check(rho, target);
+    for (i = 0; i < half; i++) {
+        row = densitymatrix_insert_zero_bits(i, &target, 1);
+        for (j = 0; j < half; j++) {
+            column = densitymatrix_insert_zero_bits(j, &target, 1);
+            densitymatrix_load_block(rho, row, column, bit, &block);
+            block.values[0] = MAT_T_ADD(block.values[0],
+                                        MAT_T_MUL(decay, block.values[3]));
+            block.values[1] = MAT_T_MUL(shrink, block.values[1]);
+            block.values[2] = MAT_T_MUL(shrink, block.values[2]);
+            block.values[3] = MAT_T_MUL(remain, block.values[3]);
+            densitymatrix_store_block(rho, row, column, bit, &block);
+        }
+    }
+    INSTRUMENT_FLOPS(4.0 * half * half * INSTRUMENT_MUL_FLOPS);
+    INSTRUMENT_END();
+}
+
+void densitymatrix_partial_trace(DensityMatrix *dest, DensityMatrix *rho,
+                                 const size_t *traced, size_t count) {
+    size_t bits[sizeof(size_t) * 8];
+    size_t mask = 0;
+    size_t i, j, row, column, offset;
+    mat_t sum;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_DENSITYMATRIX_PARTIAL_TRACE);
+    if (dest == rho) {
+        report_logic_error("partial trace cannot be taken in place");
+    }
+    if (count > rho->qubits || dest->qubits != rho->qubits - count) {
+        report_logic_error("destination must have the qubits not traced");
+    }
+    for (i = 0; i < count; i++) {
+        densitymatrix_check(rho, traced[i]);
+        if ((mask >> traced[i]) & 1) {
+            report_logic_error("traced qubits must be distinct");
+        }
+        mask |= (size_t)1 << traced[i];
+    }
+    /* the traced qubits in increasing order */
+    for (i = 0, j = 0; i < rho->qubits; i++) {
+        if ((mask >> i) & 1) {
+            bits[j++] = i;
+        }
+    }
+
+    /* sum the entries whose traced qubits agree, stepping `offset` through
+     * every subset of `mask` */
+    for (i = 0; i < dest->size; i++) {
+        row = densitymatrix_insert_zero_bits(i, bits, count);
+        for (j = 0; j < dest->size; j++) {
+            column = densitymatrix_insert_zero_bits(j, bits, count);
+            sum = MAT_T_0;
+            offset = 0;
+            do {
+                sum = MAT_T_ADD(sum, rho->values[(row | offset) * rho->size
+                                                 + (column | offset)]);
+                offset = (offset - mask) & mask;
+            } while (offset != 0);
+            dest->values[i * dest->size + j] = sum;
+        }
+    }
+    INSTRUMENT_END();
+}
+
+DensityMatrix *densitymatrix_create(size_t qubits) {
+    DensityMatrix *rho;
+
+    if (qubits >= sizeof(size_t) * 4) {
+        report_logic_error("too many qubits for this platform");
+    }
+
+    rho = calloc(1, sizeof(DensityMatrix));
+    if (rho == NULL)
+        goto densitymatrix_create_fail;
+    rho->qubits = qubits;
+    rho->size = (size_t)1 << qubits;
+
+    rho->values = calloc(rho->size * rho->size, sizeof(mat_t));
+    if (rho->values == NULL)
+        goto densitymatrix_create_fail;
+    rho->values[0] = MAT_T_1;
+
+    return rho;
+densitymatrix_create_fail:
+    densitymatrix_destroy(rho);
+    return NULL;
+}
+
+DensityMatrix *densitymatrix_create_from_state(StateVector *state) {
+    DensityMatrix *rho = densitymatrix_create(statevector_qubits(state));
+    mat_t amplitude;
+    size_t i, j;
+
+    if (rho == NULL)
+        return NULL;
+    for (i = 0; i < rho->size; i++) {
+        amplitude = statevector_get(state, i);
+        for (j = 0; j < rho->size; j++) {
+            rho->values[i * rho->size + j]
+                = MAT_T_MUL(amplitude, MAT_T_CONJ(statevector_get(state, j)));
+        }
+    }
+    return rho;
+}
+
+void densitymatrix_destroy(DensityMatrix *rho) {
+    if (rho != NULL) {
+        free(rho->values);
+        free(rho);
+    }
+}
@@ -0,0 +1,563 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "diskstate.h"
+#include "circuit_internal.h"
+#include "instrument_internal.h"
+#include "matrixfile.h"
+#include "reporter.h"
+#include "statevector_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+struct DiskState {
+    size_t qubits;
+    size_t chunk_qubits;
+    size_t chunk_size;
+    size_t chunks;
+
+    /* the amplitudes, as a 2^qubits x 1 matrix file */
+    int descriptor;
+
+    /* the bit of a file index holding each qubit, and the qubit held by each
+     * bit; they differ once swap passes have moved qubits */
+    size_t *positions;
+    size_t *qubit_at;
+
+    /* the chunk being worked on and the chunk being written and read */
+    StateVector *buffers[2];
+
+    /* since the last run or reorder started */
+    size_t bytes_read;
+    size_t bytes_written;
+    size_t passes;
+    size_t swap_passes;
+};
+
+/**
+ * Arguments for the I/O done behind a chunk's gates: write one buffer back to
+ * its chunk, then read the next chunk into it.
+ */
+typedef struct DiskStateTransfer {
+    DiskState *state;
+    mat_t *values;
+    bool writing;
+    size_t write_chunk;
+    bool reading;
+    size_t read_chunk;
+    int result;
+} DiskStateTransfer;
+
+/**
+ * Read (or write, if `writing`) the `count` amplitudes from file index
+ * `index` on.
+ * Return 0 on success, -1 on failure.
+ */
+static int diskstate_io(DiskState *state, size_t index, mat_t *values,
+                        size_t count, bool writing);
+
+/**
+ * Read chunk `chunk` into `values`, counting the bytes read.
+ * Return 0 on success, -1 on failure.
+ */
+static int diskstate_read_chunk(DiskState *state, size_t chunk,
+                                mat_t *values);
+
+/**
+ * Write `values` to chunk `chunk`, counting the bytes written.
+ * Return 0 on success, -1 on failure.
+ */
+static int diskstate_write_chunk(DiskState *state, size_t chunk,
+                                 const mat_t *values);
+
+/**
+ * Run the transfer in `context`, a DiskStateTransfer.
+ */
+static void *diskstate_transfer_task(void *context);
+
+/**
+ * Get whether every qubit of `gate` is held by a bit within a chunk.
+ */
+static bool diskstate_is_local(DiskState *state, const CircuitGate *gate);
+
+/**
+ * Apply the gates [`begin`, `end`) of `gates`, all local, in one pass over
+ * the file.
+ * Return 0 on success, -1 on failure.
+ */
+static int diskstate_gate_pass(DiskState *state, const CircuitGate *gates,
+                               size_t begin, size_t end);
+
+/**
+ * Exchange the qubits held by file bits `a[j]` and `b[j]`, for each of the
+ * `count` pairs, in one pass over the file.
+ * Return 0 on success, -1 on failure.
+ */
+static int diskstate_swap_pass(DiskState *state, const size_t *a,
+                               const size_t *b, size_t count);
+
+/**
+ * Bring the qubits of `gates[next]` that are not within a chunk into it, in
+ * place of the chunk qubits used furthest in the future.
+ * Return 0 on success, -1 on failure.
+ */
+static int diskstate_localize(DiskState *state, const CircuitGate *gates,
+                              size_t count, size_t next);
+
+/**
+ * Zero the I/O counters.
+ */
+static void diskstate_reset_counters(DiskState *state);
+
+static int diskstate_io(DiskState *state, size_t index, mat_t *values,
+                        size_t count, bool writing) {
+    unsigned char *bytes = (unsigned char *)values;
+    size_t left = count * sizeof(mat_t);
+    off_t offset = (off_t)(MATRIXFILE_OFFSET + index * sizeof(mat_t));
+    ssize_t done;
+
+    while (left > 0) {
+        done = writing ? pwrite(state->descriptor, bytes, left, offset)
+                       : pread(state->descriptor, bytes, left, offset);
+        if (done < 0 && errno == EINTR)
+            continue;
+        if (done <= 0)
+            return -1;
+        bytes += done;
+        left -= (size_t)done;
+        offset += done;
+    }
+    return 0;
+}
+
+static int diskstate_read_chunk(DiskState *state, size_t chunk,
+                                mat_t *values) {
+    if (diskstate_io(state, chunk * state->chunk_size, values,
+                     state->chunk_size, false)
+        != 0)
+        return -1;
+    state->bytes_read += state->chunk_size * sizeof(mat_t);
+    return 0;
+}
+
+static int diskstate_write_chunk(DiskState *state, size_t chunk,
+                                 const mat_t *values) {
+    if (diskstate_io(state, chunk * state->chunk_size, (mat_t *)values,
+                     state->chunk_size, true)
+        != 0)
+        return -1;
+    state->bytes_written += state->chunk_size * sizeof(mat_t);
+    return 0;
+}
+
+static void *diskstate_transfer_task(void *context) {
+    DiskStateTransfer *transfer = context;
+
+    transfer->result = 0;
+    if (transfer->writing
+        && diskstate_write_chunk(transfer->state, transfer->write_chunk,
+                                 transfer->values)
+               != 0) {
+        transfer->result = -1;
+        return NULL;
+    }
+    if (transfer->reading
+        && diskstate_read_chunk(transfer->state, transfer->read_chunk,
+                                transfer->values)
+               != 0) {
+        transfer->result = -1;
+    }
+    return NULL;
+}
+
+static bool diskstate_is_local(DiskState *state, const CircuitGate *gate) {
+    size_t k;
+
+    for (k = 0; k < gate->count; k++) {
+        if (state->positions[gate->qubits[k]] >= state->chunk_qubits)
+            return false;
+    }
+    return true;
+}
+
+static int diskstate_gate_pass(DiskState *state, const CircuitGate *gates,
+                               size_t begin, size_t end) {
+    StateVector *current = state->buffers[0];
+    StateVector *other = state->buffers[1];
+    StateVector *swap;
+    DiskStateTransfer transfer;
+    pthread_t thread;
+    bool threaded;
+    size_t bits[STATEVECTOR_GATE_QUBITS];
+    size_t chunk, i, k;
+
+    if (diskstate_read_chunk(state, 0, current->amplitudes) != 0)
+        return -1;
+    for (chunk = 0; chunk < state->chunks; chunk++) {
+        /* write the chunk just finished and read the next one while this
+         * one's gates run */
+        transfer.state = state;
+        transfer.values = other->amplitudes;
+        transfer.writing = chunk > 0;
+        transfer.write_chunk = chunk - 1;
+        transfer.reading = chunk + 1 < state->chunks;
+        transfer.read_chunk = chunk + 1;
+        transfer.result = 0;
+        threaded = (transfer.writing || transfer.reading)
+                   && pthread_create(&thread, NULL, diskstate_transfer_task,
+                                     &transfer)
+                          == 0;
+
+        for (i = begin; i < end; i++) {
+            for (k = 0; k < gates[i].count; k++) {
+                bits[k] = state->positions[gates[i].qubits[k]];
+            }
+            if (gates[i].count == 1) {
+                statevector_apply_1q(current, gates[i].matrix, bits[0]);
+            } else if (gates[i].count == 2) {
+                statevector_apply_2q(current, gates[i].matrix, bits[0],
+                                     bits[1]);
+            } else {
+                statevector_apply_kq(current, gates[i].matrix, bits,
+                                     gates[i].count);
+            }
+        }
+
+        if (threaded) {
+            pthread_join(thread, NULL);
+        } else {
+            diskstate_transfer_task(&transfer);
+        }
+        if (transfer.result != 0)
+            return -1;
+        swap = current;
+        current = other;
+        other = swap;
+    }
+    if (diskstate_write_chunk(state, state->chunks - 1, other->amplitudes)
+        != 0)
+        return -1;
+    state->passes++;
+    return 0;
+}
+
+static int diskstate_swap_pass(DiskState *state, const size_t *a,
+                               const size_t *b, size_t count) {
+    const size_t local = state->chunk_qubits;
+    /* the file bits outside a chunk taking part, in increasing order; the
+     * chunks that differ only in them are swapped among as a group */
+    size_t global[2 * STATEVECTOR_GATE_QUBITS];
+    size_t global_ct = 0;
+    size_t global_mask = 0;
+    /* each pair's bits within a group's values */
+    size_t group_a[STATEVECTOR_GATE_QUBITS];
+    size_t group_b[STATEVECTOR_GATE_QUBITS];
+    mat_t *group = NULL;
+    mat_t temp;
+    size_t members, base, member, chunk, x, y, i, j, qubit;
+
+    for (j = 0; j < 2 * count; j++) {
+        x = j < count ? a[j] : b[j - count];
+        if (x >= local && (global_mask & (size_t)1 << (x - local)) == 0) {
+            global_mask |= (size_t)1 << (x - local);
+        }
+    }
+    for (x = 0; x < state->qubits - local; x++) {
+        if (global_mask & (size_t)1 << x) {
+            global[global_ct++] = x;
+        }
+    }
+    for (j = 0; j < count; j++) {
+        group_a[j] = a[j];
+        group_b[j] = b[j];
+        for (i = 0; i < global_ct; i++) {
+            if (a[j] == local + global[i]) {
+                group_a[j] = local + i;
+            }
+            if (b[j] == local + global[i]) {
+                group_b[j] = local + i;
+            }
+        }
+    }
+
+    members = (size_t)1 << global_ct;
+    group = malloc(members * state->chunk_size * sizeof(mat_t));
+    if (group == NULL)
+        goto diskstate_swap_pass_fail;
+
+    for (base = 0; base < state->chunks; base++) {
+        if ((base & global_mask) != 0)
+            continue;
+        for (member = 0; member < members; member++) {
+            chunk = base;
+            for (i = 0; i < global_ct; i++) {
+                chunk |= ((member >> i) & 1) << global[i];
+            }
+            if (diskstate_read_chunk(state, chunk,
+                                     group + member * state->chunk_size)
+                != 0)
+                goto diskstate_swap_pass_fail;
+        }
+
+        /* exchanging bits pairs each value with one other */
+        for (x = 0; x < members * state->chunk_size; x++) {
+            y = x;
+            for (j = 0; j < count; j++) {
+                if (((x >> group_a[j]) & 1) != ((x >> group_b[j]) & 1)) {
+                    y ^= (size_t)1 << group_a[j] | (size_t)1 << group_b[j];
+                }
+            }
+            if (x < y) {
+                temp = group[x];
+                group[x] = group[y];
+                group[y] = temp;
+            }
+        }
+
+        for (member = 0; member < members; member++) {
+            chunk = base;
+            for (i = 0; i < global_ct; i++) {
+                chunk |= ((member >> i) & 1) << global[i];
+            }
+            if (diskstate_write_chunk(state, chunk,
+                                      group + member * state->chunk_size)
+                != 0)
+                goto diskstate_swap_pass_fail;
+        }
+    }
+    free(group);
+
+    for (j = 0; j < count; j++) {
+        qubit = state->qubit_at[a[j]];
+        state->qubit_at[a[j]] = state->qubit_at[b[j]];
+        state->qubit_at[b[j]] = qubit;
+        state->positions[state->qubit_at[a[j]]] = a[j];
+        state->positions[state->qubit_at[b[j]]] = b[j];
+    }
+    state->passes++;
+    state->swap_passes++;
+    return 0;
+
+diskstate_swap_pass_fail:
+    free(group);
+    return -1;
+}
+
+static int diskstate_localize(DiskState *state, const CircuitGate *gates,
+                              size_t count, size_t next) {
+    const CircuitGate *gate = &gates[next];
+    size_t incoming[STATEVECTOR_GATE_QUBITS];
+    size_t outgoing[STATEVECTOR_GATE_QUBITS];
+    size_t *next_use = NULL;
+    size_t swap_ct = 0;
+    size_t i, k, p, best;
+    int result;
+
+    next_use = malloc(state->chunk_qubits * sizeof(size_t));
+    if (next_use == NULL)
+        return -1;
+
+    for (k = 0; k < gate->count; k++) {
+        if (state->positions[gate->qubits[k]] >= state->chunk_qubits) {
+            incoming[swap_ct++] = state->positions[gate->qubits[k]];
+        }
+    }
+    /* the gate after which each chunk qubit is next used, `count` if never */
+    for (p = 0; p < state->chunk_qubits; p++) {
+        next_use[p] = count;
+        for (i = next; i < count && next_use[p] == count; i++) {
+            for (k = 0; k < gates[i].count; k++) {
+                if (gates[i].qubits[k] == state->qubit_at[p]) {
+                    next_use[p] = i;
+                }
+            }
+        }
+    }
+    /* evict the qubits needed last; the gate's own are needed first */
+    for (k = 0; k < swap_ct; k++) {
+        best = 0;
+        for (p = 1; p < state->chunk_qubits; p++) {
+            if (next_use[p] > next_use[best]
+                || (next_use[p] == next_use[best] && p > best)) {
+                best = p;
+            }
+        }
+        outgoing[k] = best;
+        next_use[best] = 0;
+    }
+    free(next_use);
+
+    result = diskstate_swap_pass(state, incoming, outgoing, swap_ct);
+    return result;
+}
+
+static void diskstate_reset_counters(DiskState *state) {
+    state->bytes_read = 0;
+    state->bytes_written = 0;
+    state->passes = 0;
+    state->swap_passes = 0;
+}
+
+size_t diskstate_qubits(DiskState *state) { return state->qubits; }
+
+size_t diskstate_chunk_qubits(DiskState *state) {
+    return state->chunk_qubits;
+}
+
+int diskstate_get(DiskState *state, size_t index, mat_t *value) {
+    size_t position = 0;
+    size_t q;
+
+    if (index >= (size_t)1 << state->qubits) {
+        report_logic_error("basis state out of bounds");
+    }
+    for (q = 0; q < state->qubits; q++) {
+        position |= ((index >> q) & 1) << state->positions[q];
+    }
+    return diskstate_io(state, position, value, 1, false);
+}
+
+int diskstate_run(DiskState *state, Circuit *circuit) {
+    const CircuitGate *gates = circuit_schedule(circuit);
+    const size_t count = circuit_passes(circuit);
+    size_t i, end;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_DISKSTATE_RUN);
+    if (circuit_qubits(circuit) != state->qubits) {
+        report_logic_error("state and circuit have different qubit counts");
+    }
+    for (i = 0; i < count; i++) {
+        if (gates[i].count > state->chunk_qubits) {
+            report_logic_error("gate acts on more qubits than a chunk holds");
+        }
+    }
+
+    diskstate_reset_counters(state);
+    i = 0;
+    while (i < count) {
+        if (!diskstate_is_local(state, &gates[i])) {
+            if (diskstate_localize(state, gates, count, i) != 0) {
+                INSTRUMENT_END();
+                return -1;
+            }
+        }
+        for (end = i + 1; end < count && diskstate_is_local(state, &gates[end]);
+             end++) {
+            continue;
+        }
+        if (diskstate_gate_pass(state, gates, i, end) != 0) {
+            INSTRUMENT_END();
+            return -1;
+        }
+        i = end;
+    }
+    INSTRUMENT_END();
+    return 0;
+}
+
+int diskstate_reorder(DiskState *state) {
+    size_t p, from;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_DISKSTATE_REORDER);
+    diskstate_reset_counters(state);
+    for (p = 0; p < state->qubits; p++) {
+        if (state->qubit_at[p] != p) {
+            from = state->positions[p];
+            if (diskstate_swap_pass(state, &p, &from, 1) != 0) {
+                INSTRUMENT_END();
+                return -1;
+            }
+        }
+    }
+    INSTRUMENT_END();
+    return 0;
+}
+
+size_t diskstate_bytes_read(DiskState *state) { return state->bytes_read; }
+
+size_t diskstate_bytes_written(DiskState *state) {
+    return state->bytes_written;
+}
+
+size_t diskstate_passes(DiskState *state) { return state->passes; }
+
+size_t diskstate_swap_passes(DiskState *state) { return state->swap_passes; }
+
+DiskState *diskstate_create(const char *path, size_t qubits,
+                            size_t chunk_qubits, ThreadPool *pool) {
+    DiskState *state = NULL;
+    MatrixWriter *writer = NULL;
+    size_t q, chunk;
+
+    if (qubits >= sizeof(size_t) * 8) {
+        report_logic_error("too many qubits for this platform");
+    }
+    if (chunk_qubits > qubits) {
+        report_logic_error("chunk holds more qubits than the state");
+    }
+
+    state = calloc(1, sizeof(DiskState));
+    if (state == NULL)
+        goto diskstate_create_fail;
+    state->descriptor = -1;
+    state->qubits = qubits;
+    state->chunk_qubits = chunk_qubits;
+    state->chunk_size = (size_t)1 << chunk_qubits;
+    state->chunks = (size_t)1 << (qubits - chunk_qubits);
+    state->positions = malloc((qubits > 0 ? qubits : 1) * sizeof(size_t));
+    state->qubit_at = malloc((qubits > 0 ? qubits : 1) * sizeof(size_t));
+    state->buffers[0] = statevector_create_parallel(chunk_qubits, pool);
+    state->buffers[1] = statevector_create_parallel(chunk_qubits, pool);
+    if (state->positions == NULL || state->qubit_at == NULL
+        || state->buffers[0] == NULL || state->buffers[1] == NULL)
+        goto diskstate_create_fail;
+    for (q = 0; q < qubits; q++) {
+        state->positions[q] = q;
+        state->qubit_at[q] = q;
+    }
+
+    /* the first chunk holds |0...0>, and the others are 0 */
+    writer = matrixwriter_create(path, (size_t)1 << qubits, 1);
+    if (writer == NULL)
+        goto diskstate_create_fail;
+    for (chunk = 0; chunk < state->chunks; chunk++) {
+        if (matrixwriter_write(writer, state->buffers[0]->amplitudes,
+                               state->chunk_size)
+            != 0)
+            goto diskstate_create_fail;
+        state->buffers[0]->amplitudes[0] = MAT_T_0;
+    }
+    if (matrixwriter_finish(writer) != 0)
+        goto diskstate_create_fail;
+    matrixwriter_destroy(writer);
+    writer = NULL;
+
+    state->descriptor = open(path, O_RDWR);
+    if (state->descriptor < 0) {
+        report_error("cannot open state file");
+        goto diskstate_create_fail;
+    }
+    return state;
+
+diskstate_create_fail:
+    matrixwriter_destroy(writer);
+    diskstate_destroy(state);
+    return NULL;
+}
+
+void diskstate_destroy(DiskState *state) {
+    if (state != NULL) {
+        if (state->descriptor >= 0) {
+            close(state->descriptor);
+        }
+        statevector_destroy(state->buffers[0]);
+        statevector_destroy(state->buffers[1]);
+        free(state->positions);
+        free(state->qubit_at);
+        free(state);
+    }
+}
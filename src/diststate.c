@@ -0,0 +1,478 @@
+#include "diststate.h"
+#include "circuit_internal.h"
+#include "instrument_internal.h"
+#include "reporter.h"
+#include "statevector_internal.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* an exchange is split into at most 2 ^ this many blocks, so gates can run
+ * on one block while the next is in flight */
+#define DISTSTATE_PIPELINE_QUBITS 3
+
+struct DistState {
+    Transport *transport;
+    size_t qubits;
+    size_t local_qubits;
+
+    /* this rank's share */
+    StateVector *local;
+
+    /* the bit of a full index holding each qubit, and the qubit held by each
+     * bit; bits from `local_qubits` up are the rank's */
+    size_t *positions;
+    size_t *qubit_at;
+
+    /* the halves of a block sent and received */
+    mat_t *send;
+    mat_t *receive;
+
+    /* of the last run */
+    size_t *gate_bytes;
+    size_t gate_ct;
+    size_t bytes_sent;
+    size_t swaps;
+};
+
+/**
+ * Arguments for exchanging one block of a swap with the peer rank: the
+ * amplitudes of `block` whose bit `bit` is not `keep` are sent, and
+ * replaced by those received.
+ */
+typedef struct DistStateExchange {
+    DistState *state;
+    size_t peer;
+    size_t bit;
+    size_t keep;
+    mat_t *block;
+    size_t block_size;
+    int result;
+} DistStateExchange;
+
+/**
+ * Run the exchange in `context`, a DistStateExchange.
+ */
+static void *diststate_exchange_task(void *context);
+
+/**
+ * Apply the gates [`begin`, `end`) of `gates`, all local, to `target`,
+ * this rank's share or a block of it.
+ */
+static void diststate_apply(DistState *state, StateVector *target,
+                            const CircuitGate *gates, size_t begin,
+                            size_t end);
+
+/**
+ * Get whether every qubit of `gate` is held by a bit within a rank's share.
+ */
+static bool diststate_is_local(DistState *state, const CircuitGate *gate);
+
+/**
+ * Record that the qubits held by bits `global` and `local` have traded
+ * places.
+ */
+static void diststate_relabel(DistState *state, size_t global, size_t local);
+
+/**
+ * Move the amplitudes to match a `diststate_relabel` of bits `global` and
+ * `local`, applying the gates [`begin`, `end`) of `gates`, local under the
+ * new labels, to each block once it has been exchanged.
+ * Return 0 on success, -1 on failure.
+ */
+static int diststate_swap(DistState *state, size_t global, size_t local,
+                          const CircuitGate *gates, size_t begin,
+                          size_t end);
+
+/**
+ * Swap the qubits of `gates[next]` that select the rank into the rank's
+ * share, in place of the local qubits used furthest in the future, and
+ * apply the gates from `next` on that are then local.
+ * Set `end` to the gate after the last applied.
+ * Return 0 on success, -1 on failure.
+ */
+static int diststate_localize(DistState *state, const CircuitGate *gates,
+                              size_t count, size_t next, size_t *end);
+
+static void *diststate_exchange_task(void *context) {
+    DistStateExchange *exchange = context;
+    DistState *state = exchange->state;
+    size_t half = exchange->block_size / 2;
+    size_t i, j;
+
+    for (i = 0, j = 0; i < exchange->block_size; i++) {
+        if (((i >> exchange->bit) & 1) != exchange->keep) {
+            state->send[j++] = exchange->block[i];
+        }
+    }
+    exchange->result = transport_exchange(
+        state->transport, exchange->peer, state->send, half * sizeof(mat_t),
+        state->receive, half * sizeof(mat_t));
+    if (exchange->result != 0)
+        return NULL;
+    for (i = 0, j = 0; i < exchange->block_size; i++) {
+        if (((i >> exchange->bit) & 1) != exchange->keep) {
+            exchange->block[i] = state->receive[j++];
+        }
+    }
+    return NULL;
+}
+
+static void diststate_apply(DistState *state, StateVector *target,
+                            const CircuitGate *gates, size_t begin,
+                            size_t end) {
+    size_t bits[STATEVECTOR_GATE_QUBITS];
+    size_t i, k;
+
+    for (i = begin; i < end; i++) {
+        for (k = 0; k < gates[i].count; k++) {
+            bits[k] = state->positions[gates[i].qubits[k]];
+        }
+        if (gates[i].count == 1) {
+            statevector_apply_1q(target, gates[i].matrix, bits[0]);
+        } else if (gates[i].count == 2) {
+            statevector_apply_2q(target, gates[i].matrix, bits[0], bits[1]);
+        } else {
+            statevector_apply_kq(target, gates[i].matrix, bits,
+                                 gates[i].count);
+        }
+    }
+}
+
+static bool diststate_is_local(DistState *state, const CircuitGate *gate) {
+    size_t k;
+
+    for (k = 0; k < gate->count; k++) {
+        if (state->positions[gate->qubits[k]] >= state->local_qubits)
+            return false;
+    }
+    return true;
+}
+
+static void diststate_relabel(DistState *state, size_t global, size_t local) {
+    size_t qubit = state->qubit_at[global];
+
+    state->qubit_at[global] = state->qubit_at[local];
+    state->qubit_at[local] = qubit;
+    state->positions[state->qubit_at[global]] = global;
+    state->positions[state->qubit_at[local]] = local;
+}
+
+static int diststate_swap(DistState *state, const size_t global,
+                          const size_t local, const CircuitGate *gates,
+                          size_t begin, size_t end) {
+    const size_t rank = transport_rank(state->transport);
+    const size_t rank_bit = global - state->local_qubits;
+    DistStateExchange exchanges[2];
+    DistStateExchange *current = &exchanges[0];
+    DistStateExchange *next = &exchanges[1];
+    DistStateExchange *swap;
+    struct StateVector block;
+    pthread_t thread;
+    bool threaded;
+    size_t used = local;
+    size_t pipeline, blocks, b, i, k;
+
+    /* blocks are runs of the share differing only in bits no gate uses */
+    for (i = begin; i < end; i++) {
+        for (k = 0; k < gates[i].count; k++) {
+            if (state->positions[gates[i].qubits[k]] > used) {
+                used = state->positions[gates[i].qubits[k]];
+            }
+        }
+    }
+    pipeline = state->local_qubits - used - 1;
+    if (pipeline > DISTSTATE_PIPELINE_QUBITS) {
+        pipeline = DISTSTATE_PIPELINE_QUBITS;
+    }
+    blocks = (size_t)1 << pipeline;
+
+    block.qubits = state->local_qubits - pipeline;
+    block.size = (size_t)1 << block.qubits;
+    block.pool = state->local->pool;
+    block.partials = NULL;
+
+    for (b = 0; b < 2; b++) {
+        exchanges[b].state = state;
+        exchanges[b].peer = rank ^ (size_t)1 << rank_bit;
+        exchanges[b].bit = local;
+        exchanges[b].keep = (rank >> rank_bit) & 1;
+        exchanges[b].block_size = block.size;
+        exchanges[b].result = 0;
+    }
+
+    current->block = state->local->amplitudes;
+    diststate_exchange_task(current);
+    if (current->result != 0)
+        return -1;
+    for (b = 0; b < blocks; b++) {
+        threaded = false;
+        if (b + 1 < blocks) {
+            next->block = state->local->amplitudes + (b + 1) * block.size;
+            threaded = pthread_create(&thread, NULL, diststate_exchange_task,
+                                      next)
+                       == 0;
+        }
+
+        block.amplitudes = current->block;
+        diststate_apply(state, &block, gates, begin, end);
+
+        if (b + 1 < blocks) {
+            if (threaded) {
+                pthread_join(thread, NULL);
+            } else {
+                diststate_exchange_task(next);
+            }
+            if (next->result != 0)
+                return -1;
+        }
+        swap = current;
+        current = next;
+        next = swap;
+    }
+    state->swaps++;
+    return 0;
+}
+
+static int diststate_localize(DistState *state, const CircuitGate *gates,
+                              size_t count, size_t next, size_t *end) {
+    const CircuitGate *gate = &gates[next];
+    size_t incoming[STATEVECTOR_GATE_QUBITS];
+    size_t outgoing[STATEVECTOR_GATE_QUBITS];
+    size_t *next_use = NULL;
+    size_t swap_ct = 0;
+    size_t i, k, p, best;
+
+    *end = next;
+    next_use = malloc(state->local_qubits * sizeof(size_t));
+    if (next_use == NULL)
+        return -1;
+
+    for (k = 0; k < gate->count; k++) {
+        if (state->positions[gate->qubits[k]] >= state->local_qubits) {
+            incoming[swap_ct++] = state->positions[gate->qubits[k]];
+        }
+    }
+    /* the gate after which each local qubit is next used, `count` if never */
+    for (p = 0; p < state->local_qubits; p++) {
+        next_use[p] = count;
+        for (i = next; i < count && next_use[p] == count; i++) {
+            for (k = 0; k < gates[i].count; k++) {
+                if (gates[i].qubits[k] == state->qubit_at[p]) {
+                    next_use[p] = i;
+                }
+            }
+        }
+    }
+    /* evict the qubits needed last, the lowest first so blocks stay large
+     * enough to pipeline; the gate's own are needed first */
+    for (k = 0; k < swap_ct; k++) {
+        best = 0;
+        for (p = 1; p < state->local_qubits; p++) {
+            if (next_use[p] > next_use[best]) {
+                best = p;
+            }
+        }
+        outgoing[k] = best;
+        next_use[best] = 0;
+    }
+    free(next_use);
+
+    /* only the last swap has gates to overlap with */
+    for (k = 0; k < swap_ct; k++) {
+        diststate_relabel(state, incoming[k], outgoing[k]);
+        if (k + 1 == swap_ct) {
+            while (*end < count && diststate_is_local(state, &gates[*end])) {
+                (*end)++;
+            }
+        }
+        if (diststate_swap(state, incoming[k], outgoing[k], gates, next, *end)
+            != 0)
+            return -1;
+    }
+    return 0;
+}
+
+size_t diststate_qubits(DistState *state) { return state->qubits; }
+
+size_t diststate_local_qubits(DistState *state) {
+    return state->local_qubits;
+}
+
+int diststate_run(DistState *state, Circuit *circuit) {
+    const CircuitGate *gates = circuit_schedule(circuit);
+    const size_t count = circuit_passes(circuit);
+    size_t *gate_bytes;
+    size_t sent, i, end;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_DISTSTATE_RUN);
+    if (circuit_qubits(circuit) != state->qubits) {
+        report_logic_error("state and circuit have different qubit counts");
+    }
+    for (i = 0; i < count; i++) {
+        if (gates[i].count > state->local_qubits) {
+            report_logic_error("gate acts on more qubits than a rank holds");
+        }
+    }
+
+    gate_bytes = realloc(state->gate_bytes, (count + 1) * sizeof(size_t));
+    if (gate_bytes == NULL) {
+        INSTRUMENT_END();
+        return -1;
+    }
+    state->gate_bytes = gate_bytes;
+    state->gate_ct = count;
+    for (i = 0; i < count; i++) {
+        state->gate_bytes[i] = 0;
+    }
+    state->bytes_sent = 0;
+    state->swaps = 0;
+
+    i = 0;
+    while (i < count) {
+        if (diststate_is_local(state, &gates[i])) {
+            for (end = i + 1;
+                 end < count && diststate_is_local(state, &gates[end]);
+                 end++) {
+                continue;
+            }
+            diststate_apply(state, state->local, gates, i, end);
+        } else {
+            sent = transport_bytes_sent(state->transport);
+            if (diststate_localize(state, gates, count, i, &end) != 0) {
+                INSTRUMENT_END();
+                return -1;
+            }
+            state->gate_bytes[i] = transport_bytes_sent(state->transport)
+                                   - sent;
+            state->bytes_sent += state->gate_bytes[i];
+        }
+        i = end;
+    }
+    INSTRUMENT_END();
+    return 0;
+}
+
+int diststate_gather(DistState *state, StateVector *full) {
+    const size_t ranks = transport_ranks(state->transport);
+    const size_t size = state->local->size;
+    mat_t *values = NULL;
+    size_t rank, i, physical, index, p;
+    int result;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_DISTSTATE_GATHER);
+    if (transport_rank(state->transport) != 0) {
+        result = transport_exchange(state->transport, 0,
+                                    state->local->amplitudes,
+                                    size * sizeof(mat_t), NULL, 0);
+        INSTRUMENT_END();
+        return result;
+    }
+    if (full == NULL || statevector_qubits(full) != state->qubits) {
+        report_logic_error("gathered state has the wrong qubit count");
+    }
+
+    values = malloc(size * sizeof(mat_t));
+    if (values == NULL)
+        goto diststate_gather_fail;
+    INSTRUMENT_BYTES(size * sizeof(mat_t));
+    for (rank = 0; rank < ranks; rank++) {
+        if (rank == 0) {
+            for (i = 0; i < size; i++) {
+                values[i] = state->local->amplitudes[i];
+            }
+        } else if (transport_exchange(state->transport, rank, NULL, 0, values,
+                                      size * sizeof(mat_t))
+                   != 0) {
+            goto diststate_gather_fail;
+        }
+        for (i = 0; i < size; i++) {
+            physical = rank << state->local_qubits | i;
+            index = 0;
+            for (p = 0; p < state->qubits; p++) {
+                index |= ((physical >> p) & 1) << state->qubit_at[p];
+            }
+            full->amplitudes[index] = values[i];
+        }
+    }
+    free(values);
+    INSTRUMENT_END();
+    return 0;
+
+diststate_gather_fail:
+    free(values);
+    INSTRUMENT_END();
+    return -1;
+}
+
+size_t diststate_gate_bytes(DistState *state, size_t gate) {
+    if (gate >= state->gate_ct) {
+        report_logic_error("gate out of bounds");
+    }
+    return state->gate_bytes[gate];
+}
+
+size_t diststate_bytes_sent(DistState *state) { return state->bytes_sent; }
+
+size_t diststate_swaps(DistState *state) { return state->swaps; }
+
+DistState *diststate_create(Transport *transport, size_t qubits,
+                            ThreadPool *pool) {
+    const size_t ranks = transport_ranks(transport);
+    DistState *state = NULL;
+    size_t global_qubits = 0;
+    size_t q;
+
+    while (((size_t)1 << global_qubits) < ranks) {
+        global_qubits++;
+    }
+    if (((size_t)1 << global_qubits) != ranks) {
+        report_logic_error("rank count is not a power of 2");
+    }
+    if (qubits >= sizeof(size_t) * 8 || global_qubits >= qubits) {
+        report_logic_error("too many ranks for the qubit count");
+    }
+
+    state = calloc(1, sizeof(DistState));
+    if (state == NULL)
+        goto diststate_create_fail;
+    state->transport = transport;
+    state->qubits = qubits;
+    state->local_qubits = qubits - global_qubits;
+    state->local = statevector_create_parallel(state->local_qubits, pool);
+    state->positions = malloc(qubits * sizeof(size_t));
+    state->qubit_at = malloc(qubits * sizeof(size_t));
+    state->send = malloc(((size_t)1 << state->local_qubits) / 2
+                         * sizeof(mat_t));
+    state->receive = malloc(((size_t)1 << state->local_qubits) / 2
+                            * sizeof(mat_t));
+    if (state->local == NULL || state->positions == NULL
+        || state->qubit_at == NULL || state->send == NULL
+        || state->receive == NULL)
+        goto diststate_create_fail;
+    for (q = 0; q < qubits; q++) {
+        state->positions[q] = q;
+        state->qubit_at[q] = q;
+    }
+    /* |0...0> is rank 0's first amplitude */
+    if (transport_rank(transport) != 0) {
+        state->local->amplitudes[0] = MAT_T_0;
+    }
+    return state;
+
+diststate_create_fail:
+    diststate_destroy(state);
+    return NULL;
+}
+
+void diststate_destroy(DistState *state) {
+    if (state != NULL) {
+        statevector_destroy(state->local);
+        free(state->positions);
+        free(state->qubit_at);
+        free(state->send);
+        free(state->receive);
+        free(state->gate_bytes);
+        free(state);
+    }
+}
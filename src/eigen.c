@@ -0,0 +1,662 @@
+#include "eigen.h"
+#include "instrument_internal.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* QL sweeps allowed per eigenvalue before giving up */
+#define EIGEN_MAX_ITERATIONS 60
+
+/* inverse iteration solves per eigenvector; each one shrinks the error by
+ * about the eigenvalue gap over machine precision */
+#define EIGEN_INVERSE_ITERATIONS 3
+
+/* reflectors applied together as one block by the back-transformation */
+#define EIGEN_BLOCK 32
+
+/**
+ * Calculate sqrt(a^2 + b^2) without destructive overflow or underflow.
+ */
+static double eigen_hypot(double a, double b);
+
+/**
+ * Reduce the Hermitian `width` x `width` lower triangle in `work` to a real
+ * symmetric tridiagonal matrix with Householder reflections.
+ * The diagonal goes to `diagonal`, the magnitudes of the subdiagonal to
+ * `off_diagonal`, and the unit phases that make the subdiagonal real to
+ * `phases`. The reflector for column k is left in `work` below row k + 1,
+ * with its scale in `taus[k]`.
+ */
+static void eigen_tridiagonalize(mat_t *work, size_t width, double *diagonal,
+                                 double *off_diagonal, mat_t *phases,
+                                 double *taus);
+
+/**
+ * Diagonalize the symmetric tridiagonal matrix with `diagonal` and
+ * `off_diagonal` by implicit QL with Wilkinson shifts, leaving the
+ * eigenvalues in `diagonal` and destroying `off_diagonal`.
+ * Return 0 on success, -1 if an eigenvalue does not converge.
+ */
+static int eigen_tridiagonal_ql(double *diagonal, double *off_diagonal,
+                                size_t width);
+
+/**
+ * Sort `eigenvalues` ascending, moving the `length` value rows of `vectors`
+ * (if not NULL) with them.
+ */
+static void eigen_sort(double *eigenvalues, size_t width, double *vectors,
+                       size_t length);
+
+/**
+ * Find the eigenvectors of the unreduced symmetric tridiagonal matrix with
+ * `diagonal` and `off_diagonal` for its ascending `eigenvalues` by inverse
+ * iteration, orthogonalizing within clusters of close eigenvalues.
+ * Eigenvector j goes to the first `width` values of row j of `vectors`,
+ * whose rows are `stride` values apart.
+ * Return 0 on success, -1 on failure.
+ */
+static int eigen_tridiagonal_vectors(const double *diagonal,
+                                     const double *off_diagonal,
+                                     const double *eigenvalues, size_t width,
+                                     double *vectors, size_t stride);
+
+/**
+ * Multiply the `width` x `width` `vectors`, with rows `stride` apart, from
+ * the left by Q, the product of the reflectors left in `work` by
+ * `eigen_tridiagonalize`, a block of reflectors at a time.
+ * Return 0 on success, -1 on failure.
+ */
+static int eigen_back_transform(const mat_t *work, const double *taus,
+                                size_t width, mat_t *vectors, size_t stride);
+
+/**
+ * Find the eigenvalues, in ascending order, and eigenvectors of the
+ * Hermitian matrix that `eigen_tridiagonalize` left as `work`, `phases`,
+ * `diagonal`, `off_diagonal` and `taus`, into `eigenvectors` with rows
+ * `stride` apart.
+ * Return 0 on success, -1 on failure.
+ */
+static int eigen_hermitian_vectors(const mat_t *work, const mat_t *phases,
+                                   const double *diagonal,
+                                   const double *off_diagonal,
+                                   const double *taus, size_t width,
+                                   double *eigenvalues, mat_t *eigenvectors,
+                                   size_t stride);
+
+static double eigen_hypot(double a, double b) {
+    a = fabs(a);
+    b = fabs(b);
+    if (a > b) {
+        return a * sqrt(1.0 + (b / a) * (b / a));
+    }
+    return b == 0.0 ? 0.0 : b * sqrt(1.0 + (a / b) * (a / b));
+}
+
+static void eigen_tridiagonalize(mat_t *work, size_t width, double *diagonal,
+                                 double *off_diagonal, mat_t *phases,
+                                 double *taus) {
+    mat_t *v;
+    mat_t *p;
+    mat_t *row;
+    mat_t alpha, x0, half_k, v_i, p_i, w_i;
+    double norm2, tail2, magnitude, tau;
+    size_t k, i, j, m;
+
+    for (k = 0; k + 1 < width; k++) {
+        m = width - k - 1;
+        diagonal[k] = MAT_T_REAL(work[k * width + k]);
+
+        /* x = column k below the diagonal */
+        x0 = work[(k + 1) * width + k];
+        tail2 = 0.0;
+        for (i = k + 2; i < width; i++) {
+            tail2 += MAT_T_ABS2(work[i * width + k]);
+        }
+
+        if (tail2 == 0.0) {
+            /* already tridiagonal in this column */
+            alpha = x0;
+            taus[k] = 0.0;
+        } else {
+            norm2 = MAT_T_ABS2(x0) + tail2;
+            magnitude = sqrt(MAT_T_ABS2(x0));
+            /* alpha = -(x0 / |x0|) |x| keeps v^H x real */
+            alpha = magnitude == 0.0
+                        ? MAT_T(-sqrt(norm2))
+                        : MAT_T_MUL(MAT_T(-sqrt(norm2) / magnitude), x0);
+
+            /* v = x - alpha e1, kept in place of x */
+            work[(k + 1) * width + k] = MAT_T_SUB(x0, alpha);
+            tau = 2.0 / (MAT_T_ABS2(work[(k + 1) * width + k]) + tail2);
+            taus[k] = tau;
+
+            /* scratch for v and p lives in the unused upper triangle of row
+             * k, which has exactly m free slots to the right of the
+             * diagonal; p goes in the phases buffer until it is needed */
+            v = work + k * width + k + 1;
+            p = phases + k + 1;
+            for (i = 0; i < m; i++) {
+                v[i] = work[(k + 1 + i) * width + k];
+                p[i] = MAT_T_0;
+            }
+
+            /* p = tau B v, reading only the lower triangle of B */
+            for (i = 0; i < m; i++) {
+                row = work + (k + 1 + i) * width + k + 1;
+                v_i = v[i];
+                p_i = MAT_T_MUL(row[i], v_i);
+                for (j = 0; j < i; j++) {
+                    p_i = MAT_T_ADD(p_i, MAT_T_MUL(row[j], v[j]));
+                    p[j] = MAT_T_ADD(p[j], MAT_T_MUL(MAT_T_CONJ(row[j]), v_i));
+                }
+                p[i] = MAT_T_ADD(p[i], p_i);
+            }
+
+            /* w = p - (tau / 2) (v^H p) v, with p scaled by tau first */
+            half_k = MAT_T_0;
+            for (i = 0; i < m; i++) {
+                p[i] = MAT_T_MUL(MAT_T(tau), p[i]);
+                half_k = MAT_T_ADD(half_k, MAT_T_MUL(MAT_T_CONJ(v[i]), p[i]));
+            }
+            half_k = MAT_T_MUL(MAT_T(tau / 2.0), half_k);
+            for (i = 0; i < m; i++) {
+                p[i] = MAT_T_SUB(p[i], MAT_T_MUL(half_k, v[i]));
+            }
+
+            /* B <- B - v w^H - w v^H, lower triangle only */
+            for (i = 0; i < m; i++) {
+                row = work + (k + 1 + i) * width + k + 1;
+                v_i = v[i];
+                w_i = p[i];
+                for (j = 0; j <= i; j++) {
+                    row[j] = MAT_T_SUB(
+                        row[j],
+                        MAT_T_ADD(MAT_T_MUL(v_i, MAT_T_CONJ(p[j])),
+                                  MAT_T_MUL(w_i, MAT_T_CONJ(v[j]))));
+                }
+            }
+        }
+
+        off_diagonal[k] = sqrt(MAT_T_ABS2(alpha));
+        /* D_{k+1} = D_k alpha / |alpha| turns alpha into |alpha| */
+        phases[k + 1] = off_diagonal[k] == 0.0
+                            ? phases[k]
+                            : MAT_T_MUL(phases[k],
+                                        MAT_T_DIV(alpha,
+                                                  MAT_T(off_diagonal[k])));
+    }
+    diagonal[width - 1] = MAT_T_REAL(work[(width - 1) * width + width - 1]);
+    off_diagonal[width - 1] = 0.0;
+}
+
+static int eigen_tridiagonal_ql(double *diagonal, double *off_diagonal,
+                                size_t width) {
+    double g, r, s, c, p, f, b, scale;
+    size_t l, m, i, iterations;
+    bool deflated;
+
+    for (l = 0; l < width; l++) {
+        iterations = 0;
+        for (;;) {
+            /* find a negligible off-diagonal value to split at */
+            for (m = l; m + 1 < width; m++) {
+                scale = fabs(diagonal[m]) + fabs(diagonal[m + 1]);
+                if (fabs(off_diagonal[m]) <= DBL_EPSILON * scale) {
+                    break;
+                }
+            }
+            if (m == l) {
+                break;
+            }
+            if (++iterations > EIGEN_MAX_ITERATIONS) {
+                return -1;
+            }
+
+            /* Wilkinson shift */
+            g = (diagonal[l + 1] - diagonal[l]) / (2.0 * off_diagonal[l]);
+            r = eigen_hypot(g, 1.0);
+            g = diagonal[m] - diagonal[l]
+                + off_diagonal[l] / (g + (g >= 0.0 ? r : -r));
+            s = c = 1.0;
+            p = 0.0;
+            deflated = false;
+
+            /* chase the bulge from m back up to l */
+            for (i = m; i-- > l;) {
+                f = s * off_diagonal[i];
+                b = c * off_diagonal[i];
+                r = eigen_hypot(f, g);
+                off_diagonal[i + 1] = r;
+                if (r == 0.0) {
+                    diagonal[i + 1] -= p;
+                    off_diagonal[m] = 0.0;
+                    deflated = true;
+                    break;
+                }
+                s = f / r;
+                c = g / r;
+                g = diagonal[i + 1] - p;
+                r = (diagonal[i] - g) * s + 2.0 * c * b;
+                p = s * r;
+                diagonal[i + 1] = g + p;
+                g = c * r - b;
+            }
+            if (deflated) {
+                continue;
+            }
+            diagonal[l] -= p;
+            off_diagonal[l] = g;
+            off_diagonal[m] = 0.0;
+        }
+    }
+    return 0;
+}
+
+static void eigen_sort(double *eigenvalues, size_t width, double *vectors,
+                       size_t length) {
+    double temp;
+    size_t i, j, smallest;
+
+    for (i = 0; i + 1 < width; i++) {
+        smallest = i;
+        for (j = i + 1; j < width; j++) {
+            if (eigenvalues[j] < eigenvalues[smallest]) {
+                smallest = j;
+            }
+        }
+        if (smallest == i) {
+            continue;
+        }
+        temp = eigenvalues[i];
+        eigenvalues[i] = eigenvalues[smallest];
+        eigenvalues[smallest] = temp;
+        if (vectors != NULL) {
+            for (j = 0; j < length; j++) {
+                temp = vectors[i * length + j];
+                vectors[i * length + j] = vectors[smallest * length + j];
+                vectors[smallest * length + j] = temp;
+            }
+        }
+    }
+}
+
+static int eigen_tridiagonal_vectors(const double *diagonal,
+                                     const double *off_diagonal,
+                                     const double *eigenvalues, size_t width,
+                                     double *vectors, size_t stride) {
+    /* the rows of the LU factors of T - shift I: up to three values of U per
+     * row, the multiplier of L, and whether the rows were swapped */
+    double *u0 = malloc(width * sizeof(double));
+    double *u1 = malloc(width * sizeof(double));
+    double *u2 = malloc(width * sizeof(double));
+    double *multipliers = malloc(width * sizeof(double));
+    bool *swapped = malloc(width * sizeof(bool));
+    double *x;
+    double norm = 0.0, cluster_gap, tiny, shift = 0.0, previous = 0.0;
+    double next0, next1, next2, row0, row1, row2, temp, dot;
+    unsigned long seed = 1;
+    size_t cluster = 0, j, k, r, iteration;
+
+    if (u0 == NULL || u1 == NULL || u2 == NULL || multipliers == NULL
+        || swapped == NULL)
+        goto eigen_tridiagonal_vectors_fail;
+
+    /* tolerances scale with the infinity norm of T */
+    for (k = 0; k < width; k++) {
+        temp = fabs(diagonal[k]) + (k + 1 < width ? fabs(off_diagonal[k]) : 0.0)
+               + (k > 0 ? fabs(off_diagonal[k - 1]) : 0.0);
+        norm = temp > norm ? temp : norm;
+    }
+    if (norm == 0.0) {
+        norm = 1.0;
+    }
+    cluster_gap = 1e-3 * norm;
+    tiny = DBL_EPSILON * norm;
+
+    for (j = 0; j < width; j++) {
+        x = vectors + j * stride;
+
+        /* equal shifts would give equal vectors, so nudge them apart */
+        shift = eigenvalues[j];
+        if (j > 0) {
+            if (shift - eigenvalues[j - 1] > cluster_gap) {
+                cluster = j;
+            }
+            if (shift < previous + 10.0 * tiny) {
+                shift = previous + 10.0 * tiny;
+            }
+        }
+        previous = shift;
+
+        /* factor T - shift I = P L U, pivoting between neighbouring rows */
+        row0 = diagonal[0] - shift;
+        row1 = width > 1 ? off_diagonal[0] : 0.0;
+        row2 = 0.0;
+        for (k = 0; k + 1 < width; k++) {
+            next0 = off_diagonal[k];
+            next1 = diagonal[k + 1] - shift;
+            next2 = k + 2 < width ? off_diagonal[k + 1] : 0.0;
+            swapped[k] = fabs(next0) > fabs(row0);
+            if (swapped[k]) {
+                temp = row0 / next0;
+                u0[k] = next0;
+                u1[k] = next1;
+                u2[k] = next2;
+                row0 = row1 - temp * next1;
+                row1 = row2 - temp * next2;
+            } else {
+                temp = row0 == 0.0 ? 0.0 : next0 / row0;
+                u0[k] = row0;
+                u1[k] = row1;
+                u2[k] = row2;
+                row0 = next1 - temp * row1;
+                row1 = next2 - temp * row2;
+            }
+            row2 = 0.0;
+            multipliers[k] = temp;
+        }
+        u0[width - 1] = row0;
+
+        /* the shift is an eigenvalue, so some pivot is (nearly) zero */
+        for (k = 0; k < width; k++) {
+            if (fabs(u0[k]) < tiny) {
+                u0[k] = u0[k] < 0.0 ? -tiny : tiny;
+            }
+        }
+
+        for (k = 0; k < width; k++) {
+            seed = seed * 1103515245UL + 12345UL;
+            x[k] = (double)((seed >> 16) & 0x7fff) / 16384.0 - 1.0;
+        }
+
+        for (iteration = 0; iteration < EIGEN_INVERSE_ITERATIONS;
+             iteration++) {
+            /* x <- U^-1 L^-1 P x */
+            for (k = 0; k + 1 < width; k++) {
+                if (swapped[k]) {
+                    temp = x[k];
+                    x[k] = x[k + 1];
+                    x[k + 1] = temp;
+                }
+                x[k + 1] -= multipliers[k] * x[k];
+            }
+            for (k = width; k-- > 0;) {
+                temp = x[k];
+                if (k + 1 < width) {
+                    temp -= u1[k] * x[k + 1];
+                }
+                if (k + 2 < width) {
+                    temp -= u2[k] * x[k + 2];
+                }
+                x[k] = temp / u0[k];
+            }
+
+            /* rescale before orthogonalizing, since x is now huge */
+            temp = 0.0;
+            for (k = 0; k < width; k++) {
+                temp = fabs(x[k]) > temp ? fabs(x[k]) : temp;
+            }
+            for (k = 0; k < width; k++) {
+                x[k] /= temp;
+            }
+
+            for (r = cluster; r < j; r++) {
+                dot = 0.0;
+                for (k = 0; k < width; k++) {
+                    dot += vectors[r * stride + k] * x[k];
+                }
+                for (k = 0; k < width; k++) {
+                    x[k] -= dot * vectors[r * stride + k];
+                }
+            }
+
+            temp = 0.0;
+            for (k = 0; k < width; k++) {
+                temp += x[k] * x[k];
+            }
+            if (temp == 0.0)
+                goto eigen_tridiagonal_vectors_fail;
+            temp = 1.0 / sqrt(temp);
+            for (k = 0; k < width; k++) {
+                x[k] *= temp;
+            }
+        }
+    }
+
+    free(u0);
+    free(u1);
+    free(u2);
+    free(multipliers);
+    free(swapped);
+    return 0;
+eigen_tridiagonal_vectors_fail:
+    free(u0);
+    free(u1);
+    free(u2);
+    free(multipliers);
+    free(swapped);
+    return -1;
+}
+
+static int eigen_back_transform(const mat_t *work, const double *taus,
+                                size_t width, mat_t *vectors, size_t stride) {
+    /* H_begin ... H_end-1 = I - V T V^H, so each block costs three
+     * products instead of one pass over `vectors` per reflector */
+    mat_t *v = malloc(width * EIGEN_BLOCK * sizeof(mat_t));
+    mat_t *v_adjoint = malloc(EIGEN_BLOCK * width * sizeof(mat_t));
+    mat_t *t = malloc(EIGEN_BLOCK * EIGEN_BLOCK * sizeof(mat_t));
+    mat_t *product = malloc(EIGEN_BLOCK * width * sizeof(mat_t));
+    mat_t *scaled = malloc(EIGEN_BLOCK * width * sizeof(mat_t));
+    mat_t sum;
+    size_t begin, end, block, rows, i, c, r;
+
+    if (v == NULL || v_adjoint == NULL || t == NULL || product == NULL
+        || scaled == NULL)
+        goto eigen_back_transform_fail;
+
+    /* Q = H_0 H_1 ... H_n-2, so the last block is applied first */
+    for (end = width - 1; end > 0; end = begin) {
+        begin = end > EIGEN_BLOCK ? end - EIGEN_BLOCK : 0;
+        block = end - begin;
+        /* reflector `begin` + c acts on rows `begin` + c + 1 onward */
+        rows = width - begin - 1;
+
+        for (i = 0; i < rows; i++) {
+            for (c = 0; c < block; c++) {
+                v[i * block + c] = i < c ? MAT_T_0
+                                         : work[(begin + 1 + i) * width
+                                                + begin + c];
+                v_adjoint[c * rows + i] = MAT_T_CONJ(v[i * block + c]);
+            }
+        }
+
+        /* T[0:c, c] = -tau_c T[0:c, 0:c] V[:, 0:c]^H v_c */
+        for (c = 0; c < block; c++) {
+            for (r = 0; r < c; r++) {
+                sum = MAT_T_0;
+                for (i = c; i < rows; i++) {
+                    sum = MAT_T_ADD(sum, MAT_T_MUL(v_adjoint[r * rows + i],
+                                                   v[i * block + c]));
+                }
+                product[r] = sum;
+            }
+            for (r = 0; r < c; r++) {
+                sum = MAT_T_0;
+                for (i = r; i < c; i++) {
+                    sum = MAT_T_ADD(sum, MAT_T_MUL(t[r * block + i],
+                                                   product[i]));
+                }
+                t[r * block + c] = MAT_T_MUL(MAT_T(-taus[begin + c]), sum);
+            }
+            t[c * block + c] = MAT_T(taus[begin + c]);
+            for (r = c + 1; r < block; r++) {
+                t[r * block + c] = MAT_T_0;
+            }
+        }
+
+        /* vectors -= V (T (V^H vectors)) over the rows the block touches */
+        memset(product, 0, block * width * sizeof(mat_t));
+        memset(scaled, 0, block * width * sizeof(mat_t));
+        if (matrix_gemm(block, width, rows, MAT_T_1, v_adjoint, rows,
+                        vectors + (begin + 1) * stride, stride, product, width)
+                != 0
+            || matrix_gemm(block, width, block, MAT_T_1, t, block, product,
+                           width, scaled, width)
+                   != 0
+            || matrix_gemm(rows, width, block, MAT_T(-1.0), v, block, scaled,
+                           width, vectors + (begin + 1) * stride, stride)
+                   != 0)
+            goto eigen_back_transform_fail;
+    }
+
+    free(v);
+    free(v_adjoint);
+    free(t);
+    free(product);
+    free(scaled);
+    return 0;
+eigen_back_transform_fail:
+    free(v);
+    free(v_adjoint);
+    free(t);
+    free(product);
+    free(scaled);
+    return -1;
+}
+
+static int eigen_hermitian_vectors(const mat_t *work, const mat_t *phases,
+                                   const double *diagonal,
+                                   const double *off_diagonal,
+                                   const double *taus, size_t width,
+                                   double *eigenvalues, mat_t *eigenvectors,
+                                   size_t stride) {
+    double *scratch = malloc(width * sizeof(double));
+    double *vectors = calloc(width * width, sizeof(double));
+    size_t begin, end, i, j;
+
+    if (scratch == NULL || vectors == NULL)
+        goto eigen_hermitian_vectors_fail;
+
+    /* solve each unreduced block of T on its own, so that eigenvalues
+     * shared between blocks never need orthogonalizing against each other */
+    for (begin = 0; begin < width; begin = end) {
+        for (end = begin + 1; end < width; end++) {
+            if (fabs(off_diagonal[end - 1])
+                <= DBL_EPSILON
+                       * (fabs(diagonal[end - 1]) + fabs(diagonal[end]))) {
+                break;
+            }
+        }
+
+        /* inverse iteration still needs T, so QL works on a copy */
+        memcpy(scratch + begin, off_diagonal + begin,
+               (end - begin) * sizeof(double));
+        scratch[end - 1] = 0.0;
+        if (eigen_tridiagonal_ql(eigenvalues + begin, scratch + begin,
+                                 end - begin)
+            != 0)
+            goto eigen_hermitian_vectors_fail;
+        eigen_sort(eigenvalues + begin, end - begin, NULL, 0);
+
+        if (eigen_tridiagonal_vectors(diagonal + begin, off_diagonal + begin,
+                                      eigenvalues + begin, end - begin,
+                                      vectors + begin * width + begin, width)
+            != 0)
+            goto eigen_hermitian_vectors_fail;
+    }
+    eigen_sort(eigenvalues, width, vectors, width);
+
+    /* eigenvectors = Q D Z, where row j of `vectors` is column j of Z */
+    for (i = 0; i < width; i++) {
+        for (j = 0; j < width; j++) {
+            eigenvectors[i * stride + j]
+                = MAT_T_MUL(phases[i], MAT_T(vectors[j * width + i]));
+        }
+    }
+    if (eigen_back_transform(work, taus, width, eigenvectors, stride) != 0)
+        goto eigen_hermitian_vectors_fail;
+
+    free(scratch);
+    free(vectors);
+    return 0;
+eigen_hermitian_vectors_fail:
+    free(scratch);
+    free(vectors);
+    return -1;
+}
+
+int eigen_hermitian(Matrix *matrix, double *eigenvalues, Matrix *eigenvectors) {
+    const size_t width = matrix_width(matrix);
+    mat_t *work = NULL;
+    mat_t *phases = NULL;
+    double *diagonal = NULL;
+    double *off_diagonal = NULL;
+    double *taus = NULL;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_EIGEN_HERMITIAN);
+    if (matrix_height(matrix) != width) {
+        report_logic_error("eigenvalues undefined for non-square matrix");
+    }
+    if (eigenvectors != NULL
+        && (matrix_height(eigenvectors) != width
+            || matrix_width(eigenvectors) != width)) {
+        report_logic_error("eigenvector matrix has wrong dimensions");
+    }
+    if (width == 0) {
+        INSTRUMENT_END();
+        return 0;
+    }
+
+    work = malloc(width * width * sizeof(mat_t));
+    if (work == NULL)
+        goto eigen_hermitian_fail;
+    phases = malloc(width * sizeof(mat_t));
+    if (phases == NULL)
+        goto eigen_hermitian_fail;
+    diagonal = malloc(width * sizeof(double));
+    if (diagonal == NULL)
+        goto eigen_hermitian_fail;
+    off_diagonal = malloc(width * sizeof(double));
+    if (off_diagonal == NULL)
+        goto eigen_hermitian_fail;
+    taus = calloc(width, sizeof(double));
+    if (taus == NULL)
+        goto eigen_hermitian_fail;
+    INSTRUMENT_BYTES((width * width + width) * sizeof(mat_t)
+                     + 3 * width * sizeof(double));
+
+    matrix_copy_to_buffer(matrix, work);
+    phases[0] = MAT_T_1;
+    eigen_tridiagonalize(work, width, diagonal, off_diagonal, phases, taus);
+    memcpy(eigenvalues, diagonal, width * sizeof(double));
+
+    if (eigenvectors == NULL) {
+        if (eigen_tridiagonal_ql(eigenvalues, off_diagonal, width) != 0)
+            goto eigen_hermitian_fail;
+        eigen_sort(eigenvalues, width, NULL, 0);
+    } else if (eigen_hermitian_vectors(work, phases, diagonal, off_diagonal,
+                                       taus, width, eigenvalues,
+                                       eigenvectors->values,
+                                       eigenvectors->stride)
+               != 0)
+        goto eigen_hermitian_fail;
+
+    free(work);
+    free(phases);
+    free(diagonal);
+    free(off_diagonal);
+    free(taus);
+    INSTRUMENT_END();
+    return 0;
+eigen_hermitian_fail:
+    free(work);
+    free(phases);
+    free(diagonal);
+    free(off_diagonal);
+    free(taus);
+    INSTRUMENT_END();
+    return -1;
+}
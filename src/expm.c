@@ -0,0 +1,289 @@
+#include "expm.h"
+#include "eigen.h"
+#include "instrument_internal.h"
+#include "krylov_internal.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* a Krylov step whose new direction is this small relative to the operator
+ * has found an invariant subspace, so its exponential is exact */
+#define EXPM_BREAKDOWN 1e-12
+
+/* most a step may grow over the last accepted one */
+#define EXPM_GROWTH 5.0
+
+/* rows of `psi` rebuilt at a time from the Krylov basis */
+#define EXPM_BLOCK 1024
+
+struct Expm {
+    size_t size;
+    size_t basis;
+
+    /* basis + 1 orthonormal vectors of `size` values, one after another */
+    mat_t *vectors;
+    mat_t *coefficients;
+    /* the tridiagonal projection V^H H V and its eigendecomposition */
+    Matrix *projection;
+    Matrix *ritz_vectors;
+    double *ritz_values;
+    /* exp(rate t H) psi in the Krylov basis */
+    mat_t *weights;
+
+    size_t steps;
+    size_t rejections;
+    size_t matvecs;
+};
+
+/**
+ * Set the first `dimension` weights to exp(`scaled` T) e_1 in the Krylov
+ * basis, from the eigendecomposition of T in `ritz_vectors` and
+ * `ritz_values`.
+ */
+static void expm_weigh(Expm *expm, const Matrix *ritz_vectors,
+                       size_t dimension, mat_t scaled);
+
+/**
+ * Decompose the leading `dimension` x `dimension` block of the projection,
+ * then take steps through it, shrinking them until the estimated error of
+ * each is within its share of `tolerance`, and overwrite `psi` with the
+ * result of the first accepted step.
+ * `residual` is the size of the next Krylov direction, 0 if the basis is
+ * invariant. `sigma` is the fraction of `t` to try, updated to the next one.
+ * Return the accepted fraction of `t` on success, 0 on failure.
+ */
+static double expm_step(Expm *expm, size_t dimension, double beta,
+                        double residual, mat_t rate, double t,
+                        double tolerance, double remaining, double *sigma,
+                        mat_t *psi);
+
+static void expm_weigh(Expm *expm, const Matrix *ritz_vectors,
+                       size_t dimension, mat_t scaled) {
+    const mat_t *y = ritz_vectors->values;
+    mat_t exponential;
+    size_t k, l;
+
+    for (k = 0; k < dimension; k++) {
+        expm->weights[k] = MAT_T_0;
+    }
+    for (l = 0; l < dimension; l++) {
+        /* exp(scaled theta_l) times the first component of its vector */
+        exponential = MAT_T_MUL(
+            MAT_T_EXP(MAT_T_MUL(scaled, MAT_T(expm->ritz_values[l]))),
+            MAT_T_CONJ(y[l]));
+        for (k = 0; k < dimension; k++) {
+            expm->weights[k] = MAT_T_ADD(
+                expm->weights[k], MAT_T_MUL(y[k * dimension + l], exponential));
+        }
+    }
+}
+
+static double expm_step(Expm *expm, size_t dimension, double beta,
+                        double residual, mat_t rate, double t,
+                        double tolerance, double remaining, double *sigma,
+                        mat_t *psi) {
+    const size_t size = expm->size;
+    Matrix *projection = expm->projection;
+    Matrix *ritz_vectors = expm->ritz_vectors;
+    double step, error, allowed, factor;
+    mat_t weight;
+    size_t begin, end, i, k;
+
+    /* an invariant subspace is smaller than the basis */
+    if (dimension < expm->basis) {
+        projection = matrix_create(dimension, dimension);
+        ritz_vectors = matrix_create(dimension, dimension);
+        if (projection == NULL || ritz_vectors == NULL)
+            goto expm_step_fail;
+        for (i = 0; i < dimension; i++) {
+            memcpy(projection->values + i * dimension,
+                   expm->projection->values + i * expm->basis,
+                   dimension * sizeof(mat_t));
+        }
+    }
+    if (eigen_hermitian(projection, expm->ritz_values, ritz_vectors) != 0)
+        goto expm_step_fail;
+
+    /* the error of a step is about beta residual |e_m^T exp(step T) e_1| */
+    for (;;) {
+        step = *sigma < remaining ? *sigma : remaining;
+        expm_weigh(expm, ritz_vectors, dimension,
+                   MAT_T_MUL(MAT_T(step * t), rate));
+        error = beta * residual
+                * sqrt(MAT_T_ABS2(expm->weights[dimension - 1]));
+        allowed = tolerance * step * beta;
+        if (error <= allowed) {
+            break;
+        }
+        expm->rejections++;
+        factor = 0.9 * pow(allowed / error, 1.0 / (double)dimension);
+        *sigma = step * (factor < 0.1 ? 0.1 : factor > 0.9 ? 0.9 : factor);
+        if (*sigma <= DBL_EPSILON * remaining)
+            goto expm_step_fail;
+    }
+
+    /* psi = beta V weights */
+    for (begin = 0; begin < size; begin = end) {
+        end = size - begin < EXPM_BLOCK ? size : begin + EXPM_BLOCK;
+        for (i = begin; i < end; i++) {
+            psi[i] = MAT_T_0;
+        }
+        for (k = 0; k < dimension; k++) {
+            weight = MAT_T_MUL(MAT_T(beta), expm->weights[k]);
+            for (i = begin; i < end; i++) {
+                psi[i] = MAT_T_ADD(psi[i],
+                                   MAT_T_MUL(weight,
+                                             expm->vectors[k * size + i]));
+            }
+        }
+    }
+
+    factor = error == 0.0 ? EXPM_GROWTH
+                          : 0.9 * pow(allowed / error, 1.0 / (double)dimension);
+    *sigma = step * (factor > EXPM_GROWTH ? EXPM_GROWTH : factor);
+
+    if (dimension < expm->basis) {
+        matrix_destroy(projection);
+        matrix_destroy(ritz_vectors);
+    }
+    return step;
+expm_step_fail:
+    if (dimension < expm->basis) {
+        matrix_destroy(projection);
+        matrix_destroy(ritz_vectors);
+    }
+    return 0.0;
+}
+
+size_t expm_steps(Expm *expm) { return expm->steps; }
+
+size_t expm_rejections(Expm *expm) { return expm->rejections; }
+
+size_t expm_matvecs(Expm *expm) { return expm->matvecs; }
+
+int expm_multiply(Expm *expm, MatVec matvec, void *context, mat_t rate,
+                  double t, mat_t *psi, double tolerance) {
+    const size_t size = expm->size;
+    const size_t basis = expm->basis;
+    mat_t *h = expm->projection->values;
+    mat_t *w;
+    double done = 0.0, sigma = 1.0, norm = 0.0, alpha, beta, residual, step;
+    size_t dimension, i, j;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_EXPM_MULTIPLY);
+    expm->steps = 0;
+    expm->rejections = 0;
+    expm->matvecs = 0;
+
+    while (done < 1.0) {
+        beta = krylov_norm(psi, size);
+        if (beta == 0.0) {
+            break;
+        }
+        for (i = 0; i < size; i++) {
+            expm->vectors[i] = MAT_T_MUL(MAT_T(1.0 / beta), psi[i]);
+        }
+        for (i = 0; i < basis * basis; i++) {
+            h[i] = MAT_T_0;
+        }
+
+        /* Lanczos with full reorthogonalization */
+        dimension = basis;
+        residual = 0.0;
+        for (j = 0; j < basis; j++) {
+            w = expm->vectors + (j + 1) * size;
+            matvec(context, expm->vectors + j * size, w);
+            expm->matvecs++;
+
+            alpha = MAT_T_REAL(krylov_orthogonalize(
+                expm->vectors, size, j + 1, expm->coefficients, w));
+            residual = krylov_norm(w, size);
+            h[j * basis + j] = MAT_T(alpha);
+            norm = fabs(alpha) + residual > norm ? fabs(alpha) + residual
+                                                 : norm;
+            if (residual <= EXPM_BREAKDOWN * norm) {
+                dimension = j + 1;
+                residual = 0.0;
+                break;
+            }
+            for (i = 0; i < size; i++) {
+                w[i] = MAT_T_MUL(MAT_T(1.0 / residual), w[i]);
+            }
+            if (j + 1 < basis) {
+                h[j * basis + j + 1] = MAT_T(residual);
+                h[(j + 1) * basis + j] = MAT_T(residual);
+            }
+        }
+
+        step = expm_step(expm, dimension, beta, residual, rate, t, tolerance,
+                         1.0 - done, &sigma, psi);
+        if (step == 0.0) {
+            INSTRUMENT_END();
+            return -1;
+        }
+        expm->steps++;
+        done = step >= 1.0 - done ? 1.0 : done + step;
+    }
+
+    INSTRUMENT_END();
+    return 0;
+}
+
+Expm *expm_create(size_t size, size_t basis) {
+    Expm *expm;
+
+    if (size == 0) {
+        report_logic_error("cannot exponentiate an empty operator");
+    }
+    if (basis == 0) {
+        basis = 30;
+    }
+    if (basis > size) {
+        basis = size;
+    }
+
+    expm = calloc(1, sizeof(Expm));
+    if (expm == NULL)
+        goto expm_create_fail;
+    expm->size = size;
+    expm->basis = basis;
+
+    expm->vectors = malloc((basis + 1) * size * sizeof(mat_t));
+    if (expm->vectors == NULL)
+        goto expm_create_fail;
+    expm->coefficients = malloc((basis + 1) * sizeof(mat_t));
+    if (expm->coefficients == NULL)
+        goto expm_create_fail;
+    expm->projection = matrix_create(basis, basis);
+    if (expm->projection == NULL)
+        goto expm_create_fail;
+    expm->ritz_vectors = matrix_create(basis, basis);
+    if (expm->ritz_vectors == NULL)
+        goto expm_create_fail;
+    expm->ritz_values = malloc(basis * sizeof(double));
+    if (expm->ritz_values == NULL)
+        goto expm_create_fail;
+    expm->weights = malloc(basis * sizeof(mat_t));
+    if (expm->weights == NULL)
+        goto expm_create_fail;
+
+    return expm;
+expm_create_fail:
+    expm_destroy(expm);
+    return NULL;
+}
+
+void expm_destroy(Expm *expm) {
+    if (expm != NULL) {
+        free(expm->vectors);
+        free(expm->coefficients);
+        matrix_destroy(expm->projection);
+        matrix_destroy(expm->ritz_vectors);
+        free(expm->ritz_values);
+        free(expm->weights);
+        free(expm);
+    }
+}
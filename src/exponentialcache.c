@@ -0,0 +1,141 @@
+#include "exponentialcache.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <stdlib.h>
+
+struct ExponentialCache {
+    Matrix *matrix;
+    /* A^2, A^4, A^6 and A^8, each created when first needed */
+    Matrix *powers[4];
+
+    size_t capacity;
+    size_t count;
+    mat_t *times;
+    Matrix **results;
+    /* when each entry was last used, for evicting the least recent */
+    unsigned long *used;
+    unsigned long clock;
+
+    size_t hits;
+    size_t misses;
+};
+
+/**
+ * Return `true` iff `a` and `b` are exactly the same value.
+ */
+static bool exponentialcache_same(mat_t a, mat_t b);
+
+static bool exponentialcache_same(mat_t a, mat_t b) {
+    return MAT_T_REAL(a) == MAT_T_REAL(b) && MAT_T_IMAG(a) == MAT_T_IMAG(b);
+}
+
+int exponentialcache_get(ExponentialCache *cache, Matrix *dest, mat_t t) {
+    const size_t n = matrix_width(cache->matrix);
+    size_t i, slot;
+
+    if (matrix_height(dest) != n || matrix_width(dest) != n) {
+        report_logic_error("destination has wrong dimensions for exponential");
+    }
+
+    cache->clock++;
+    for (i = 0; i < cache->count; i++) {
+        if (exponentialcache_same(cache->times[i], t)) {
+            cache->hits++;
+            cache->used[i] = cache->clock;
+            matrix_copy_from_buffer(dest, cache->results[i]->values);
+            return 0;
+        }
+    }
+    cache->misses++;
+
+    if (cache->count < cache->capacity) {
+        slot = cache->count;
+        cache->results[slot] = matrix_create(n, n);
+        if (cache->results[slot] == NULL)
+            return -1;
+        cache->count++;
+    } else {
+        slot = 0;
+        for (i = 1; i < cache->count; i++) {
+            if (cache->used[i] < cache->used[slot]) {
+                slot = i;
+            }
+        }
+    }
+    cache->times[slot] = t;
+    cache->used[slot] = cache->clock;
+
+    if (matrix_exponential_pade(cache->results[slot], cache->matrix,
+                                cache->powers, t)
+        != 0) {
+        /* drop the entry, keeping the live ones first */
+        cache->count--;
+        matrix_destroy(cache->results[slot]);
+        cache->results[slot] = cache->results[cache->count];
+        cache->times[slot] = cache->times[cache->count];
+        cache->used[slot] = cache->used[cache->count];
+        return -1;
+    }
+    matrix_copy_from_buffer(dest, cache->results[slot]->values);
+    return 0;
+}
+
+size_t exponentialcache_hits(ExponentialCache *cache) { return cache->hits; }
+
+size_t exponentialcache_misses(ExponentialCache *cache) {
+    return cache->misses;
+}
+
+ExponentialCache *exponentialcache_create(Matrix *matrix, size_t capacity) {
+    ExponentialCache *cache;
+
+    if (matrix_width(matrix) != matrix_height(matrix)) {
+        report_logic_error("exponential undefined for non-square matrix");
+    }
+    if (capacity == 0) {
+        report_logic_error("cache capacity must be positive");
+    }
+
+    cache = calloc(1, sizeof(ExponentialCache));
+    if (cache == NULL)
+        goto exponentialcache_create_fail;
+    cache->capacity = capacity;
+
+    cache->matrix = matrix_clone(matrix);
+    if (cache->matrix == NULL)
+        goto exponentialcache_create_fail;
+    cache->times = malloc(capacity * sizeof(mat_t));
+    if (cache->times == NULL)
+        goto exponentialcache_create_fail;
+    cache->results = calloc(capacity, sizeof(Matrix *));
+    if (cache->results == NULL)
+        goto exponentialcache_create_fail;
+    cache->used = calloc(capacity, sizeof(unsigned long));
+    if (cache->used == NULL)
+        goto exponentialcache_create_fail;
+
+    return cache;
+exponentialcache_create_fail:
+    exponentialcache_destroy(cache);
+    return NULL;
+}
+
+void exponentialcache_destroy(ExponentialCache *cache) {
+    size_t i;
+
+    if (cache != NULL) {
+        matrix_destroy(cache->matrix);
+        for (i = 0; i < 4; i++) {
+            matrix_destroy(cache->powers[i]);
+        }
+        if (cache->results != NULL) {
+            for (i = 0; i < cache->count; i++) {
+                matrix_destroy(cache->results[i]);
+            }
+        }
+        free(cache->times);
+        free(cache->results);
+        free(cache->used);
+        free(cache);
+    }
+}
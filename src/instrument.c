@@ -0,0 +1,392 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "instrument.h"
+#include "instrument_internal.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* nested calls deeper than this are folded into the deepest one counted */
+#define INSTRUMENT_MAX_DEPTH 16
+
+typedef struct InstrumentCounters {
+    unsigned long calls;
+    double flops;
+    double bytes;
+    double seconds;
+} InstrumentCounters;
+
+/* a call in progress, collecting the work of the calls it makes */
+typedef struct InstrumentFrame {
+    InstrumentFunction function;
+    double start;
+    double flops;
+    double bytes;
+} InstrumentFrame;
+
+/* the counters of one thread, updated only by that thread; snapshots and
+ * resets from other threads take `lock` to read or zero them */
+typedef struct InstrumentThread {
+    pthread_mutex_t lock;
+    InstrumentCounters counters[INSTRUMENT_FUNCTIONS];
+    unsigned long pivot_swaps;
+    InstrumentFrame frames[INSTRUMENT_MAX_DEPTH];
+    size_t depth;
+    struct InstrumentThread *previous;
+    struct InstrumentThread *next;
+} InstrumentThread;
+
+struct InstrumentSnapshot {
+    InstrumentCounters counters[INSTRUMENT_FUNCTIONS];
+    unsigned long pivot_swaps;
+};
+
+static const char *const instrument_names[INSTRUMENT_FUNCTIONS] = {
+    "matrix_create",
+    "matrix_multiply",
+    "matrix_multiply_accumulate",
+    "matrix_kron",
+    "matrix_exponential",
+    "matrix_determinant",
+    "matrix_determinant_in",
+    "matrix_diagonalize",
+    "matrix_svd",
+    "matrix_qr",
+    "lufactor_create",
+    "lufactor_solve",
+    "lufactor_inverse",
+    "eigen_hermitian",
+    "lanczos_solve",
+    "expm_multiply",
+    "sparsematrix_multiply_vector",
+    "sparsematrix_multiply_vector_parallel",
+    "sparsematrix_multiply_dense",
+    "kronoperator_multiply_vector",
+    "statevector_apply_1q",
+    "statevector_apply_controlled_1q",
+    "statevector_apply_2q",
+    "statevector_apply_controlled_2q",
+    "statevector_apply_kq",
+    "statevector_norm",
+    "statevector_expectation_1q",
+    "circuit_run",
+    "diskstate_run",
+    "diskstate_reorder",
+    "diststate_run",
+    "diststate_gather",
+    "densitymatrix_apply_1q",
+    "densitymatrix_apply_2q",
+    "densitymatrix_apply_kraus_1q",
+    "densitymatrix_depolarize",
+    "densitymatrix_amplitude_damp",
+    "densitymatrix_partial_trace",
+    "mps_apply_2q",
+    "tableau_h",
+    "tableau_s",
+    "tableau_cnot",
+    "tableau_x",
+    "tableau_y",
+    "tableau_z",
+    "tableau_measure",
+    "sampler_sample",
+    "sampler_histogram"};
+
+static pthread_once_t instrument_once = PTHREAD_ONCE_INIT;
+static pthread_key_t instrument_key;
+static bool instrument_key_ready = false;
+
+/* guards the list of live threads and the counters of exited ones; taken
+ * before any thread's lock */
+static pthread_mutex_t instrument_mutex = PTHREAD_MUTEX_INITIALIZER;
+static InstrumentThread *instrument_threads = NULL;
+static InstrumentSnapshot instrument_retired;
+
+/**
+ * Create the key holding each thread's counters.
+ */
+static void instrument_create_key(void);
+
+/**
+ * Fold the counters of an exiting thread into the retired counters.
+ */
+static void instrument_retire(void *thread);
+
+/**
+ * Get the counters of the calling thread, creating them on first use.
+ * Return NULL on failure.
+ */
+static InstrumentThread *instrument_thread(void);
+
+/**
+ * Add `counters` and `pivot_swaps` into `snapshot`.
+ */
+static void instrument_merge(InstrumentSnapshot *snapshot,
+                             const InstrumentCounters *counters,
+                             unsigned long pivot_swaps);
+
+/**
+ * Get a monotonic time in seconds.
+ */
+static double instrument_now(void);
+
+static void instrument_create_key(void) {
+    instrument_key_ready =
+        pthread_key_create(&instrument_key, instrument_retire) == 0;
+}
+
+static void instrument_retire(void *thread) {
+    InstrumentThread *self = thread;
+
+    pthread_mutex_lock(&instrument_mutex);
+    pthread_mutex_lock(&self->lock);
+    instrument_merge(&instrument_retired, self->counters, self->pivot_swaps);
+    pthread_mutex_unlock(&self->lock);
+    if (self->previous != NULL) {
+        self->previous->next = self->next;
+    } else {
+        instrument_threads = self->next;
+    }
+    if (self->next != NULL) {
+        self->next->previous = self->previous;
+    }
+    pthread_mutex_unlock(&instrument_mutex);
+    pthread_mutex_destroy(&self->lock);
+    free(self);
+}
+
+static InstrumentThread *instrument_thread(void) {
+    InstrumentThread *self;
+
+    pthread_once(&instrument_once, instrument_create_key);
+    if (!instrument_key_ready)
+        return NULL;
+    self = pthread_getspecific(instrument_key);
+    if (self != NULL)
+        return self;
+
+    self = calloc(1, sizeof(InstrumentThread));
+    if (self == NULL)
+        return NULL;
+    if (pthread_mutex_init(&self->lock, NULL) != 0) {
+        free(self);
+        return NULL;
+    }
+    if (pthread_setspecific(instrument_key, self) != 0) {
+        pthread_mutex_destroy(&self->lock);
+        free(self);
+        return NULL;
+    }
+    pthread_mutex_lock(&instrument_mutex);
+    self->next = instrument_threads;
+    if (instrument_threads != NULL) {
+        instrument_threads->previous = self;
+    }
+    instrument_threads = self;
+    pthread_mutex_unlock(&instrument_mutex);
+    return self;
+}
+
+static void instrument_merge(InstrumentSnapshot *snapshot,
+                             const InstrumentCounters *counters,
+                             unsigned long pivot_swaps) {
+    size_t i;
+
+    for (i = 0; i < INSTRUMENT_FUNCTIONS; i++) {
+        snapshot->counters[i].calls += counters[i].calls;
+        snapshot->counters[i].flops += counters[i].flops;
+        snapshot->counters[i].bytes += counters[i].bytes;
+        snapshot->counters[i].seconds += counters[i].seconds;
+    }
+    snapshot->pivot_swaps += pivot_swaps;
+}
+
+static double instrument_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void instrument_begin(InstrumentFunction function) {
+    InstrumentThread *self = instrument_thread();
+    InstrumentFrame *frame;
+
+    if (self == NULL)
+        return;
+    if (self->depth < INSTRUMENT_MAX_DEPTH) {
+        frame = &self->frames[self->depth];
+        frame->function = function;
+        frame->flops = 0;
+        frame->bytes = 0;
+        frame->start = instrument_now();
+    }
+    self->depth++;
+}
+
+void instrument_end(void) {
+    InstrumentThread *self = instrument_thread();
+    InstrumentFrame *frame;
+    InstrumentCounters *counters;
+    double seconds;
+
+    if (self == NULL || self->depth == 0)
+        return;
+    self->depth--;
+    if (self->depth >= INSTRUMENT_MAX_DEPTH)
+        return;
+
+    frame = &self->frames[self->depth];
+    seconds = instrument_now() - frame->start;
+    pthread_mutex_lock(&self->lock);
+    counters = &self->counters[frame->function];
+    counters->calls++;
+    counters->seconds += seconds;
+    counters->flops += frame->flops;
+    counters->bytes += frame->bytes;
+    pthread_mutex_unlock(&self->lock);
+    /* the caller's totals include this call's work */
+    if (self->depth > 0) {
+        self->frames[self->depth - 1].flops += frame->flops;
+        self->frames[self->depth - 1].bytes += frame->bytes;
+    }
+}
+
+void instrument_add_flops(double flops) {
+    InstrumentThread *self = instrument_thread();
+    size_t depth;
+
+    if (self == NULL || self->depth == 0)
+        return;
+    depth = self->depth < INSTRUMENT_MAX_DEPTH ? self->depth
+                                               : INSTRUMENT_MAX_DEPTH;
+    self->frames[depth - 1].flops += flops;
+}
+
+void instrument_add_bytes(double bytes) {
+    InstrumentThread *self = instrument_thread();
+    size_t depth;
+
+    if (self == NULL || self->depth == 0)
+        return;
+    depth = self->depth < INSTRUMENT_MAX_DEPTH ? self->depth
+                                               : INSTRUMENT_MAX_DEPTH;
+    self->frames[depth - 1].bytes += bytes;
+}
+
+void instrument_add_pivot_swap(void) {
+    InstrumentThread *self = instrument_thread();
+
+    if (self != NULL) {
+        pthread_mutex_lock(&self->lock);
+        self->pivot_swaps++;
+        pthread_mutex_unlock(&self->lock);
+    }
+}
+
+bool instrument_enabled(void) {
+#ifdef LIBQUANT_INSTRUMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char *instrument_function_name(InstrumentFunction function) {
+    return instrument_names[function];
+}
+
+void instrument_reset(void) {
+    const InstrumentCounters zero = {0, 0, 0, 0};
+    InstrumentThread *thread;
+    size_t i;
+
+    pthread_mutex_lock(&instrument_mutex);
+    for (i = 0; i < INSTRUMENT_FUNCTIONS; i++) {
+        instrument_retired.counters[i] = zero;
+    }
+    instrument_retired.pivot_swaps = 0;
+    for (thread = instrument_threads; thread != NULL; thread = thread->next) {
+        pthread_mutex_lock(&thread->lock);
+        for (i = 0; i < INSTRUMENT_FUNCTIONS; i++) {
+            thread->counters[i] = zero;
+        }
+        thread->pivot_swaps = 0;
+        pthread_mutex_unlock(&thread->lock);
+    }
+    pthread_mutex_unlock(&instrument_mutex);
+}
+
+unsigned long instrumentsnapshot_calls(InstrumentSnapshot *snapshot,
+                                       InstrumentFunction function) {
+    return snapshot->counters[function].calls;
+}
+
+double instrumentsnapshot_flops(InstrumentSnapshot *snapshot,
+                                InstrumentFunction function) {
+    return snapshot->counters[function].flops;
+}
+
+double instrumentsnapshot_bytes(InstrumentSnapshot *snapshot,
+                                InstrumentFunction function) {
+    return snapshot->counters[function].bytes;
+}
+
+double instrumentsnapshot_seconds(InstrumentSnapshot *snapshot,
+                                  InstrumentFunction function) {
+    return snapshot->counters[function].seconds;
+}
+
+unsigned long instrumentsnapshot_pivot_swaps(InstrumentSnapshot *snapshot) {
+    return snapshot->pivot_swaps;
+}
+
+int instrumentsnapshot_dump(InstrumentSnapshot *snapshot, FILE *file) {
+    const InstrumentCounters *counters;
+    size_t i;
+
+    if (fprintf(file, "{\"enabled\": %s, \"pivot_swaps\": %lu, "
+                      "\"functions\": [",
+                instrument_enabled() ? "true" : "false",
+                snapshot->pivot_swaps) < 0)
+        return -1;
+    for (i = 0; i < INSTRUMENT_FUNCTIONS; i++) {
+        counters = &snapshot->counters[i];
+        if (fprintf(file, "%s\n    {\"name\": \"%s\", \"calls\": %lu, "
+                          "\"flops\": %.0f, \"bytes\": %.0f, "
+                          "\"seconds\": %.9f}",
+                    i > 0 ? "," : "", instrument_names[i], counters->calls,
+                    counters->flops, counters->bytes, counters->seconds)
+            < 0)
+            return -1;
+    }
+    if (fprintf(file, "\n]}\n") < 0)
+        return -1;
+    return 0;
+}
+
+InstrumentSnapshot *instrumentsnapshot_create(void) {
+    InstrumentSnapshot *snapshot = calloc(1, sizeof(InstrumentSnapshot));
+    InstrumentThread *thread;
+
+    if (snapshot == NULL)
+        return NULL;
+    /* live threads keep counting while this reads them, so each one's share
+     * is as of the moment its lock is taken */
+    pthread_mutex_lock(&instrument_mutex);
+    instrument_merge(snapshot, instrument_retired.counters,
+                     instrument_retired.pivot_swaps);
+    for (thread = instrument_threads; thread != NULL; thread = thread->next) {
+        pthread_mutex_lock(&thread->lock);
+        instrument_merge(snapshot, thread->counters, thread->pivot_swaps);
+        pthread_mutex_unlock(&thread->lock);
+    }
+    pthread_mutex_unlock(&instrument_mutex);
+    return snapshot;
+}
+
+void instrumentsnapshot_destroy(InstrumentSnapshot *snapshot) {
+    if (snapshot != NULL) {
+        free(snapshot);
+    }
+}
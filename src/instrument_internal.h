@@ -0,0 +1,59 @@
+#ifndef INSTRUMENT_INTERNAL_H
+#define INSTRUMENT_INTERNAL_H
+
+#include "instrument.h"
+
+/* floating point operations in one multiply-add, and in one multiply, of
+ * mat_t values */
+#ifdef MAT_T_COMPLEX
+#define INSTRUMENT_FMA_FLOPS 8
+#define INSTRUMENT_MUL_FLOPS 6
+#else
+#define INSTRUMENT_FMA_FLOPS 2
+#define INSTRUMENT_MUL_FLOPS 1
+#endif
+
+/* every public function counted starts with INSTRUMENT_BEGIN and passes
+ * INSTRUMENT_END on each way out; without LIBQUANT_INSTRUMENT the hooks,
+ * and their arguments, compile to nothing */
+#ifdef LIBQUANT_INSTRUMENT
+#define INSTRUMENT_BEGIN(function) instrument_begin(function)
+#define INSTRUMENT_END() instrument_end()
+#define INSTRUMENT_FLOPS(flops) instrument_add_flops((double)(flops))
+#define INSTRUMENT_BYTES(bytes) instrument_add_bytes((double)(bytes))
+#define INSTRUMENT_PIVOT_SWAP() instrument_add_pivot_swap()
+#else
+#define INSTRUMENT_BEGIN(function) ((void)0)
+#define INSTRUMENT_END() ((void)0)
+#define INSTRUMENT_FLOPS(flops) ((void)0)
+#define INSTRUMENT_BYTES(bytes) ((void)0)
+#define INSTRUMENT_PIVOT_SWAP() ((void)0)
+#endif
+
+/**
+ * Start timing a call to `function` on this thread.
+ */
+void instrument_begin(InstrumentFunction function);
+
+/**
+ * Finish the call started by the latest unfinished `instrument_begin` on this
+ * thread.
+ */
+void instrument_end(void);
+
+/**
+ * Count `flops` floating point operations in the current call.
+ */
+void instrument_add_flops(double flops);
+
+/**
+ * Count `bytes` bytes allocated in the current call.
+ */
+void instrument_add_bytes(double bytes);
+
+/**
+ * Count a row swap made while pivoting.
+ */
+void instrument_add_pivot_swap(void);
+
+#endif
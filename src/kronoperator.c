@@ -0,0 +1,175 @@
+#include "kronoperator.h"
+#include "instrument_internal.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct KronOperator {
+    size_t size;
+    size_t count;
+
+    /* copies of the factors */
+    Matrix **factors;
+    /* identity factors are skipped */
+    bool *identities;
+    size_t passes;
+
+    /* the vector between passes */
+    mat_t *scratch;
+};
+
+/**
+ * Set `y` to factor `index` applied along its axis of `x`, with `left`
+ * values before that axis and `right` after it.
+ */
+static void kronoperator_apply(KronOperator *kron, size_t index, size_t left,
+                               size_t right, const mat_t *x, mat_t *y);
+
+static void kronoperator_apply(KronOperator *kron, size_t index, size_t left,
+                               size_t right, const mat_t *x, mat_t *y) {
+    const Matrix *factor = kron->factors[index];
+    const size_t d = factor->width;
+    const mat_t *a = factor->values;
+    const mat_t *in;
+    mat_t *out;
+    mat_t value, sum;
+    size_t l, i, j, r;
+
+    if (right == 1) {
+        /* the axis is innermost: each output is a short dot product */
+        for (l = 0; l < left; l++) {
+            in = x + l * d;
+            out = y + l * d;
+            for (i = 0; i < d; i++) {
+                sum = MAT_T_0;
+                for (j = 0; j < d; j++) {
+                    sum = MAT_T_ADD(sum, MAT_T_MUL(a[i * d + j], in[j]));
+                }
+                out[i] = sum;
+            }
+        }
+        return;
+    }
+
+    /* otherwise each slice is a d x `right` matrix X_l, and Y_l = A X_l is
+     * built from contiguous runs of `right` values */
+    memset(y, 0, left * d * right * sizeof(mat_t));
+    for (l = 0; l < left; l++) {
+        in = x + l * d * right;
+        out = y + l * d * right;
+        for (i = 0; i < d; i++) {
+            for (j = 0; j < d; j++) {
+                value = a[i * d + j];
+                for (r = 0; r < right; r++) {
+                    out[i * right + r] = MAT_T_ADD(
+                        out[i * right + r], MAT_T_MUL(value, in[j * right + r]));
+                }
+            }
+        }
+    }
+}
+
+void kronoperator_multiply_vector(KronOperator *kron, const mat_t *x,
+                                  mat_t *y) {
+    const mat_t *in = x;
+    mat_t *out;
+    size_t left = 1, right = kron->size, pass = 0, k;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_KRONOPERATOR_MULTIPLY_VECTOR);
+    if (kron->passes == 0) {
+        memcpy(y, x, kron->size * sizeof(mat_t));
+        INSTRUMENT_END();
+        return;
+    }
+
+    /* alternate between `y` and the scratch vector so the last pass lands
+     * in `y` */
+    for (k = 0; k < kron->count; k++) {
+        right /= kron->factors[k]->width;
+        if (!kron->identities[k]) {
+            out = (kron->passes - pass) % 2 == 1 ? y : kron->scratch;
+            kronoperator_apply(kron, k, left, right, in, out);
+            INSTRUMENT_FLOPS((double)kron->size * kron->factors[k]->width
+                             * INSTRUMENT_FMA_FLOPS);
+            in = out;
+            pass++;
+        }
+        left *= kron->factors[k]->width;
+    }
+    INSTRUMENT_END();
+}
+
+size_t kronoperator_size(KronOperator *kron) { return kron->size; }
+
+KronOperator *kronoperator_create(Matrix **factors, size_t count) {
+    KronOperator *kron;
+    Matrix *factor;
+    mat_t expected;
+    size_t d, i, k;
+
+    if (count == 0) {
+        report_logic_error("Kronecker product needs at least one factor");
+    }
+
+    kron = calloc(1, sizeof(KronOperator));
+    if (kron == NULL)
+        goto kronoperator_create_fail;
+    kron->count = count;
+    kron->size = 1;
+
+    kron->factors = calloc(count, sizeof(Matrix *));
+    if (kron->factors == NULL)
+        goto kronoperator_create_fail;
+    kron->identities = calloc(count, sizeof(bool));
+    if (kron->identities == NULL)
+        goto kronoperator_create_fail;
+
+    for (k = 0; k < count; k++) {
+        d = matrix_width(factors[k]);
+        if (matrix_height(factors[k]) != d) {
+            report_logic_error("Kronecker factors must be square");
+        }
+        factor = kron->factors[k] = matrix_clone(factors[k]);
+        if (factor == NULL)
+            goto kronoperator_create_fail;
+        /* only exact identities are skipped */
+        kron->identities[k] = true;
+        for (i = 0; i < d * d && kron->identities[k]; i++) {
+            expected = i % (d + 1) == 0 ? MAT_T_1 : MAT_T_0;
+            kron->identities[k]
+                = MAT_T_REAL(factor->values[i]) == MAT_T_REAL(expected)
+                  && MAT_T_IMAG(factor->values[i]) == MAT_T_IMAG(expected);
+        }
+        if (!kron->identities[k]) {
+            kron->passes++;
+        }
+        kron->size *= d;
+    }
+
+    kron->scratch = malloc(kron->size * sizeof(mat_t));
+    if (kron->scratch == NULL)
+        goto kronoperator_create_fail;
+
+    return kron;
+kronoperator_create_fail:
+    kronoperator_destroy(kron);
+    return NULL;
+}
+
+void kronoperator_destroy(KronOperator *kron) {
+    size_t k;
+
+    if (kron != NULL) {
+        if (kron->factors != NULL) {
+            for (k = 0; k < kron->count; k++) {
+                matrix_destroy(kron->factors[k]);
+            }
+        }
+        free(kron->factors);
+        free(kron->identities);
+        free(kron->scratch);
+        free(kron);
+    }
+}
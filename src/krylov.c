@@ -0,0 +1,98 @@
+#include "krylov_internal.h"
+#include <math.h>
+
+/* rows of the basis worked on at a time */
+#define KRYLOV_BLOCK 1024
+
+mat_t krylov_orthogonalize(const mat_t *vectors, size_t size, size_t count,
+                           mat_t *coefficients, mat_t *w) {
+    const mat_t *v0;
+    const mat_t *v1;
+    const mat_t *v2;
+    const mat_t *v3;
+    mat_t sum0, sum1, sum2, sum3, value, last = MAT_T_0;
+    size_t pass, begin, end, i, k;
+
+    for (pass = 0; pass < 2; pass++) {
+        /* classical Gram-Schmidt: every coefficient from the same w, a
+         * block of rows at a time so w stays in cache across the basis */
+        for (i = 0; i < count; i++) {
+            coefficients[i] = MAT_T_0;
+        }
+        for (begin = 0; begin < size; begin = end) {
+            end = size - begin < KRYLOV_BLOCK ? size : begin + KRYLOV_BLOCK;
+            /* four vectors per pass over w, for four independent sums */
+            for (i = 0; i + 4 <= count; i += 4) {
+                v0 = vectors + i * size;
+                v1 = v0 + size;
+                v2 = v1 + size;
+                v3 = v2 + size;
+                sum0 = sum1 = sum2 = sum3 = MAT_T_0;
+                for (k = begin; k < end; k++) {
+                    value = w[k];
+                    sum0 = MAT_T_ADD(sum0, MAT_T_MUL(MAT_T_CONJ(v0[k]), value));
+                    sum1 = MAT_T_ADD(sum1, MAT_T_MUL(MAT_T_CONJ(v1[k]), value));
+                    sum2 = MAT_T_ADD(sum2, MAT_T_MUL(MAT_T_CONJ(v2[k]), value));
+                    sum3 = MAT_T_ADD(sum3, MAT_T_MUL(MAT_T_CONJ(v3[k]), value));
+                }
+                coefficients[i]
+                    = MAT_T_ADD(coefficients[i], sum0);
+                coefficients[i + 1]
+                    = MAT_T_ADD(coefficients[i + 1], sum1);
+                coefficients[i + 2]
+                    = MAT_T_ADD(coefficients[i + 2], sum2);
+                coefficients[i + 3]
+                    = MAT_T_ADD(coefficients[i + 3], sum3);
+            }
+            for (; i < count; i++) {
+                v0 = vectors + i * size;
+                sum0 = MAT_T_0;
+                for (k = begin; k < end; k++) {
+                    sum0 = MAT_T_ADD(sum0, MAT_T_MUL(MAT_T_CONJ(v0[k]), w[k]));
+                }
+                coefficients[i]
+                    = MAT_T_ADD(coefficients[i], sum0);
+            }
+        }
+        for (begin = 0; begin < size; begin = end) {
+            end = size - begin < KRYLOV_BLOCK ? size : begin + KRYLOV_BLOCK;
+            for (i = 0; i + 4 <= count; i += 4) {
+                v0 = vectors + i * size;
+                v1 = v0 + size;
+                v2 = v1 + size;
+                v3 = v2 + size;
+                sum0 = coefficients[i];
+                sum1 = coefficients[i + 1];
+                sum2 = coefficients[i + 2];
+                sum3 = coefficients[i + 3];
+                for (k = begin; k < end; k++) {
+                    value = MAT_T_ADD(MAT_T_MUL(sum0, v0[k]),
+                                      MAT_T_MUL(sum1, v1[k]));
+                    value = MAT_T_ADD(value, MAT_T_MUL(sum2, v2[k]));
+                    value = MAT_T_ADD(value, MAT_T_MUL(sum3, v3[k]));
+                    w[k] = MAT_T_SUB(w[k], value);
+                }
+            }
+            for (; i < count; i++) {
+                v0 = vectors + i * size;
+                sum0 = coefficients[i];
+                for (k = begin; k < end; k++) {
+                    w[k] = MAT_T_SUB(w[k], MAT_T_MUL(sum0, v0[k]));
+                }
+            }
+        }
+        if (count > 0) {
+            last = MAT_T_ADD(last, coefficients[count - 1]);
+        }
+    }
+    return last;
+}
+
+double krylov_norm(const mat_t *x, size_t size) {
+    double sum = 0.0;
+    size_t k;
+    for (k = 0; k < size; k++) {
+        sum += MAT_T_ABS2(x[k]);
+    }
+    return sqrt(sum);
+}
@@ -0,0 +1,23 @@
+#ifndef KRYLOV_INTERNAL_H
+#define KRYLOV_INTERNAL_H
+
+#include "mat_t.h"
+#include <stdlib.h>
+
+/* vector kernels shared by the Krylov subspace methods */
+
+/**
+ * Subtract from `w` its components along the `count` orthonormal vectors of
+ * `size` values stored one after another at `vectors`, twice for stability.
+ * `coefficients` is scratch for `count` values.
+ * Return the total component of `w` along the last of the vectors.
+ */
+mat_t krylov_orthogonalize(const mat_t *vectors, size_t size, size_t count,
+                           mat_t *coefficients, mat_t *w);
+
+/**
+ * Get the norm of the `size` values at `x`.
+ */
+double krylov_norm(const mat_t *x, size_t size);
+
+#endif
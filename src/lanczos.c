@@ -0,0 +1,309 @@
+#include "lanczos.h"
+#include "eigen.h"
+#include "instrument_internal.h"
+#include "krylov_internal.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* a step whose new direction is this small relative to the operator has
+ * found an invariant subspace */
+#define LANCZOS_BREAKDOWN 1e-12
+
+/* rows of the basis rotated at a time when restarting */
+#define LANCZOS_BLOCK 1024
+
+struct Lanczos {
+    size_t size;
+    size_t count;
+    size_t basis;
+
+    /* basis + 1 orthonormal vectors of `size` values, one after another */
+    mat_t *vectors;
+    /* V^H A V over the basis: tridiagonal, plus an arrow after a restart */
+    Matrix *projection;
+    Matrix *ritz_vectors;
+    double *ritz_values;
+    /* V^H w while orthogonalizing w */
+    mat_t *coefficients;
+    /* scratch for restarts: the transposed rotation and a block of rows */
+    mat_t *rotation;
+    mat_t *rows;
+
+    double *residuals;
+    size_t iterations;
+    size_t matvecs;
+    unsigned long seed;
+};
+
+/**
+ * Fill `x` with pseudo-random values orthogonal to the first `count` basis
+ * vectors, and normalize it.
+ */
+static void lanczos_random(Lanczos *lanczos, mat_t *x, size_t count);
+
+/**
+ * Replace the first `keep` basis vectors with the Ritz vectors for the
+ * first `keep` Ritz values.
+ * Return 0 on success, -1 on failure.
+ */
+static int lanczos_rotate(Lanczos *lanczos, size_t keep);
+
+static void lanczos_random(Lanczos *lanczos, mat_t *x, size_t count) {
+    double norm;
+    size_t k;
+
+    do {
+        for (k = 0; k < lanczos->size; k++) {
+            lanczos->seed = lanczos->seed * 1103515245UL + 12345UL;
+            x[k] = MAT_T((double)((lanczos->seed >> 16) & 0x7fff) / 16384.0
+                         - 1.0);
+        }
+        krylov_orthogonalize(lanczos->vectors, lanczos->size, count,
+                             lanczos->coefficients, x);
+        norm = krylov_norm(x, lanczos->size);
+    } while (norm == 0.0);
+
+    for (k = 0; k < lanczos->size; k++) {
+        x[k] = MAT_T_MUL(MAT_T(1.0 / norm), x[k]);
+    }
+}
+
+static int lanczos_rotate(Lanczos *lanczos, size_t keep) {
+    const size_t size = lanczos->size;
+    const size_t basis = lanczos->basis;
+    const mat_t *y = lanczos->ritz_vectors->values;
+    size_t begin, rows, i, j;
+
+    for (j = 0; j < keep; j++) {
+        for (i = 0; i < basis; i++) {
+            lanczos->rotation[j * basis + i] = y[i * basis + j];
+        }
+    }
+
+    /* V[:, rows] = Y^T V[:, rows] a block of rows at a time, so only the
+     * block needs copying */
+    for (begin = 0; begin < size; begin += LANCZOS_BLOCK) {
+        rows = size - begin < LANCZOS_BLOCK ? size - begin : LANCZOS_BLOCK;
+        for (i = 0; i < basis; i++) {
+            memcpy(lanczos->rows + i * rows,
+                   lanczos->vectors + i * size + begin, rows * sizeof(mat_t));
+        }
+        for (j = 0; j < keep; j++) {
+            memset(lanczos->vectors + j * size + begin, 0,
+                   rows * sizeof(mat_t));
+        }
+        if (matrix_gemm(keep, rows, basis, MAT_T_1, lanczos->rotation, basis,
+                        lanczos->rows, rows, lanczos->vectors + begin, size)
+            != 0)
+            return -1;
+    }
+    return 0;
+}
+
+double lanczos_eigenvalue(Lanczos *lanczos, size_t index) {
+    if (index >= lanczos->count) {
+        report_logic_error("eigenpair index out of bounds");
+    }
+    return lanczos->ritz_values[index];
+}
+
+const mat_t *lanczos_eigenvector(Lanczos *lanczos, size_t index) {
+    if (index >= lanczos->count) {
+        report_logic_error("eigenpair index out of bounds");
+    }
+    return lanczos->vectors + index * lanczos->size;
+}
+
+double lanczos_residual(Lanczos *lanczos, size_t index) {
+    if (index >= lanczos->count) {
+        report_logic_error("eigenpair index out of bounds");
+    }
+    return lanczos->residuals[index];
+}
+
+size_t lanczos_iterations(Lanczos *lanczos) { return lanczos->iterations; }
+
+size_t lanczos_matvecs(Lanczos *lanczos) { return lanczos->matvecs; }
+
+int lanczos_solve(Lanczos *lanczos, MatVec matvec, void *context,
+                  double tolerance, size_t max_iterations) {
+    const size_t size = lanczos->size;
+    const size_t basis = lanczos->basis;
+    mat_t *h = lanczos->projection->values;
+    const mat_t *y = lanczos->ritz_vectors->values;
+    mat_t *w;
+    mat_t coupling;
+    double alpha, beta = 0.0, norm = 0.0;
+    size_t active = 0, keep, i, j;
+    bool converged = false;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_LANCZOS_SOLVE);
+    lanczos->iterations = 0;
+    lanczos->matvecs = 0;
+    for (i = 0; i < basis * basis; i++) {
+        h[i] = MAT_T_0;
+    }
+    lanczos_random(lanczos, lanczos->vectors, 0);
+
+    while (!converged && lanczos->iterations < max_iterations) {
+        lanczos->iterations++;
+
+        /* extend the basis to `basis` vectors; vector j + 1 is the part of
+         * A v_j orthogonal to all before it */
+        for (j = active; j < basis; j++) {
+            w = lanczos->vectors + (j + 1) * size;
+            matvec(context, lanczos->vectors + j * size, w);
+            lanczos->matvecs++;
+
+            alpha = MAT_T_REAL(krylov_orthogonalize(
+                lanczos->vectors, size, j + 1, lanczos->coefficients, w));
+            beta = krylov_norm(w, size);
+            h[j * basis + j] = MAT_T(alpha);
+            norm = fabs(alpha) + beta > norm ? fabs(alpha) + beta : norm;
+
+            if (beta <= LANCZOS_BREAKDOWN * norm) {
+                /* invariant subspace: carry on from a fresh direction */
+                beta = 0.0;
+                if (j + 1 < size) {
+                    lanczos_random(lanczos, w, j + 1);
+                }
+            } else {
+                for (i = 0; i < size; i++) {
+                    w[i] = MAT_T_MUL(MAT_T(1.0 / beta), w[i]);
+                }
+            }
+            if (j + 1 < basis) {
+                h[j * basis + j + 1] = MAT_T(beta);
+                h[(j + 1) * basis + j] = MAT_T(beta);
+            }
+        }
+
+        if (eigen_hermitian(lanczos->projection, lanczos->ritz_values,
+                            lanczos->ritz_vectors)
+            != 0) {
+            INSTRUMENT_END();
+            return -1;
+        }
+
+        /* the residual of a Ritz pair is beta times the last component of
+         * its Ritz vector */
+        converged = true;
+        for (i = 0; i < lanczos->count; i++) {
+            lanczos->residuals[i]
+                = beta * sqrt(MAT_T_ABS2(y[(basis - 1) * basis + i]));
+            converged = converged
+                        && lanczos->residuals[i]
+                               <= tolerance
+                                      * (fabs(lanczos->ritz_values[i]) > 1.0
+                                             ? fabs(lanczos->ritz_values[i])
+                                             : 1.0);
+        }
+
+        /* keep the wanted Ritz vectors and as many again of the next ones,
+         * leaving room to continue from the residual direction */
+        if (converged || lanczos->iterations == max_iterations) {
+            keep = lanczos->count;
+        } else {
+            keep = lanczos->count + (basis - lanczos->count) / 2;
+            if (keep >= basis) {
+                keep = basis - 1;
+            }
+        }
+        if (lanczos_rotate(lanczos, keep) != 0) {
+            INSTRUMENT_END();
+            return -1;
+        }
+        if (converged || lanczos->iterations == max_iterations) {
+            break;
+        }
+        memcpy(lanczos->vectors + keep * size, lanczos->vectors + basis * size,
+               size * sizeof(mat_t));
+
+        for (i = 0; i < basis * basis; i++) {
+            h[i] = MAT_T_0;
+        }
+        for (i = 0; i < keep; i++) {
+            coupling = MAT_T_MUL(MAT_T(beta), y[(basis - 1) * basis + i]);
+            h[i * basis + i] = MAT_T(lanczos->ritz_values[i]);
+            h[keep * basis + i] = coupling;
+            h[i * basis + keep] = MAT_T_CONJ(coupling);
+        }
+        active = keep;
+    }
+
+    INSTRUMENT_END();
+    return converged ? 0 : -1;
+}
+
+Lanczos *lanczos_create(size_t size, size_t count, size_t basis) {
+    Lanczos *lanczos;
+
+    if (count == 0 || count > size) {
+        report_logic_error("eigenpair count must be in [1, size]");
+    }
+    if (basis == 0) {
+        basis = 2 * count + 20;
+    }
+    /* a restart needs room for the kept vectors and at least one more */
+    if (basis < count + 2) {
+        basis = count + 2;
+    }
+    if (basis > size) {
+        basis = size;
+    }
+
+    lanczos = calloc(1, sizeof(Lanczos));
+    if (lanczos == NULL)
+        goto lanczos_create_fail;
+    lanczos->size = size;
+    lanczos->count = count;
+    lanczos->basis = basis;
+    lanczos->seed = 1;
+
+    lanczos->vectors = malloc((basis + 1) * size * sizeof(mat_t));
+    if (lanczos->vectors == NULL)
+        goto lanczos_create_fail;
+    lanczos->projection = matrix_create(basis, basis);
+    if (lanczos->projection == NULL)
+        goto lanczos_create_fail;
+    lanczos->ritz_vectors = matrix_create(basis, basis);
+    if (lanczos->ritz_vectors == NULL)
+        goto lanczos_create_fail;
+    lanczos->ritz_values = malloc(basis * sizeof(double));
+    if (lanczos->ritz_values == NULL)
+        goto lanczos_create_fail;
+    lanczos->coefficients = malloc((basis + 1) * sizeof(mat_t));
+    if (lanczos->coefficients == NULL)
+        goto lanczos_create_fail;
+    lanczos->rotation = malloc(basis * basis * sizeof(mat_t));
+    if (lanczos->rotation == NULL)
+        goto lanczos_create_fail;
+    lanczos->rows = malloc(basis * LANCZOS_BLOCK * sizeof(mat_t));
+    if (lanczos->rows == NULL)
+        goto lanczos_create_fail;
+    lanczos->residuals = calloc(count, sizeof(double));
+    if (lanczos->residuals == NULL)
+        goto lanczos_create_fail;
+
+    return lanczos;
+lanczos_create_fail:
+    lanczos_destroy(lanczos);
+    return NULL;
+}
+
+void lanczos_destroy(Lanczos *lanczos) {
+    if (lanczos != NULL) {
+        free(lanczos->vectors);
+        matrix_destroy(lanczos->projection);
+        matrix_destroy(lanczos->ritz_vectors);
+        free(lanczos->ritz_values);
+        free(lanczos->coefficients);
+        free(lanczos->rotation);
+        free(lanczos->rows);
+        free(lanczos->residuals);
+        free(lanczos);
+    }
+}
@@ -0,0 +1,252 @@
+#include "lufactor.h"
+#include "instrument_internal.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <stdlib.h>
+
+/* columns per panel; the trailing update of each panel is a matrix_gemm */
+#define LUFACTOR_BLOCK 64
+
+struct LUFactor {
+    /* L below the diagonal (with an implied unit diagonal), U on and above */
+    Matrix *lu;
+    /* row i was swapped with row pivots[i] while factoring */
+    size_t *pivots;
+    /* parity of the row swaps */
+    bool odd;
+    bool singular;
+};
+
+/**
+ * Subtract `multiple` * `src` from `dest`, over `count` values.
+ */
+static void lufactor_subtract(mat_t *dest, const mat_t *src, mat_t multiple,
+                              size_t count);
+
+/**
+ * Swap `count` values between `a` and `b`.
+ */
+static void lufactor_swap(mat_t *a, mat_t *b, size_t count);
+
+/**
+ * Factor columns [`begin`, `end`) of the rows at and below `begin`, pivoting
+ * whole rows.
+ */
+static void lufactor_factor_panel(LUFactor *factor, size_t begin, size_t end);
+
+static void lufactor_subtract(mat_t *dest, const mat_t *src, mat_t multiple,
+                              size_t count) {
+    size_t i;
+    for (i = 0; i < count; i++) {
+        dest[i] = MAT_T_SUB(dest[i], MAT_T_MUL(multiple, src[i]));
+    }
+}
+
+static void lufactor_swap(mat_t *a, mat_t *b, size_t count) {
+    mat_t temp;
+    size_t i;
+    for (i = 0; i < count; i++) {
+        temp = a[i];
+        a[i] = b[i];
+        b[i] = temp;
+    }
+}
+
+size_t lufactor_width(LUFactor *factor) { return factor->lu->width; }
+
+bool lufactor_is_singular(LUFactor *factor) { return factor->singular; }
+
+static void lufactor_factor_panel(LUFactor *factor, size_t begin, size_t end) {
+    const size_t width = factor->lu->width;
+    mat_t *values = factor->lu->values;
+    mat_t *pivot_row;
+    mat_t *row;
+    mat_t reciprocal;
+    double magnitude, best;
+    size_t i, j, pivot;
+
+    for (j = begin; j < end; j++) {
+        /* partial pivoting: bring up the largest value in column j */
+        pivot = j;
+        best = MAT_T_ABS2(values[j * width + j]);
+        for (i = j + 1; i < width; i++) {
+            magnitude = MAT_T_ABS2(values[i * width + j]);
+            if (magnitude > best) {
+                best = magnitude;
+                pivot = i;
+            }
+        }
+        factor->pivots[j] = pivot;
+        if (pivot != j) {
+            lufactor_swap(values + j * width, values + pivot * width, width);
+            factor->odd = !factor->odd;
+            INSTRUMENT_PIVOT_SWAP();
+        }
+
+        /* only an exactly zero column is singular: a tolerance here would
+         * also reject small but well-defined pivots of scaled matrices */
+        pivot_row = values + j * width;
+        if (best == 0.0) {
+            factor->singular = true;
+            continue;
+        }
+
+        reciprocal = MAT_T_DIV(MAT_T_1, pivot_row[j]);
+        INSTRUMENT_FLOPS((double)(width - j - 1) * (end - j)
+                         * INSTRUMENT_FMA_FLOPS);
+        for (i = j + 1; i < width; i++) {
+            row = values + i * width;
+            row[j] = MAT_T_MUL(row[j], reciprocal);
+            lufactor_subtract(row + j + 1, pivot_row + j + 1, row[j],
+                              end - j - 1);
+        }
+    }
+}
+
+mat_t lufactor_determinant(LUFactor *factor) {
+    const size_t width = factor->lu->width;
+    mat_t result = factor->odd ? MAT_T(-1.0) : MAT_T_1;
+    size_t i;
+
+    if (factor->singular) {
+        return MAT_T_0;
+    }
+    for (i = 0; i < width; i++) {
+        result = MAT_T_MUL(result, factor->lu->values[i * width + i]);
+    }
+    return result;
+}
+
+int lufactor_solve(LUFactor *factor, Matrix *rhs) {
+    const size_t width = factor->lu->width;
+    const size_t columns = matrix_width(rhs);
+    const size_t stride = rhs->stride;
+    const mat_t *lu = factor->lu->values;
+    mat_t *values = rhs->values;
+    size_t i, r;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_LUFACTOR_SOLVE);
+    if (matrix_height(rhs) != width) {
+        report_logic_error("right-hand side has wrong height for solve");
+    }
+    if (factor->singular)
+        goto lufactor_solve_fail;
+    INSTRUMENT_FLOPS((double)width * width * columns * INSTRUMENT_FMA_FLOPS);
+
+    for (i = 0; i < width; i++) {
+        if (factor->pivots[i] != i) {
+            lufactor_swap(values + i * stride,
+                          values + factor->pivots[i] * stride, columns);
+        }
+    }
+
+    /* L y = P b */
+    for (i = 1; i < width; i++) {
+        for (r = 0; r < i; r++) {
+            lufactor_subtract(values + i * stride, values + r * stride,
+                              lu[i * width + r], columns);
+        }
+    }
+
+    /* U x = y */
+    for (i = width; i-- > 0;) {
+        for (r = i + 1; r < width; r++) {
+            lufactor_subtract(values + i * stride, values + r * stride,
+                              lu[i * width + r], columns);
+        }
+        for (r = 0; r < columns; r++) {
+            values[i * stride + r]
+                = MAT_T_DIV(values[i * stride + r], lu[i * width + i]);
+        }
+    }
+
+    INSTRUMENT_END();
+    return 0;
+lufactor_solve_fail:
+    INSTRUMENT_END();
+    return -1;
+}
+
+Matrix *lufactor_inverse(LUFactor *factor) {
+    Matrix *inverse;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_LUFACTOR_INVERSE);
+    inverse = matrix_create_identity(factor->lu->width);
+    if (inverse == NULL)
+        goto lufactor_inverse_fail;
+    if (lufactor_solve(factor, inverse) != 0)
+        goto lufactor_inverse_fail;
+    INSTRUMENT_END();
+    return inverse;
+lufactor_inverse_fail:
+    matrix_destroy(inverse);
+    INSTRUMENT_END();
+    return NULL;
+}
+
+LUFactor *lufactor_create(Matrix *matrix) {
+    const size_t width = matrix_width(matrix);
+    LUFactor *factor;
+    mat_t *values;
+    size_t begin, end, i, r;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_LUFACTOR_CREATE);
+    if (matrix_height(matrix) != width) {
+        report_logic_error("non-square matrix cannot be LU factored");
+    }
+
+    factor = calloc(1, sizeof(LUFactor));
+    if (factor == NULL)
+        goto lufactor_create_fail;
+
+    factor->pivots = calloc(width, sizeof(size_t));
+    if (factor->pivots == NULL)
+        goto lufactor_create_fail;
+    INSTRUMENT_BYTES(sizeof(LUFactor) + width * sizeof(size_t));
+
+    factor->lu = matrix_clone(matrix);
+    if (factor->lu == NULL)
+        goto lufactor_create_fail;
+    values = factor->lu->values;
+
+    /* right-looking: factor a panel of columns, solve for the block row of U
+     * to its right, then update the trailing matrix with one product */
+    for (begin = 0; begin < width; begin = end) {
+        end = width - begin < LUFACTOR_BLOCK ? width : begin + LUFACTOR_BLOCK;
+
+        lufactor_factor_panel(factor, begin, end);
+        if (end == width) {
+            break;
+        }
+
+        for (i = begin + 1; i < end; i++) {
+            for (r = begin; r < i; r++) {
+                lufactor_subtract(values + i * width + end,
+                                  values + r * width + end,
+                                  values[i * width + r], width - end);
+            }
+        }
+
+        if (matrix_gemm(width - end, width - end, end - begin, MAT_T(-1.0),
+                        values + end * width + begin, width,
+                        values + begin * width + end, width,
+                        values + end * width + end, width)
+            != 0)
+            goto lufactor_create_fail;
+    }
+
+    INSTRUMENT_END();
+    return factor;
+lufactor_create_fail:
+    lufactor_destroy(factor);
+    INSTRUMENT_END();
+    return NULL;
+}
+
+void lufactor_destroy(LUFactor *factor) {
+    if (factor != NULL) {
+        matrix_destroy(factor->lu);
+        free(factor->pivots);
+        free(factor);
+    }
+}
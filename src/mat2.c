@@ -0,0 +1,73 @@
+#include "mat2.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+
+void mat2_identity(Mat2 *dest) {
+    dest->values[0] = MAT_T_1;
+    dest->values[1] = MAT_T_0;
+    dest->values[2] = MAT_T_0;
+    dest->values[3] = MAT_T_1;
+}
+
+void mat2_multiply(Mat2 *dest, const Mat2 *a, const Mat2 *b) {
+    const mat_t a00 = a->values[0], a01 = a->values[1];
+    const mat_t a10 = a->values[2], a11 = a->values[3];
+    const mat_t b00 = b->values[0], b01 = b->values[1];
+    const mat_t b10 = b->values[2], b11 = b->values[3];
+
+    dest->values[0] = MAT_T_ADD(MAT_T_MUL(a00, b00), MAT_T_MUL(a01, b10));
+    dest->values[1] = MAT_T_ADD(MAT_T_MUL(a00, b01), MAT_T_MUL(a01, b11));
+    dest->values[2] = MAT_T_ADD(MAT_T_MUL(a10, b00), MAT_T_MUL(a11, b10));
+    dest->values[3] = MAT_T_ADD(MAT_T_MUL(a10, b01), MAT_T_MUL(a11, b11));
+}
+
+void mat2_adjoint(Mat2 *dest, const Mat2 *a) {
+    const mat_t a01 = a->values[1], a10 = a->values[2];
+
+    dest->values[0] = MAT_T_CONJ(a->values[0]);
+    dest->values[1] = MAT_T_CONJ(a10);
+    dest->values[2] = MAT_T_CONJ(a01);
+    dest->values[3] = MAT_T_CONJ(a->values[3]);
+}
+
+mat_t mat2_determinant(const Mat2 *a) {
+    return MAT_T_SUB(MAT_T_MUL(a->values[0], a->values[3]),
+                     MAT_T_MUL(a->values[1], a->values[2]));
+}
+
+int mat2_inverse(Mat2 *dest, const Mat2 *a) {
+    const mat_t determinant = mat2_determinant(a);
+    mat_t reciprocal, a00;
+
+    /* as in LU, only exactly 0 is singular, so scaled gates still invert */
+    if (MAT_T_ABS2(determinant) == 0.0)
+        return -1;
+
+    reciprocal = MAT_T_DIV(MAT_T_1, determinant);
+    a00 = a->values[0];
+    dest->values[0] = MAT_T_MUL(a->values[3], reciprocal);
+    dest->values[1] = MAT_T_MUL(MAT_T_SUB(MAT_T_0, a->values[1]), reciprocal);
+    dest->values[2] = MAT_T_MUL(MAT_T_SUB(MAT_T_0, a->values[2]), reciprocal);
+    dest->values[3] = MAT_T_MUL(a00, reciprocal);
+    return 0;
+}
+
+void mat2_from_matrix(Mat2 *dest, Matrix *matrix) {
+    if (matrix->height != 2 || matrix->width != 2) {
+        report_logic_error("matrix must be 2x2");
+    }
+    dest->values[0] = matrix->values[0];
+    dest->values[1] = matrix->values[1];
+    dest->values[2] = matrix->values[matrix->stride];
+    dest->values[3] = matrix->values[matrix->stride + 1];
+}
+
+void mat2_to_matrix(Matrix *dest, const Mat2 *a) {
+    if (dest->height != 2 || dest->width != 2) {
+        report_logic_error("matrix must be 2x2");
+    }
+    dest->values[0] = a->values[0];
+    dest->values[1] = a->values[1];
+    dest->values[dest->stride] = a->values[2];
+    dest->values[dest->stride + 1] = a->values[3];
+}
@@ -0,0 +1,238 @@
+#include "mat4.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+
+/**
+ * Get `x` * `p` - `y` * `q` + `z` * `r`, one cofactor of a 4x4 matrix from
+ * its 2x2 minors.
+ */
+static mat_t mat4_cofactor(mat_t x, mat_t p, mat_t y, mat_t q, mat_t z,
+                           mat_t r);
+
+static mat_t mat4_cofactor(mat_t x, mat_t p, mat_t y, mat_t q, mat_t z,
+                           mat_t r) {
+    return MAT_T_ADD(MAT_T_SUB(MAT_T_MUL(x, p), MAT_T_MUL(y, q)),
+                     MAT_T_MUL(z, r));
+}
+
+void mat4_identity(Mat4 *dest) {
+    size_t i;
+
+    for (i = 0; i < 16; i++) {
+        dest->values[i] = i % 5 == 0 ? MAT_T_1 : MAT_T_0;
+    }
+}
+
+void mat4_multiply(Mat4 *dest, const Mat4 *a, const Mat4 *b) {
+    const Mat4 rhs = *b;
+    const mat_t *c = rhs.values;
+    mat_t a0, a1, a2, a3;
+    mat_t *row;
+    size_t i;
+
+    /* a row of `dest` depends only on the same row of `a`, so once `b` is
+     * copied `dest` may be either operand */
+    for (i = 0; i < 4; i++) {
+        row = dest->values + 4 * i;
+        a0 = a->values[4 * i];
+        a1 = a->values[4 * i + 1];
+        a2 = a->values[4 * i + 2];
+        a3 = a->values[4 * i + 3];
+        row[0] = MAT_T_ADD(MAT_T_ADD(MAT_T_MUL(a0, c[0]), MAT_T_MUL(a1, c[4])),
+                           MAT_T_ADD(MAT_T_MUL(a2, c[8]),
+                                     MAT_T_MUL(a3, c[12])));
+        row[1] = MAT_T_ADD(MAT_T_ADD(MAT_T_MUL(a0, c[1]), MAT_T_MUL(a1, c[5])),
+                           MAT_T_ADD(MAT_T_MUL(a2, c[9]),
+                                     MAT_T_MUL(a3, c[13])));
+        row[2] = MAT_T_ADD(MAT_T_ADD(MAT_T_MUL(a0, c[2]), MAT_T_MUL(a1, c[6])),
+                           MAT_T_ADD(MAT_T_MUL(a2, c[10]),
+                                     MAT_T_MUL(a3, c[14])));
+        row[3] = MAT_T_ADD(MAT_T_ADD(MAT_T_MUL(a0, c[3]), MAT_T_MUL(a1, c[7])),
+                           MAT_T_ADD(MAT_T_MUL(a2, c[11]),
+                                     MAT_T_MUL(a3, c[15])));
+    }
+}
+
+void mat4_adjoint(Mat4 *dest, const Mat4 *a) {
+    const Mat4 source = *a;
+    size_t i, j;
+
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            dest->values[4 * i + j] = MAT_T_CONJ(source.values[4 * j + i]);
+        }
+    }
+}
+
+mat_t mat4_determinant(const Mat4 *a) {
+    const mat_t *v = a->values;
+    /* 2x2 minors of the top two rows (s) and the bottom two rows (c) */
+    const mat_t s0 = MAT_T_SUB(MAT_T_MUL(v[0], v[5]), MAT_T_MUL(v[4], v[1]));
+    const mat_t s1 = MAT_T_SUB(MAT_T_MUL(v[0], v[6]), MAT_T_MUL(v[4], v[2]));
+    const mat_t s2 = MAT_T_SUB(MAT_T_MUL(v[0], v[7]), MAT_T_MUL(v[4], v[3]));
+    const mat_t s3 = MAT_T_SUB(MAT_T_MUL(v[1], v[6]), MAT_T_MUL(v[5], v[2]));
+    const mat_t s4 = MAT_T_SUB(MAT_T_MUL(v[1], v[7]), MAT_T_MUL(v[5], v[3]));
+    const mat_t s5 = MAT_T_SUB(MAT_T_MUL(v[2], v[7]), MAT_T_MUL(v[6], v[3]));
+    const mat_t c0 = MAT_T_SUB(MAT_T_MUL(v[8], v[13]), MAT_T_MUL(v[12], v[9]));
+    const mat_t c1 = MAT_T_SUB(MAT_T_MUL(v[8], v[14]),
+                               MAT_T_MUL(v[12], v[10]));
+    const mat_t c2 = MAT_T_SUB(MAT_T_MUL(v[8], v[15]),
+                               MAT_T_MUL(v[12], v[11]));
+    const mat_t c3 = MAT_T_SUB(MAT_T_MUL(v[9], v[14]),
+                               MAT_T_MUL(v[13], v[10]));
+    const mat_t c4 = MAT_T_SUB(MAT_T_MUL(v[9], v[15]),
+                               MAT_T_MUL(v[13], v[11]));
+    const mat_t c5 = MAT_T_SUB(MAT_T_MUL(v[10], v[15]),
+                               MAT_T_MUL(v[14], v[11]));
+
+    return MAT_T_ADD(mat4_cofactor(s0, c5, s1, c4, s2, c3),
+                     mat4_cofactor(s3, c2, s4, c1, s5, c0));
+}
+
+int mat4_inverse(Mat4 *dest, const Mat4 *a) {
+    const Mat4 source = *a;
+    const mat_t *v = source.values;
+    mat_t s0, s1, s2, s3, s4, s5, c0, c1, c2, c3, c4, c5;
+    mat_t determinant, positive, negative;
+    mat_t *w = dest->values;
+
+    s0 = MAT_T_SUB(MAT_T_MUL(v[0], v[5]), MAT_T_MUL(v[4], v[1]));
+    s1 = MAT_T_SUB(MAT_T_MUL(v[0], v[6]), MAT_T_MUL(v[4], v[2]));
+    s2 = MAT_T_SUB(MAT_T_MUL(v[0], v[7]), MAT_T_MUL(v[4], v[3]));
+    s3 = MAT_T_SUB(MAT_T_MUL(v[1], v[6]), MAT_T_MUL(v[5], v[2]));
+    s4 = MAT_T_SUB(MAT_T_MUL(v[1], v[7]), MAT_T_MUL(v[5], v[3]));
+    s5 = MAT_T_SUB(MAT_T_MUL(v[2], v[7]), MAT_T_MUL(v[6], v[3]));
+    c0 = MAT_T_SUB(MAT_T_MUL(v[8], v[13]), MAT_T_MUL(v[12], v[9]));
+    c1 = MAT_T_SUB(MAT_T_MUL(v[8], v[14]), MAT_T_MUL(v[12], v[10]));
+    c2 = MAT_T_SUB(MAT_T_MUL(v[8], v[15]), MAT_T_MUL(v[12], v[11]));
+    c3 = MAT_T_SUB(MAT_T_MUL(v[9], v[14]), MAT_T_MUL(v[13], v[10]));
+    c4 = MAT_T_SUB(MAT_T_MUL(v[9], v[15]), MAT_T_MUL(v[13], v[11]));
+    c5 = MAT_T_SUB(MAT_T_MUL(v[10], v[15]), MAT_T_MUL(v[14], v[11]));
+
+    determinant = MAT_T_ADD(mat4_cofactor(s0, c5, s1, c4, s2, c3),
+                            mat4_cofactor(s3, c2, s4, c1, s5, c0));
+    /* a tolerance would refuse small but invertible scaled gates */
+    if (MAT_T_ABS2(determinant) == 0.0)
+        return -1;
+    positive = MAT_T_DIV(MAT_T_1, determinant);
+    negative = MAT_T_SUB(MAT_T_0, positive);
+
+    /* the adjugate, transposed cofactor by cofactor */
+    w[0] = MAT_T_MUL(mat4_cofactor(v[5], c5, v[6], c4, v[7], c3), positive);
+    w[1] = MAT_T_MUL(mat4_cofactor(v[1], c5, v[2], c4, v[3], c3), negative);
+    w[2] = MAT_T_MUL(mat4_cofactor(v[13], s5, v[14], s4, v[15], s3), positive);
+    w[3] = MAT_T_MUL(mat4_cofactor(v[9], s5, v[10], s4, v[11], s3), negative);
+    w[4] = MAT_T_MUL(mat4_cofactor(v[4], c5, v[6], c2, v[7], c1), negative);
+    w[5] = MAT_T_MUL(mat4_cofactor(v[0], c5, v[2], c2, v[3], c1), positive);
+    w[6] = MAT_T_MUL(mat4_cofactor(v[12], s5, v[14], s2, v[15], s1), negative);
+    w[7] = MAT_T_MUL(mat4_cofactor(v[8], s5, v[10], s2, v[11], s1), positive);
+    w[8] = MAT_T_MUL(mat4_cofactor(v[4], c4, v[5], c2, v[7], c0), positive);
+    w[9] = MAT_T_MUL(mat4_cofactor(v[0], c4, v[1], c2, v[3], c0), negative);
+    w[10] = MAT_T_MUL(mat4_cofactor(v[12], s4, v[13], s2, v[15], s0),
+                      positive);
+    w[11] = MAT_T_MUL(mat4_cofactor(v[8], s4, v[9], s2, v[11], s0), negative);
+    w[12] = MAT_T_MUL(mat4_cofactor(v[4], c3, v[5], c1, v[6], c0), negative);
+    w[13] = MAT_T_MUL(mat4_cofactor(v[0], c3, v[1], c1, v[2], c0), positive);
+    w[14] = MAT_T_MUL(mat4_cofactor(v[12], s3, v[13], s1, v[14], s0),
+                      negative);
+    w[15] = MAT_T_MUL(mat4_cofactor(v[8], s3, v[9], s1, v[10], s0), positive);
+    return 0;
+}
+
+void mat4_kron(Mat4 *dest, const Mat2 *high, const Mat2 *low) {
+    const mat_t *h = high->values;
+    const mat_t *l = low->values;
+
+    dest->values[0] = MAT_T_MUL(h[0], l[0]);
+    dest->values[1] = MAT_T_MUL(h[0], l[1]);
+    dest->values[2] = MAT_T_MUL(h[1], l[0]);
+    dest->values[3] = MAT_T_MUL(h[1], l[1]);
+    dest->values[4] = MAT_T_MUL(h[0], l[2]);
+    dest->values[5] = MAT_T_MUL(h[0], l[3]);
+    dest->values[6] = MAT_T_MUL(h[1], l[2]);
+    dest->values[7] = MAT_T_MUL(h[1], l[3]);
+    dest->values[8] = MAT_T_MUL(h[2], l[0]);
+    dest->values[9] = MAT_T_MUL(h[2], l[1]);
+    dest->values[10] = MAT_T_MUL(h[3], l[0]);
+    dest->values[11] = MAT_T_MUL(h[3], l[1]);
+    dest->values[12] = MAT_T_MUL(h[2], l[2]);
+    dest->values[13] = MAT_T_MUL(h[2], l[3]);
+    dest->values[14] = MAT_T_MUL(h[3], l[2]);
+    dest->values[15] = MAT_T_MUL(h[3], l[3]);
+}
+
+void mat4_controlled(Mat4 *dest, const Mat2 *gate) {
+    mat4_identity(dest);
+    dest->values[10] = gate->values[0];
+    dest->values[11] = gate->values[1];
+    dest->values[14] = gate->values[2];
+    dest->values[15] = gate->values[3];
+}
+
+void mat4_apply_high(Mat4 *dest, const Mat2 *gate, const Mat4 *a) {
+    const mat_t g00 = gate->values[0], g01 = gate->values[1];
+    const mat_t g10 = gate->values[2], g11 = gate->values[3];
+    mat_t top, bottom;
+    size_t j;
+
+    /* rows 2 h + l mix with the row of the other value of h */
+    for (j = 0; j < 8; j++) {
+        top = a->values[j];
+        bottom = a->values[j + 8];
+        dest->values[j] = MAT_T_ADD(MAT_T_MUL(g00, top),
+                                    MAT_T_MUL(g01, bottom));
+        dest->values[j + 8] = MAT_T_ADD(MAT_T_MUL(g10, top),
+                                        MAT_T_MUL(g11, bottom));
+    }
+}
+
+void mat4_apply_low(Mat4 *dest, const Mat2 *gate, const Mat4 *a) {
+    const mat_t g00 = gate->values[0], g01 = gate->values[1];
+    const mat_t g10 = gate->values[2], g11 = gate->values[3];
+    mat_t top, bottom;
+    size_t j;
+
+    /* rows 2 h + l mix with the row of the other value of l */
+    for (j = 0; j < 4; j++) {
+        top = a->values[j];
+        bottom = a->values[j + 4];
+        dest->values[j] = MAT_T_ADD(MAT_T_MUL(g00, top),
+                                    MAT_T_MUL(g01, bottom));
+        dest->values[j + 4] = MAT_T_ADD(MAT_T_MUL(g10, top),
+                                        MAT_T_MUL(g11, bottom));
+        top = a->values[j + 8];
+        bottom = a->values[j + 12];
+        dest->values[j + 8] = MAT_T_ADD(MAT_T_MUL(g00, top),
+                                        MAT_T_MUL(g01, bottom));
+        dest->values[j + 12] = MAT_T_ADD(MAT_T_MUL(g10, top),
+                                         MAT_T_MUL(g11, bottom));
+    }
+}
+
+void mat4_from_matrix(Mat4 *dest, Matrix *matrix) {
+    size_t i;
+
+    if (matrix->height != 4 || matrix->width != 4) {
+        report_logic_error("matrix must be 4x4");
+    }
+    for (i = 0; i < 4; i++) {
+        dest->values[4 * i] = matrix->values[i * matrix->stride];
+        dest->values[4 * i + 1] = matrix->values[i * matrix->stride + 1];
+        dest->values[4 * i + 2] = matrix->values[i * matrix->stride + 2];
+        dest->values[4 * i + 3] = matrix->values[i * matrix->stride + 3];
+    }
+}
+
+void mat4_to_matrix(Matrix *dest, const Mat4 *a) {
+    size_t i;
+
+    if (dest->height != 4 || dest->width != 4) {
+        report_logic_error("matrix must be 4x4");
+    }
+    for (i = 0; i < 4; i++) {
+        dest->values[i * dest->stride] = a->values[4 * i];
+        dest->values[i * dest->stride + 1] = a->values[4 * i + 1];
+        dest->values[i * dest->stride + 2] = a->values[4 * i + 2];
+        dest->values[i * dest->stride + 3] = a->values[4 * i + 3];
+    }
+}
@@ -1,15 +1,61 @@
 #include "matrix.h"
+#include "instrument_internal.h"
+#include "lufactor.h"
+#include "matrix_internal.h"
 #include "reporter.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-struct Matrix {
-    size_t height;
-    size_t width;
+/* matrix_multiply tuning: `MR` x `NR` register tile, `MC` x `KC` block of the
+ * left operand, `KC` x `NC` panel of the right operand */
+#ifdef MAT_T_COMPLEX
+/* complex tiles hold two accumulators per element */
+#define MATRIX_MULTIPLY_MR 2
+#define MATRIX_MULTIPLY_NR 2
+#else
+#define MATRIX_MULTIPLY_MR 4
+#define MATRIX_MULTIPLY_NR 8
+#endif
+#define MATRIX_MULTIPLY_MC 64
+#define MATRIX_MULTIPLY_KC 256
+#define MATRIX_MULTIPLY_NC 512
 
-    mat_t *values;
-};
+/* matrix_determinant eliminates in a single scratch copy up to this size,
+ * and uses the blocked LUFactor above it */
+#define MATRIX_DETERMINANT_SMALL 32
+
+/* matrix_svd stops after this many Jacobi sweeps, and skips rotating
+ * columns whose overlap is below this fraction of their norms */
+#define MATRIX_SVD_SWEEPS 60
+#define MATRIX_SVD_TOLERANCE 1e-15
+
+/* columns matrix_qr factors per panel before updating the rest at once */
+#define MATRIX_QR_BLOCK 32
+
+/* bytes from the start of a matrix allocation to its values */
+#define MATRIX_HEADER                                                         \
+    ((sizeof(Matrix) + MATRIXARENA_ALIGNMENT - 1) / MATRIXARENA_ALIGNMENT    \
+     * MATRIXARENA_ALIGNMENT)
+
+/* degree 3, 5, 7, 9 and 13 Pade approximants tried by matrix_exponential:
+ * the largest 1-norm of t A each is accurate to double precision for
+ * (Higham 2005), and the coefficients of each from the constant term up */
+#define MATRIX_PADE_COUNT 5
+static const double matrix_pade_thetas[MATRIX_PADE_COUNT] = {
+    1.495585217958292e-2, 2.539398330063230e-1, 9.504178996162932e-1,
+    2.097847961257068e0, 5.371920351148152e0};
+static const double matrix_pade_coefficients[MATRIX_PADE_COUNT][14] = {
+    {120.0, 60.0, 12.0, 1.0},
+    {30240.0, 15120.0, 3360.0, 420.0, 30.0, 1.0},
+    {17297280.0, 8648640.0, 1995840.0, 277200.0, 25200.0, 1512.0, 56.0, 1.0},
+    {17643225600.0, 8821612800.0, 2075673600.0, 302702400.0, 30270240.0,
+     2162160.0, 110880.0, 3960.0, 90.0, 1.0},
+    {64764752532480000.0, 32382376266240000.0, 7771770303897600.0,
+     1187353796428800.0, 129060195264000.0, 10559470521600.0,
+     670442572800.0, 33522128640.0, 1323241920.0, 40840800.0, 960960.0,
+     16380.0, 182.0, 1.0}};
 
 /**
  * Triangularize a matrix, such that no values are above or to the right of
@@ -34,6 +80,89 @@ static void matrix_swap_rows(Matrix *matrix, size_t idx_a, size_t idx_b);
  */
 static void matrix_multiply_row(Matrix *matrix, size_t idx, mat_t scalar);
 
+/**
+ * Copy the `mc` x `kc` block at `a` (rows `a_width` apart) into `packed` as
+ * zero-padded slivers of `MATRIX_MULTIPLY_MR` rows, stored column by column.
+ */
+static void matrix_pack_a(const mat_t *a, size_t a_width, size_t mc,
+                          size_t kc, mat_t *packed);
+
+/**
+ * Copy the `kc` x `nc` panel at `b` (rows `b_width` apart) into `packed` as
+ * zero-padded slivers of `MATRIX_MULTIPLY_NR` columns, stored row by row.
+ */
+static void matrix_pack_b(const mat_t *b, size_t b_width, size_t kc,
+                          size_t nc, mat_t *packed);
+
+/**
+ * Add `alpha` times the product of a packed `a` sliver and a packed `b`
+ * sliver to the top-left `mr` x `nr` corner of `c`.
+ */
+static void matrix_multiply_kernel(size_t kc, const mat_t *a, const mat_t *b,
+                                   mat_t *c, size_t c_width, size_t mr,
+                                   size_t nr, mat_t alpha);
+
+/**
+ * Calculate the determinant of the `n` x `n` contiguous `values` by Gaussian
+ * elimination with partial pivoting, overwriting them.
+ */
+static mat_t matrix_eliminate(mat_t *values, size_t n);
+
+/**
+ * Set up `matrix` as `height` x `width`, with its values at `values`.
+ */
+static void matrix_place(Matrix *matrix, size_t height, size_t width,
+                         mat_t *values);
+
+/**
+ * Calculate the 1-norm (largest column sum of magnitudes) of a matrix.
+ */
+static double matrix_norm_1(Matrix *matrix);
+
+/**
+ * Set `dest` to `identity` * I plus `weights[k]` times even power
+ * `powers[k]` for each of the first `count` of them. None may be views.
+ */
+static void matrix_pade_sum(Matrix *dest, Matrix **powers,
+                            const mat_t *weights, size_t count,
+                            mat_t identity);
+
+/**
+ * Rotate pairs of the `count` rows of `length` values at `w` until they are
+ * orthogonal, applying each rotation to the `count` x `count` rows at `v`
+ * too unless it is NULL. `norms` is scratch for `count` values.
+ */
+static void matrix_svd_jacobi(mat_t *w, mat_t *v, double *norms, size_t count,
+                              size_t length);
+
+/**
+ * Replace the `length` values `stride` apart at `x` with beta and the
+ * reflector v (whose first value, 1, is not stored) such that
+ * (I - `tau` v v^H)^H x = beta e1.
+ */
+static void matrix_householder(mat_t *x, size_t stride, size_t length,
+                               mat_t *tau);
+
+/**
+ * Copy the `count` reflectors of a panel stored below the diagonal from
+ * (`first`, `first`) of the `width` wide `a` into the `rows` x `count` `v`,
+ * with their unit diagonal and zeros above, and into its conjugate
+ * transpose `vh`.
+ */
+static void matrix_qr_vectors(const mat_t *a, size_t width, size_t first,
+                              size_t count, size_t rows, mat_t *v, mat_t *vh);
+
+/**
+ * Replace the `rows` x `cols` block `c`, rows `stride` apart, with
+ * (I - V T V^H) `c`, or (I - V T^H V^H) `c` if `adjoint`, for the `count`
+ * reflectors in `v` and `vh` and the upper triangle `t` (rows
+ * `MATRIX_QR_BLOCK` apart). `w` is scratch for `count` * `cols` values.
+ * Return 0 on success, -1 on failure.
+ */
+static int matrix_qr_apply(mat_t *c, size_t stride, size_t rows, size_t cols,
+                           const mat_t *v, const mat_t *vh, const mat_t *t,
+                           size_t count, mat_t *w, bool adjoint);
+
 size_t matrix_height(Matrix *matrix) { return matrix->height; }
 
 size_t matrix_width(Matrix *matrix) { return matrix->width; }
@@ -42,33 +171,524 @@ void matrix_set(Matrix *matrix, size_t i, size_t j, mat_t value) {
     if (!i || !j || i > matrix->height || j > matrix->width) {
         report_logic_error("index out of bounds");
     }
-    matrix->values[(i - 1) * matrix->height + j - 1] = value;
+    matrix->values[(i - 1) * matrix->stride + j - 1] = value;
 }
 
 mat_t matrix_get(Matrix *matrix, size_t i, size_t j) {
     if (!i || !j || i > matrix->height || j > matrix->width) {
         report_logic_error("index out of bounds");
     }
-    return matrix->values[(i - 1) * matrix->height + j - 1];
+    return matrix->values[(i - 1) * matrix->stride + j - 1];
+}
+
+size_t matrix_stride(Matrix *matrix) { return matrix->stride; }
+
+mat_t *matrix_row(Matrix *matrix, size_t i) {
+    if (!i || i > matrix->height) {
+        report_logic_error("row out of bounds");
+    }
+    return matrix->values + (i - 1) * matrix->stride;
+}
+
+mat_t *matrix_column(Matrix *matrix, size_t j) {
+    if (!j || j > matrix->width) {
+        report_logic_error("column out of bounds");
+    }
+    return matrix->values + j - 1;
+}
+
+void matrix_copy_from_buffer(Matrix *matrix, const mat_t *buffer) {
+    size_t i;
+
+    if (matrix->stride == matrix->width) {
+        memcpy(matrix->values, buffer,
+               matrix->height * matrix->width * sizeof(mat_t));
+        return;
+    }
+    for (i = 0; i < matrix->height; i++) {
+        memcpy(matrix->values + i * matrix->stride, buffer + i * matrix->width,
+               matrix->width * sizeof(mat_t));
+    }
+}
+
+void matrix_copy_to_buffer(Matrix *matrix, mat_t *buffer) {
+    size_t i;
+
+    if (matrix->stride == matrix->width) {
+        memcpy(buffer, matrix->values,
+               matrix->height * matrix->width * sizeof(mat_t));
+        return;
+    }
+    for (i = 0; i < matrix->height; i++) {
+        memcpy(buffer + i * matrix->width, matrix->values + i * matrix->stride,
+               matrix->width * sizeof(mat_t));
+    }
+}
+
+static void matrix_pack_a(const mat_t *a, size_t a_width, size_t mc,
+                          size_t kc, mat_t *packed) {
+    const mat_t *src;
+    size_t ir, r, p, mr;
+
+    for (ir = 0; ir < mc; ir += MATRIX_MULTIPLY_MR) {
+        mr = mc - ir < MATRIX_MULTIPLY_MR ? mc - ir : MATRIX_MULTIPLY_MR;
+        for (p = 0; p < kc; p++) {
+            src = a + ir * a_width + p;
+            for (r = 0; r < mr; r++) {
+                packed[r] = src[r * a_width];
+            }
+            for (; r < MATRIX_MULTIPLY_MR; r++) {
+                packed[r] = MAT_T_0;
+            }
+            packed += MATRIX_MULTIPLY_MR;
+        }
+    }
+}
+
+static void matrix_pack_b(const mat_t *b, size_t b_width, size_t kc,
+                          size_t nc, mat_t *packed) {
+    const mat_t *src;
+    size_t jr, s, p, nr;
+
+    for (jr = 0; jr < nc; jr += MATRIX_MULTIPLY_NR) {
+        nr = nc - jr < MATRIX_MULTIPLY_NR ? nc - jr : MATRIX_MULTIPLY_NR;
+        for (p = 0; p < kc; p++) {
+            src = b + p * b_width + jr;
+            for (s = 0; s < nr; s++) {
+                packed[s] = src[s];
+            }
+            for (; s < MATRIX_MULTIPLY_NR; s++) {
+                packed[s] = MAT_T_0;
+            }
+            packed += MATRIX_MULTIPLY_NR;
+        }
+    }
+}
+
+static void matrix_multiply_kernel(size_t kc, const mat_t *a, const mat_t *b,
+                                   mat_t *c, size_t c_width, size_t mr,
+                                   size_t nr, mat_t alpha) {
+#ifdef MAT_T_COMPLEX
+    /* split accumulators so the real and imaginary updates vectorize
+     * independently instead of going through mat_t_mul */
+    double acc_re[MATRIX_MULTIPLY_MR * MATRIX_MULTIPLY_NR];
+    double acc_im[MATRIX_MULTIPLY_MR * MATRIX_MULTIPLY_NR];
+    double a_re, a_im;
+    size_t p, r, s;
+
+    for (r = 0; r < MATRIX_MULTIPLY_MR * MATRIX_MULTIPLY_NR; r++) {
+        acc_re[r] = 0.0;
+        acc_im[r] = 0.0;
+    }
+
+    for (p = 0; p < kc; p++) {
+        for (r = 0; r < MATRIX_MULTIPLY_MR; r++) {
+            a_re = a[r].re;
+            a_im = a[r].im;
+            for (s = 0; s < MATRIX_MULTIPLY_NR; s++) {
+                acc_re[r * MATRIX_MULTIPLY_NR + s]
+                    += a_re * b[s].re - a_im * b[s].im;
+                acc_im[r * MATRIX_MULTIPLY_NR + s]
+                    += a_re * b[s].im + a_im * b[s].re;
+            }
+        }
+        a += MATRIX_MULTIPLY_MR;
+        b += MATRIX_MULTIPLY_NR;
+    }
+
+    for (r = 0; r < mr; r++) {
+        for (s = 0; s < nr; s++) {
+            c[r * c_width + s] = MAT_T_ADD(
+                c[r * c_width + s],
+                MAT_T_MUL(alpha,
+                          mat_t_complex(acc_re[r * MATRIX_MULTIPLY_NR + s],
+                                        acc_im[r * MATRIX_MULTIPLY_NR + s])));
+        }
+    }
+#else
+    mat_t acc[MATRIX_MULTIPLY_MR * MATRIX_MULTIPLY_NR];
+    size_t p, r, s;
+
+    for (r = 0; r < MATRIX_MULTIPLY_MR * MATRIX_MULTIPLY_NR; r++) {
+        acc[r] = MAT_T_0;
+    }
+
+    /* fixed trip counts so the compiler unrolls this and keeps `acc` in
+     * vector registers */
+    for (p = 0; p < kc; p++) {
+        for (r = 0; r < MATRIX_MULTIPLY_MR; r++) {
+            for (s = 0; s < MATRIX_MULTIPLY_NR; s++) {
+                acc[r * MATRIX_MULTIPLY_NR + s]
+                    = MAT_T_ADD(acc[r * MATRIX_MULTIPLY_NR + s],
+                                MAT_T_MUL(a[r], b[s]));
+            }
+        }
+        a += MATRIX_MULTIPLY_MR;
+        b += MATRIX_MULTIPLY_NR;
+    }
+
+    for (r = 0; r < mr; r++) {
+        for (s = 0; s < nr; s++) {
+            c[r * c_width + s]
+                = MAT_T_ADD(c[r * c_width + s],
+                            MAT_T_MUL(alpha, acc[r * MATRIX_MULTIPLY_NR + s]));
+        }
+    }
+#endif
+}
+
+int matrix_multiply(Matrix *dest, Matrix *a, Matrix *b) {
+    int result;
+    size_t i, j;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_MULTIPLY);
+    if (matrix_height(dest) != matrix_height(a)
+        || matrix_width(dest) != matrix_width(b)) {
+        report_logic_error("destination has wrong dimensions for product");
+    }
+
+    for (i = 0; i < dest->height; i++) {
+        for (j = 0; j < dest->width; j++) {
+            dest->values[i * dest->stride + j] = MAT_T_0;
+        }
+    }
+
+    result = matrix_multiply_accumulate(dest, MAT_T_1, a, b);
+    INSTRUMENT_END();
+    return result;
+}
+
+int matrix_multiply_accumulate(Matrix *dest, mat_t alpha, Matrix *a,
+                               Matrix *b) {
+    int result;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_MULTIPLY_ACCUMULATE);
+    if (matrix_width(a) != matrix_height(b)) {
+        report_logic_error("inner dimensions differ in matrix product");
+    }
+    if (matrix_height(dest) != matrix_height(a)
+        || matrix_width(dest) != matrix_width(b)) {
+        report_logic_error("destination has wrong dimensions for product");
+    }
+    if (dest == a || dest == b) {
+        report_logic_error("destination of product cannot be an operand");
+    }
+
+    result = matrix_gemm(matrix_height(a), matrix_width(b), matrix_width(a),
+                         alpha, a->values, a->stride, b->values, b->stride,
+                         dest->values, dest->stride);
+    INSTRUMENT_END();
+    return result;
+}
+
+int matrix_gemm(size_t height, size_t width, size_t inner, mat_t alpha,
+                const mat_t *a, size_t a_width, const mat_t *b, size_t b_width,
+                mat_t *c, size_t c_width) {
+    mat_t *packed_a = NULL;
+    mat_t *packed_b = NULL;
+    size_t a_size, b_size;
+    size_t i, j, k, ir, jr, mc, nc, kc;
+
+    /* the largest blocks this product packs, padded up to whole slivers, so
+     * small products allocate little */
+    mc = height < MATRIX_MULTIPLY_MC ? height : MATRIX_MULTIPLY_MC;
+    nc = width < MATRIX_MULTIPLY_NC ? width : MATRIX_MULTIPLY_NC;
+    kc = inner < MATRIX_MULTIPLY_KC ? inner : MATRIX_MULTIPLY_KC;
+    a_size = (mc + MATRIX_MULTIPLY_MR - 1) / MATRIX_MULTIPLY_MR
+             * MATRIX_MULTIPLY_MR * kc;
+    b_size = (nc + MATRIX_MULTIPLY_NR - 1) / MATRIX_MULTIPLY_NR
+             * MATRIX_MULTIPLY_NR * kc;
+    packed_a = malloc((a_size > 0 ? a_size : 1) * sizeof(mat_t));
+    if (packed_a == NULL)
+        goto matrix_gemm_fail;
+    packed_b = malloc((b_size > 0 ? b_size : 1) * sizeof(mat_t));
+    if (packed_b == NULL)
+        goto matrix_gemm_fail;
+    INSTRUMENT_BYTES((a_size + b_size) * sizeof(mat_t));
+    INSTRUMENT_FLOPS((double)height * width * inner * INSTRUMENT_FMA_FLOPS);
+
+    for (j = 0; j < width; j += MATRIX_MULTIPLY_NC) {
+        nc = width - j < MATRIX_MULTIPLY_NC ? width - j : MATRIX_MULTIPLY_NC;
+        for (k = 0; k < inner; k += MATRIX_MULTIPLY_KC) {
+            kc = inner - k < MATRIX_MULTIPLY_KC ? inner - k
+                                                 : MATRIX_MULTIPLY_KC;
+            matrix_pack_b(b + k * b_width + j, b_width, kc, nc, packed_b);
+            for (i = 0; i < height; i += MATRIX_MULTIPLY_MC) {
+                mc = height - i < MATRIX_MULTIPLY_MC ? height - i
+                                                      : MATRIX_MULTIPLY_MC;
+                matrix_pack_a(a + i * a_width + k, a_width, mc, kc, packed_a);
+                for (jr = 0; jr < nc; jr += MATRIX_MULTIPLY_NR) {
+                    for (ir = 0; ir < mc; ir += MATRIX_MULTIPLY_MR) {
+                        matrix_multiply_kernel(
+                            kc, packed_a + ir * kc, packed_b + jr * kc,
+                            c + (i + ir) * c_width + j + jr, c_width,
+                            mc - ir < MATRIX_MULTIPLY_MR ? mc - ir
+                                                         : MATRIX_MULTIPLY_MR,
+                            nc - jr < MATRIX_MULTIPLY_NR ? nc - jr
+                                                         : MATRIX_MULTIPLY_NR,
+                            alpha);
+                    }
+                }
+            }
+        }
+    }
+
+    free(packed_a);
+    free(packed_b);
+    return 0;
+matrix_gemm_fail:
+    free(packed_a);
+    free(packed_b);
+    return -1;
+}
+
+void matrix_kron(Matrix *dest, Matrix *a, Matrix *b) {
+    const size_t b_height = b->height;
+    const size_t b_width = b->width;
+    const mat_t *a_row, *b_row;
+    mat_t *dest_row;
+    mat_t scale;
+    size_t i, r, k, c;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_KRON);
+    if (dest->height != a->height * b_height
+        || dest->width != a->width * b_width) {
+        report_logic_error("destination has wrong dimensions for product");
+    }
+    if (dest == a || dest == b) {
+        report_logic_error("destination of product cannot be an operand");
+    }
+
+    /* each destination row is one row of b scaled by each value in a row of
+     * a, so it is written front to back while that row of b stays in cache */
+    for (i = 0; i < a->height; i++) {
+        a_row = a->values + i * a->stride;
+        for (r = 0; r < b_height; r++) {
+            b_row = b->values + r * b->stride;
+            dest_row = dest->values + (i * b_height + r) * dest->stride;
+            for (k = 0; k < a->width; k++) {
+                scale = a_row[k];
+                for (c = 0; c < b_width; c++) {
+                    dest_row[k * b_width + c] = MAT_T_MUL(scale, b_row[c]);
+                }
+            }
+        }
+    }
+    INSTRUMENT_FLOPS((double)dest->height * dest->width
+                     * INSTRUMENT_MUL_FLOPS);
+    INSTRUMENT_END();
+}
+
+static double matrix_norm_1(Matrix *matrix) {
+    const size_t height = matrix_height(matrix);
+    const size_t width = matrix_width(matrix);
+    double norm = 0.0, sum;
+    size_t i, j;
+
+    for (j = 0; j < width; j++) {
+        sum = 0.0;
+        for (i = 0; i < height; i++) {
+            sum += sqrt(MAT_T_ABS2(matrix->values[i * matrix->stride + j]));
+        }
+        norm = sum > norm ? sum : norm;
+    }
+    return norm;
+}
+
+static void matrix_pade_sum(Matrix *dest, Matrix **powers,
+                            const mat_t *weights, size_t count,
+                            mat_t identity) {
+    const size_t n = matrix_width(dest);
+    size_t i, k;
+
+    for (i = 0; i < n * n; i++) {
+        dest->values[i] = MAT_T_0;
+    }
+    for (k = 0; k < count; k++) {
+        for (i = 0; i < n * n; i++) {
+            dest->values[i] = MAT_T_ADD(
+                dest->values[i], MAT_T_MUL(weights[k], powers[k]->values[i]));
+        }
+    }
+    for (i = 0; i < n; i++) {
+        dest->values[i * n + i] = MAT_T_ADD(dest->values[i * n + i], identity);
+    }
+}
+
+int matrix_exponential_pade(Matrix *dest, Matrix *matrix, Matrix **powers,
+                            mat_t t) {
+    const size_t n = matrix_width(matrix);
+    const double *b;
+    double norm;
+    mat_t scale, scales[4], odd[4], even[4];
+    Matrix *u = NULL, *v = NULL, *work = NULL, *swap;
+    LUFactor *factor = NULL;
+    size_t pade, count, squarings = 0, i, k;
+
+    if (matrix_height(matrix) != n) {
+        report_logic_error("exponential undefined for non-square matrix");
+    }
+    if (matrix_height(dest) != n || matrix_width(dest) != n) {
+        report_logic_error("destination has wrong dimensions for exponential");
+    }
+
+    /* the cheapest approximant accurate for |t A|, or the largest one on
+     * t A / 2^squarings */
+    norm = sqrt(MAT_T_ABS2(t)) * matrix_norm_1(matrix);
+    for (pade = 0; pade + 1 < MATRIX_PADE_COUNT; pade++) {
+        if (norm <= matrix_pade_thetas[pade]) {
+            break;
+        }
+    }
+    if (norm > matrix_pade_thetas[pade]) {
+        squarings = (size_t)ceil(log(norm / matrix_pade_thetas[pade])
+                                 / log(2.0));
+    }
+    b = matrix_pade_coefficients[pade];
+    scale = MAT_T_MUL(MAT_T(ldexp(1.0, -(int)squarings)), t);
+
+    /* even powers A^2, A^4, A^6 and (for degree 9) A^8 */
+    count = pade == 4 ? 3 : pade + 1;
+    for (k = 0; k < count; k++) {
+        if (powers[k] == NULL) {
+            powers[k] = matrix_create(n, n);
+            if (powers[k] == NULL)
+                goto matrix_exponential_pade_fail;
+            if (matrix_multiply(powers[k], k == 0 ? matrix : powers[(k - 1) / 2],
+                                k == 0 ? matrix : powers[k / 2])
+                != 0)
+                goto matrix_exponential_pade_fail;
+        }
+    }
+    scales[0] = MAT_T_MUL(scale, scale);
+    for (k = 1; k < count; k++) {
+        scales[k] = MAT_T_MUL(scales[k - 1], scales[0]);
+    }
+
+    u = matrix_create(n, n);
+    v = matrix_create(n, n);
+    work = matrix_create(n, n);
+    if (u == NULL || v == NULL || work == NULL)
+        goto matrix_exponential_pade_fail;
+
+    /* r(tA) = q(tA)^-1 p(tA), where p(x) = v(x^2) + x u(x^2) and q(x) =
+     * v(x^2) - x u(x^2); `u` holds u before it is multiplied by x */
+    if (pade < 4) {
+        for (k = 0; k < count; k++) {
+            odd[k] = MAT_T_MUL(MAT_T(b[2 * k + 3]), scales[k]);
+            even[k] = MAT_T_MUL(MAT_T(b[2 * k + 2]), scales[k]);
+        }
+        matrix_pade_sum(u, powers, odd, count, MAT_T(b[1]));
+        matrix_pade_sum(v, powers, even, count, MAT_T(b[0]));
+    } else {
+        /* degree 13 nests the terms above x^6 behind one more product */
+        for (k = 0; k < 3; k++) {
+            odd[k] = MAT_T_MUL(MAT_T(b[2 * k + 9]), scales[k]);
+        }
+        matrix_pade_sum(work, powers, odd, 3, MAT_T_0);
+        for (k = 0; k < 3; k++) {
+            odd[k] = MAT_T_MUL(MAT_T(b[2 * k + 3]), scales[k]);
+        }
+        matrix_pade_sum(u, powers, odd, 3, MAT_T(b[1]));
+        if (matrix_multiply_accumulate(u, scales[2], powers[2], work) != 0)
+            goto matrix_exponential_pade_fail;
+
+        for (k = 0; k < 3; k++) {
+            even[k] = MAT_T_MUL(MAT_T(b[2 * k + 8]), scales[k]);
+        }
+        matrix_pade_sum(work, powers, even, 3, MAT_T_0);
+        for (k = 0; k < 3; k++) {
+            even[k] = MAT_T_MUL(MAT_T(b[2 * k + 2]), scales[k]);
+        }
+        matrix_pade_sum(v, powers, even, 3, MAT_T(b[0]));
+        if (matrix_multiply_accumulate(v, scales[2], powers[2], work) != 0)
+            goto matrix_exponential_pade_fail;
+    }
+
+    for (i = 0; i < n * n; i++) {
+        work->values[i] = MAT_T_0;
+    }
+    if (matrix_multiply_accumulate(work, scale, matrix, u) != 0)
+        goto matrix_exponential_pade_fail;
+    for (i = 0; i < n * n; i++) {
+        u->values[i] = MAT_T_ADD(v->values[i], work->values[i]);
+        v->values[i] = MAT_T_SUB(v->values[i], work->values[i]);
+    }
+    factor = lufactor_create(v);
+    if (factor == NULL || lufactor_solve(factor, u) != 0)
+        goto matrix_exponential_pade_fail;
+
+    /* exp(t A) = r(t A / 2^s)^(2^s) */
+    for (k = 0; k < squarings; k++) {
+        if (matrix_multiply(work, u, u) != 0)
+            goto matrix_exponential_pade_fail;
+        swap = u;
+        u = work;
+        work = swap;
+    }
+    matrix_copy_from_buffer(dest, u->values);
+
+    lufactor_destroy(factor);
+    matrix_destroy(u);
+    matrix_destroy(v);
+    matrix_destroy(work);
+    return 0;
+matrix_exponential_pade_fail:
+    lufactor_destroy(factor);
+    matrix_destroy(u);
+    matrix_destroy(v);
+    matrix_destroy(work);
+    return -1;
+}
+
+int matrix_exponential(Matrix *dest, Matrix *matrix, mat_t t) {
+    Matrix *powers[4] = {NULL, NULL, NULL, NULL};
+    int result;
+    size_t k;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_EXPONENTIAL);
+    result = matrix_exponential_pade(dest, matrix, powers, t);
+    for (k = 0; k < 4; k++) {
+        matrix_destroy(powers[k]);
+    }
+    INSTRUMENT_END();
+    return result;
 }
 
 static void matrix_subtract_row(Matrix *matrix, size_t dest_idx, size_t src_idx,
                                 mat_t multiple) {
     const size_t width = matrix_width(matrix);
-    mat_t *dest = matrix->values + width * (dest_idx - 1);
-    const mat_t *src = matrix->values + width * (src_idx - 1);
+    mat_t *dest = matrix->values + matrix->stride * (dest_idx - 1);
+    const mat_t *src = matrix->values + matrix->stride * (src_idx - 1);
     size_t i;
+#ifdef MAT_T_COMPLEX
+    /* work on the interleaved doubles so the loop vectorizes */
+    double *dest_parts = (double *)dest;
+    const double *src_parts = (const double *)src;
+    const double multiple_re = multiple.re;
+    const double multiple_im = multiple.im;
+    double src_re, src_im;
 
+    INSTRUMENT_FLOPS(width * INSTRUMENT_FMA_FLOPS);
+    for (i = 0; i < 2 * width; i += 2) {
+        src_re = src_parts[i];
+        src_im = src_parts[i + 1];
+        dest_parts[i] -= multiple_re * src_re - multiple_im * src_im;
+        dest_parts[i + 1] -= multiple_re * src_im + multiple_im * src_re;
+    }
+#else
+    INSTRUMENT_FLOPS(width * INSTRUMENT_FMA_FLOPS);
     for (i = 0; i < width; i++) {
         dest[i] = MAT_T_SUB(dest[i], MAT_T_MUL(multiple, src[i]));
     }
+#endif
 }
 
 static void matrix_swap_rows(Matrix *matrix, size_t idx_a, size_t idx_b) {
     const size_t width = matrix_width(matrix);
     mat_t temp;
-    mat_t *a = matrix->values + width * (idx_a - 1);
-    mat_t *b = matrix->values + width * (idx_b - 1);
+    mat_t *a = matrix->values + matrix->stride * (idx_a - 1);
+    mat_t *b = matrix->values + matrix->stride * (idx_b - 1);
     size_t i;
 
     if (idx_a == idx_b) {
@@ -84,16 +704,32 @@ static void matrix_swap_rows(Matrix *matrix, size_t idx_a, size_t idx_b) {
 
 static void matrix_multiply_row(Matrix *matrix, size_t idx, mat_t scalar) {
     const size_t width = matrix_width(matrix);
-    mat_t *a = matrix->values + width * (idx - 1);
+    mat_t *a = matrix->values + matrix->stride * (idx - 1);
     size_t i;
+#ifdef MAT_T_COMPLEX
+    double *parts = (double *)a;
+    const double scalar_re = scalar.re;
+    const double scalar_im = scalar.im;
+    double a_re, a_im;
+
+    for (i = 0; i < 2 * width; i += 2) {
+        a_re = parts[i];
+        a_im = parts[i + 1];
+        parts[i] = a_re * scalar_re - a_im * scalar_im;
+        parts[i + 1] = a_re * scalar_im + a_im * scalar_re;
+    }
+#else
     for (i = 0; i < width; i++) {
         a[i] = MAT_T_MUL(a[i], scalar);
     }
+#endif
 }
 
 static void matrix_triangularize(Matrix *matrix) {
     const size_t height = matrix_height(matrix);
     const size_t width = matrix_width(matrix);
+    const size_t stride = matrix->stride;
+    const mat_t *column;
     mat_t multiple;
     size_t dest_idx, src_idx;
 
@@ -102,11 +738,15 @@ static void matrix_triangularize(Matrix *matrix) {
     }
 
     for (src_idx = height; src_idx > 1; src_idx--) {
+        /* walk column `src_idx` directly rather than through matrix_get */
+        column = matrix->values + src_idx - 1;
+
         /* ensure that the src idx row has a non-zero element at its end */
         for (dest_idx = src_idx; dest_idx >= 1; dest_idx--) {
-            if (!MAT_T_EQ(MAT_T_0, matrix_get(matrix, dest_idx, src_idx))) {
+            if (!MAT_T_EQ(MAT_T_0, column[(dest_idx - 1) * stride])) {
                 if (dest_idx != src_idx) {
                     matrix_swap_rows(matrix, src_idx, dest_idx);
+                    INSTRUMENT_PIVOT_SWAP();
                     /* swapping rows multiplies determinant by -1, so this needs
                      * to be undone */
                     matrix_multiply_row(matrix, src_idx, MAT_T(-1.0));
@@ -117,9 +757,9 @@ static void matrix_triangularize(Matrix *matrix) {
 
         for (dest_idx = 1; dest_idx < src_idx; dest_idx++) {
             /* set desired element of target row to 0 */
-            if (!MAT_T_EQ(MAT_T_0, matrix_get(matrix, dest_idx, src_idx))) {
-                multiple = MAT_T_DIV(matrix_get(matrix, dest_idx, src_idx),
-                                     matrix_get(matrix, src_idx, src_idx));
+            if (!MAT_T_EQ(MAT_T_0, column[(dest_idx - 1) * stride])) {
+                multiple = MAT_T_DIV(column[(dest_idx - 1) * stride],
+                                     column[(src_idx - 1) * stride]);
                 matrix_subtract_row(matrix, dest_idx, src_idx, multiple);
             }
         }
@@ -129,7 +769,7 @@ static void matrix_triangularize(Matrix *matrix) {
 bool matrix_is_diagonal(Matrix *matrix) {
     const size_t width = matrix_width(matrix);
     const size_t height = matrix_height(matrix);
-    bool is_diagonal = true;
+    const mat_t *row;
     size_t i, j;
 
     if (height != width) {
@@ -137,22 +777,26 @@ bool matrix_is_diagonal(Matrix *matrix) {
             "diagonalization undefined for matrix height != width");
     }
 
-    for (i = 1; i <= width && is_diagonal; i++) {
-        for (j = 1; j <= width && is_diagonal; j++) {
-            if (i != j && !MAT_T_EQ(MAT_T_0, matrix_get(matrix, i, j))) {
-                is_diagonal = false;
+    for (i = 0; i < height; i++) {
+        row = matrix->values + i * matrix->stride;
+        for (j = 0; j < width; j++) {
+            if (i != j && !MAT_T_EQ(MAT_T_0, row[j])) {
+                return false;
             }
         }
     }
-    return is_diagonal;
+    return true;
 }
 
 void matrix_diagonalize(Matrix *matrix) {
     const size_t height = matrix_height(matrix);
     const size_t width = matrix_width(matrix);
+    const size_t stride = matrix->stride;
+    const mat_t *column;
     mat_t multiple;
     size_t dest_idx, src_idx;
 
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_DIAGONALIZE);
     if (width != height) {
         report_logic_error("non-square matrix cannot be diagonalized");
     }
@@ -160,52 +804,555 @@ void matrix_diagonalize(Matrix *matrix) {
     matrix_triangularize(matrix);
 
     for (src_idx = height - 1; src_idx > 0; src_idx--) {
+        column = matrix->values + src_idx - 1;
         for (dest_idx = src_idx + 1; dest_idx <= height; dest_idx++) {
             /* set desired element of target row to 0 */
-            if (!MAT_T_EQ(MAT_T_0, matrix_get(matrix, dest_idx, src_idx))) {
-                multiple = MAT_T_DIV(matrix_get(matrix, dest_idx, src_idx),
-                                     matrix_get(matrix, src_idx, src_idx));
+            if (!MAT_T_EQ(MAT_T_0, column[(dest_idx - 1) * stride])) {
+                multiple = MAT_T_DIV(column[(dest_idx - 1) * stride],
+                                     column[(src_idx - 1) * stride]);
                 matrix_subtract_row(matrix, dest_idx, src_idx, multiple);
             }
         }
     }
+    INSTRUMENT_END();
+}
+
+static void matrix_svd_jacobi(mat_t *w, mat_t *v, double *norms, size_t count,
+                              size_t length) {
+    mat_t *w_p, *w_q;
+    mat_t gamma, phase, x, y;
+    double g, zeta, t, c, s;
+    size_t sweep, p, q, i;
+    bool rotated = true;
+
+    for (sweep = 0; sweep < MATRIX_SVD_SWEEPS && rotated; sweep++) {
+        rotated = false;
+        for (p = 0; p < count; p++) {
+            norms[p] = 0;
+            for (i = 0; i < length; i++) {
+                norms[p] += MAT_T_ABS2(w[p * length + i]);
+            }
+        }
+        for (p = 0; p + 1 < count; p++) {
+            for (q = p + 1; q < count; q++) {
+                w_p = w + p * length;
+                w_q = w + q * length;
+                gamma = MAT_T_0;
+                for (i = 0; i < length; i++) {
+                    gamma = MAT_T_ADD(gamma,
+                                      MAT_T_MUL(MAT_T_CONJ(w_p[i]), w_q[i]));
+                }
+                g = sqrt(MAT_T_ABS2(gamma));
+                INSTRUMENT_FLOPS(length * INSTRUMENT_FMA_FLOPS);
+                if (g == 0
+                    || g <= MATRIX_SVD_TOLERANCE * sqrt(norms[p] * norms[q]))
+                    continue;
+                rotated = true;
+                /* a phase and two scaled sums per entry rotated */
+                INSTRUMENT_FLOPS(3.0 * (length + (v != NULL ? count : 0))
+                                 * INSTRUMENT_FMA_FLOPS);
+
+                /* turn column q by the phase of the overlap, so the 2 x 2
+                 * Gram matrix is real, and rotate that to diagonal */
+                phase = MAT_T_MUL(MAT_T_CONJ(gamma), MAT_T(1.0 / g));
+                zeta = (norms[q] - norms[p]) / (2 * g);
+                t = (zeta < 0 ? -1.0 : 1.0)
+                    / (fabs(zeta) + sqrt(1 + zeta * zeta));
+                c = 1 / sqrt(1 + t * t);
+                s = c * t;
+                for (i = 0; i < length; i++) {
+                    x = w_p[i];
+                    y = MAT_T_MUL(w_q[i], phase);
+                    w_p[i] = MAT_T_SUB(MAT_T_MUL(MAT_T(c), x),
+                                       MAT_T_MUL(MAT_T(s), y));
+                    w_q[i] = MAT_T_ADD(MAT_T_MUL(MAT_T(s), x),
+                                       MAT_T_MUL(MAT_T(c), y));
+                }
+                for (i = 0; v != NULL && i < count; i++) {
+                    x = v[p * count + i];
+                    y = MAT_T_MUL(v[q * count + i], phase);
+                    v[p * count + i] = MAT_T_SUB(MAT_T_MUL(MAT_T(c), x),
+                                                 MAT_T_MUL(MAT_T(s), y));
+                    v[q * count + i] = MAT_T_ADD(MAT_T_MUL(MAT_T(s), x),
+                                                 MAT_T_MUL(MAT_T(c), y));
+                }
+                norms[p] -= t * g;
+                norms[q] += t * g;
+            }
+        }
+    }
+}
+
+int matrix_svd(Matrix *u, double *singular_values, Matrix *v, Matrix *matrix) {
+    const size_t height = matrix->height;
+    const size_t width = matrix->width;
+    /* the SVD of the conjugate transpose is found when the matrix is wide,
+     * so the rows rotated are always the shorter dimension's */
+    const bool wide = width > height;
+    const size_t count = wide ? height : width;
+    const size_t length = wide ? width : height;
+    Matrix *long_side = wide ? v : u;
+    Matrix *short_side = wide ? u : v;
+    mat_t *w = NULL;
+    double *norms = NULL;
+    size_t *order = NULL;
+    mat_t *row, *rotations;
+    size_t i, j, k, best;
+    double scale;
+
+    if ((u != NULL && (u->height != height || u->width != count))
+        || (v != NULL && (v->height != width || v->width != count))) {
+        report_logic_error("singular vectors have wrong dimensions");
+    }
+
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_SVD);
+    w = malloc((count * length + (short_side != NULL ? count * count : 0))
+               * sizeof(mat_t));
+    norms = malloc(count * sizeof(double));
+    order = malloc(count * sizeof(size_t));
+    if (w == NULL || norms == NULL || order == NULL)
+        goto matrix_svd_fail;
+    INSTRUMENT_BYTES((count * length + (short_side != NULL ? count * count : 0))
+                         * sizeof(mat_t)
+                     + count * (sizeof(double) + sizeof(size_t)));
+
+    /* row j of w is column j of the matrix (or of its conjugate transpose),
+     * and row j of the rotations starts as unit vector j */
+    for (i = 0; i < height; i++) {
+        row = matrix->values + i * matrix->stride;
+        for (j = 0; j < width; j++) {
+            if (wide) {
+                w[i * length + j] = MAT_T_CONJ(row[j]);
+            } else {
+                w[j * length + i] = row[j];
+            }
+        }
+    }
+    /* without the short side's vectors there is nothing to accumulate */
+    rotations = short_side != NULL ? w + count * length : NULL;
+    for (i = 0; rotations != NULL && i < count * count; i++) {
+        rotations[i] = i % (count + 1) == 0 ? MAT_T_1 : MAT_T_0;
+    }
+
+    matrix_svd_jacobi(w, rotations, norms, count, length);
+
+    for (j = 0; j < count; j++) {
+        norms[j] = 0;
+        for (i = 0; i < length; i++) {
+            norms[j] += MAT_T_ABS2(w[j * length + i]);
+        }
+        norms[j] = sqrt(norms[j]);
+        order[j] = j;
+    }
+    for (k = 0; k < count; k++) {
+        best = k;
+        for (j = k + 1; j < count; j++) {
+            if (norms[order[j]] > norms[order[best]]) {
+                best = j;
+            }
+        }
+        j = order[k];
+        order[k] = order[best];
+        order[best] = j;
+    }
+
+    for (k = 0; k < count; k++) {
+        j = order[k];
+        singular_values[k] = norms[j];
+        scale = norms[j] > 0 ? 1 / norms[j] : 0;
+        row = w + j * length;
+        for (i = 0; long_side != NULL && i < length; i++) {
+            long_side->values[i * long_side->stride + k] =
+                MAT_T_MUL(row[i], MAT_T(scale));
+        }
+        for (i = 0; short_side != NULL && i < count; i++) {
+            short_side->values[i * short_side->stride + k] =
+                rotations[j * count + i];
+        }
+    }
+
+    free(w);
+    free(norms);
+    free(order);
+    INSTRUMENT_END();
+    return 0;
+
+matrix_svd_fail:
+    free(w);
+    free(norms);
+    free(order);
+    INSTRUMENT_END();
+    return -1;
+}
+
+static void matrix_householder(mat_t *x, size_t stride, size_t length,
+                               mat_t *tau) {
+    const mat_t alpha = x[0];
+    double rest = 0, beta;
+    mat_t scale;
+    size_t i;
+
+    INSTRUMENT_FLOPS(length * (INSTRUMENT_FMA_FLOPS + INSTRUMENT_MUL_FLOPS));
+    for (i = 1; i < length; i++) {
+        rest += MAT_T_ABS2(x[i * stride]);
+    }
+    if (rest == 0 && MAT_T_IMAG(alpha) == 0) {
+        *tau = MAT_T_0;
+        return;
+    }
+    /* beta takes the opposite sign to alpha so alpha - beta cannot cancel */
+    beta = (MAT_T_REAL(alpha) >= 0 ? -1 : 1)
+           * sqrt(MAT_T_ABS2(alpha) + rest);
+    *tau = MAT_T_DIV(MAT_T_SUB(MAT_T(beta), alpha), MAT_T(beta));
+    scale = MAT_T_DIV(MAT_T_1, MAT_T_SUB(alpha, MAT_T(beta)));
+    for (i = 1; i < length; i++) {
+        x[i * stride] = MAT_T_MUL(x[i * stride], scale);
+    }
+    x[0] = MAT_T(beta);
+}
+
+static void matrix_qr_vectors(const mat_t *a, size_t width, size_t first,
+                              size_t count, size_t rows, mat_t *v,
+                              mat_t *vh) {
+    mat_t value;
+    size_t i, j;
+
+    for (i = 0; i < rows; i++) {
+        for (j = 0; j < count; j++) {
+            if (i < j) {
+                value = MAT_T_0;
+            } else if (i == j) {
+                value = MAT_T_1;
+            } else {
+                value = a[(first + i) * width + first + j];
+            }
+            v[i * count + j] = value;
+            vh[j * rows + i] = MAT_T_CONJ(value);
+        }
+    }
+}
+
+static int matrix_qr_apply(mat_t *c, size_t stride, size_t rows, size_t cols,
+                           const mat_t *v, const mat_t *vh, const mat_t *t,
+                           size_t count, mat_t *w, bool adjoint) {
+    mat_t x;
+    size_t i, j, p;
+
+    /* W = V^H C, then T W (or T^H W) in place, then C -= V W */
+    for (i = 0; i < count * cols; i++) {
+        w[i] = MAT_T_0;
+    }
+    if (matrix_gemm(count, cols, rows, MAT_T_1, vh, rows, c, stride, w, cols)
+        != 0)
+        return -1;
+    INSTRUMENT_FLOPS((double)count * (count + 1) / 2 * cols
+                     * INSTRUMENT_FMA_FLOPS);
+    if (adjoint) {
+        /* row i of T^H W only reads rows up to i, so go bottom up */
+        for (i = count; i-- > 0;) {
+            for (j = 0; j < cols; j++) {
+                x = MAT_T_MUL(MAT_T_CONJ(t[i * MATRIX_QR_BLOCK + i]),
+                              w[i * cols + j]);
+                for (p = 0; p < i; p++) {
+                    x = MAT_T_ADD(x, MAT_T_MUL(
+                                         MAT_T_CONJ(t[p * MATRIX_QR_BLOCK + i]),
+                                         w[p * cols + j]));
+                }
+                w[i * cols + j] = x;
+            }
+        }
+    } else {
+        for (i = 0; i < count; i++) {
+            for (j = 0; j < cols; j++) {
+                x = MAT_T_0;
+                for (p = i; p < count; p++) {
+                    x = MAT_T_ADD(x, MAT_T_MUL(t[i * MATRIX_QR_BLOCK + p],
+                                               w[p * cols + j]));
+                }
+                w[i * cols + j] = x;
+            }
+        }
+    }
+    return matrix_gemm(rows, cols, count, MAT_T(-1), v, count, w, cols, c,
+                       stride);
+}
+
+int matrix_qr(Matrix *q, Matrix *r, Matrix *matrix) {
+    const size_t height = matrix->height;
+    const size_t width = matrix->width;
+    const size_t rank = height < width ? height : width;
+    mat_t *a = NULL, *tau = NULL, *v = NULL, *vh = NULL, *t = NULL;
+    mat_t *w = NULL, *block, *row;
+    mat_t x;
+    size_t first, count, rows, i, j, k, p;
+
+    if (r->height != rank || r->width != width
+        || (q != NULL && (q->height != height || q->width != rank))) {
+        report_logic_error("factors have wrong dimensions");
+    }
+
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_QR);
+    /* R has no rows and Q no columns to fill */
+    if (rank == 0) {
+        INSTRUMENT_END();
+        return 0;
+    }
+    a = malloc(height * width * sizeof(mat_t));
+    tau = malloc(rank * sizeof(mat_t));
+    v = malloc(height * MATRIX_QR_BLOCK * sizeof(mat_t));
+    vh = malloc(height * MATRIX_QR_BLOCK * sizeof(mat_t));
+    t = malloc(rank * MATRIX_QR_BLOCK * sizeof(mat_t));
+    w = malloc(width * MATRIX_QR_BLOCK * sizeof(mat_t));
+    if (a == NULL || tau == NULL || v == NULL || vh == NULL || t == NULL
+        || w == NULL)
+        goto matrix_qr_fail;
+    INSTRUMENT_BYTES((height * width + rank
+                      + (2 * height + rank + width) * MATRIX_QR_BLOCK)
+                     * sizeof(mat_t));
+    for (i = 0; i < height; i++) {
+        memcpy(a + i * width, matrix->values + i * matrix->stride,
+               width * sizeof(mat_t));
+    }
+
+    for (first = 0; first < rank; first += MATRIX_QR_BLOCK) {
+        count = rank - first < MATRIX_QR_BLOCK ? rank - first
+                                               : MATRIX_QR_BLOCK;
+        rows = height - first;
+
+        /* reflect the panel one column at a time */
+        for (j = first; j < first + count; j++) {
+            matrix_householder(a + j * width + j, width, height - j, &tau[j]);
+            for (k = j + 1; k < first + count; k++) {
+                x = a[j * width + k];
+                for (i = j + 1; i < height; i++) {
+                    x = MAT_T_ADD(x, MAT_T_MUL(MAT_T_CONJ(a[i * width + j]),
+                                               a[i * width + k]));
+                }
+                x = MAT_T_MUL(MAT_T_CONJ(tau[j]), x);
+                a[j * width + k] = MAT_T_SUB(a[j * width + k], x);
+                for (i = j + 1; i < height; i++) {
+                    a[i * width + k] = MAT_T_SUB(
+                        a[i * width + k], MAT_T_MUL(a[i * width + j], x));
+                }
+            }
+        }
+
+        /* the panel's reflectors are I - V T V^H, with T upper triangular
+         * and column k of it -tau_k T V^H v_k above tau_k */
+        matrix_qr_vectors(a, width, first, count, rows, v, vh);
+        block = t + first * MATRIX_QR_BLOCK;
+        for (k = 0; k < count; k++) {
+            for (p = 0; p < k; p++) {
+                w[p] = MAT_T_0;
+                for (i = k; i < rows; i++) {
+                    w[p] = MAT_T_ADD(w[p], MAT_T_MUL(vh[p * rows + i],
+                                                     v[i * count + k]));
+                }
+            }
+            for (p = 0; p < k; p++) {
+                x = MAT_T_0;
+                for (j = p; j < k; j++) {
+                    x = MAT_T_ADD(
+                        x, MAT_T_MUL(block[p * MATRIX_QR_BLOCK + j], w[j]));
+                }
+                block[p * MATRIX_QR_BLOCK + k] =
+                    MAT_T_MUL(MAT_T_SUB(MAT_T_0, tau[first + k]), x);
+                block[k * MATRIX_QR_BLOCK + p] = MAT_T_0;
+            }
+            block[k * MATRIX_QR_BLOCK + k] = tau[first + k];
+        }
+
+        if (first + count < width
+            && matrix_qr_apply(a + first * width + first + count, width, rows,
+                               width - first - count, v, vh, block, count, w,
+                               true)
+                   != 0)
+            goto matrix_qr_fail;
+    }
+
+    for (i = 0; i < rank; i++) {
+        row = r->values + i * r->stride;
+        for (j = 0; j < width; j++) {
+            row[j] = j >= i ? a[i * width + j] : MAT_T_0;
+        }
+    }
+
+    /* Q is the reflectors applied to the first columns of I, last block
+     * first, each touching only the rows and columns from its own on */
+    if (q != NULL) {
+        for (i = 0; i < height; i++) {
+            row = q->values + i * q->stride;
+            for (j = 0; j < rank; j++) {
+                row[j] = i == j ? MAT_T_1 : MAT_T_0;
+            }
+        }
+        for (first = (rank - 1) / MATRIX_QR_BLOCK * MATRIX_QR_BLOCK;;
+             first -= MATRIX_QR_BLOCK) {
+            count = rank - first < MATRIX_QR_BLOCK ? rank - first
+                                                   : MATRIX_QR_BLOCK;
+            rows = height - first;
+            matrix_qr_vectors(a, width, first, count, rows, v, vh);
+            if (matrix_qr_apply(q->values + first * q->stride + first,
+                                q->stride, rows, rank - first, v, vh,
+                                t + first * MATRIX_QR_BLOCK, count, w, false)
+                != 0)
+                goto matrix_qr_fail;
+            if (first == 0)
+                break;
+        }
+    }
+
+    free(a);
+    free(tau);
+    free(v);
+    free(vh);
+    free(t);
+    free(w);
+    INSTRUMENT_END();
+    return 0;
+
+matrix_qr_fail:
+    free(a);
+    free(tau);
+    free(v);
+    free(vh);
+    free(t);
+    free(w);
+    INSTRUMENT_END();
+    return -1;
 }
 
-static Matrix *matrix_clone(Matrix *matrix) {
+static mat_t matrix_eliminate(mat_t *values, size_t n) {
+    mat_t result = MAT_T_1;
+    mat_t reciprocal, multiple, temp;
+    mat_t *pivot_row, *row;
+    double magnitude, best;
+    size_t i, j, k, pivot;
+
+    for (j = 0; j < n; j++) {
+        pivot = j;
+        best = MAT_T_ABS2(values[j * n + j]);
+        for (i = j + 1; i < n; i++) {
+            magnitude = MAT_T_ABS2(values[i * n + j]);
+            if (magnitude > best) {
+                best = magnitude;
+                pivot = i;
+            }
+        }
+        /* only an exactly zero column makes the determinant 0; a tolerance
+         * would zero the determinants of widely scaled matrices */
+        pivot_row = values + pivot * n;
+        if (best == 0.0) {
+            return MAT_T_0;
+        }
+        if (pivot != j) {
+            row = values + j * n;
+            for (k = j; k < n; k++) {
+                temp = row[k];
+                row[k] = pivot_row[k];
+                pivot_row[k] = temp;
+            }
+            pivot_row = row;
+            result = MAT_T_MUL(MAT_T(-1.0), result);
+            INSTRUMENT_PIVOT_SWAP();
+        }
+        INSTRUMENT_FLOPS((double)(n - j - 1) * (n - j - 1)
+                         * INSTRUMENT_FMA_FLOPS);
+
+        result = MAT_T_MUL(result, pivot_row[j]);
+        reciprocal = MAT_T_DIV(MAT_T_1, pivot_row[j]);
+        for (i = j + 1; i < n; i++) {
+            row = values + i * n;
+            multiple = MAT_T_MUL(row[j], reciprocal);
+            for (k = j + 1; k < n; k++) {
+                row[k] = MAT_T_SUB(row[k], MAT_T_MUL(multiple, pivot_row[k]));
+            }
+        }
+    }
+    return result;
+}
+
+Matrix *matrix_clone(Matrix *matrix) {
     const size_t height = matrix_height(matrix);
     const size_t width = matrix_width(matrix);
     Matrix *clone = matrix_create(height, width);
     if (clone == NULL)
         goto matrix_clone_fail;
-    memcpy(clone->values, matrix->values, height * width * sizeof(mat_t));
+    matrix_copy_to_buffer(matrix, clone->values);
     return clone;
 matrix_clone_fail:
     return NULL;
 }
 
+Matrix *matrix_clone_in(MatrixArena *arena, Matrix *matrix) {
+    Matrix *clone = matrix_create_in(arena, matrix->height, matrix->width);
+    if (clone == NULL)
+        return NULL;
+    matrix_copy_to_buffer(matrix, clone->values);
+    return clone;
+}
+
 mat_t matrix_determinant(Matrix *matrix) {
-    mat_t result = MAT_T_1;
-    size_t i;
-    Matrix *triangle = matrix_clone(matrix);
-    if (triangle == NULL)
-        goto matrix_determinant_fail;
+    const size_t n = matrix_width(matrix);
+    mat_t result;
+    mat_t *values;
+    LUFactor *factor;
 
-    if (matrix_width(matrix) != matrix_height(matrix)) {
+    if (n != matrix_height(matrix)) {
         report_logic_error("determinant undefined for non-square matrix");
     }
 
-    matrix_triangularize(triangle);
-
-    for (i = 1; i <= matrix_width(triangle); i++) {
-        result = MAT_T_MUL(result, matrix_get(triangle, i, i));
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_DETERMINANT);
+    if (n <= MATRIX_DETERMINANT_SMALL) {
+        values = malloc((n > 0 ? n * n : 1) * sizeof(mat_t));
+        if (values == NULL)
+            goto matrix_determinant_fail;
+        INSTRUMENT_BYTES((n > 0 ? n * n : 1) * sizeof(mat_t));
+        matrix_copy_to_buffer(matrix, values);
+        result = matrix_eliminate(values, n);
+        free(values);
+        INSTRUMENT_END();
+        return result;
     }
 
-    matrix_destroy(triangle);
+    /* callers needing several determinants, solves or inverses of the same
+     * matrix should keep the LUFactor instead */
+    factor = lufactor_create(matrix);
+    if (factor == NULL)
+        goto matrix_determinant_fail;
+
+    result = lufactor_determinant(factor);
+
+    lufactor_destroy(factor);
 
+    INSTRUMENT_END();
     return result;
 matrix_determinant_fail:
+    INSTRUMENT_END();
     /* TODO - return some sort of error code */
-    return 0;
+    return MAT_T_0;
+}
+
+mat_t matrix_determinant_in(MatrixArena *arena, Matrix *matrix) {
+    const size_t n = matrix_width(matrix);
+    mat_t result = MAT_T_0;
+    mat_t *values;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_DETERMINANT_IN);
+    if (n != matrix_height(matrix)) {
+        report_logic_error("determinant undefined for non-square matrix");
+    }
+    if (n > MATRIX_DETERMINANT_SMALL) {
+        result = matrix_determinant(matrix);
+    } else {
+        values = matrixarena_allocate(arena, n * n * sizeof(mat_t));
+        if (values != NULL) {
+            matrix_copy_to_buffer(matrix, values);
+            result = matrix_eliminate(values, n);
+        }
+    }
+    INSTRUMENT_END();
+    return result;
 }
 
 Matrix *matrix_create_identity(size_t width) {
@@ -224,27 +1371,81 @@ matrix_create_identity_fail:
     return NULL;
 }
 
+static void matrix_place(Matrix *matrix, size_t height, size_t width,
+                         mat_t *values) {
+    matrix->height = height;
+    matrix->width = width;
+    matrix->stride = width;
+    matrix->values = values;
+}
+
 Matrix *matrix_create(size_t height, size_t width) {
-    Matrix *matrix = calloc(1, sizeof(Matrix));
-    if (matrix == NULL)
-        goto matrix_create_fail;
+    /* the header and values share one allocation, with room to align the
+     * values */
+    const size_t bytes =
+        MATRIX_HEADER + MATRIXARENA_ALIGNMENT + height * width * sizeof(mat_t);
+    unsigned char *memory;
+    size_t address;
 
-    matrix->values = calloc(height * width, sizeof(mat_t));
-    if (matrix->values == NULL)
-        goto matrix_create_fail;
+    INSTRUMENT_BEGIN(INSTRUMENT_MATRIX_CREATE);
+    memory = calloc(1, bytes);
+    if (memory == NULL) {
+        INSTRUMENT_END();
+        return NULL;
+    }
+    INSTRUMENT_BYTES(bytes);
+    address = (size_t)(memory + MATRIX_HEADER);
+    matrix_place((Matrix *)memory, height, width,
+                 (mat_t *)(memory + MATRIX_HEADER
+                           + (MATRIXARENA_ALIGNMENT
+                              - address % MATRIXARENA_ALIGNMENT)
+                                 % MATRIXARENA_ALIGNMENT));
+    INSTRUMENT_END();
+    return (Matrix *)memory;
+}
 
-    matrix->height = height;
-    matrix->width = width;
+Matrix *matrix_create_in(MatrixArena *arena, size_t height, size_t width) {
+    /* arena allocations are aligned, so the values follow the header */
+    unsigned char *memory = matrixarena_allocate(
+        arena, MATRIX_HEADER + height * width * sizeof(mat_t));
+    Matrix *matrix = (Matrix *)memory;
 
+    if (memory == NULL)
+        return NULL;
+    memset(memory + MATRIX_HEADER, 0, height * width * sizeof(mat_t));
+    matrix_place(matrix, height, width, (mat_t *)(memory + MATRIX_HEADER));
+    matrix->in_arena = true;
+    matrix->mapping = NULL;
     return matrix;
-matrix_create_fail:
-    matrix_destroy(matrix);
+}
+
+Matrix *matrix_create_view(Matrix *matrix, size_t i, size_t j, size_t height,
+                           size_t width) {
+    Matrix *view;
+
+    if (!i || !j || i - 1 + height > matrix->height
+        || j - 1 + width > matrix->width) {
+        report_logic_error("view out of bounds");
+    }
+
+    view = calloc(1, sizeof(Matrix));
+    if (view == NULL)
+        goto matrix_create_view_fail;
+
+    view->height = height;
+    view->width = width;
+    view->stride = matrix->stride;
+    view->values = matrix->values + (i - 1) * matrix->stride + j - 1;
+
+    return view;
+matrix_create_view_fail:
     return NULL;
 }
 
 void matrix_destroy(Matrix *matrix) {
-    if (matrix != NULL) {
-        free(matrix->values);
+    if (matrix != NULL && matrix->mapping != NULL) {
+        matrix_unmap(matrix);
+    } else if (matrix != NULL && !matrix->in_arena) {
         free(matrix);
     }
 }
@@ -252,6 +1453,7 @@ void matrix_destroy(Matrix *matrix) {
 void matrix_print(Matrix *matrix) {
     const size_t width = matrix_width(matrix);
     const size_t height = matrix_height(matrix);
+    const mat_t *row;
     size_t i, j;
 
     printf("┌ ");
@@ -259,11 +1461,12 @@ void matrix_print(Matrix *matrix) {
         printf("      ");
     }
     puts("┐");
-    for (i = 1; i <= height; i++) {
+    for (i = 0; i < height; i++) {
+        row = matrix->values + i * matrix->stride;
         printf("| ");
-        for (j = 1; j <= width; j++) {
+        for (j = 0; j < width; j++) {
             /* TODO - ensure equal spacing for these */
-            MAT_T_PRINT(matrix_get(matrix, i, j));
+            MAT_T_PRINT(row[j]);
             printf(" ");
         }
         puts("|");
@@ -0,0 +1,49 @@
+#ifndef MATRIX_INTERNAL_H
+#define MATRIX_INTERNAL_H
+
+#include "matrix.h"
+
+/* layout shared by the translation units that work on Matrix storage
+ * directly; values are row-first with rows `stride` apart, which is more
+ * than `width` for views into a wider matrix */
+struct Matrix {
+    size_t height;
+    size_t width;
+    size_t stride;
+
+    mat_t *values;
+    /* matrices in a MatrixArena are freed by resetting it; the others are
+     * one allocation starting at the header, or a header for a view */
+    bool in_arena;
+    /* the read-only file mapping of a matrix from matrix_map, unmapped when
+     * it is destroyed; NULL for the others */
+    void *mapping;
+    size_t mapping_size;
+};
+
+/**
+ * Add `alpha` * A * B to C, where A is `height` x `inner` at `a`, B is
+ * `inner` x `width` at `b`, and C is `height` x `width` at `c`, each stored
+ * row-first with rows `*_width` elements apart.
+ * C must not overlap A or B.
+ * Return 0 on success, -1 on failure.
+ */
+int matrix_gemm(size_t height, size_t width, size_t inner, mat_t alpha,
+                const mat_t *a, size_t a_width, const mat_t *b, size_t b_width,
+                mat_t *c, size_t c_width);
+
+/**
+ * Unmap the file of a Matrix from `matrix_map`, and free its header.
+ */
+void matrix_unmap(Matrix *matrix);
+
+/**
+ * Set `dest` to exp(`t` * `matrix`) as `matrix_exponential` does, given
+ * A^2, A^4, A^6 and A^8 of `matrix` in `powers`. Powers that are NULL and
+ * needed are created and stored there, for the caller to destroy.
+ * Return 0 on success, -1 on failure.
+ */
+int matrix_exponential_pade(Matrix *dest, Matrix *matrix, Matrix **powers,
+                            mat_t t);
+
+#endif
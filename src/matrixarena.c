@@ -0,0 +1,149 @@
+#include "matrixarena.h"
+#include <stdlib.h>
+
+/* capacity of an arena created with none given */
+#define MATRIXARENA_DEFAULT (64 * 1024)
+
+/* one block of memory; an arena fills its newest block and adds a larger one
+ * when that runs out */
+typedef struct MatrixArenaBlock {
+    struct MatrixArenaBlock *previous;
+    size_t size;
+    size_t used;
+    /* the first aligned byte of the allocation, which starts at the block */
+    unsigned char *data;
+} MatrixArenaBlock;
+
+struct MatrixArena {
+    MatrixArenaBlock *block;
+    size_t capacity;
+    /* bytes allocated in blocks before the current one */
+    size_t retired;
+};
+
+/**
+ * Round `bytes` up to a multiple of `MATRIXARENA_ALIGNMENT`.
+ */
+static size_t matrixarena_round(size_t bytes);
+
+/**
+ * Create a block with room for `size` aligned bytes after `previous`.
+ * Return NULL on failure.
+ */
+static MatrixArenaBlock *matrixarena_block_create(MatrixArenaBlock *previous,
+                                                  size_t size);
+
+static size_t matrixarena_round(size_t bytes) {
+    return (bytes + MATRIXARENA_ALIGNMENT - 1)
+           / MATRIXARENA_ALIGNMENT * MATRIXARENA_ALIGNMENT;
+}
+
+static MatrixArenaBlock *matrixarena_block_create(MatrixArenaBlock *previous,
+                                                  size_t size) {
+    MatrixArenaBlock *block
+        = malloc(sizeof(MatrixArenaBlock) + MATRIXARENA_ALIGNMENT + size);
+    size_t address;
+
+    if (block == NULL)
+        return NULL;
+    block->previous = previous;
+    block->size = size;
+    block->used = 0;
+    address = (size_t)(block + 1);
+    block->data = (unsigned char *)(block + 1)
+                  + (matrixarena_round(address) - address);
+    return block;
+}
+
+void *matrixarena_allocate(MatrixArena *arena, size_t bytes) {
+    MatrixArenaBlock *block = arena->block;
+    size_t size;
+    void *memory;
+
+    bytes = matrixarena_round(bytes > 0 ? bytes : 1);
+    if (block->size - block->used < bytes) {
+        /* at least double, so a growing loop adds few blocks */
+        size = 2 * block->size > bytes ? 2 * block->size : bytes;
+        block = matrixarena_block_create(arena->block, size);
+        if (block == NULL)
+            return NULL;
+        arena->retired += arena->block->used;
+        arena->capacity += size;
+        arena->block = block;
+    }
+    memory = block->data + block->used;
+    block->used += bytes;
+    return memory;
+}
+
+int matrixarena_reset(MatrixArena *arena) {
+    MatrixArenaBlock *block = arena->block;
+    MatrixArenaBlock *merged;
+    MatrixArenaBlock *previous;
+
+    arena->retired = 0;
+    block->used = 0;
+    if (block->previous == NULL) {
+        return 0;
+    }
+
+    /* replace every block with one as large as all of them */
+    merged = matrixarena_block_create(NULL, arena->capacity);
+    if (merged == NULL) {
+        /* keep the newest (largest) block */
+        for (block = block->previous; block != NULL; block = previous) {
+            previous = block->previous;
+            arena->capacity -= block->size;
+            free(block);
+        }
+        arena->block->previous = NULL;
+        return -1;
+    }
+    for (; block != NULL; block = previous) {
+        previous = block->previous;
+        free(block);
+    }
+    arena->block = merged;
+    return 0;
+}
+
+size_t matrixarena_used(MatrixArena *arena) {
+    return arena->retired + arena->block->used;
+}
+
+size_t matrixarena_capacity(MatrixArena *arena) { return arena->capacity; }
+
+MatrixArena *matrixarena_create(size_t capacity) {
+    MatrixArena *arena;
+
+    if (capacity == 0) {
+        capacity = MATRIXARENA_DEFAULT;
+    }
+    capacity = matrixarena_round(capacity);
+
+    arena = calloc(1, sizeof(MatrixArena));
+    if (arena == NULL)
+        goto matrixarena_create_fail;
+    arena->block = matrixarena_block_create(NULL, capacity);
+    if (arena->block == NULL)
+        goto matrixarena_create_fail;
+    arena->capacity = capacity;
+
+    return arena;
+matrixarena_create_fail:
+    matrixarena_destroy(arena);
+    return NULL;
+}
+
+void matrixarena_destroy(MatrixArena *arena) {
+    MatrixArenaBlock *block;
+    MatrixArenaBlock *previous;
+
+    if (arena != NULL) {
+        for (block = arena->block; block != NULL; block = previous) {
+            previous = block->previous;
+            free(block);
+        }
+        free(arena);
+    }
+}
@@ -0,0 +1,465 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "matrixfile.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* header layout: magic, then little-endian fields at these byte offsets;
+ * the rest of the header is zero */
+#define MATRIXFILE_MAGIC "LQMATRIX"
+#define MATRIXFILE_MAGIC_SIZE 8
+#define MATRIXFILE_VERSION_AT 8
+#define MATRIXFILE_TYPE_AT 12
+#define MATRIXFILE_ORDER_AT 16
+#define MATRIXFILE_OFFSET_AT 20
+#define MATRIXFILE_HEIGHT_AT 24
+#define MATRIXFILE_WIDTH_AT 32
+/* the values follow the header, at an offset that keeps them aligned in
+ * page-aligned mappings */
+#define MATRIXFILE_HEADER MATRIXFILE_OFFSET
+
+/* element types: doubles, or pairs of doubles (real, imaginary) */
+#define MATRIXFILE_REAL 1
+#define MATRIXFILE_COMPLEX 2
+#ifdef MAT_T_COMPLEX
+#define MATRIXFILE_TYPE MATRIXFILE_COMPLEX
+#else
+#define MATRIXFILE_TYPE MATRIXFILE_REAL
+#endif
+
+/* byte orders of the values */
+#define MATRIXFILE_LITTLE 0
+#define MATRIXFILE_BIG 1
+
+/* doubles converted per pass when a file's values need converting */
+#define MATRIXFILE_CHUNK 4096
+
+/* the fields of a checked header */
+typedef struct MatrixFileHeader {
+    unsigned long type;
+    unsigned long order;
+    size_t offset;
+    size_t height;
+    size_t width;
+    /* bytes of values after the offset */
+    size_t bytes;
+} MatrixFileHeader;
+
+struct MatrixReader {
+    FILE *file;
+    MatrixFileHeader header;
+    size_t rows;
+    double *chunk;
+};
+
+struct MatrixWriter {
+    FILE *file;
+    size_t height;
+    size_t width;
+    size_t rows;
+};
+
+/**
+ * Get the byte order of this machine.
+ */
+static unsigned long matrixfile_order(void);
+
+/**
+ * Store the low `size` bytes of `value` at `bytes`, least significant first.
+ */
+static void matrixfile_put(unsigned char *bytes, size_t value, size_t size);
+
+/**
+ * Get the `size` byte little-endian number at `bytes`.
+ * Return -1 if it does not fit in a size_t, 0 otherwise.
+ */
+static int matrixfile_get(const unsigned char *bytes, size_t size,
+                          size_t *value);
+
+/**
+ * Check the header in `bytes` and fill `header` from it, reporting what is
+ * wrong with it if anything.
+ * Return 0 on success, -1 on failure.
+ */
+static int matrixfile_parse(const unsigned char *bytes,
+                            MatrixFileHeader *header);
+
+/**
+ * Reverse the bytes of each of the `count` doubles at `values`.
+ */
+static void matrixfile_swap(double *values, size_t count);
+
+static unsigned long matrixfile_order(void) {
+    const unsigned int one = 1;
+    return *(const unsigned char *)&one == 1 ? MATRIXFILE_LITTLE
+                                              : MATRIXFILE_BIG;
+}
+
+static void matrixfile_put(unsigned char *bytes, size_t value, size_t size) {
+    size_t i;
+    for (i = 0; i < size; i++) {
+        bytes[i] = (unsigned char)(value & 0xff);
+        /* two shifts, as one by the width of size_t is undefined */
+        value = value >> 4 >> 4;
+    }
+}
+
+static int matrixfile_get(const unsigned char *bytes, size_t size,
+                          size_t *value) {
+    size_t i;
+
+    *value = 0;
+    for (i = size; i-- > 0;) {
+        if (*value >> (sizeof(size_t) * 8 - 8) != 0)
+            return -1;
+        *value = *value << 8 | bytes[i];
+    }
+    return 0;
+}
+
+static int matrixfile_parse(const unsigned char *bytes,
+                            MatrixFileHeader *header) {
+    size_t version, type, order, element, count;
+
+    if (memcmp(bytes, MATRIXFILE_MAGIC, MATRIXFILE_MAGIC_SIZE) != 0) {
+        report_error("not a matrix file");
+        return -1;
+    }
+    matrixfile_get(bytes + MATRIXFILE_VERSION_AT, 4, &version);
+    matrixfile_get(bytes + MATRIXFILE_TYPE_AT, 4, &type);
+    matrixfile_get(bytes + MATRIXFILE_ORDER_AT, 4, &order);
+    matrixfile_get(bytes + MATRIXFILE_OFFSET_AT, 4, &header->offset);
+    if (version == 0 || version > MATRIXFILE_VERSION) {
+        report_error("matrix file version is not supported");
+        return -1;
+    }
+    if ((type != MATRIXFILE_REAL && type != MATRIXFILE_COMPLEX)
+        || (order != MATRIXFILE_LITTLE && order != MATRIXFILE_BIG)
+        || header->offset < MATRIXFILE_HEADER
+        || header->offset % sizeof(double) != 0) {
+        report_error("matrix file header is corrupt");
+        return -1;
+    }
+    if (type == MATRIXFILE_COMPLEX && MATRIXFILE_TYPE == MATRIXFILE_REAL) {
+        report_error("complex matrix file cannot be read as real");
+        return -1;
+    }
+    header->type = type;
+    header->order = order;
+
+    element = (type == MATRIXFILE_COMPLEX ? 2 : 1) * sizeof(double);
+    if (matrixfile_get(bytes + MATRIXFILE_HEIGHT_AT, 8, &header->height) != 0
+        || matrixfile_get(bytes + MATRIXFILE_WIDTH_AT, 8, &header->width) != 0
+        || (header->width != 0
+            && header->height > (size_t)-1 / header->width)) {
+        report_error("matrix file is too large for this platform");
+        return -1;
+    }
+    count = header->height * header->width;
+    if (count > ((size_t)-1 - header->offset) / element) {
+        report_error("matrix file is too large for this platform");
+        return -1;
+    }
+    header->bytes = count * element;
+    return 0;
+}
+
+static void matrixfile_swap(double *values, size_t count) {
+    unsigned char *bytes = (unsigned char *)values;
+    unsigned char temp;
+    size_t i, j;
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < sizeof(double) / 2; j++) {
+            temp = bytes[j];
+            bytes[j] = bytes[sizeof(double) - 1 - j];
+            bytes[sizeof(double) - 1 - j] = temp;
+        }
+        bytes += sizeof(double);
+    }
+}
+
+size_t matrixreader_height(MatrixReader *reader) {
+    return reader->header.height;
+}
+
+size_t matrixreader_width(MatrixReader *reader) {
+    return reader->header.width;
+}
+
+size_t matrixreader_rows(MatrixReader *reader) { return reader->rows; }
+
+int matrixreader_read(MatrixReader *reader, mat_t *values, size_t rows) {
+    const size_t count = rows * reader->header.width;
+    size_t i, done, part;
+
+    if (rows > reader->header.height - reader->rows) {
+        report_logic_error("read past the last row of the matrix file");
+    }
+
+    if (reader->header.type == MATRIXFILE_TYPE) {
+        /* mat_t is made of doubles, so read straight into the values */
+        if (fread(values, sizeof(mat_t), count, reader->file) != count)
+            goto matrixreader_read_fail;
+        if (reader->header.order != matrixfile_order()) {
+            matrixfile_swap((double *)values,
+                            count * (sizeof(mat_t) / sizeof(double)));
+        }
+    } else {
+        /* real values into a complex build */
+        for (done = 0; done < count; done += part) {
+            part = count - done < MATRIXFILE_CHUNK ? count - done
+                                                   : MATRIXFILE_CHUNK;
+            if (fread(reader->chunk, sizeof(double), part, reader->file)
+                != part)
+                goto matrixreader_read_fail;
+            if (reader->header.order != matrixfile_order()) {
+                matrixfile_swap(reader->chunk, part);
+            }
+            for (i = 0; i < part; i++) {
+                values[done + i] = MAT_T(reader->chunk[i]);
+            }
+        }
+    }
+    reader->rows += rows;
+    return 0;
+matrixreader_read_fail:
+    report_error("matrix file is truncated");
+    return -1;
+}
+
+MatrixReader *matrixreader_create(const char *path) {
+    MatrixReader *reader = NULL;
+    unsigned char bytes[MATRIXFILE_HEADER];
+
+    reader = calloc(1, sizeof(MatrixReader));
+    if (reader == NULL)
+        goto matrixreader_create_fail;
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) {
+        report_error("cannot open matrix file");
+        goto matrixreader_create_fail;
+    }
+    if (fread(bytes, 1, MATRIXFILE_HEADER, reader->file) != MATRIXFILE_HEADER) {
+        report_error("matrix file is truncated");
+        goto matrixreader_create_fail;
+    }
+    if (matrixfile_parse(bytes, &reader->header) != 0)
+        goto matrixreader_create_fail;
+    /* later versions may place the values further on */
+    if (fseek(reader->file, (long)reader->header.offset, SEEK_SET) != 0)
+        goto matrixreader_create_fail;
+    if (reader->header.type != MATRIXFILE_TYPE) {
+        reader->chunk = malloc(MATRIXFILE_CHUNK * sizeof(double));
+        if (reader->chunk == NULL)
+            goto matrixreader_create_fail;
+    }
+    return reader;
+
+matrixreader_create_fail:
+    matrixreader_destroy(reader);
+    return NULL;
+}
+
+void matrixreader_destroy(MatrixReader *reader) {
+    if (reader != NULL) {
+        if (reader->file != NULL) {
+            fclose(reader->file);
+        }
+        free(reader->chunk);
+        free(reader);
+    }
+}
+
+size_t matrixwriter_rows(MatrixWriter *writer) { return writer->rows; }
+
+int matrixwriter_write(MatrixWriter *writer, const mat_t *values,
+                       size_t rows) {
+    const size_t count = rows * writer->width;
+
+    if (writer->file == NULL) {
+        report_logic_error("matrix file is already finished");
+    }
+    if (rows > writer->height - writer->rows) {
+        report_logic_error("write past the last row of the matrix file");
+    }
+    if (fwrite(values, sizeof(mat_t), count, writer->file) != count)
+        return -1;
+    writer->rows += rows;
+    return 0;
+}
+
+int matrixwriter_finish(MatrixWriter *writer) {
+    int result;
+
+    if (writer->file == NULL) {
+        report_logic_error("matrix file is already finished");
+    }
+    if (writer->rows != writer->height) {
+        report_logic_error("matrix file finished before its last row");
+    }
+    result = fclose(writer->file);
+    writer->file = NULL;
+    return result == 0 ? 0 : -1;
+}
+
+MatrixWriter *matrixwriter_create(const char *path, size_t height,
+                                  size_t width) {
+    MatrixWriter *writer = NULL;
+    unsigned char bytes[MATRIXFILE_HEADER];
+
+    writer = calloc(1, sizeof(MatrixWriter));
+    if (writer == NULL)
+        goto matrixwriter_create_fail;
+    writer->height = height;
+    writer->width = width;
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        report_error("cannot create matrix file");
+        goto matrixwriter_create_fail;
+    }
+
+    memset(bytes, 0, MATRIXFILE_HEADER);
+    memcpy(bytes, MATRIXFILE_MAGIC, MATRIXFILE_MAGIC_SIZE);
+    matrixfile_put(bytes + MATRIXFILE_VERSION_AT, MATRIXFILE_VERSION, 4);
+    matrixfile_put(bytes + MATRIXFILE_TYPE_AT, MATRIXFILE_TYPE, 4);
+    matrixfile_put(bytes + MATRIXFILE_ORDER_AT, matrixfile_order(), 4);
+    matrixfile_put(bytes + MATRIXFILE_OFFSET_AT, MATRIXFILE_HEADER, 4);
+    matrixfile_put(bytes + MATRIXFILE_HEIGHT_AT, height, 8);
+    matrixfile_put(bytes + MATRIXFILE_WIDTH_AT, width, 8);
+    if (fwrite(bytes, 1, MATRIXFILE_HEADER, writer->file) != MATRIXFILE_HEADER)
+        goto matrixwriter_create_fail;
+    return writer;
+
+matrixwriter_create_fail:
+    matrixwriter_destroy(writer);
+    return NULL;
+}
+
+void matrixwriter_destroy(MatrixWriter *writer) {
+    if (writer != NULL) {
+        if (writer->file != NULL) {
+            fclose(writer->file);
+        }
+        free(writer);
+    }
+}
+
+int matrix_save(Matrix *matrix, const char *path) {
+    MatrixWriter *writer;
+    size_t i;
+
+    writer = matrixwriter_create(path, matrix->height, matrix->width);
+    if (writer == NULL)
+        goto matrix_save_fail;
+    if (matrix->stride == matrix->width) {
+        if (matrixwriter_write(writer, matrix->values, matrix->height) != 0)
+            goto matrix_save_fail;
+    } else {
+        /* a view's rows are apart in memory */
+        for (i = 0; i < matrix->height; i++) {
+            if (matrixwriter_write(writer, matrix->values + i * matrix->stride,
+                                   1)
+                != 0)
+                goto matrix_save_fail;
+        }
+    }
+    if (matrixwriter_finish(writer) != 0)
+        goto matrix_save_fail;
+    matrixwriter_destroy(writer);
+    return 0;
+
+matrix_save_fail:
+    matrixwriter_destroy(writer);
+    return -1;
+}
+
+Matrix *matrix_load(const char *path) {
+    MatrixReader *reader;
+    Matrix *matrix = NULL;
+
+    reader = matrixreader_create(path);
+    if (reader == NULL)
+        goto matrix_load_fail;
+    matrix = matrix_create(reader->header.height, reader->header.width);
+    if (matrix == NULL)
+        goto matrix_load_fail;
+    if (matrixreader_read(reader, matrix->values, matrix->height) != 0)
+        goto matrix_load_fail;
+    matrixreader_destroy(reader);
+    return matrix;
+
+matrix_load_fail:
+    matrixreader_destroy(reader);
+    matrix_destroy(matrix);
+    return NULL;
+}
+
+Matrix *matrix_map(const char *path) {
+    MatrixFileHeader header;
+    struct stat status;
+    Matrix *matrix = NULL;
+    void *mapping = MAP_FAILED;
+    size_t size = 0;
+    int descriptor;
+
+    descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) {
+        report_error("cannot open matrix file");
+        return NULL;
+    }
+    if (fstat(descriptor, &status) != 0)
+        goto matrix_map_fail;
+    size = (size_t)status.st_size;
+    if (size < MATRIXFILE_HEADER) {
+        report_error("matrix file is truncated");
+        goto matrix_map_fail;
+    }
+    mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (mapping == MAP_FAILED)
+        goto matrix_map_fail;
+    if (matrixfile_parse(mapping, &header) != 0)
+        goto matrix_map_fail;
+    if (header.offset > size || header.bytes > size - header.offset) {
+        report_error("matrix file is truncated");
+        goto matrix_map_fail;
+    }
+    if (header.type != MATRIXFILE_TYPE || header.order != matrixfile_order()) {
+        report_error("only files of this build's element type and byte order "
+                     "can be mapped");
+        goto matrix_map_fail;
+    }
+
+    matrix = calloc(1, sizeof(Matrix));
+    if (matrix == NULL)
+        goto matrix_map_fail;
+    matrix->height = header.height;
+    matrix->width = header.width;
+    matrix->stride = header.width;
+    matrix->values = (mat_t *)((unsigned char *)mapping + header.offset);
+    matrix->mapping = mapping;
+    matrix->mapping_size = size;
+    /* the mapping outlives the descriptor */
+    close(descriptor);
+    return matrix;
+
+matrix_map_fail:
+    if (mapping != MAP_FAILED) {
+        munmap(mapping, size);
+    }
+    close(descriptor);
+    return NULL;
+}
+
+void matrix_unmap(Matrix *matrix) {
+    munmap(matrix->mapping, matrix->mapping_size);
+    free(matrix);
+}
@@ -0,0 +1,28 @@
+#include "matvec.h"
+#include "kronoperator.h"
+#include "matrix_internal.h"
+#include "sparsematrix.h"
+
+void matvec_dense(void *matrix, const mat_t *x, mat_t *y) {
+    const Matrix *dense = matrix;
+    const mat_t *row;
+    mat_t sum;
+    size_t i, j;
+
+    for (i = 0; i < dense->height; i++) {
+        row = dense->values + i * dense->stride;
+        sum = MAT_T_0;
+        for (j = 0; j < dense->width; j++) {
+            sum = MAT_T_ADD(sum, MAT_T_MUL(row[j], x[j]));
+        }
+        y[i] = sum;
+    }
+}
+
+void matvec_sparse(void *sparse, const mat_t *x, mat_t *y) {
+    sparsematrix_multiply_vector(sparse, x, y);
+}
+
+void matvec_kron(void *kron, const mat_t *x, mat_t *y) {
+    kronoperator_multiply_vector(kron, x, y);
+}
@@ -0,0 +1,382 @@
+#include "mps.h"
+#include "instrument_internal.h"
+#include "mat2.h"
+#include "mat4.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* singular values weighing less than this fraction of the total are dropped
+ * even when no truncation is asked for, as rounding noise */
+#define MPS_NEGLIGIBLE 1e-24
+
+struct Mps {
+    size_t qubits;
+    size_t max_bond;
+    double threshold;
+
+    /* site k is (left bond * 2) x (right bond), row 2 l + p holding qubit k
+     * in state p; the same values read as left bond x (2 * right bond) have
+     * column p * (right bond) + r, which is how a pair is contracted */
+    Matrix **sites;
+    /* every site left of `center` is left-orthonormal and every site right of
+     * it right-orthonormal, so the norm is all in the center site */
+    size_t center;
+    double discarded;
+
+    /* two vectors as long as the largest bond, for mps_get */
+    mat_t *scratch;
+    size_t scratch_bond;
+};
+
+/**
+ * Check that `qubit` is in the state.
+ */
+static void mps_check(Mps *mps, size_t qubit);
+
+/**
+ * Contract sites `site` and `site` + 1, apply `gate` (NULL for none) to
+ * them, indexed by 2 * (qubit `site`) + (qubit `site` + 1), and split them
+ * again by a truncated SVD. The center, which must be one of the two, moves
+ * to the right one if `center_right`, else to the left one.
+ * Return 0 on success, -1 on failure.
+ */
+static int mps_update_pair(Mps *mps, size_t site, const Mat4 *gate,
+                           bool center_right);
+
+/**
+ * Move the center to `site` or `site` + 1, then update that pair as
+ * `mps_update_pair` does.
+ * Return 0 on success, -1 on failure.
+ */
+static int mps_apply_pair(Mps *mps, size_t site, const Mat4 *gate,
+                          bool center_right);
+
+static void mps_check(Mps *mps, size_t qubit) {
+    if (qubit >= mps->qubits) {
+        report_logic_error("qubit out of bounds");
+    }
+}
+
+static int mps_update_pair(Mps *mps, size_t site, const Mat4 *gate,
+                           bool center_right) {
+    Matrix *a = mps->sites[site];
+    Matrix *b = mps->sites[site + 1];
+    const size_t left = a->height / 2;
+    const size_t right = b->width;
+    const size_t rank = left < right ? 2 * left : 2 * right;
+    struct Matrix b_wide;
+    Matrix *theta = NULL, *u = NULL, *v = NULL;
+    Matrix *new_a = NULL, *new_b = NULL;
+    double *s = NULL;
+    mat_t *scratch, *row;
+    mat_t block[4], x;
+    double total = 0, dropped = 0, weight, scale;
+    size_t kept, l, r, i, j, m;
+
+    theta = matrix_create(2 * left, 2 * right);
+    u = matrix_create(2 * left, rank);
+    v = matrix_create(2 * right, rank);
+    s = malloc(rank * sizeof(double));
+    if (theta == NULL || u == NULL || v == NULL || s == NULL)
+        goto mps_update_pair_fail;
+
+    b_wide.height = a->width;
+    b_wide.width = 2 * right;
+    b_wide.stride = 2 * right;
+    b_wide.values = b->values;
+    b_wide.in_arena = false;
+    b_wide.mapping = NULL;
+    if (matrix_multiply(theta, a, &b_wide) != 0)
+        goto mps_update_pair_fail;
+
+    if (gate != NULL) {
+        for (l = 0; l < left; l++) {
+            for (r = 0; r < right; r++) {
+                for (i = 0; i < 4; i++) {
+                    block[i] = theta->values[(2 * l + i / 2) * theta->stride
+                                             + (i % 2) * right + r];
+                }
+                for (i = 0; i < 4; i++) {
+                    x = MAT_T_0;
+                    for (j = 0; j < 4; j++) {
+                        x = MAT_T_ADD(x, MAT_T_MUL(gate->values[4 * i + j],
+                                                   block[j]));
+                    }
+                    theta->values[(2 * l + i / 2) * theta->stride
+                                  + (i % 2) * right + r] = x;
+                }
+            }
+        }
+    }
+
+    if (matrix_svd(u, s, v, theta) != 0)
+        goto mps_update_pair_fail;
+
+    /* drop the smallest singular values while the bond is over its cap or
+     * the weight dropped stays within the threshold */
+    for (m = 0; m < rank; m++) {
+        total += s[m] * s[m];
+    }
+    kept = rank;
+    while (kept > 1) {
+        weight = s[kept - 1] * s[kept - 1];
+        if ((mps->max_bond == 0 || kept <= mps->max_bond)
+            && dropped + weight > mps->threshold * total
+            && weight > MPS_NEGLIGIBLE * total)
+            break;
+        dropped += weight;
+        kept--;
+    }
+    scale = 1;
+    if (total > 0) {
+        mps->discarded += dropped / total;
+        scale = sqrt(total / (total - dropped));
+    }
+
+    if (kept > mps->scratch_bond) {
+        scratch = realloc(mps->scratch, 2 * kept * sizeof(mat_t));
+        if (scratch == NULL)
+            goto mps_update_pair_fail;
+        mps->scratch = scratch;
+        mps->scratch_bond = kept;
+    }
+    new_a = matrix_create(2 * left, kept);
+    new_b = matrix_create(2 * kept, right);
+    if (new_a == NULL || new_b == NULL)
+        goto mps_update_pair_fail;
+
+    /* U goes left and V^H right, with S on the side the center moves to */
+    for (i = 0; i < 2 * left; i++) {
+        row = u->values + i * u->stride;
+        for (m = 0; m < kept; m++) {
+            new_a->values[i * kept + m] =
+                center_right ? row[m] : MAT_T_MUL(row[m], MAT_T(s[m] * scale));
+        }
+    }
+    for (j = 0; j < 2 * right; j++) {
+        row = v->values + j * v->stride;
+        for (m = 0; m < kept; m++) {
+            x = MAT_T_CONJ(row[m]);
+            new_b->values[m * 2 * right + j] =
+                center_right ? MAT_T_MUL(x, MAT_T(s[m] * scale)) : x;
+        }
+    }
+
+    matrix_destroy(a);
+    matrix_destroy(b);
+    mps->sites[site] = new_a;
+    mps->sites[site + 1] = new_b;
+    mps->center = center_right ? site + 1 : site;
+
+    matrix_destroy(theta);
+    matrix_destroy(u);
+    matrix_destroy(v);
+    free(s);
+    return 0;
+
+mps_update_pair_fail:
+    matrix_destroy(theta);
+    matrix_destroy(u);
+    matrix_destroy(v);
+    matrix_destroy(new_a);
+    matrix_destroy(new_b);
+    free(s);
+    return -1;
+}
+
+static int mps_apply_pair(Mps *mps, size_t site, const Mat4 *gate,
+                          bool center_right) {
+    while (mps->center < site) {
+        if (mps_update_pair(mps, mps->center, NULL, true) != 0)
+            return -1;
+    }
+    while (mps->center > site + 1) {
+        if (mps_update_pair(mps, mps->center - 1, NULL, false) != 0)
+            return -1;
+    }
+    return mps_update_pair(mps, site, gate, center_right);
+}
+
+size_t mps_qubits(Mps *mps) {
+    return mps->qubits;
+}
+
+size_t mps_bond_dimension(Mps *mps, size_t bond) {
+    if (bond + 1 >= mps->qubits) {
+        report_logic_error("bond out of bounds");
+    }
+    return mps->sites[bond]->width;
+}
+
+size_t mps_max_bond_dimension(Mps *mps) {
+    size_t largest = 1;
+    size_t k;
+
+    for (k = 0; k + 1 < mps->qubits; k++) {
+        if (mps->sites[k]->width > largest) {
+            largest = mps->sites[k]->width;
+        }
+    }
+    return largest;
+}
+
+double mps_discarded_weight(Mps *mps) {
+    return mps->discarded;
+}
+
+mat_t mps_get(Mps *mps, size_t index) {
+    mat_t *current = mps->scratch;
+    mat_t *next = mps->scratch + mps->scratch_bond;
+    mat_t *swap;
+    Matrix *site;
+    size_t k, l, r, p;
+
+    /* a row vector through the chain, picking each site's slice for the
+     * value of its qubit; qubits past the bits of `index` are 0 */
+    current[0] = MAT_T_1;
+    for (k = 0; k < mps->qubits; k++) {
+        site = mps->sites[k];
+        p = k < sizeof(size_t) * CHAR_BIT ? (index >> k) & 1 : 0;
+        for (r = 0; r < site->width; r++) {
+            next[r] = MAT_T_0;
+            for (l = 0; l < site->height / 2; l++) {
+                next[r] = MAT_T_ADD(
+                    next[r],
+                    MAT_T_MUL(current[l],
+                              site->values[(2 * l + p) * site->width + r]));
+            }
+        }
+        swap = current;
+        current = next;
+        next = swap;
+    }
+    return current[0];
+}
+
+void mps_apply_1q(Mps *mps, Matrix *gate, size_t target) {
+    Matrix *site;
+    Mat2 g;
+    mat_t *zero, *one;
+    mat_t x;
+    size_t l, r;
+
+    mps_check(mps, target);
+    mat2_from_matrix(&g, gate);
+
+    /* a unitary on the physical index keeps the site orthonormal */
+    site = mps->sites[target];
+    for (l = 0; l < site->height / 2; l++) {
+        zero = site->values + 2 * l * site->width;
+        one = zero + site->width;
+        for (r = 0; r < site->width; r++) {
+            x = zero[r];
+            zero[r] = MAT_T_ADD(MAT_T_MUL(g.values[0], x),
+                                MAT_T_MUL(g.values[1], one[r]));
+            one[r] = MAT_T_ADD(MAT_T_MUL(g.values[2], x),
+                               MAT_T_MUL(g.values[3], one[r]));
+        }
+    }
+}
+
+int mps_apply_2q(Mps *mps, Matrix *gate, size_t high, size_t low) {
+    Mat4 g, swapped, swap;
+    size_t i, j, p;
+
+    mps_check(mps, high);
+    mps_check(mps, low);
+    if (high == low) {
+        report_logic_error("gate qubits must be distinct");
+    }
+    INSTRUMENT_BEGIN(INSTRUMENT_MPS_APPLY_2Q);
+    mat4_from_matrix(&g, gate);
+    /* the gate with its qubits in the other order, and a swap */
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            swapped.values[4 * i + j] =
+                g.values[4 * (2 * (i % 2) + i / 2) + 2 * (j % 2) + j / 2];
+            swap.values[4 * i + j] =
+                j == 2 * (i % 2) + i / 2 ? MAT_T_1 : MAT_T_0;
+        }
+    }
+
+    if (high < low) {
+        for (p = high; p + 1 < low; p++) {
+            if (mps_apply_pair(mps, p, &swap, true) != 0)
+                goto mps_apply_2q_fail;
+        }
+        if (mps_apply_pair(mps, low - 1, &g, false) != 0)
+            goto mps_apply_2q_fail;
+        for (p = low - 1; p > high; p--) {
+            if (mps_apply_pair(mps, p - 1, &swap, false) != 0)
+                goto mps_apply_2q_fail;
+        }
+    } else {
+        for (p = high; p > low + 1; p--) {
+            if (mps_apply_pair(mps, p - 1, &swap, false) != 0)
+                goto mps_apply_2q_fail;
+        }
+        if (mps_apply_pair(mps, low, &swapped, true) != 0)
+            goto mps_apply_2q_fail;
+        for (p = low + 1; p < high; p++) {
+            if (mps_apply_pair(mps, p, &swap, true) != 0)
+                goto mps_apply_2q_fail;
+        }
+    }
+    INSTRUMENT_END();
+    return 0;
+
+mps_apply_2q_fail:
+    INSTRUMENT_END();
+    return -1;
+}
+
+Mps *mps_create(size_t qubits, size_t max_bond, double threshold) {
+    Mps *mps = NULL;
+    size_t k;
+
+    if (qubits == 0) {
+        report_logic_error("state needs at least one qubit");
+    }
+
+    mps = calloc(1, sizeof(Mps));
+    if (mps == NULL)
+        goto mps_create_fail;
+    mps->qubits = qubits;
+    mps->max_bond = max_bond;
+    mps->threshold = threshold;
+    mps->sites = calloc(qubits, sizeof(Matrix *));
+    mps->scratch = malloc(2 * sizeof(mat_t));
+    mps->scratch_bond = 1;
+    if (mps->sites == NULL || mps->scratch == NULL)
+        goto mps_create_fail;
+    for (k = 0; k < qubits; k++) {
+        mps->sites[k] = matrix_create(2, 1);
+        if (mps->sites[k] == NULL)
+            goto mps_create_fail;
+        mps->sites[k]->values[0] = MAT_T_1;
+    }
+    return mps;
+
+mps_create_fail:
+    mps_destroy(mps);
+    return NULL;
+}
+
+void mps_destroy(Mps *mps) {
+    size_t k;
+
+    if (mps != NULL) {
+        if (mps->sites != NULL) {
+            for (k = 0; k < mps->qubits; k++) {
+                matrix_destroy(mps->sites[k]);
+            }
+        }
+        free(mps->sites);
+        free(mps->scratch);
+        free(mps);
+    }
+}
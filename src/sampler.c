@@ -0,0 +1,288 @@
+#include "sampler.h"
+#include "instrument_internal.h"
+#include "mat_t.h"
+#include "reporter.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* keeps generator words to 32 bits when unsigned long is wider */
+#define SAMPLER_MASK 0xffffffffUL
+
+struct Sampler {
+    size_t size;
+    /* basis state i is kept with probability `keep[i]`, else replaced by
+     * `alias[i]`, once i is drawn uniformly */
+    double *keep;
+    size_t *alias;
+};
+
+/**
+ * A xoshiro128** generator, one per block of shots.
+ */
+typedef struct SamplerStream {
+    unsigned long s[4];
+} SamplerStream;
+
+/**
+ * Arguments for the parallel sampling kernels.
+ */
+typedef struct SamplerJob {
+    Sampler *sampler;
+    size_t shots;
+    unsigned long seed;
+    /* where shots are stored, or NULL to only count them */
+    size_t *results;
+    /* one histogram per worker, the first being the caller's */
+    size_t **counts;
+} SamplerJob;
+
+/**
+ * Scramble the 32 bits of `x`.
+ */
+static unsigned long sampler_mix(unsigned long x);
+
+/**
+ * Seed `stream` for block `block` of the shots drawn with `seed`.
+ */
+static void sampler_stream_seed(SamplerStream *stream, unsigned long seed,
+                                size_t block);
+
+/**
+ * Get the next 32 random bits of `stream`.
+ */
+static unsigned long sampler_stream_next(SamplerStream *stream);
+
+/**
+ * Draw one basis state.
+ */
+static size_t sampler_draw(Sampler *sampler, SamplerStream *stream);
+
+/**
+ * Draw the shots of blocks [`begin`, `end`) of a SamplerJob.
+ */
+static void sampler_task(void *context, size_t worker, size_t begin,
+                         size_t end);
+
+static unsigned long sampler_mix(unsigned long x) {
+    x = (x + 0x9e3779b9UL) & SAMPLER_MASK;
+    x = ((x ^ (x >> 16)) * 0x85ebca6bUL) & SAMPLER_MASK;
+    x = ((x ^ (x >> 13)) * 0xc2b2ae35UL) & SAMPLER_MASK;
+    return x ^ (x >> 16);
+}
+
+static void sampler_stream_seed(SamplerStream *stream, unsigned long seed,
+                                size_t block) {
+    unsigned long x = sampler_mix(sampler_mix(seed & SAMPLER_MASK)
+                                  ^ ((unsigned long)block & SAMPLER_MASK));
+    size_t i;
+
+    for (i = 0; i < 4; i++) {
+        x = sampler_mix(x);
+        stream->s[i] = x;
+    }
+    /* the all-zero state never leaves zero */
+    if ((stream->s[0] | stream->s[1] | stream->s[2] | stream->s[3]) == 0) {
+        stream->s[0] = 1;
+    }
+}
+
+static unsigned long sampler_stream_next(SamplerStream *stream) {
+    unsigned long *s = stream->s;
+    unsigned long result, t;
+
+    result = (s[1] * 5) & SAMPLER_MASK;
+    result = ((result << 7) | (result >> 25)) & SAMPLER_MASK;
+    result = (result * 9) & SAMPLER_MASK;
+    t = (s[1] << 9) & SAMPLER_MASK;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = ((s[3] << 11) | (s[3] >> 21)) & SAMPLER_MASK;
+    return result;
+}
+
+static size_t sampler_draw(Sampler *sampler, SamplerStream *stream) {
+    /* a uniform double in [0, 1) from 53 random bits */
+    double high = (double)(sampler_stream_next(stream) >> 5);
+    double low = (double)(sampler_stream_next(stream) >> 6);
+    double x = (high * 67108864.0 + low) * (1.0 / 9007199254740992.0)
+               * (double)sampler->size;
+    size_t index = (size_t)x;
+
+    if (index >= sampler->size) {
+        index = sampler->size - 1;
+    }
+    return x - (double)index < sampler->keep[index] ? index
+                                                    : sampler->alias[index];
+}
+
+static void sampler_task(void *context, size_t worker, size_t begin,
+                         size_t end) {
+    SamplerJob *job = context;
+    SamplerStream stream;
+    size_t block, i, last;
+
+    for (block = begin; block < end; block++) {
+        sampler_stream_seed(&stream, job->seed, block);
+        i = block * SAMPLER_BLOCK;
+        last = i + SAMPLER_BLOCK < job->shots ? i + SAMPLER_BLOCK : job->shots;
+        if (job->results != NULL) {
+            for (; i < last; i++) {
+                job->results[i] = sampler_draw(job->sampler, &stream);
+            }
+        } else {
+            for (; i < last; i++) {
+                job->counts[worker][sampler_draw(job->sampler, &stream)]++;
+            }
+        }
+    }
+}
+
+size_t sampler_size(Sampler *sampler) {
+    return sampler->size;
+}
+
+void sampler_sample(Sampler *sampler, size_t *results, size_t shots,
+                    unsigned long seed, ThreadPool *pool) {
+    SamplerJob job;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_SAMPLER_SAMPLE);
+    job.sampler = sampler;
+    job.shots = shots;
+    job.seed = seed;
+    job.results = results;
+    job.counts = NULL;
+    threadpool_parallel_for(pool, (shots + SAMPLER_BLOCK - 1) / SAMPLER_BLOCK,
+                            1, sampler_task, &job);
+    INSTRUMENT_END();
+}
+
+int sampler_histogram(Sampler *sampler, size_t *counts, size_t shots,
+                      unsigned long seed, ThreadPool *pool) {
+    const size_t threads = threadpool_threads(pool);
+    const size_t blocks = (shots + SAMPLER_BLOCK - 1) / SAMPLER_BLOCK;
+    size_t **histograms = NULL;
+    SamplerJob job;
+    size_t i, k;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_SAMPLER_HISTOGRAM);
+    histograms = calloc(threads, sizeof(size_t *));
+    if (histograms == NULL)
+        goto sampler_histogram_fail;
+    INSTRUMENT_BYTES(threads * sizeof(size_t *));
+    histograms[0] = counts;
+    memset(counts, 0, sampler->size * sizeof(size_t));
+    /* only the workers the pool gives a range of blocks need a histogram */
+    for (k = 1; k < threads; k++) {
+        if ((k + 1) * blocks / threads > k * blocks / threads) {
+            histograms[k] = calloc(sampler->size, sizeof(size_t));
+            if (histograms[k] == NULL)
+                goto sampler_histogram_fail;
+            INSTRUMENT_BYTES(sampler->size * sizeof(size_t));
+        }
+    }
+
+    job.sampler = sampler;
+    job.shots = shots;
+    job.seed = seed;
+    job.results = NULL;
+    job.counts = histograms;
+    threadpool_parallel_for(pool, blocks, 1, sampler_task, &job);
+
+    for (k = 1; k < threads; k++) {
+        if (histograms[k] != NULL) {
+            for (i = 0; i < sampler->size; i++) {
+                counts[i] += histograms[k][i];
+            }
+            free(histograms[k]);
+        }
+    }
+    free(histograms);
+    INSTRUMENT_END();
+    return 0;
+
+sampler_histogram_fail:
+    if (histograms != NULL) {
+        for (k = 1; k < threads; k++) {
+            free(histograms[k]);
+        }
+    }
+    free(histograms);
+    INSTRUMENT_END();
+    return -1;
+}
+
+Sampler *sampler_create(StateVector *state) {
+    Sampler *sampler = NULL;
+    size_t *work = NULL;
+    size_t size = statevector_size(state);
+    size_t small = 0, large = 0;
+    size_t i, s, l;
+    double total = 0;
+
+    sampler = malloc(sizeof(Sampler));
+    if (sampler == NULL)
+        goto sampler_create_fail;
+    sampler->size = size;
+    sampler->keep = malloc(size * sizeof(double));
+    sampler->alias = malloc(size * sizeof(size_t));
+    work = malloc(size * sizeof(size_t));
+    if (sampler->keep == NULL || sampler->alias == NULL || work == NULL)
+        goto sampler_create_fail;
+
+    for (i = 0; i < size; i++) {
+        sampler->keep[i] = MAT_T_ABS2(statevector_get(state, i));
+        total += sampler->keep[i];
+    }
+    if (total <= 0) {
+        report_logic_error("state has zero norm");
+    }
+
+    /* Vose's method: small entries fill up from the front of `work` and large
+     * ones from the back; each small entry is topped up by a large one */
+    for (i = 0; i < size; i++) {
+        sampler->keep[i] *= (double)size / total;
+        sampler->alias[i] = i;
+        if (sampler->keep[i] < 1) {
+            work[small++] = i;
+        } else {
+            work[size - ++large] = i;
+        }
+    }
+    while (small > 0 && large > 0) {
+        s = work[--small];
+        l = work[size - large--];
+        sampler->alias[s] = l;
+        sampler->keep[l] -= 1 - sampler->keep[s];
+        if (sampler->keep[l] < 1) {
+            work[small++] = l;
+        } else {
+            work[size - ++large] = l;
+        }
+    }
+    /* whatever is left is 1 up to rounding */
+    while (small > 0) {
+        sampler->keep[work[--small]] = 1;
+    }
+    while (large > 0) {
+        sampler->keep[work[size - large--]] = 1;
+    }
+
+    free(work);
+    return sampler;
+
+sampler_create_fail:
+    free(work);
+    sampler_destroy(sampler);
+    return NULL;
+}
+
+void sampler_destroy(Sampler *sampler) {
+    if (sampler != NULL) {
+        free(sampler->keep);
+        free(sampler->alias);
+        free(sampler);
+    }
+}
@@ -0,0 +1,413 @@
+#include "sparsematrix.h"
+#include "instrument_internal.h"
+#include "matrix_internal.h"
+#include "reporter.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* rows per block of work handed to a thread */
+#define SPARSEMATRIX_GRAIN 1024
+
+struct SparseMatrix {
+    size_t height;
+    size_t width;
+    size_t nonzeros;
+
+    /* row i holds values [row_offsets[i], row_offsets[i + 1]), sorted by
+     * their 0-indexed column */
+    size_t *row_offsets;
+    size_t *columns;
+    mat_t *values;
+};
+
+struct SparseMatrixBuilder {
+    size_t height;
+    size_t width;
+
+    /* 0-indexed coordinates of each entry, in insertion order */
+    size_t entries;
+    size_t capacity;
+    size_t *rows;
+    size_t *columns;
+    mat_t *values;
+};
+
+/**
+ * Arguments for the parallel product kernel.
+ */
+typedef struct SparseMatrixJob {
+    SparseMatrix *sparse;
+    const mat_t *x;
+    mat_t *y;
+} SparseMatrixJob;
+
+/**
+ * Multiply rows [`begin`, `end`) of the matrix by the job's `x`.
+ */
+static void sparsematrix_multiply_task(void *context, size_t worker,
+                                       size_t begin, size_t end);
+
+/**
+ * Create an empty `height` x `width` sparse matrix with room for `nonzeros`
+ * values.
+ * Return NULL on failure.
+ */
+static SparseMatrix *sparsematrix_allocate(size_t height, size_t width,
+                                           size_t nonzeros);
+
+int sparsematrixbuilder_add(SparseMatrixBuilder *builder, size_t row,
+                            size_t column, mat_t value) {
+    size_t capacity;
+    size_t *rows;
+    size_t *columns;
+    mat_t *values;
+
+    if (row == 0 || row > builder->height || column == 0
+        || column > builder->width) {
+        report_logic_error("sparse entry out of bounds");
+    }
+
+    if (builder->entries == builder->capacity) {
+        capacity = builder->capacity == 0 ? 16 : 2 * builder->capacity;
+        rows = realloc(builder->rows, capacity * sizeof(size_t));
+        if (rows == NULL)
+            goto sparsematrixbuilder_add_fail;
+        builder->rows = rows;
+        columns = realloc(builder->columns, capacity * sizeof(size_t));
+        if (columns == NULL)
+            goto sparsematrixbuilder_add_fail;
+        builder->columns = columns;
+        values = realloc(builder->values, capacity * sizeof(mat_t));
+        if (values == NULL)
+            goto sparsematrixbuilder_add_fail;
+        builder->values = values;
+        builder->capacity = capacity;
+    }
+
+    builder->rows[builder->entries] = row - 1;
+    builder->columns[builder->entries] = column - 1;
+    builder->values[builder->entries] = value;
+    builder->entries++;
+    return 0;
+sparsematrixbuilder_add_fail:
+    return -1;
+}
+
+size_t sparsematrixbuilder_entries(SparseMatrixBuilder *builder) {
+    return builder->entries;
+}
+
+SparseMatrixBuilder *sparsematrixbuilder_create(size_t height, size_t width,
+                                                size_t capacity) {
+    SparseMatrixBuilder *builder = calloc(1, sizeof(SparseMatrixBuilder));
+    if (builder == NULL)
+        goto sparsematrixbuilder_create_fail;
+    builder->height = height;
+    builder->width = width;
+
+    if (capacity > 0) {
+        builder->rows = malloc(capacity * sizeof(size_t));
+        builder->columns = malloc(capacity * sizeof(size_t));
+        builder->values = malloc(capacity * sizeof(mat_t));
+        if (builder->rows == NULL || builder->columns == NULL
+            || builder->values == NULL)
+            goto sparsematrixbuilder_create_fail;
+        builder->capacity = capacity;
+    }
+
+    return builder;
+sparsematrixbuilder_create_fail:
+    sparsematrixbuilder_destroy(builder);
+    return NULL;
+}
+
+void sparsematrixbuilder_destroy(SparseMatrixBuilder *builder) {
+    if (builder != NULL) {
+        free(builder->rows);
+        free(builder->columns);
+        free(builder->values);
+        free(builder);
+    }
+}
+
+size_t sparsematrix_height(SparseMatrix *sparse) { return sparse->height; }
+
+size_t sparsematrix_width(SparseMatrix *sparse) { return sparse->width; }
+
+size_t sparsematrix_nonzeros(SparseMatrix *sparse) {
+    return sparse->nonzeros;
+}
+
+mat_t sparsematrix_get(SparseMatrix *sparse, size_t row, size_t column) {
+    size_t low, high, middle;
+
+    if (row == 0 || row > sparse->height || column == 0
+        || column > sparse->width) {
+        report_logic_error("sparse index out of bounds");
+    }
+
+    /* binary search the row's sorted columns */
+    low = sparse->row_offsets[row - 1];
+    high = sparse->row_offsets[row];
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (sparse->columns[middle] < column - 1) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < sparse->row_offsets[row] && sparse->columns[low] == column - 1) {
+        return sparse->values[low];
+    }
+    return MAT_T_0;
+}
+
+static void sparsematrix_multiply_task(void *context, size_t worker,
+                                       size_t begin, size_t end) {
+    SparseMatrixJob *job = context;
+    const size_t *row_offsets = job->sparse->row_offsets;
+    const size_t *columns = job->sparse->columns;
+    const mat_t *values = job->sparse->values;
+    const mat_t *x = job->x;
+    mat_t sum;
+    size_t i, k;
+
+    (void)worker;
+    for (i = begin; i < end; i++) {
+        sum = MAT_T_0;
+        for (k = row_offsets[i]; k < row_offsets[i + 1]; k++) {
+            sum = MAT_T_ADD(sum, MAT_T_MUL(values[k], x[columns[k]]));
+        }
+        job->y[i] = sum;
+    }
+}
+
+void sparsematrix_multiply_vector(SparseMatrix *sparse, const mat_t *x,
+                                  mat_t *y) {
+    INSTRUMENT_BEGIN(INSTRUMENT_SPARSEMATRIX_MULTIPLY_VECTOR);
+    sparsematrix_multiply_vector_parallel(sparse, x, y, NULL);
+    INSTRUMENT_END();
+}
+
+void sparsematrix_multiply_vector_parallel(SparseMatrix *sparse,
+                                           const mat_t *x, mat_t *y,
+                                           ThreadPool *pool) {
+    SparseMatrixJob job;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_SPARSEMATRIX_MULTIPLY_VECTOR_PARALLEL);
+    job.sparse = sparse;
+    job.x = x;
+    job.y = y;
+    threadpool_parallel_for(pool, sparse->height, SPARSEMATRIX_GRAIN,
+                            sparsematrix_multiply_task, &job);
+    INSTRUMENT_FLOPS((double)sparse->nonzeros * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+}
+
+void sparsematrix_multiply_dense(Matrix *dest, SparseMatrix *a, Matrix *b) {
+    const size_t width = b->width;
+    mat_t *row;
+    mat_t value;
+    const mat_t *b_row;
+    size_t i, j, k;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_SPARSEMATRIX_MULTIPLY_DENSE);
+    if (a->width != b->height) {
+        report_logic_error("a's width must equal b's height to multiply");
+    }
+    if (dest->height != a->height || dest->width != width) {
+        report_logic_error("destination has wrong dimensions for product");
+    }
+    if (dest == b) {
+        report_logic_error("product destination must not be an operand");
+    }
+
+    /* each stored value scales one row of b into one row of dest */
+    for (i = 0; i < a->height; i++) {
+        row = dest->values + i * dest->stride;
+        for (j = 0; j < width; j++) {
+            row[j] = MAT_T_0;
+        }
+        for (k = a->row_offsets[i]; k < a->row_offsets[i + 1]; k++) {
+            value = a->values[k];
+            b_row = b->values + a->columns[k] * b->stride;
+            for (j = 0; j < width; j++) {
+                row[j] = MAT_T_ADD(row[j], MAT_T_MUL(value, b_row[j]));
+            }
+        }
+    }
+    INSTRUMENT_FLOPS((double)a->nonzeros * width * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+}
+
+Matrix *sparsematrix_to_dense(SparseMatrix *sparse) {
+    Matrix *matrix = matrix_create(sparse->height, sparse->width);
+    size_t i, k;
+
+    if (matrix == NULL)
+        return NULL;
+    for (i = 0; i < sparse->height; i++) {
+        for (k = sparse->row_offsets[i]; k < sparse->row_offsets[i + 1]; k++) {
+            matrix->values[i * sparse->width + sparse->columns[k]]
+                = sparse->values[k];
+        }
+    }
+    return matrix;
+}
+
+static SparseMatrix *sparsematrix_allocate(size_t height, size_t width,
+                                           size_t nonzeros) {
+    SparseMatrix *sparse = calloc(1, sizeof(SparseMatrix));
+    if (sparse == NULL)
+        goto sparsematrix_allocate_fail;
+    sparse->height = height;
+    sparse->width = width;
+    sparse->nonzeros = nonzeros;
+
+    sparse->row_offsets = calloc(height + 1, sizeof(size_t));
+    if (sparse->row_offsets == NULL)
+        goto sparsematrix_allocate_fail;
+    /* malloc(0) may return NULL, so always ask for at least one value */
+    sparse->columns = malloc((nonzeros > 0 ? nonzeros : 1) * sizeof(size_t));
+    if (sparse->columns == NULL)
+        goto sparsematrix_allocate_fail;
+    sparse->values = malloc((nonzeros > 0 ? nonzeros : 1) * sizeof(mat_t));
+    if (sparse->values == NULL)
+        goto sparsematrix_allocate_fail;
+
+    return sparse;
+sparsematrix_allocate_fail:
+    sparsematrix_destroy(sparse);
+    return NULL;
+}
+
+SparseMatrix *sparsematrix_create(SparseMatrixBuilder *builder) {
+    const size_t entries = builder->entries;
+    SparseMatrix *sparse = NULL;
+    size_t *counts = NULL;
+    size_t *order = NULL;
+    size_t *by_column = NULL;
+    size_t i, k, e, start, kept, total;
+
+    /* two stable counting sorts order the entries by row, then column,
+     * without comparing any of them */
+    counts = malloc(
+        ((builder->height > builder->width ? builder->height : builder->width)
+         + 1)
+        * sizeof(size_t));
+    if (counts == NULL)
+        goto sparsematrix_create_fail;
+    order = malloc((entries > 0 ? entries : 1) * sizeof(size_t));
+    if (order == NULL)
+        goto sparsematrix_create_fail;
+    by_column = malloc((entries > 0 ? entries : 1) * sizeof(size_t));
+    if (by_column == NULL)
+        goto sparsematrix_create_fail;
+
+    memset(counts, 0, (builder->width + 1) * sizeof(size_t));
+    for (e = 0; e < entries; e++) {
+        counts[builder->columns[e] + 1]++;
+    }
+    for (i = 0; i < builder->width; i++) {
+        counts[i + 1] += counts[i];
+    }
+    for (e = 0; e < entries; e++) {
+        by_column[counts[builder->columns[e]]++] = e;
+    }
+
+    memset(counts, 0, (builder->height + 1) * sizeof(size_t));
+    for (e = 0; e < entries; e++) {
+        counts[builder->rows[e] + 1]++;
+    }
+    for (i = 0; i < builder->height; i++) {
+        counts[i + 1] += counts[i];
+    }
+    for (k = 0; k < entries; k++) {
+        e = by_column[k];
+        order[counts[builder->rows[e]]++] = e;
+    }
+
+    /* duplicates are now adjacent; count the distinct positions */
+    total = 0;
+    for (k = 0; k < entries; k++) {
+        if (k == 0 || builder->rows[order[k]] != builder->rows[order[k - 1]]
+            || builder->columns[order[k]] != builder->columns[order[k - 1]]) {
+            total++;
+        }
+    }
+
+    sparse = sparsematrix_allocate(builder->height, builder->width, total);
+    if (sparse == NULL)
+        goto sparsematrix_create_fail;
+
+    kept = 0;
+    start = 0;
+    for (i = 0; i < builder->height; i++) {
+        sparse->row_offsets[i] = kept;
+        for (; start < entries && builder->rows[order[start]] == i; start++) {
+            e = order[start];
+            if (kept > sparse->row_offsets[i]
+                && sparse->columns[kept - 1] == builder->columns[e]) {
+                sparse->values[kept - 1]
+                    = MAT_T_ADD(sparse->values[kept - 1], builder->values[e]);
+            } else {
+                sparse->columns[kept] = builder->columns[e];
+                sparse->values[kept] = builder->values[e];
+                kept++;
+            }
+        }
+    }
+    sparse->row_offsets[builder->height] = kept;
+
+    free(counts);
+    free(order);
+    free(by_column);
+    return sparse;
+sparsematrix_create_fail:
+    free(counts);
+    free(order);
+    free(by_column);
+    sparsematrix_destroy(sparse);
+    return NULL;
+}
+
+SparseMatrix *sparsematrix_create_from_dense(Matrix *matrix) {
+    const size_t stride = matrix->stride;
+    SparseMatrix *sparse;
+    size_t i, j, nonzeros = 0, kept = 0;
+
+    for (i = 0; i < matrix->height; i++) {
+        for (j = 0; j < matrix->width; j++) {
+            if (MAT_T_ABS2(matrix->values[i * stride + j]) != 0.0) {
+                nonzeros++;
+            }
+        }
+    }
+
+    sparse = sparsematrix_allocate(matrix->height, matrix->width, nonzeros);
+    if (sparse == NULL)
+        return NULL;
+
+    for (i = 0; i < matrix->height; i++) {
+        sparse->row_offsets[i] = kept;
+        for (j = 0; j < matrix->width; j++) {
+            if (MAT_T_ABS2(matrix->values[i * stride + j]) != 0.0) {
+                sparse->columns[kept] = j;
+                sparse->values[kept] = matrix->values[i * stride + j];
+                kept++;
+            }
+        }
+    }
+    sparse->row_offsets[matrix->height] = kept;
+    return sparse;
+}
+
+void sparsematrix_destroy(SparseMatrix *sparse) {
+    if (sparse != NULL) {
+        free(sparse->row_offsets);
+        free(sparse->columns);
+        free(sparse->values);
+        free(sparse);
+    }
+}
@@ -0,0 +1,643 @@
+#include "statevector.h"
+#include "instrument_internal.h"
+#include "matrix_internal.h"
+#include "matrixfile.h"
+#include "reporter.h"
+#include "statevector_internal.h"
+#include <math.h>
+#include <stdlib.h>
+
+/* amplitudes per block of work handed to a thread; 64 KiB of complex values,
+ * and a whole number of pages so workers never share one */
+#define STATEVECTOR_BLOCK 4096
+
+/**
+ * Arguments for the parallel gate, norm and expectation kernels.
+ */
+typedef struct StateVectorJob {
+    StateVector *state;
+    mat_t gate[16];
+    /* sorted qubits to insert zero bits at */
+    size_t bits[STATEVECTOR_GATE_QUBITS];
+    size_t bit_ct;
+    /* bits set on every index the gate touches */
+    size_t control_bit;
+    size_t target;
+    size_t high_bit;
+    size_t low_bit;
+    /* a k-qubit gate, read in place, and the offset of each of its rows'
+     * amplitudes from the base index */
+    const mat_t *values;
+    size_t stride;
+    size_t dimension;
+    size_t offsets[1 << STATEVECTOR_GATE_QUBITS];
+} StateVectorJob;
+
+/**
+ * Copy the 2x2 `gate` into `entries`, row-first.
+ */
+static void statevector_load_1q_gate(Matrix *gate, mat_t *entries);
+
+/**
+ * Copy the 4x4 `gate` into `entries`, row-first.
+ */
+static void statevector_load_2q_gate(Matrix *gate, mat_t *entries);
+
+/**
+ * Insert a 0 bit into `index` at each of the `count` positions in `bits`,
+ * which must be sorted in increasing order.
+ */
+static size_t statevector_insert_zero_bits(size_t index, const size_t *bits,
+                                           size_t count);
+
+/**
+ * Sort `count` bit positions in increasing order.
+ */
+static void statevector_sort_bits(size_t *bits, size_t count);
+
+/**
+ * Apply a row-first 2x2 gate to the amplitude pair at `i0` and `i1`.
+ */
+static void statevector_update_pair(mat_t *amplitudes, const mat_t *gate,
+                                    size_t i0, size_t i1);
+
+/**
+ * Apply a row-first 4x4 gate to the amplitudes of `base` with qubits `high`
+ * and `low` set to each of 00, 01, 10, 11.
+ */
+static void statevector_update_quad(mat_t *amplitudes, const mat_t *gate,
+                                    size_t base, size_t high_bit,
+                                    size_t low_bit);
+
+/**
+ * Zero amplitudes [`begin`, `end`).
+ */
+static void statevector_zero_task(void *context, size_t worker, size_t begin,
+                                  size_t end);
+
+/**
+ * Apply an uncontrolled 2x2 gate to pairs [`begin`, `end`).
+ */
+static void statevector_apply_1q_task(void *context, size_t worker,
+                                      size_t begin, size_t end);
+
+/**
+ * Apply a controlled 2x2 gate to pairs [`begin`, `end`).
+ */
+static void statevector_apply_controlled_1q_task(void *context, size_t worker,
+                                                 size_t begin, size_t end);
+
+/**
+ * Apply a (possibly controlled) 4x4 gate to quads [`begin`, `end`).
+ */
+static void statevector_apply_2q_task(void *context, size_t worker,
+                                      size_t begin, size_t end);
+
+/**
+ * Apply a k-qubit gate to groups [`begin`, `end`) of 2^k amplitudes.
+ */
+static void statevector_apply_kq_task(void *context, size_t worker,
+                                      size_t begin, size_t end);
+
+/**
+ * Sum |amplitude|^2 over [`begin`, `end`) into the worker's partial.
+ */
+static void statevector_norm_task(void *context, size_t worker, size_t begin,
+                                  size_t end);
+
+/**
+ * Sum <pair| observable |pair> over pairs [`begin`, `end`) into the worker's
+ * partial.
+ */
+static void statevector_expectation_1q_task(void *context, size_t worker,
+                                            size_t begin, size_t end);
+
+/**
+ * Zero the workers' partials before a reduction, so workers given no range
+ * add nothing to the sum.
+ */
+static void statevector_clear_partials(StateVector *state);
+
+/**
+ * Sum the workers' partials.
+ */
+static mat_t statevector_sum_partials(StateVector *state);
+
+size_t statevector_qubits(StateVector *state) { return state->qubits; }
+
+size_t statevector_size(StateVector *state) { return state->size; }
+
+void statevector_set(StateVector *state, size_t index, mat_t value) {
+    if (index >= state->size) {
+        report_logic_error("index out of bounds");
+    }
+    state->amplitudes[index] = value;
+}
+
+mat_t statevector_get(StateVector *state, size_t index) {
+    if (index >= state->size) {
+        report_logic_error("index out of bounds");
+    }
+    return state->amplitudes[index];
+}
+
+static void statevector_load_1q_gate(Matrix *gate, mat_t *entries) {
+    size_t i, j;
+    if (matrix_height(gate) != 2 || matrix_width(gate) != 2) {
+        report_logic_error("one-qubit gate must be 2x2");
+    }
+    for (i = 1; i <= 2; i++) {
+        for (j = 1; j <= 2; j++) {
+            entries[(i - 1) * 2 + j - 1] = matrix_get(gate, i, j);
+        }
+    }
+}
+
+static void statevector_load_2q_gate(Matrix *gate, mat_t *entries) {
+    size_t i, j;
+    if (matrix_height(gate) != 4 || matrix_width(gate) != 4) {
+        report_logic_error("two-qubit gate must be 4x4");
+    }
+    for (i = 1; i <= 4; i++) {
+        for (j = 1; j <= 4; j++) {
+            entries[(i - 1) * 4 + j - 1] = matrix_get(gate, i, j);
+        }
+    }
+}
+
+static size_t statevector_insert_zero_bits(size_t index, const size_t *bits,
+                                           size_t count) {
+    size_t i, low_mask;
+    for (i = 0; i < count; i++) {
+        low_mask = ((size_t)1 << bits[i]) - 1;
+        index = ((index & ~low_mask) << 1) | (index & low_mask);
+    }
+    return index;
+}
+
+static void statevector_sort_bits(size_t *bits, size_t count) {
+    size_t i, j, temp;
+    for (i = 1; i < count; i++) {
+        for (j = i; j > 0 && bits[j - 1] > bits[j]; j--) {
+            temp = bits[j];
+            bits[j] = bits[j - 1];
+            bits[j - 1] = temp;
+        }
+    }
+}
+
+static void statevector_update_pair(mat_t *amplitudes, const mat_t *gate,
+                                    size_t i0, size_t i1) {
+    const mat_t a0 = amplitudes[i0];
+    const mat_t a1 = amplitudes[i1];
+    amplitudes[i0] = MAT_T_ADD(MAT_T_MUL(gate[0], a0), MAT_T_MUL(gate[1], a1));
+    amplitudes[i1] = MAT_T_ADD(MAT_T_MUL(gate[2], a0), MAT_T_MUL(gate[3], a1));
+}
+
+static void statevector_update_quad(mat_t *amplitudes, const mat_t *gate,
+                                    size_t base, size_t high_bit,
+                                    size_t low_bit) {
+    size_t indices[4];
+    mat_t in[4];
+    mat_t sum;
+    size_t i, j;
+
+    indices[0] = base;
+    indices[1] = base | low_bit;
+    indices[2] = base | high_bit;
+    indices[3] = base | high_bit | low_bit;
+
+    for (i = 0; i < 4; i++) {
+        in[i] = amplitudes[indices[i]];
+    }
+    for (i = 0; i < 4; i++) {
+        sum = MAT_T_0;
+        for (j = 0; j < 4; j++) {
+            sum = MAT_T_ADD(sum, MAT_T_MUL(gate[i * 4 + j], in[j]));
+        }
+        amplitudes[indices[i]] = sum;
+    }
+}
+
+static void statevector_zero_task(void *context, size_t worker, size_t begin,
+                                  size_t end) {
+    StateVector *state = context;
+    size_t i;
+    (void)worker;
+    for (i = begin; i < end; i++) {
+        state->amplitudes[i] = MAT_T_0;
+    }
+}
+
+static void statevector_apply_1q_task(void *context, size_t worker,
+                                      size_t begin, size_t end) {
+    StateVectorJob *job = context;
+    mat_t *amplitudes = job->state->amplitudes;
+    const size_t stride = (size_t)1 << job->target;
+    size_t k, low, run, i, j;
+    (void)worker;
+
+    /* pairs differ only in bit `target`, so walk contiguous runs of up to
+     * `stride` amplitudes against the run `stride` above them */
+    for (k = begin; k < end; k += run) {
+        low = k & (stride - 1);
+        run = stride - low < end - k ? stride - low : end - k;
+        i = ((k - low) << 1) | low;
+        for (j = i; j < i + run; j++) {
+            statevector_update_pair(amplitudes, job->gate, j, j + stride);
+        }
+    }
+}
+
+static void statevector_apply_controlled_1q_task(void *context, size_t worker,
+                                                 size_t begin, size_t end) {
+    StateVectorJob *job = context;
+    mat_t *amplitudes = job->state->amplitudes;
+    const size_t stride = (size_t)1 << job->target;
+    size_t k, i;
+    (void)worker;
+
+    for (k = begin; k < end; k++) {
+        i = statevector_insert_zero_bits(k, job->bits, job->bit_ct)
+            | job->control_bit;
+        statevector_update_pair(amplitudes, job->gate, i, i + stride);
+    }
+}
+
+static void statevector_apply_2q_task(void *context, size_t worker,
+                                      size_t begin, size_t end) {
+    StateVectorJob *job = context;
+    mat_t *amplitudes = job->state->amplitudes;
+    size_t k;
+    (void)worker;
+
+    for (k = begin; k < end; k++) {
+        statevector_update_quad(
+            amplitudes, job->gate,
+            statevector_insert_zero_bits(k, job->bits, job->bit_ct)
+                | job->control_bit,
+            job->high_bit, job->low_bit);
+    }
+}
+
+static void statevector_apply_kq_task(void *context, size_t worker,
+                                      size_t begin, size_t end) {
+    StateVectorJob *job = context;
+    mat_t *amplitudes = job->state->amplitudes;
+    const size_t dimension = job->dimension;
+    mat_t in[1 << STATEVECTOR_GATE_QUBITS];
+    const mat_t *row;
+    mat_t sum;
+    size_t k, base, i, j;
+    (void)worker;
+
+    for (k = begin; k < end; k++) {
+        base = statevector_insert_zero_bits(k, job->bits, job->bit_ct);
+        for (i = 0; i < dimension; i++) {
+            in[i] = amplitudes[base | job->offsets[i]];
+        }
+        for (i = 0; i < dimension; i++) {
+            row = job->values + i * job->stride;
+            sum = MAT_T_0;
+            for (j = 0; j < dimension; j++) {
+                sum = MAT_T_ADD(sum, MAT_T_MUL(row[j], in[j]));
+            }
+            amplitudes[base | job->offsets[i]] = sum;
+        }
+    }
+}
+
+static void statevector_norm_task(void *context, size_t worker, size_t begin,
+                                  size_t end) {
+    StateVector *state = context;
+    double sum = 0.0;
+    size_t i;
+    for (i = begin; i < end; i++) {
+        sum += MAT_T_ABS2(state->amplitudes[i]);
+    }
+    state->partials[worker] = MAT_T_ADD(state->partials[worker], MAT_T(sum));
+}
+
+static void statevector_expectation_1q_task(void *context, size_t worker,
+                                            size_t begin, size_t end) {
+    StateVectorJob *job = context;
+    const mat_t *amplitudes = job->state->amplitudes;
+    const size_t stride = (size_t)1 << job->target;
+    mat_t sum = MAT_T_0;
+    mat_t a0, a1;
+    size_t k, i;
+
+    for (k = begin; k < end; k++) {
+        i = statevector_insert_zero_bits(k, job->bits, 1);
+        a0 = amplitudes[i];
+        a1 = amplitudes[i + stride];
+        sum = MAT_T_ADD(
+            sum, MAT_T_MUL(MAT_T_CONJ(a0), MAT_T_ADD(MAT_T_MUL(job->gate[0], a0),
+                                                     MAT_T_MUL(job->gate[1], a1))));
+        sum = MAT_T_ADD(
+            sum, MAT_T_MUL(MAT_T_CONJ(a1), MAT_T_ADD(MAT_T_MUL(job->gate[2], a0),
+                                                     MAT_T_MUL(job->gate[3], a1))));
+    }
+    job->state->partials[worker] = MAT_T_ADD(job->state->partials[worker],
+                                             sum);
+}
+
+static void statevector_clear_partials(StateVector *state) {
+    size_t i;
+    for (i = 0; i < threadpool_threads(state->pool); i++) {
+        state->partials[i] = MAT_T_0;
+    }
+}
+
+static mat_t statevector_sum_partials(StateVector *state) {
+    mat_t sum = MAT_T_0;
+    size_t i;
+    for (i = 0; i < threadpool_threads(state->pool); i++) {
+        sum = MAT_T_ADD(sum, state->partials[i]);
+    }
+    return sum;
+}
+
+void statevector_apply_1q(StateVector *state, Matrix *gate, size_t target) {
+    StateVectorJob job;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_STATEVECTOR_APPLY_1Q);
+    if (target >= state->qubits) {
+        report_logic_error("target qubit out of bounds");
+    }
+    statevector_load_1q_gate(gate, job.gate);
+    job.state = state;
+    job.target = target;
+
+    threadpool_parallel_for(state->pool, state->size >> 1,
+                            STATEVECTOR_BLOCK >> 1, statevector_apply_1q_task,
+                            &job);
+    INSTRUMENT_FLOPS(2.0 * state->size * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+}
+
+void statevector_apply_controlled_1q(StateVector *state, Matrix *gate,
+                                     size_t control, size_t target) {
+    StateVectorJob job;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_STATEVECTOR_APPLY_CONTROLLED_1Q);
+    if (target >= state->qubits || control >= state->qubits) {
+        report_logic_error("qubit out of bounds");
+    }
+    if (control == target) {
+        report_logic_error("control qubit cannot be the target");
+    }
+    statevector_load_1q_gate(gate, job.gate);
+    job.state = state;
+    job.target = target;
+    job.control_bit = (size_t)1 << control;
+    job.bits[0] = control;
+    job.bits[1] = target;
+    job.bit_ct = 2;
+    statevector_sort_bits(job.bits, job.bit_ct);
+
+    threadpool_parallel_for(state->pool, state->size >> 2,
+                            STATEVECTOR_BLOCK >> 2,
+                            statevector_apply_controlled_1q_task, &job);
+    INSTRUMENT_FLOPS((double)state->size * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+}
+
+void statevector_apply_2q(StateVector *state, Matrix *gate, size_t high,
+                          size_t low) {
+    StateVectorJob job;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_STATEVECTOR_APPLY_2Q);
+    if (high >= state->qubits || low >= state->qubits) {
+        report_logic_error("qubit out of bounds");
+    }
+    if (high == low) {
+        report_logic_error("two-qubit gate needs two distinct qubits");
+    }
+    statevector_load_2q_gate(gate, job.gate);
+    job.state = state;
+    job.control_bit = 0;
+    job.high_bit = (size_t)1 << high;
+    job.low_bit = (size_t)1 << low;
+    job.bits[0] = high;
+    job.bits[1] = low;
+    job.bit_ct = 2;
+    statevector_sort_bits(job.bits, job.bit_ct);
+
+    threadpool_parallel_for(state->pool, state->size >> 2,
+                            STATEVECTOR_BLOCK >> 2, statevector_apply_2q_task,
+                            &job);
+    INSTRUMENT_FLOPS(4.0 * state->size * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+}
+
+void statevector_apply_controlled_2q(StateVector *state, Matrix *gate,
+                                     size_t control, size_t high, size_t low) {
+    StateVectorJob job;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_STATEVECTOR_APPLY_CONTROLLED_2Q);
+    if (high >= state->qubits || low >= state->qubits
+        || control >= state->qubits) {
+        report_logic_error("qubit out of bounds");
+    }
+    if (high == low || control == high || control == low) {
+        report_logic_error("controlled two-qubit gate needs three distinct "
+                           "qubits");
+    }
+    statevector_load_2q_gate(gate, job.gate);
+    job.state = state;
+    job.control_bit = (size_t)1 << control;
+    job.high_bit = (size_t)1 << high;
+    job.low_bit = (size_t)1 << low;
+    job.bits[0] = control;
+    job.bits[1] = high;
+    job.bits[2] = low;
+    job.bit_ct = 3;
+    statevector_sort_bits(job.bits, job.bit_ct);
+
+    threadpool_parallel_for(state->pool, state->size >> 3,
+                            STATEVECTOR_BLOCK >> 3, statevector_apply_2q_task,
+                            &job);
+    INSTRUMENT_FLOPS(2.0 * state->size * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+}
+
+void statevector_apply_kq(StateVector *state, Matrix *gate,
+                          const size_t *qubits, size_t count) {
+    StateVectorJob job;
+    size_t i, j;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_STATEVECTOR_APPLY_KQ);
+    if (count == 0 || count > STATEVECTOR_GATE_QUBITS) {
+        report_logic_error("gate must act on 1 to STATEVECTOR_GATE_QUBITS "
+                           "qubits");
+    }
+    if (gate->height != (size_t)1 << count
+        || gate->width != (size_t)1 << count) {
+        report_logic_error("gate on k qubits must be 2^k x 2^k");
+    }
+    for (i = 0; i < count; i++) {
+        if (qubits[i] >= state->qubits) {
+            report_logic_error("qubit out of bounds");
+        }
+        for (j = 0; j < i; j++) {
+            if (qubits[j] == qubits[i]) {
+                report_logic_error("gate qubits must be distinct");
+            }
+        }
+    }
+    job.state = state;
+    job.values = gate->values;
+    job.stride = gate->stride;
+    job.dimension = (size_t)1 << count;
+    for (i = 0; i < job.dimension; i++) {
+        job.offsets[i] = 0;
+        for (j = 0; j < count; j++) {
+            if ((i >> (count - 1 - j)) & 1) {
+                job.offsets[i] |= (size_t)1 << qubits[j];
+            }
+        }
+    }
+    for (i = 0; i < count; i++) {
+        job.bits[i] = qubits[i];
+    }
+    job.bit_ct = count;
+    statevector_sort_bits(job.bits, job.bit_ct);
+
+    threadpool_parallel_for(state->pool, state->size >> count,
+                            STATEVECTOR_BLOCK >> count,
+                            statevector_apply_kq_task, &job);
+    INSTRUMENT_FLOPS((double)state->size * job.dimension
+                     * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+}
+
+double statevector_norm(StateVector *state) {
+    double norm;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_STATEVECTOR_NORM);
+    statevector_clear_partials(state);
+    threadpool_parallel_for(state->pool, state->size, STATEVECTOR_BLOCK,
+                            statevector_norm_task, state);
+    norm = sqrt(MAT_T_REAL(statevector_sum_partials(state)));
+    INSTRUMENT_FLOPS((double)state->size * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+    return norm;
+}
+
+mat_t statevector_expectation_1q(StateVector *state, Matrix *observable,
+                                 size_t target) {
+    StateVectorJob job;
+    mat_t expectation;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_STATEVECTOR_EXPECTATION_1Q);
+    if (target >= state->qubits) {
+        report_logic_error("target qubit out of bounds");
+    }
+    statevector_load_1q_gate(observable, job.gate);
+    job.state = state;
+    job.target = target;
+    job.bits[0] = target;
+
+    statevector_clear_partials(state);
+    threadpool_parallel_for(state->pool, state->size >> 1,
+                            STATEVECTOR_BLOCK >> 1,
+                            statevector_expectation_1q_task, &job);
+    expectation = statevector_sum_partials(state);
+    INSTRUMENT_FLOPS(3.0 * state->size * INSTRUMENT_FMA_FLOPS);
+    INSTRUMENT_END();
+    return expectation;
+}
+
+int statevector_save(StateVector *state, const char *path) {
+    MatrixWriter *writer = matrixwriter_create(path, state->size, 1);
+
+    if (writer == NULL)
+        goto statevector_save_fail;
+    if (matrixwriter_write(writer, state->amplitudes, state->size) != 0
+        || matrixwriter_finish(writer) != 0)
+        goto statevector_save_fail;
+    matrixwriter_destroy(writer);
+    return 0;
+statevector_save_fail:
+    matrixwriter_destroy(writer);
+    return -1;
+}
+
+StateVector *statevector_create(size_t qubits) {
+    return statevector_create_parallel(qubits, NULL);
+}
+
+StateVector *statevector_create_parallel(size_t qubits, ThreadPool *pool) {
+    StateVector *state;
+
+    if (qubits >= sizeof(size_t) * 8) {
+        report_logic_error("too many qubits for this platform");
+    }
+
+    state = calloc(1, sizeof(StateVector));
+    if (state == NULL)
+        goto statevector_create_parallel_fail;
+
+    state->qubits = qubits;
+    state->size = (size_t)1 << qubits;
+    state->pool = pool;
+
+    state->partials = calloc(threadpool_threads(pool), sizeof(mat_t));
+    if (state->partials == NULL)
+        goto statevector_create_parallel_fail;
+
+    /* not calloc, so no page is touched before the workers zero their own
+     * blocks */
+    state->amplitudes = malloc(state->size * sizeof(mat_t));
+    if (state->amplitudes == NULL)
+        goto statevector_create_parallel_fail;
+    threadpool_parallel_for(pool, state->size, STATEVECTOR_BLOCK,
+                            statevector_zero_task, state);
+
+    state->amplitudes[0] = MAT_T_1;
+
+    return state;
+statevector_create_parallel_fail:
+    statevector_destroy(state);
+    return NULL;
+}
+
+StateVector *statevector_load(const char *path, ThreadPool *pool) {
+    MatrixReader *reader = NULL;
+    StateVector *state = NULL;
+    size_t size, qubits;
+
+    reader = matrixreader_create(path);
+    if (reader == NULL)
+        goto statevector_load_fail;
+    size = matrixreader_height(reader);
+    qubits = 0;
+    while (qubits + 1 < sizeof(size_t) * 8 && ((size_t)1 << qubits) < size) {
+        qubits++;
+    }
+    if (matrixreader_width(reader) != 1 || ((size_t)1 << qubits) != size) {
+        report_error("state file is not a 2^n x 1 matrix");
+        goto statevector_load_fail;
+    }
+
+    state = statevector_create_parallel(qubits, pool);
+    if (state == NULL)
+        goto statevector_load_fail;
+    if (matrixreader_read(reader, state->amplitudes, size) != 0)
+        goto statevector_load_fail;
+    matrixreader_destroy(reader);
+    return state;
+statevector_load_fail:
+    matrixreader_destroy(reader);
+    statevector_destroy(state);
+    return NULL;
+}
+
+void statevector_destroy(StateVector *state) {
+    if (state != NULL) {
+        free(state->amplitudes);
+        free(state->partials);
+        free(state);
+    }
+}
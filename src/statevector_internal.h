@@ -0,0 +1,20 @@
+#ifndef STATEVECTOR_INTERNAL_H
+#define STATEVECTOR_INTERNAL_H
+
+#include "statevector.h"
+#include "threadpool.h"
+
+/* layout shared by the simulators that move amplitudes in and out of a
+ * StateVector directly */
+struct StateVector {
+    size_t qubits;
+    size_t size;
+
+    mat_t *amplitudes;
+
+    ThreadPool *pool;
+    /* one slot per worker for reductions */
+    mat_t *partials;
+};
+
+#endif
@@ -0,0 +1,421 @@
+#include "tableau.h"
+#include "instrument_internal.h"
+#include "reporter.h"
+#include <limits.h>
+#include <stdlib.h>
+
+/* generator rows packed into each word of a column */
+#define TABLEAU_BITS (sizeof(unsigned long) * CHAR_BIT)
+
+struct Tableau {
+    size_t qubits;
+    /* words per half of a column */
+    size_t words;
+
+    /* column q of each holds the X (Z) bit of qubit q for every generator:
+     * destabilizer i at bit i of words [0, words), stabilizer i at bit i of
+     * words [words, 2 words), so a gate is a few XORs down two columns */
+    unsigned long *x;
+    unsigned long *z;
+    /* the sign bit of each generator, laid out like a column */
+    unsigned long *r;
+
+    /* measurement scratch: the rows to update and their phase mod 4 */
+    unsigned long *mask;
+    unsigned long *low;
+    unsigned long *high;
+
+    unsigned long seed;
+};
+
+/**
+ * Check that `qubit` is in the state.
+ */
+static void tableau_check(Tableau *tableau, size_t qubit);
+
+/**
+ * Get bit `row` of `column`.
+ */
+static bool tableau_bit(const unsigned long *column, size_t row);
+
+/**
+ * Set bit `row` of `column` to `value`.
+ */
+static void tableau_set_bit(unsigned long *column, size_t row, bool value);
+
+/**
+ * Count the bits set in `word`.
+ */
+static size_t tableau_popcount(unsigned long word);
+
+/**
+ * Get the XOR of bits 0 through k of `word` in each bit k.
+ */
+static unsigned long tableau_prefix(unsigned long word);
+
+/**
+ * For each bit, find whether multiplying the one-qubit Pauli (`x2`, `z2`) by
+ * (`x1`, `z1`) on the left adds i (`plus`) or -i (`minus`) to the phase.
+ */
+static void tableau_phase(unsigned long x1, unsigned long z1, unsigned long x2,
+                          unsigned long z2, unsigned long *plus,
+                          unsigned long *minus);
+
+/**
+ * Measure `qubit` when stabilizer row `p` anticommutes with Z on it: the
+ * outcome is random, and `p` is replaced by +/-Z on `qubit`.
+ */
+static int tableau_measure_random(Tableau *tableau, size_t qubit, size_t p);
+
+/**
+ * Measure `qubit` when every stabilizer commutes with Z on it: the outcome is
+ * the sign of the product of the stabilizers that make up Z on `qubit`.
+ */
+static int tableau_measure_deterministic(Tableau *tableau, size_t qubit);
+
+static void tableau_check(Tableau *tableau, size_t qubit) {
+    if (qubit >= tableau->qubits) {
+        report_logic_error("qubit out of bounds");
+    }
+}
+
+static bool tableau_bit(const unsigned long *column, size_t row) {
+    return (column[row / TABLEAU_BITS] >> (row % TABLEAU_BITS)) & 1UL;
+}
+
+static void tableau_set_bit(unsigned long *column, size_t row, bool value) {
+    const unsigned long bit = 1UL << (row % TABLEAU_BITS);
+
+    if (value) {
+        column[row / TABLEAU_BITS] |= bit;
+    } else {
+        column[row / TABLEAU_BITS] &= ~bit;
+    }
+}
+
+static size_t tableau_popcount(unsigned long word) {
+#ifdef __GNUC__
+    return (size_t)__builtin_popcountl(word);
+#else
+    size_t count = 0;
+
+    for (; word != 0; word &= word - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+static unsigned long tableau_prefix(unsigned long word) {
+    size_t shift;
+
+    for (shift = 1; shift < TABLEAU_BITS; shift <<= 1) {
+        word ^= word << shift;
+    }
+    return word;
+}
+
+static void tableau_phase(unsigned long x1, unsigned long z1, unsigned long x2,
+                          unsigned long z2, unsigned long *plus,
+                          unsigned long *minus) {
+    const unsigned long y = x1 & z1;
+    const unsigned long x = x1 & ~z1;
+    const unsigned long z = ~x1 & z1;
+
+    /* Aaronson and Gottesman's g: Y by (x2, z2) adds z2 - x2, X adds
+     * z2 (2 x2 - 1) and Z adds x2 (1 - 2 z2) */
+    *plus = (y & z2 & ~x2) | (x & x2 & z2) | (z & x2 & ~z2);
+    *minus = (y & x2 & ~z2) | (x & ~x2 & z2) | (z & x2 & z2);
+}
+
+static int tableau_measure_random(Tableau *tableau, size_t qubit, size_t p) {
+    const size_t height = 2 * tableau->words;
+    const size_t k = p - tableau->words * TABLEAU_BITS;
+    unsigned long *mask = tableau->mask;
+    unsigned long *low = tableau->low;
+    unsigned long *high = tableau->high;
+    unsigned long *x, *z;
+    unsigned long px, pz, plus, minus, sign;
+    size_t j, w;
+    int outcome;
+
+    /* multiply every other generator with X on `qubit` by row p, all rows
+     * at once, keeping their phases mod 4 in the bits of `low` and `high` */
+    for (w = 0; w < height; w++) {
+        mask[w] = tableau->x[qubit * height + w];
+        low[w] = 0;
+        high[w] = 0;
+    }
+    tableau_set_bit(mask, p, false);
+    for (j = 0; j < tableau->qubits; j++) {
+        x = tableau->x + j * height;
+        z = tableau->z + j * height;
+        px = tableau_bit(x, p) ? ~0UL : 0UL;
+        pz = tableau_bit(z, p) ? ~0UL : 0UL;
+        if (px == 0 && pz == 0) {
+            continue;
+        }
+        for (w = 0; w < height; w++) {
+            if (mask[w] == 0) {
+                continue;
+            }
+            tableau_phase(px, pz, x[w], z[w], &plus, &minus);
+            plus &= mask[w];
+            minus &= mask[w];
+            high[w] ^= low[w] & plus;
+            low[w] ^= plus;
+            high[w] ^= ~low[w] & minus;
+            low[w] ^= minus;
+            x[w] ^= px & mask[w];
+            z[w] ^= pz & mask[w];
+        }
+    }
+    /* the phases are even, so each sign flips with the sign of row p and
+     * the high bit of its count */
+    sign = tableau_bit(tableau->r, p) ? ~0UL : 0UL;
+    for (w = 0; w < height; w++) {
+        tableau->r[w] ^= (high[w] ^ sign) & mask[w];
+    }
+
+    /* row p moves to its destabilizer, and +/-Z on `qubit` takes its place */
+    tableau->seed = tableau->seed * 1103515245UL + 12345UL;
+    outcome = (int)((tableau->seed >> 16) & 1UL);
+    for (j = 0; j < tableau->qubits; j++) {
+        x = tableau->x + j * height;
+        z = tableau->z + j * height;
+        tableau_set_bit(x, k, tableau_bit(x, p));
+        tableau_set_bit(z, k, tableau_bit(z, p));
+        tableau_set_bit(x, p, false);
+        tableau_set_bit(z, p, j == qubit);
+    }
+    tableau_set_bit(tableau->r, k, tableau_bit(tableau->r, p));
+    tableau_set_bit(tableau->r, p, outcome != 0);
+    return outcome;
+}
+
+static int tableau_measure_deterministic(Tableau *tableau, size_t qubit) {
+    const size_t words = tableau->words;
+    const size_t height = 2 * words;
+    const unsigned long *destabilizers = tableau->x + qubit * height;
+    const unsigned long *x, *z;
+    unsigned long xs, zs, px, pz, carry_x, carry_z, plus, minus;
+    size_t total = 0;
+    size_t j, w;
+
+    /* Z on `qubit` is the product of stabilizer i for each destabilizer i
+     * with X on `qubit`; multiply them in order, one column at a time, the
+     * running product of a column being the XOR of the rows before */
+    for (w = 0; w < words; w++) {
+        total += 2 * tableau_popcount(tableau->r[words + w] & destabilizers[w]);
+    }
+    for (j = 0; j < tableau->qubits; j++) {
+        x = tableau->x + j * height + words;
+        z = tableau->z + j * height + words;
+        carry_x = 0;
+        carry_z = 0;
+        for (w = 0; w < words; w++) {
+            if (destabilizers[w] == 0) {
+                continue;
+            }
+            xs = x[w] & destabilizers[w];
+            zs = z[w] & destabilizers[w];
+            px = tableau_prefix(xs);
+            pz = tableau_prefix(zs);
+            tableau_phase(xs, zs, px ^ xs ^ carry_x, pz ^ zs ^ carry_z, &plus,
+                          &minus);
+            total += tableau_popcount(plus) + 3 * tableau_popcount(minus);
+            carry_x ^= px >> (TABLEAU_BITS - 1) ? ~0UL : 0UL;
+            carry_z ^= pz >> (TABLEAU_BITS - 1) ? ~0UL : 0UL;
+        }
+    }
+    return total % 4 == 2 ? 1 : 0;
+}
+
+void tableau_h(Tableau *tableau, size_t qubit) {
+    const size_t height = 2 * tableau->words;
+    unsigned long *x = tableau->x + qubit * height;
+    unsigned long *z = tableau->z + qubit * height;
+    unsigned long *r = tableau->r;
+    unsigned long swap;
+    size_t w;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_TABLEAU_H);
+    tableau_check(tableau, qubit);
+    for (w = 0; w < height; w++) {
+        r[w] ^= x[w] & z[w];
+        swap = x[w];
+        x[w] = z[w];
+        z[w] = swap;
+    }
+    INSTRUMENT_END();
+}
+
+void tableau_s(Tableau *tableau, size_t qubit) {
+    const size_t height = 2 * tableau->words;
+    unsigned long *x = tableau->x + qubit * height;
+    unsigned long *z = tableau->z + qubit * height;
+    unsigned long *r = tableau->r;
+    size_t w;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_TABLEAU_S);
+    tableau_check(tableau, qubit);
+    for (w = 0; w < height; w++) {
+        r[w] ^= x[w] & z[w];
+        z[w] ^= x[w];
+    }
+    INSTRUMENT_END();
+}
+
+void tableau_cnot(Tableau *tableau, size_t control, size_t target) {
+    const size_t height = 2 * tableau->words;
+    unsigned long *xa = tableau->x + control * height;
+    unsigned long *za = tableau->z + control * height;
+    unsigned long *xb = tableau->x + target * height;
+    unsigned long *zb = tableau->z + target * height;
+    unsigned long *r = tableau->r;
+    size_t w;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_TABLEAU_CNOT);
+    tableau_check(tableau, control);
+    tableau_check(tableau, target);
+    if (control == target) {
+        report_logic_error("control qubit cannot be the target");
+    }
+    for (w = 0; w < height; w++) {
+        r[w] ^= xa[w] & zb[w] & ~(xb[w] ^ za[w]);
+        xb[w] ^= xa[w];
+        za[w] ^= zb[w];
+    }
+    INSTRUMENT_END();
+}
+
+void tableau_x(Tableau *tableau, size_t qubit) {
+    const size_t height = 2 * tableau->words;
+    const unsigned long *z = tableau->z + qubit * height;
+    size_t w;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_TABLEAU_X);
+    tableau_check(tableau, qubit);
+    for (w = 0; w < height; w++) {
+        tableau->r[w] ^= z[w];
+    }
+    INSTRUMENT_END();
+}
+
+void tableau_y(Tableau *tableau, size_t qubit) {
+    const size_t height = 2 * tableau->words;
+    const unsigned long *x = tableau->x + qubit * height;
+    const unsigned long *z = tableau->z + qubit * height;
+    size_t w;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_TABLEAU_Y);
+    tableau_check(tableau, qubit);
+    for (w = 0; w < height; w++) {
+        tableau->r[w] ^= x[w] ^ z[w];
+    }
+    INSTRUMENT_END();
+}
+
+void tableau_z(Tableau *tableau, size_t qubit) {
+    const size_t height = 2 * tableau->words;
+    const unsigned long *x = tableau->x + qubit * height;
+    size_t w;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_TABLEAU_Z);
+    tableau_check(tableau, qubit);
+    for (w = 0; w < height; w++) {
+        tableau->r[w] ^= x[w];
+    }
+    INSTRUMENT_END();
+}
+
+int tableau_measure(Tableau *tableau, size_t qubit, bool *deterministic) {
+    const size_t words = tableau->words;
+    const unsigned long *x = tableau->x + qubit * 2 * words;
+    size_t w, bit;
+    int outcome;
+
+    INSTRUMENT_BEGIN(INSTRUMENT_TABLEAU_MEASURE);
+    tableau_check(tableau, qubit);
+    w = words;
+    while (w < 2 * words && x[w] == 0) {
+        w++;
+    }
+    if (deterministic != NULL) {
+        *deterministic = w == 2 * words;
+    }
+    if (w == 2 * words) {
+        outcome = tableau_measure_deterministic(tableau, qubit);
+    } else {
+        bit = 0;
+        while (!((x[w] >> bit) & 1UL)) {
+            bit++;
+        }
+        outcome = tableau_measure_random(tableau, qubit,
+                                         w * TABLEAU_BITS + bit);
+    }
+    INSTRUMENT_END();
+    return outcome;
+}
+
+size_t tableau_qubits(Tableau *tableau) { return tableau->qubits; }
+
+Tableau *tableau_create(size_t qubits, unsigned long seed) {
+    Tableau *tableau;
+    size_t height, q;
+
+    if (qubits == 0) {
+        report_logic_error("tableau needs at least one qubit");
+    }
+
+    tableau = calloc(1, sizeof(Tableau));
+    if (tableau == NULL)
+        goto tableau_create_fail;
+    tableau->qubits = qubits;
+    tableau->words = (qubits + TABLEAU_BITS - 1) / TABLEAU_BITS;
+    tableau->seed = seed;
+    height = 2 * tableau->words;
+
+    tableau->x = calloc(qubits * height, sizeof(unsigned long));
+    if (tableau->x == NULL)
+        goto tableau_create_fail;
+    tableau->z = calloc(qubits * height, sizeof(unsigned long));
+    if (tableau->z == NULL)
+        goto tableau_create_fail;
+    tableau->r = calloc(height, sizeof(unsigned long));
+    if (tableau->r == NULL)
+        goto tableau_create_fail;
+    tableau->mask = malloc(height * sizeof(unsigned long));
+    if (tableau->mask == NULL)
+        goto tableau_create_fail;
+    tableau->low = malloc(height * sizeof(unsigned long));
+    if (tableau->low == NULL)
+        goto tableau_create_fail;
+    tableau->high = malloc(height * sizeof(unsigned long));
+    if (tableau->high == NULL)
+        goto tableau_create_fail;
+
+    /* |0...0> is stabilized by each Z, with each X as its destabilizer */
+    for (q = 0; q < qubits; q++) {
+        tableau_set_bit(tableau->x + q * height, q, true);
+        tableau_set_bit(tableau->z + q * height,
+                        tableau->words * TABLEAU_BITS + q, true);
+    }
+
+    return tableau;
+tableau_create_fail:
+    tableau_destroy(tableau);
+    return NULL;
+}
+
+void tableau_destroy(Tableau *tableau) {
+    if (tableau != NULL) {
+        free(tableau->x);
+        free(tableau->z);
+        free(tableau->r);
+        free(tableau->mask);
+        free(tableau->low);
+        free(tableau->high);
+        free(tableau);
+    }
+}
@@ -1,7 +1,33 @@
+#include "circuit.h"
 #include "colors.h"
+#include "densitymatrix.h"
+#include "diskstate.h"
+#include "diststate.h"
+#include "eigen.h"
+#include "expm.h"
+#include "exponentialcache.h"
+#include "instrument.h"
+#include "kronoperator.h"
+#include "lanczos.h"
+#include "lufactor.h"
+#include "mat2.h"
+#include "mat4.h"
 #include "matrix.h"
+#include "matrixarena.h"
+#include "matrixfile.h"
+#include "matvec.h"
+#include "mps.h"
+#include "sampler.h"
+#include "sparsematrix.h"
+#include "statevector.h"
+#include "tableau.h"
+#include "threadpool.h"
+#include "transport.h"
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 /**
  * Assert two `mat_t` values are equal, and print a relevant status message.
@@ -18,6 +44,16 @@ int size_t_assert_equal(size_t a, size_t b);
  */
 int matrix_assert_equal(Matrix *a, Matrix *b);
 
+/**
+ * Fill a matrix with deterministic pseudo-random values.
+ */
+void matrix_fill_random(Matrix *matrix, unsigned long seed);
+
+/**
+ * Multiply `a` by `b` into `dest` element by element, as a reference.
+ */
+void matrix_multiply_reference(Matrix *dest, Matrix *a, Matrix *b);
+
 int mat_t_assert_equal(mat_t a, mat_t b) {
     bool success = MAT_T_EQ(a, b);
     if (success) {
@@ -70,6 +106,346 @@ int matrix_assert_equal(Matrix *a, Matrix *b) {
     return success ? 0 : -1;
 }
 
+void matrix_fill_random(Matrix *matrix, unsigned long seed) {
+    size_t i, j;
+    for (i = 1; i <= matrix_height(matrix); i++) {
+        for (j = 1; j <= matrix_width(matrix); j++) {
+            seed = seed * 1103515245UL + 12345UL;
+            matrix_set(matrix, i, j,
+                       MAT_T((double)((seed >> 16) & 0x7fff) / 16384.0 - 1.0));
+        }
+    }
+}
+
+void matrix_multiply_reference(Matrix *dest, Matrix *a, Matrix *b) {
+    size_t i, j, k;
+    mat_t sum;
+    for (i = 1; i <= matrix_height(a); i++) {
+        for (j = 1; j <= matrix_width(b); j++) {
+            sum = MAT_T_0;
+            for (k = 1; k <= matrix_width(a); k++) {
+                sum = MAT_T_ADD(sum, MAT_T_MUL(matrix_get(a, i, k),
+                                               matrix_get(b, k, j)));
+            }
+            matrix_set(dest, i, j, sum);
+        }
+    }
+}
+
+/**
+ * Create a matrix from `height` * `width` real values, row-first.
+ * Return NULL on failure.
+ */
+Matrix *matrix_create_from_values(size_t height, size_t width,
+                                  const double *values);
+
+/**
+ * Assert the amplitudes of `state` equal the column vector `expected`, and
+ * print a relevant status message.
+ */
+int statevector_assert_equal(StateVector *state, Matrix *expected);
+
+Matrix *matrix_create_from_values(size_t height, size_t width,
+                                  const double *values) {
+    size_t i, j;
+    Matrix *matrix = matrix_create(height, width);
+    if (matrix == NULL)
+        return NULL;
+    for (i = 1; i <= height; i++) {
+        for (j = 1; j <= width; j++) {
+            matrix_set(matrix, i, j, MAT_T(values[(i - 1) * width + j - 1]));
+        }
+    }
+    return matrix;
+}
+
+int statevector_assert_equal(StateVector *state, Matrix *expected) {
+    bool success = true;
+    size_t i;
+
+    if (statevector_size(state) != matrix_height(expected)) {
+        success = false;
+        printf(RED "Failure: sizes differ" RESET "\n");
+    }
+    for (i = 0; i < statevector_size(state) && success; i++) {
+        if (!MAT_T_EQ(statevector_get(state, i),
+                      matrix_get(expected, i + 1, 1))) {
+            success = false;
+            printf(RED "Failure: amplitudes differ at %lu" RESET "\n",
+                   (unsigned long)i);
+        }
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    }
+    return success ? 0 : -1;
+}
+
+/**
+ * Fill a square matrix with deterministic pseudo-random Hermitian values
+ * (complex ones, for complex `mat_t`).
+ * Return 0 on success, -1 on failure.
+ */
+int matrix_fill_random_hermitian(Matrix *matrix, unsigned long seed);
+
+int matrix_fill_random_hermitian(Matrix *matrix, unsigned long seed) {
+    const size_t n = matrix_width(matrix);
+    Matrix *random = matrix_create(n, n);
+    mat_t value;
+    size_t i, j;
+
+    if (random == NULL)
+        return -1;
+    matrix_fill_random(random, seed);
+    for (i = 1; i <= n; i++) {
+        for (j = 1; j <= i; j++) {
+            value = MAT_T_ADD(matrix_get(random, i, j),
+                              matrix_get(random, j, i));
+#ifdef MAT_T_COMPLEX
+            if (i != j) {
+                value = MAT_T_ADD(
+                    value, MAT_T_MUL(MAT_T_I, matrix_get(random, i, j)));
+            }
+#endif
+            matrix_set(matrix, i, j, value);
+            matrix_set(matrix, j, i, MAT_T_CONJ(value));
+        }
+    }
+    matrix_destroy(random);
+    return 0;
+}
+
+/**
+ * Add `entries` deterministic pseudo-random entries to `builder`, some of
+ * them at repeated positions.
+ * Return 0 on success, -1 on failure.
+ */
+int sparsematrixbuilder_fill_random(SparseMatrixBuilder *builder,
+                                    size_t height, size_t width,
+                                    size_t entries, unsigned long seed);
+
+int sparsematrixbuilder_fill_random(SparseMatrixBuilder *builder,
+                                    size_t height, size_t width,
+                                    size_t entries, unsigned long seed) {
+    size_t i, row, column;
+    for (i = 0; i < entries; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        row = (seed >> 8) % height + 1;
+        seed = seed * 1103515245UL + 12345UL;
+        column = (seed >> 8) % width + 1;
+        seed = seed * 1103515245UL + 12345UL;
+        if (sparsematrixbuilder_add(
+                builder, row, column,
+                MAT_T((double)((seed >> 16) & 0x7fff) / 16384.0 - 1.0))
+            != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * Create the Heisenberg Hamiltonian of a periodic chain of `sites` spins.
+ * Return NULL on failure.
+ */
+SparseMatrix *sparsematrix_create_heisenberg_chain(size_t sites);
+
+SparseMatrix *sparsematrix_create_heisenberg_chain(size_t sites) {
+    const size_t size = (size_t)1 << sites;
+    SparseMatrixBuilder *builder = sparsematrixbuilder_create(size, size, 0);
+    SparseMatrix *sparse = NULL;
+    double diagonal;
+    size_t state, site, next, flipped;
+
+    if (builder == NULL)
+        return NULL;
+    for (state = 0; state < size; state++) {
+        diagonal = 0.0;
+        for (site = 0; site < sites; site++) {
+            next = (site + 1) % sites;
+            if (((state >> site) & 1) == ((state >> next) & 1)) {
+                diagonal += 0.25;
+            } else {
+                diagonal -= 0.25;
+                flipped = state ^ ((size_t)1 << site) ^ ((size_t)1 << next);
+                if (sparsematrixbuilder_add(builder, state + 1, flipped + 1,
+                                            MAT_T(0.5))
+                    != 0)
+                    goto sparsematrix_create_heisenberg_chain_cleanup;
+            }
+        }
+        if (sparsematrixbuilder_add(builder, state + 1, state + 1,
+                                    MAT_T(diagonal))
+            != 0)
+            goto sparsematrix_create_heisenberg_chain_cleanup;
+    }
+    sparse = sparsematrix_create(builder);
+
+sparsematrix_create_heisenberg_chain_cleanup:
+    sparsematrixbuilder_destroy(builder);
+    return sparse;
+}
+
+/**
+ * Set `expected` to exp(`rate` * `t` * `matrix`) `psi` for a Hermitian
+ * `matrix`, through its eigendecomposition.
+ * Return 0 on success, -1 on failure.
+ */
+int expm_multiply_reference(Matrix *matrix, mat_t rate, double t,
+                            const mat_t *psi, mat_t *expected);
+
+int expm_multiply_reference(Matrix *matrix, mat_t rate, double t,
+                            const mat_t *psi, mat_t *expected) {
+    const size_t n = matrix_width(matrix);
+    Matrix *vectors = matrix_create(n, n);
+    double *values = malloc(n * sizeof(double));
+    mat_t coefficient;
+    size_t i, l;
+    int result = -1;
+
+    if (vectors == NULL || values == NULL
+        || eigen_hermitian(matrix, values, vectors) != 0)
+        goto expm_multiply_reference_cleanup;
+    for (i = 0; i < n; i++) {
+        expected[i] = MAT_T_0;
+    }
+    for (l = 1; l <= n; l++) {
+        coefficient = MAT_T_0;
+        for (i = 1; i <= n; i++) {
+            coefficient = MAT_T_ADD(
+                coefficient,
+                MAT_T_MUL(MAT_T_CONJ(matrix_get(vectors, i, l)), psi[i - 1]));
+        }
+        coefficient = MAT_T_MUL(
+            coefficient,
+            MAT_T_EXP(MAT_T_MUL(MAT_T(t * values[l - 1]), rate)));
+        for (i = 1; i <= n; i++) {
+            expected[i - 1] = MAT_T_ADD(
+                expected[i - 1],
+                MAT_T_MUL(matrix_get(vectors, i, l), coefficient));
+        }
+    }
+    result = 0;
+
+expm_multiply_reference_cleanup:
+    matrix_destroy(vectors);
+    free(values);
+    return result;
+}
+
+/**
+ * Compare two vectors of `size` values, relative to the norm of `expected`.
+ * Return 0 if they agree within `tolerance`, -1 otherwise.
+ */
+int vector_assert_close(const mat_t *expected, const mat_t *actual,
+                        size_t size, double tolerance);
+
+int vector_assert_close(const mat_t *expected, const mat_t *actual,
+                        size_t size, double tolerance) {
+    double norm = 0.0, difference = 0.0;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        norm += MAT_T_ABS2(expected[i]);
+        difference += MAT_T_ABS2(MAT_T_SUB(expected[i], actual[i]));
+    }
+    if (sqrt(difference) <= tolerance * sqrt(norm)) {
+        printf(GREEN "Success" RESET "\n");
+        return 0;
+    }
+    printf(RED "Failure: relative difference %g" RESET "\n",
+           sqrt(difference / norm));
+    return -1;
+}
+
+/**
+ * Assert two DensityMatrix objects are equal, and print a relevant status
+ * message.
+ * Return 0 if equal, -1 if not.
+ */
+int densitymatrix_assert_equal(DensityMatrix *expected, DensityMatrix *actual);
+
+int densitymatrix_assert_equal(DensityMatrix *expected,
+                               DensityMatrix *actual) {
+    bool success = true;
+    size_t i, j;
+
+    if (densitymatrix_size(expected) != densitymatrix_size(actual)) {
+        success = false;
+        printf(RED "Failure: sizes differ" RESET "\n");
+    }
+    for (i = 0; i < densitymatrix_size(expected) && success; i++) {
+        for (j = 0; j < densitymatrix_size(expected) && success; j++) {
+            if (!MAT_T_EQ(densitymatrix_get(expected, i, j),
+                          densitymatrix_get(actual, i, j))) {
+                success = false;
+                printf(RED "Failure: entries differ at (%lu, %lu)" RESET "\n",
+                       (unsigned long)i, (unsigned long)j);
+            }
+        }
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    }
+    return success ? 0 : -1;
+}
+
+/**
+ * Set `dest` to `u` * diag(`s`) * `v`^H, to check a singular value
+ * decomposition.
+ */
+void matrix_svd_reconstruct(Matrix *dest, Matrix *u, const double *s,
+                            Matrix *v);
+
+void matrix_svd_reconstruct(Matrix *dest, Matrix *u, const double *s,
+                            Matrix *v) {
+    mat_t sum;
+    size_t i, j, k;
+
+    for (i = 1; i <= matrix_height(dest); i++) {
+        for (j = 1; j <= matrix_width(dest); j++) {
+            sum = MAT_T_0;
+            for (k = 1; k <= matrix_width(u); k++) {
+                sum = MAT_T_ADD(
+                    sum, MAT_T_MUL(MAT_T_MUL(matrix_get(u, i, k),
+                                             MAT_T(s[k - 1])),
+                                   MAT_T_CONJ(matrix_get(v, j, k))));
+            }
+            matrix_set(dest, i, j, sum);
+        }
+    }
+}
+
+/**
+ * Check that the amplitudes of `state` are the column `expected`.
+ * Return 0 if they are, -1 otherwise.
+ */
+static int diskstate_assert_equal(DiskState *state, Matrix *expected);
+
+static int diskstate_assert_equal(DiskState *state, Matrix *expected) {
+    bool success = true;
+    mat_t value;
+    size_t i;
+
+    for (i = 0; i < matrix_height(expected) && success; i++) {
+        if (diskstate_get(state, i, &value) != 0
+            || !MAT_T_EQ(value, matrix_get(expected, i + 1, 1))) {
+            success = false;
+            printf(RED "Failure: amplitudes differ at %lu" RESET "\n",
+                   (unsigned long)i);
+        }
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    }
+    return success ? 0 : -1;
+}
+
+/**
+ * Test the `mat_t` arithmetic macros.
+ * Return # of failed test cases.
+ */
+int test_mat_t(void);
+
 /**
  * Test `matrix_width`.
  * Return # of failed test cases.
@@ -100,6 +476,18 @@ int test_matrix_is_diagonal(void);
  */
 int test_matrix_diagonalize(void);
 
+/**
+ * Test `matrix_multiply`.
+ * Return # of failed test cases.
+ */
+int test_matrix_multiply(void);
+
+/**
+ * Test `matrix_multiply_accumulate`.
+ * Return # of failed test cases.
+ */
+int test_matrix_multiply_accumulate(void);
+
 /**
  * Test `matrix_create_identity`.
  * Return # of failed test cases.
@@ -112,99 +500,441 @@ int test_matrix_create_identity(void);
  */
 int test_matrix_create(void);
 
-int test_matrix_width(void) {
-    const int test_ct = 2;
-    int tests_left = test_ct;
-    int tests_failed = 0;
-    Matrix *matrix;
+/**
+ * Test `statevector_create`.
+ * Return # of failed test cases.
+ */
+int test_statevector_create(void);
 
-    printf("Testing: matrix_width\n");
+/**
+ * Test `statevector_apply_1q`.
+ * Return # of failed test cases.
+ */
+int test_statevector_apply_1q(void);
 
-    printf("  1x1 matrix_width test: ");
-    matrix = matrix_create(1, 1);
-    if (matrix == NULL)
-        goto test_matrix_width_skip_remaining_tests;
-    tests_failed += size_t_assert_equal(1, matrix_width(matrix)) != 0 ? 1 : 0;
-    tests_left--;
-    matrix_destroy(matrix);
+/**
+ * Test `statevector_apply_controlled_1q`.
+ * Return # of failed test cases.
+ */
+int test_statevector_apply_controlled_1q(void);
 
-    printf("  1x2 matrix_width test: ");
-    matrix = matrix_create(1, 2);
-    if (matrix == NULL)
-        goto test_matrix_width_skip_remaining_tests;
-    tests_failed += size_t_assert_equal(2, matrix_width(matrix)) != 0 ? 1 : 0;
-    tests_left--;
-    matrix_destroy(matrix);
+/**
+ * Test `statevector_apply_2q`.
+ * Return # of failed test cases.
+ */
+int test_statevector_apply_2q(void);
 
-test_matrix_width_skip_remaining_tests:
-    printf("Failed: %i\n", tests_failed);
-    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
-    printf("Skipped: %i\n", tests_left);
+/**
+ * Test `statevector_apply_controlled_2q`.
+ * Return # of failed test cases.
+ */
+int test_statevector_apply_controlled_2q(void);
 
-    return tests_failed;
-}
+/**
+ * Test `threadpool_parallel_for`.
+ * Return # of failed test cases.
+ */
+int test_threadpool_parallel_for(void);
 
-int test_matrix_height(void) {
-    const int test_ct = 2;
-    int tests_left = test_ct;
-    int tests_failed = 0;
-    Matrix *matrix;
+/**
+ * Test `statevector_create_parallel`.
+ * Return # of failed test cases.
+ */
+int test_statevector_create_parallel(void);
 
-    printf("Testing: matrix_height\n");
+/**
+ * Test `statevector_norm`.
+ * Return # of failed test cases.
+ */
+int test_statevector_norm(void);
 
-    printf("  1x1 matrix_height test: ");
-    matrix = matrix_create(1, 1);
-    if (matrix == NULL)
-        goto test_matrix_height_skip_remaining_tests;
-    tests_failed += size_t_assert_equal(1, matrix_height(matrix)) != 0 ? 1 : 0;
-    tests_left--;
-    matrix_destroy(matrix);
+/**
+ * Test `statevector_expectation_1q`.
+ * Return # of failed test cases.
+ */
+int test_statevector_expectation_1q(void);
 
-    printf("  2x1 matrix_height test: ");
-    matrix = matrix_create(2, 1);
-    if (matrix == NULL)
-        goto test_matrix_height_skip_remaining_tests;
-    tests_failed += size_t_assert_equal(2, matrix_height(matrix)) != 0 ? 1 : 0;
-    tests_left--;
-    matrix_destroy(matrix);
+/**
+ * Test `lufactor_determinant`.
+ * Return # of failed test cases.
+ */
+int test_lufactor_determinant(void);
 
-test_matrix_height_skip_remaining_tests:
-    printf("Failed: %i\n", tests_failed);
-    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
-    printf("Skipped: %i\n", tests_left);
+/**
+ * Test `lufactor_solve`.
+ * Return # of failed test cases.
+ */
+int test_lufactor_solve(void);
 
-    return tests_failed;
-}
+/**
+ * Test `lufactor_inverse`.
+ * Return # of failed test cases.
+ */
+int test_lufactor_inverse(void);
 
-int test_matrix_determinant(void) {
-    const int test_ct = 4;
-    int tests_left = test_ct;
-    int tests_failed = 0;
-    Matrix *matrix;
+/**
+ * Test `eigen_hermitian`.
+ * Return # of failed test cases.
+ */
+int test_eigen_hermitian(void);
 
-    printf("Testing: matrix_determinant\n");
+/**
+ * Test `sparsematrix_create`.
+ * Return # of failed test cases.
+ */
+int test_sparsematrix_create(void);
 
-    printf("  1x1 matrix_determinant test: ");
-    matrix = matrix_create(1, 1);
-    if (matrix == NULL)
-        goto test_matrix_determinant_skip_remaining_tests;
-    matrix_set(matrix, 1, 1, MAT_T(3.0));
-    tests_failed += mat_t_assert_equal(3.0, matrix_determinant(matrix)) != 0 ? 1 : 0;
-    tests_left--;
-    matrix_destroy(matrix);
+/**
+ * Test `sparsematrix_multiply_vector`.
+ * Return # of failed test cases.
+ */
+int test_sparsematrix_multiply_vector(void);
 
-    printf("  2x2 matrix_determinant test 1: ");
-    matrix = matrix_create(2, 2);
-    if (matrix == NULL)
-        goto test_matrix_determinant_skip_remaining_tests;
+/**
+ * Test `sparsematrix_multiply_vector_parallel`.
+ * Return # of failed test cases.
+ */
+int test_sparsematrix_multiply_vector_parallel(void);
 
-    matrix_set(matrix, 1, 1, MAT_T(5.0));
-    matrix_set(matrix, 1, 2, MAT_T(2.0));
+/**
+ * Test `sparsematrix_create_from_dense`, `sparsematrix_to_dense` and
+ * `sparsematrix_multiply_dense`.
+ * Return # of failed test cases.
+ */
+int test_sparsematrix_dense(void);
+
+/**
+ * Test `lanczos_solve`.
+ * Return # of failed test cases.
+ */
+int test_lanczos_solve(void);
+
+/**
+ * Test `expm_multiply`.
+ * Return # of failed test cases.
+ */
+int test_expm_multiply(void);
+
+/**
+ * Test `matrix_exponential`.
+ * Return # of failed test cases.
+ */
+int test_matrix_exponential(void);
+
+/**
+ * Test `exponentialcache_get`.
+ * Return # of failed test cases.
+ */
+int test_exponentialcache_get(void);
+
+/**
+ * Test `matrix_create_view`, and other Matrix functions on views.
+ * Return # of failed test cases.
+ */
+int test_matrix_create_view(void);
+
+/**
+ * Test `matrix_row`, `matrix_column`, `matrix_copy_from_buffer` and
+ * `matrix_copy_to_buffer`.
+ * Return # of failed test cases.
+ */
+int test_matrix_copy_buffer(void);
+
+/**
+ * Test `matrix_kron`.
+ * Return # of failed test cases.
+ */
+int test_matrix_kron(void);
+
+/**
+ * Test `kronoperator_multiply_vector`.
+ * Return # of failed test cases.
+ */
+int test_kronoperator_multiply_vector(void);
+
+/**
+ * Test `matrixarena_allocate` and `matrixarena_reset`.
+ * Return # of failed test cases.
+ */
+int test_matrixarena_allocate(void);
+
+/**
+ * Test `matrix_create_in`, `matrix_clone_in` and `matrix_determinant_in`.
+ * Return # of failed test cases.
+ */
+int test_matrix_create_in(void);
+
+/**
+ * Test `mat2_multiply`, `mat2_determinant` and `mat2_inverse`.
+ * Return # of failed test cases.
+ */
+int test_mat2_multiply(void);
+
+/**
+ * Test `mat4_multiply`, `mat4_determinant` and `mat4_inverse`.
+ * Return # of failed test cases.
+ */
+int test_mat4_multiply(void);
+
+/**
+ * Test `mat4_kron`, `mat4_controlled`, `mat4_apply_high` and
+ * `mat4_apply_low`.
+ * Return # of failed test cases.
+ */
+int test_mat4_kron(void);
+
+/**
+ * Test `statevector_apply_kq`.
+ * Return # of failed test cases.
+ */
+int test_statevector_apply_kq(void);
+
+/**
+ * Test `circuit_compile` and `circuit_run`.
+ * Return # of failed test cases.
+ */
+int test_circuit_compile(void);
+
+/**
+ * Test `tableau_measure` after Clifford gates.
+ * Return # of failed test cases.
+ */
+int test_tableau_measure(void);
+
+/**
+ * Test `densitymatrix_apply_1q` and `densitymatrix_apply_2q`.
+ * Return # of failed test cases.
+ */
+int test_densitymatrix_apply_1q(void);
+
+/**
+ * Test `densitymatrix_depolarize`, `densitymatrix_amplitude_damp` and
+ * `densitymatrix_apply_kraus_1q`.
+ * Return # of failed test cases.
+ */
+int test_densitymatrix_depolarize(void);
+
+/**
+ * Test `densitymatrix_partial_trace`.
+ * Return # of failed test cases.
+ */
+int test_densitymatrix_partial_trace(void);
+
+/**
+ * Test `sampler_sample` and `sampler_histogram`.
+ * Return # of failed test cases.
+ */
+int test_sampler_sample(void);
+
+/**
+ * Test `matrix_svd`.
+ * Return # of failed test cases.
+ */
+int test_matrix_svd(void);
+
+/**
+ * Test `mps_apply_1q` and `mps_apply_2q`.
+ * Return # of failed test cases.
+ */
+int test_mps_apply_2q(void);
+
+/**
+ * Test `matrix_qr`.
+ * Return # of failed test cases.
+ */
+int test_matrix_qr(void);
+
+/**
+ * Test the instrumentation counters and `instrumentsnapshot_dump`.
+ * Return # of failed test cases.
+ */
+int test_instrument(void);
+
+/**
+ * Test `matrix_save`, `matrix_load`, `matrix_map` and the state and chunked
+ * writes built on them.
+ * Return # of failed test cases.
+ */
+int test_matrix_save(void);
+
+/**
+ * Test `diskstate_run` and `diskstate_reorder` against `circuit_run`.
+ * Return # of failed test cases.
+ */
+int test_diskstate_run(void);
+
+/**
+ * Test `diststate_run` over forked local ranks against `circuit_run`.
+ * Return # of failed test cases.
+ */
+int test_diststate_run(void);
+
+int test_mat_t(void) {
+#ifdef MAT_T_COMPLEX
+    const int test_ct = 6;
+#else
+    const int test_ct = 3;
+#endif
+    int tests_left = test_ct;
+    int tests_failed = 0;
+
+    printf("Testing: mat_t\n");
+
+    printf("  mat_t multiply test: ");
+    tests_failed += mat_t_assert_equal(MAT_T(-6.0),
+                                       MAT_T_MUL(MAT_T(2.0), MAT_T(-3.0)))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    printf("  mat_t divide test: ");
+    tests_failed += mat_t_assert_equal(MAT_T(-0.5),
+                                       MAT_T_DIV(MAT_T(2.0), MAT_T(-4.0)))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    printf("  mat_t exponential test: ");
+    tests_failed += mat_t_assert_equal(MAT_T(1.0), MAT_T_EXP(MAT_T(0.0))) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+#ifdef MAT_T_COMPLEX
+    /* (1 + 2i)(3 - i) = 5 + 5i */
+    printf("  complex mat_t multiply test: ");
+    tests_failed += mat_t_assert_equal(mat_t_complex(5.0, 5.0),
+                                       MAT_T_MUL(mat_t_complex(1.0, 2.0),
+                                                 mat_t_complex(3.0, -1.0)))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    /* (5 + 5i) / (1 + 2i) = 3 - i */
+    printf("  complex mat_t divide test: ");
+    tests_failed += mat_t_assert_equal(
+                        MAT_T_CONJ(mat_t_complex(3.0, 1.0)),
+                        MAT_T_DIV(mat_t_complex(5.0, 5.0),
+                                  mat_t_complex(1.0, 2.0)))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    /* exp(ln 2 + i pi / 2) = 2i */
+    printf("  complex mat_t exponential test: ");
+    tests_failed += mat_t_assert_equal(
+                        mat_t_complex(0.0, 2.0),
+                        MAT_T_EXP(mat_t_complex(log(2.0), 2.0 * atan(1.0))))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+#endif
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_width(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix;
+
+    printf("Testing: matrix_width\n");
+
+    printf("  1x1 matrix_width test: ");
+    matrix = matrix_create(1, 1);
+    if (matrix == NULL)
+        goto test_matrix_width_skip_remaining_tests;
+    tests_failed += size_t_assert_equal(1, matrix_width(matrix)) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+
+    printf("  1x2 matrix_width test: ");
+    matrix = matrix_create(1, 2);
+    if (matrix == NULL)
+        goto test_matrix_width_skip_remaining_tests;
+    tests_failed += size_t_assert_equal(2, matrix_width(matrix)) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+
+test_matrix_width_skip_remaining_tests:
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_height(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix;
+
+    printf("Testing: matrix_height\n");
+
+    printf("  1x1 matrix_height test: ");
+    matrix = matrix_create(1, 1);
+    if (matrix == NULL)
+        goto test_matrix_height_skip_remaining_tests;
+    tests_failed += size_t_assert_equal(1, matrix_height(matrix)) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+
+    printf("  2x1 matrix_height test: ");
+    matrix = matrix_create(2, 1);
+    if (matrix == NULL)
+        goto test_matrix_height_skip_remaining_tests;
+    tests_failed += size_t_assert_equal(2, matrix_height(matrix)) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+
+test_matrix_height_skip_remaining_tests:
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_determinant(void) {
+    const int test_ct = 5;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix;
+
+    printf("Testing: matrix_determinant\n");
+
+    printf("  1x1 matrix_determinant test: ");
+    matrix = matrix_create(1, 1);
+    if (matrix == NULL)
+        goto test_matrix_determinant_skip_remaining_tests;
+    matrix_set(matrix, 1, 1, MAT_T(3.0));
+    tests_failed += mat_t_assert_equal(MAT_T(3.0), matrix_determinant(matrix)) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+
+    printf("  2x2 matrix_determinant test 1: ");
+    matrix = matrix_create(2, 2);
+    if (matrix == NULL)
+        goto test_matrix_determinant_skip_remaining_tests;
+
+    matrix_set(matrix, 1, 1, MAT_T(5.0));
+    matrix_set(matrix, 1, 2, MAT_T(2.0));
 
     matrix_set(matrix, 2, 1, MAT_T(4.0));
     matrix_set(matrix, 2, 2, MAT_T(3.0));
 
-    tests_failed += mat_t_assert_equal(7.0, matrix_determinant(matrix)) != 0 ? 1 : 0;
+    tests_failed += mat_t_assert_equal(MAT_T(7.0), matrix_determinant(matrix)) != 0 ? 1 : 0;
     tests_left--;
     matrix_destroy(matrix);
 
@@ -219,7 +949,7 @@ int test_matrix_determinant(void) {
     matrix_set(matrix, 2, 1, MAT_T(4.0));
     matrix_set(matrix, 2, 2, MAT_T(0.0));
 
-    tests_failed += mat_t_assert_equal(-8.0, matrix_determinant(matrix)) != 0 ? 1 : 0;
+    tests_failed += mat_t_assert_equal(MAT_T(-8.0), matrix_determinant(matrix)) != 0 ? 1 : 0;
     tests_left--;
     matrix_destroy(matrix);
 
@@ -240,7 +970,23 @@ int test_matrix_determinant(void) {
     matrix_set(matrix, 3, 2, MAT_T(5.0));
     matrix_set(matrix, 3, 3, MAT_T(4.0));
 
-    tests_failed += mat_t_assert_equal(25.0, matrix_determinant(matrix)) != 0 ? 1 : 0;
+    tests_failed += mat_t_assert_equal(MAT_T(25.0), matrix_determinant(matrix)) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+
+    /* a pivot below MAT_T_PRECISION is small, not zero */
+    printf("  widely scaled matrix_determinant test: ");
+    matrix = matrix_create(2, 2);
+    if (matrix == NULL)
+        goto test_matrix_determinant_skip_remaining_tests;
+
+    matrix_set(matrix, 1, 1, MAT_T(1e-11));
+    matrix_set(matrix, 1, 2, MAT_T(0.0));
+
+    matrix_set(matrix, 2, 1, MAT_T(0.0));
+    matrix_set(matrix, 2, 2, MAT_T(1e11));
+
+    tests_failed += mat_t_assert_equal(MAT_T_1, matrix_determinant(matrix)) != 0 ? 1 : 0;
     tests_left--;
     matrix_destroy(matrix);
 
@@ -456,30 +1202,188 @@ test_matrix_diagonalize_skip_remaining_tests:
     
 }
 
-int test_matrix_create_identity(void) {
-    const int test_ct = 2;
+int test_matrix_multiply(void) {
+    const int test_ct = 3;
     int tests_left = test_ct;
     int tests_failed = 0;
+    Matrix *a = NULL;
+    Matrix *b = NULL;
+    Matrix *product = NULL;
+    Matrix *expected = NULL;
 
-    Matrix *matrix1;
-    Matrix *matrix2;
-    printf("Testing: matrix_create_identity\n");
-    printf("  1x1 matrix_create_identity test: ");
-    matrix1 = matrix_create_identity(1);
-    if (matrix1 == NULL) {
-        printf(RED "Failure: could not create" RESET "\n");
-        tests_failed++;
-    } else {
-        tests_failed
-            += mat_t_assert_equal(matrix_get(matrix1, 1, 1), MAT_T_1) != 0 ? 1
-                                                                           : 0;
-        matrix_destroy(matrix1);
-    }
+    printf("Testing: matrix_multiply\n");
+
+    printf("  2x2 matrix_multiply test: ");
+    a = matrix_create(2, 2);
+    b = matrix_create(2, 2);
+    product = matrix_create(2, 2);
+    expected = matrix_create(2, 2);
+    if (a == NULL || b == NULL || product == NULL || expected == NULL)
+        goto test_matrix_multiply_skip_remaining_tests;
+
+    matrix_set(a, 1, 1, MAT_T(1.0));
+    matrix_set(a, 1, 2, MAT_T(2.0));
+    matrix_set(a, 2, 1, MAT_T(3.0));
+    matrix_set(a, 2, 2, MAT_T(4.0));
+
+    matrix_set(b, 1, 1, MAT_T(5.0));
+    matrix_set(b, 1, 2, MAT_T(6.0));
+    matrix_set(b, 2, 1, MAT_T(7.0));
+    matrix_set(b, 2, 2, MAT_T(8.0));
+
+    matrix_set(expected, 1, 1, MAT_T(19.0));
+    matrix_set(expected, 1, 2, MAT_T(22.0));
+    matrix_set(expected, 2, 1, MAT_T(43.0));
+    matrix_set(expected, 2, 2, MAT_T(50.0));
+
+    if (matrix_multiply(product, a, b) != 0)
+        goto test_matrix_multiply_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(expected, product) != 0 ? 1 : 0;
     tests_left--;
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(product);
+    matrix_destroy(expected);
 
-    printf("  3x3 matrix_create_identity test: ");
-    matrix1 = matrix_create_identity(3);
-    matrix2 = matrix_create(3, 3);
+    printf("  2x3 by 3x1 matrix_multiply test: ");
+    a = matrix_create(2, 3);
+    b = matrix_create(3, 1);
+    product = matrix_create(2, 1);
+    expected = matrix_create(2, 1);
+    if (a == NULL || b == NULL || product == NULL || expected == NULL)
+        goto test_matrix_multiply_skip_remaining_tests;
+
+    matrix_set(a, 1, 1, MAT_T(1.0));
+    matrix_set(a, 1, 2, MAT_T(0.0));
+    matrix_set(a, 1, 3, MAT_T(-1.0));
+    matrix_set(a, 2, 1, MAT_T(2.0));
+    matrix_set(a, 2, 2, MAT_T(3.0));
+    matrix_set(a, 2, 3, MAT_T(4.0));
+
+    matrix_set(b, 1, 1, MAT_T(1.0));
+    matrix_set(b, 2, 1, MAT_T(2.0));
+    matrix_set(b, 3, 1, MAT_T(3.0));
+
+    matrix_set(expected, 1, 1, MAT_T(-2.0));
+    matrix_set(expected, 2, 1, MAT_T(20.0));
+
+    if (matrix_multiply(product, a, b) != 0)
+        goto test_matrix_multiply_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(expected, product) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(product);
+    matrix_destroy(expected);
+
+    /* spans several cache blocks with ragged edges */
+    printf("  70x300 by 300x530 matrix_multiply test: ");
+    a = matrix_create(70, 300);
+    b = matrix_create(300, 530);
+    product = matrix_create(70, 530);
+    expected = matrix_create(70, 530);
+    if (a == NULL || b == NULL || product == NULL || expected == NULL)
+        goto test_matrix_multiply_skip_remaining_tests;
+
+    matrix_fill_random(a, 1);
+    matrix_fill_random(b, 2);
+    matrix_multiply_reference(expected, a, b);
+
+    if (matrix_multiply(product, a, b) != 0)
+        goto test_matrix_multiply_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(expected, product) != 0 ? 1 : 0;
+    tests_left--;
+
+test_matrix_multiply_skip_remaining_tests:
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(product);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_multiply_accumulate(void) {
+    const int test_ct = 1;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *a = NULL;
+    Matrix *b = NULL;
+    Matrix *product = NULL;
+    Matrix *expected = NULL;
+
+    printf("Testing: matrix_multiply_accumulate\n");
+
+    printf("  2x2 matrix_multiply_accumulate test: ");
+    a = matrix_create(2, 2);
+    b = matrix_create(2, 2);
+    product = matrix_create_identity(2);
+    expected = matrix_create(2, 2);
+    if (a == NULL || b == NULL || product == NULL || expected == NULL)
+        goto test_matrix_multiply_accumulate_skip_remaining_tests;
+
+    matrix_set(a, 1, 1, MAT_T(1.0));
+    matrix_set(a, 1, 2, MAT_T(2.0));
+    matrix_set(a, 2, 1, MAT_T(3.0));
+    matrix_set(a, 2, 2, MAT_T(4.0));
+
+    matrix_set(b, 1, 1, MAT_T(0.0));
+    matrix_set(b, 1, 2, MAT_T(1.0));
+    matrix_set(b, 2, 1, MAT_T(1.0));
+    matrix_set(b, 2, 2, MAT_T(0.0));
+
+    /* I + 2 * A * B */
+    matrix_set(expected, 1, 1, MAT_T(5.0));
+    matrix_set(expected, 1, 2, MAT_T(2.0));
+    matrix_set(expected, 2, 1, MAT_T(8.0));
+    matrix_set(expected, 2, 2, MAT_T(7.0));
+
+    if (matrix_multiply_accumulate(product, MAT_T(2.0), a, b) != 0)
+        goto test_matrix_multiply_accumulate_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(expected, product) != 0 ? 1 : 0;
+    tests_left--;
+
+test_matrix_multiply_accumulate_skip_remaining_tests:
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(product);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_create_identity(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+
+    Matrix *matrix1;
+    Matrix *matrix2;
+    printf("Testing: matrix_create_identity\n");
+    printf("  1x1 matrix_create_identity test: ");
+    matrix1 = matrix_create_identity(1);
+    if (matrix1 == NULL) {
+        printf(RED "Failure: could not create" RESET "\n");
+        tests_failed++;
+    } else {
+        tests_failed
+            += mat_t_assert_equal(matrix_get(matrix1, 1, 1), MAT_T_1) != 0 ? 1
+                                                                           : 0;
+        matrix_destroy(matrix1);
+    }
+    tests_left--;
+
+    printf("  3x3 matrix_create_identity test: ");
+    matrix1 = matrix_create_identity(3);
+    matrix2 = matrix_create(3, 3);
     matrix_set(matrix2, 1, 1, MAT_T_1);
     matrix_set(matrix2, 2, 2, MAT_T_1);
     matrix_set(matrix2, 3, 3, MAT_T_1);
@@ -538,8 +1442,3625 @@ int test_matrix_create(void) {
     return tests_failed;
 }
 
+static const double pauli_x_values[] = {0.0, 1.0, 1.0, 0.0};
+
+static const double hadamard_values[] = {
+    0.70710678118654752, 0.70710678118654752, 0.70710678118654752,
+    -0.70710678118654752};
+
+static const double swap_values[] = {1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0,
+                                     0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0};
+
+int test_statevector_create(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state;
+    Matrix *expected = NULL;
+
+    printf("Testing: statevector_create\n");
+
+    printf("  3 qubit statevector_create size test: ");
+    state = statevector_create(3);
+    if (state == NULL)
+        goto test_statevector_create_skip_remaining_tests;
+    tests_failed += size_t_assert_equal(8, statevector_size(state)) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  3 qubit statevector_create amplitude test: ");
+    expected = matrix_create(8, 1);
+    if (expected == NULL)
+        goto test_statevector_create_skip_remaining_tests;
+    matrix_set(expected, 1, 1, MAT_T_1);
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_statevector_create_skip_remaining_tests:
+    statevector_destroy(state);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_statevector_apply_1q(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state = NULL;
+    Matrix *gate = NULL;
+    Matrix *expected = NULL;
+
+    printf("Testing: statevector_apply_1q\n");
+
+    printf("  2 qubit X statevector_apply_1q test: ");
+    state = statevector_create(2);
+    gate = matrix_create_from_values(2, 2, pauli_x_values);
+    expected = matrix_create(4, 1);
+    if (state == NULL || gate == NULL || expected == NULL)
+        goto test_statevector_apply_1q_skip_remaining_tests;
+    statevector_apply_1q(state, gate, 1);
+    matrix_set(expected, 3, 1, MAT_T_1);
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+    statevector_destroy(state);
+    matrix_destroy(gate);
+    matrix_destroy(expected);
+
+    printf("  2 qubit H statevector_apply_1q test: ");
+    state = statevector_create(2);
+    gate = matrix_create_from_values(2, 2, hadamard_values);
+    expected = matrix_create(4, 1);
+    if (state == NULL || gate == NULL || expected == NULL)
+        goto test_statevector_apply_1q_skip_remaining_tests;
+    statevector_apply_1q(state, gate, 0);
+    matrix_set(expected, 1, 1, MAT_T(0.70710678118654752));
+    matrix_set(expected, 2, 1, MAT_T(0.70710678118654752));
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_statevector_apply_1q_skip_remaining_tests:
+    statevector_destroy(state);
+    matrix_destroy(gate);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_statevector_apply_controlled_1q(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state = NULL;
+    Matrix *hadamard = NULL;
+    Matrix *pauli_x = NULL;
+    Matrix *expected = NULL;
+
+    printf("Testing: statevector_apply_controlled_1q\n");
+
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    pauli_x = matrix_create_from_values(2, 2, pauli_x_values);
+    if (hadamard == NULL || pauli_x == NULL)
+        goto test_statevector_apply_controlled_1q_skip_remaining_tests;
+
+    printf("  unset control statevector_apply_controlled_1q test: ");
+    state = statevector_create(2);
+    expected = matrix_create(4, 1);
+    if (state == NULL || expected == NULL)
+        goto test_statevector_apply_controlled_1q_skip_remaining_tests;
+    statevector_apply_controlled_1q(state, pauli_x, 1, 0);
+    matrix_set(expected, 1, 1, MAT_T_1);
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+    statevector_destroy(state);
+    matrix_destroy(expected);
+
+    printf("  Bell state statevector_apply_controlled_1q test: ");
+    state = statevector_create(2);
+    expected = matrix_create(4, 1);
+    if (state == NULL || expected == NULL)
+        goto test_statevector_apply_controlled_1q_skip_remaining_tests;
+    statevector_apply_1q(state, hadamard, 0);
+    statevector_apply_controlled_1q(state, pauli_x, 0, 1);
+    matrix_set(expected, 1, 1, MAT_T(0.70710678118654752));
+    matrix_set(expected, 4, 1, MAT_T(0.70710678118654752));
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_statevector_apply_controlled_1q_skip_remaining_tests:
+    statevector_destroy(state);
+    matrix_destroy(hadamard);
+    matrix_destroy(pauli_x);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_statevector_apply_2q(void) {
+    const int test_ct = 1;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state = NULL;
+    Matrix *gate = NULL;
+    Matrix *expected = NULL;
+
+    printf("Testing: statevector_apply_2q\n");
+
+    printf("  3 qubit SWAP statevector_apply_2q test: ");
+    state = statevector_create(3);
+    gate = matrix_create_from_values(4, 4, swap_values);
+    expected = matrix_create(8, 1);
+    if (state == NULL || gate == NULL || expected == NULL)
+        goto test_statevector_apply_2q_skip_remaining_tests;
+    /* |001> -> |100> */
+    statevector_set(state, 0, MAT_T_0);
+    statevector_set(state, 1, MAT_T_1);
+    statevector_apply_2q(state, gate, 2, 0);
+    matrix_set(expected, 5, 1, MAT_T_1);
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_statevector_apply_2q_skip_remaining_tests:
+    statevector_destroy(state);
+    matrix_destroy(gate);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_statevector_apply_controlled_2q(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state = NULL;
+    Matrix *gate = NULL;
+    Matrix *expected = NULL;
+
+    printf("Testing: statevector_apply_controlled_2q\n");
+
+    gate = matrix_create_from_values(4, 4, swap_values);
+    if (gate == NULL)
+        goto test_statevector_apply_controlled_2q_skip_remaining_tests;
+
+    printf("  set control statevector_apply_controlled_2q test: ");
+    state = statevector_create(3);
+    expected = matrix_create(8, 1);
+    if (state == NULL || expected == NULL)
+        goto test_statevector_apply_controlled_2q_skip_remaining_tests;
+    /* |101> -> |110> */
+    statevector_set(state, 0, MAT_T_0);
+    statevector_set(state, 5, MAT_T_1);
+    statevector_apply_controlled_2q(state, gate, 2, 1, 0);
+    matrix_set(expected, 7, 1, MAT_T_1);
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+    statevector_destroy(state);
+    matrix_destroy(expected);
+
+    printf("  unset control statevector_apply_controlled_2q test: ");
+    state = statevector_create(3);
+    expected = matrix_create(8, 1);
+    if (state == NULL || expected == NULL)
+        goto test_statevector_apply_controlled_2q_skip_remaining_tests;
+    /* |001> unchanged */
+    statevector_set(state, 0, MAT_T_0);
+    statevector_set(state, 1, MAT_T_1);
+    statevector_apply_controlled_2q(state, gate, 2, 1, 0);
+    matrix_set(expected, 2, 1, MAT_T_1);
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_statevector_apply_controlled_2q_skip_remaining_tests:
+    statevector_destroy(state);
+    matrix_destroy(gate);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+/**
+ * Add 1 to each index of the `size_t` array `context` in [`begin`, `end`).
+ */
+static void test_threadpool_count_task(void *context, size_t worker,
+                                       size_t begin, size_t end);
+
+static void test_threadpool_count_task(void *context, size_t worker,
+                                       size_t begin, size_t end) {
+    size_t *counts = context;
+    size_t i;
+    (void)worker;
+    for (i = begin; i < end; i++) {
+        counts[i]++;
+    }
+}
+
+int test_threadpool_parallel_for(void) {
+    const int test_ct = 2;
+    const size_t count = 100003;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    ThreadPool *pool = NULL;
+    size_t *counts = NULL;
+    size_t i, once;
+
+    printf("Testing: threadpool_parallel_for\n");
+
+    pool = threadpool_create(4);
+    counts = calloc(count, sizeof(size_t));
+    if (pool == NULL || counts == NULL)
+        goto test_threadpool_parallel_for_skip_remaining_tests;
+
+    printf("  4 thread threadpool_parallel_for test: ");
+    threadpool_parallel_for(pool, count, 64, test_threadpool_count_task,
+                            counts);
+    for (i = once = 0; i < count; i++) {
+        once += counts[i] == 1 ? 1 : 0;
+    }
+    tests_failed += size_t_assert_equal(count, once) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  repeated threadpool_parallel_for test: ");
+    for (i = 0; i < 99; i++) {
+        threadpool_parallel_for(pool, count, 64, test_threadpool_count_task,
+                                counts);
+    }
+    for (i = once = 0; i < count; i++) {
+        once += counts[i] == 100 ? 1 : 0;
+    }
+    tests_failed += size_t_assert_equal(count, once) != 0 ? 1 : 0;
+    tests_left--;
+
+test_threadpool_parallel_for_skip_remaining_tests:
+    threadpool_destroy(pool);
+    free(counts);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_statevector_create_parallel(void) {
+    const int test_ct = 1;
+    const size_t qubits = 16;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    ThreadPool *pool = NULL;
+    StateVector *parallel = NULL;
+    StateVector *serial = NULL;
+    Matrix *hadamard = NULL;
+    Matrix *pauli_x = NULL;
+    Matrix *swap = NULL;
+    Matrix *expected = NULL;
+    size_t i;
+
+    printf("Testing: statevector_create_parallel\n");
+
+    pool = threadpool_create(4);
+    parallel = statevector_create_parallel(qubits, pool);
+    serial = statevector_create(qubits);
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    pauli_x = matrix_create_from_values(2, 2, pauli_x_values);
+    swap = matrix_create_from_values(4, 4, swap_values);
+    expected = matrix_create((size_t)1 << qubits, 1);
+    if (pool == NULL || parallel == NULL || serial == NULL || hadamard == NULL
+        || pauli_x == NULL || swap == NULL || expected == NULL)
+        goto test_statevector_create_parallel_skip_remaining_tests;
+
+    printf("  4 thread circuit statevector_create_parallel test: ");
+    for (i = 0; i < qubits; i++) {
+        statevector_apply_1q(parallel, hadamard, i);
+        statevector_apply_1q(serial, hadamard, i);
+        statevector_apply_controlled_1q(parallel, pauli_x, i,
+                                        (i * 7 + 3) % qubits);
+        statevector_apply_controlled_1q(serial, pauli_x, i,
+                                        (i * 7 + 3) % qubits);
+        statevector_apply_2q(parallel, swap, i, (i + 5) % qubits);
+        statevector_apply_2q(serial, swap, i, (i + 5) % qubits);
+    }
+    for (i = 0; i < statevector_size(serial); i++) {
+        matrix_set(expected, i + 1, 1, statevector_get(serial, i));
+    }
+    tests_failed += statevector_assert_equal(parallel, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_statevector_create_parallel_skip_remaining_tests:
+    statevector_destroy(parallel);
+    statevector_destroy(serial);
+    threadpool_destroy(pool);
+    matrix_destroy(hadamard);
+    matrix_destroy(pauli_x);
+    matrix_destroy(swap);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_statevector_norm(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state = NULL;
+    Matrix *hadamard = NULL;
+    size_t i;
+
+    printf("Testing: statevector_norm\n");
+
+    printf("  basis state statevector_norm test: ");
+    state = statevector_create(14);
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    if (state == NULL || hadamard == NULL)
+        goto test_statevector_norm_skip_remaining_tests;
+    tests_failed
+        += mat_t_assert_equal(MAT_T_1, MAT_T(statevector_norm(state))) != 0
+               ? 1
+               : 0;
+    tests_left--;
+
+    printf("  scaled superposition statevector_norm test: ");
+    for (i = 0; i < 14; i++) {
+        statevector_apply_1q(state, hadamard, i);
+    }
+    statevector_set(state, 0, MAT_T_ADD(statevector_get(state, 0),
+                                        MAT_T(0.5)));
+    /* 1 + 2 * 0.5 * 2^-7 + 0.25 */
+    tests_failed += mat_t_assert_equal(MAT_T(sqrt(1.25 + 1.0 / 128.0)),
+                                       MAT_T(statevector_norm(state)))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+test_statevector_norm_skip_remaining_tests:
+    statevector_destroy(state);
+    matrix_destroy(hadamard);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_statevector_expectation_1q(void) {
+    const int test_ct = 2;
+    const double pauli_z_values[] = {1.0, 0.0, 0.0, -1.0};
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state = NULL;
+    Matrix *pauli_z = NULL;
+    Matrix *pauli_x = NULL;
+    Matrix *hadamard = NULL;
+
+    printf("Testing: statevector_expectation_1q\n");
+
+    state = statevector_create(3);
+    pauli_z = matrix_create_from_values(2, 2, pauli_z_values);
+    pauli_x = matrix_create_from_values(2, 2, pauli_x_values);
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    if (state == NULL || pauli_z == NULL || pauli_x == NULL
+        || hadamard == NULL)
+        goto test_statevector_expectation_1q_skip_remaining_tests;
+
+    printf("  <1|Z|1> statevector_expectation_1q test: ");
+    statevector_apply_1q(state, pauli_x, 2);
+    tests_failed += mat_t_assert_equal(
+                        MAT_T(-1.0),
+                        statevector_expectation_1q(state, pauli_z, 2))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    printf("  <+|X|+> statevector_expectation_1q test: ");
+    statevector_apply_1q(state, hadamard, 1);
+    tests_failed += mat_t_assert_equal(
+                        MAT_T_1, statevector_expectation_1q(state, pauli_x, 1))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+test_statevector_expectation_1q_skip_remaining_tests:
+    statevector_destroy(state);
+    matrix_destroy(pauli_z);
+    matrix_destroy(pauli_x);
+    matrix_destroy(hadamard);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_lufactor_determinant(void) {
+    const int test_ct = 4;
+    const double swap_needed_values[] = {0.0, 2.0, 3.0, 1.0};
+    const double singular_values[] = {1.0, 2.0, 3.0, 2.0, 4.0, 6.0,
+                                      1.0, 0.0, 1.0};
+    const double triangular_values[] = {2.0, 0.0, 0.0, 0.0, 3.0, 0.0,
+                                        0.0, 0.0, 4.0};
+    const double scaled_values[] = {1e-11, 0.0, 0.0, 1e11};
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL;
+    LUFactor *factor = NULL;
+
+    printf("Testing: lufactor_determinant\n");
+
+    printf("  2x2 pivoting lufactor_determinant test: ");
+    matrix = matrix_create_from_values(2, 2, swap_needed_values);
+    if (matrix == NULL)
+        goto test_lufactor_determinant_skip_remaining_tests;
+    factor = lufactor_create(matrix);
+    if (factor == NULL)
+        goto test_lufactor_determinant_skip_remaining_tests;
+    tests_failed += mat_t_assert_equal(MAT_T(-6.0),
+                                       lufactor_determinant(factor))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+    lufactor_destroy(factor);
+
+    printf("  3x3 singular lufactor_determinant test: ");
+    matrix = matrix_create_from_values(3, 3, singular_values);
+    if (matrix == NULL)
+        goto test_lufactor_determinant_skip_remaining_tests;
+    factor = lufactor_create(matrix);
+    if (factor == NULL)
+        goto test_lufactor_determinant_skip_remaining_tests;
+    if (lufactor_is_singular(factor)) {
+        tests_failed += mat_t_assert_equal(MAT_T_0,
+                                           lufactor_determinant(factor))
+                                != 0
+                            ? 1
+                            : 0;
+    } else {
+        tests_failed++;
+        printf(RED "Failure: matrix is singular" RESET "\n");
+    }
+    tests_left--;
+    matrix_destroy(matrix);
+    lufactor_destroy(factor);
+
+    printf("  3x3 diagonal lufactor_determinant test: ");
+    matrix = matrix_create_from_values(3, 3, triangular_values);
+    if (matrix == NULL)
+        goto test_lufactor_determinant_skip_remaining_tests;
+    factor = lufactor_create(matrix);
+    if (factor == NULL)
+        goto test_lufactor_determinant_skip_remaining_tests;
+    tests_failed += mat_t_assert_equal(MAT_T(24.0),
+                                       lufactor_determinant(factor))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+    lufactor_destroy(factor);
+    factor = NULL;
+
+    /* a pivot below MAT_T_PRECISION is small, not zero */
+    printf("  widely scaled lufactor_determinant test: ");
+    matrix = matrix_create_from_values(2, 2, scaled_values);
+    if (matrix == NULL)
+        goto test_lufactor_determinant_skip_remaining_tests;
+    factor = lufactor_create(matrix);
+    if (factor == NULL)
+        goto test_lufactor_determinant_skip_remaining_tests;
+    if (!lufactor_is_singular(factor)) {
+        tests_failed += mat_t_assert_equal(MAT_T_1,
+                                           lufactor_determinant(factor))
+                                != 0
+                            ? 1
+                            : 0;
+    } else {
+        tests_failed++;
+        printf(RED "Failure: matrix is not singular" RESET "\n");
+    }
+    tests_left--;
+
+test_lufactor_determinant_skip_remaining_tests:
+    matrix_destroy(matrix);
+    lufactor_destroy(factor);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_lufactor_solve(void) {
+    const int test_ct = 2;
+    const size_t n = 150;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL;
+    Matrix *solution = NULL;
+    Matrix *rhs = NULL;
+    LUFactor *factor = NULL;
+
+    printf("Testing: lufactor_solve\n");
+
+    /* spans several panels, so exercises the blocked update */
+    matrix = matrix_create(n, n);
+    solution = matrix_create(n, 3);
+    rhs = matrix_create(n, 3);
+    if (matrix == NULL || solution == NULL || rhs == NULL)
+        goto test_lufactor_solve_skip_remaining_tests;
+    matrix_fill_random(matrix, 3);
+    matrix_fill_random(solution, 4);
+    factor = lufactor_create(matrix);
+    if (factor == NULL)
+        goto test_lufactor_solve_skip_remaining_tests;
+
+    printf("  150x150 lufactor_solve test: ");
+    matrix_multiply_reference(rhs, matrix, solution);
+    if (lufactor_solve(factor, rhs) != 0) {
+        tests_failed++;
+        printf(RED "Failure: solve failed" RESET "\n");
+    } else {
+        tests_failed += matrix_assert_equal(solution, rhs) != 0 ? 1 : 0;
+    }
+    tests_left--;
+
+    printf("  repeated 150x150 lufactor_solve test: ");
+    matrix_fill_random(solution, 5);
+    matrix_multiply_reference(rhs, matrix, solution);
+    if (lufactor_solve(factor, rhs) != 0) {
+        tests_failed++;
+        printf(RED "Failure: solve failed" RESET "\n");
+    } else {
+        tests_failed += matrix_assert_equal(solution, rhs) != 0 ? 1 : 0;
+    }
+    tests_left--;
+
+test_lufactor_solve_skip_remaining_tests:
+    matrix_destroy(matrix);
+    matrix_destroy(solution);
+    matrix_destroy(rhs);
+    lufactor_destroy(factor);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_lufactor_inverse(void) {
+    const int test_ct = 1;
+    const size_t n = 70;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL;
+    Matrix *inverse = NULL;
+    Matrix *product = NULL;
+    Matrix *identity = NULL;
+    LUFactor *factor = NULL;
+
+    printf("Testing: lufactor_inverse\n");
+
+    printf("  70x70 lufactor_inverse test: ");
+    matrix = matrix_create(n, n);
+    product = matrix_create(n, n);
+    identity = matrix_create_identity(n);
+    if (matrix == NULL || product == NULL || identity == NULL)
+        goto test_lufactor_inverse_skip_remaining_tests;
+    matrix_fill_random(matrix, 6);
+    factor = lufactor_create(matrix);
+    if (factor == NULL)
+        goto test_lufactor_inverse_skip_remaining_tests;
+    inverse = lufactor_inverse(factor);
+    if (inverse == NULL)
+        goto test_lufactor_inverse_skip_remaining_tests;
+    matrix_multiply_reference(product, matrix, inverse);
+    tests_failed += matrix_assert_equal(identity, product) != 0 ? 1 : 0;
+    tests_left--;
+
+test_lufactor_inverse_skip_remaining_tests:
+    matrix_destroy(matrix);
+    matrix_destroy(inverse);
+    matrix_destroy(product);
+    matrix_destroy(identity);
+    lufactor_destroy(factor);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_eigen_hermitian(void) {
+    const int test_ct = 6;
+    const size_t n = 60;
+    const double pair_values[] = {2.0, 1.0, 1.0, 2.0};
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL;
+    Matrix *vectors = NULL;
+    Matrix *product = NULL;
+    Matrix *scaled = NULL;
+    Matrix *adjoint = NULL;
+    Matrix *identity = NULL;
+    double eigenvalues[60];
+    double values_only[60];
+    bool success;
+    size_t i, j;
+
+    printf("Testing: eigen_hermitian\n");
+
+    printf("  2x2 eigen_hermitian test: ");
+    matrix = matrix_create_from_values(2, 2, pair_values);
+    if (matrix == NULL || eigen_hermitian(matrix, eigenvalues, NULL) != 0)
+        goto test_eigen_hermitian_skip_remaining_tests;
+    tests_failed += mat_t_assert_equal(MAT_T(eigenvalues[0]), MAT_T(1.0)) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    printf("  2x2 eigen_hermitian test: ");
+    tests_failed += mat_t_assert_equal(MAT_T(eigenvalues[1]), MAT_T(3.0)) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+
+    /* a thrice degenerate eigenvalue needs an orthonormal eigenspace */
+    printf("  degenerate 4x4 eigen_hermitian test: ");
+    matrix = matrix_create_from_values(4, 4, swap_values);
+    vectors = matrix_create(4, 4);
+    product = matrix_create(4, 4);
+    adjoint = matrix_create(4, 4);
+    identity = matrix_create_identity(4);
+    if (matrix == NULL || vectors == NULL || product == NULL || adjoint == NULL
+        || identity == NULL
+        || eigen_hermitian(matrix, eigenvalues, vectors) != 0)
+        goto test_eigen_hermitian_skip_remaining_tests;
+    for (i = 1; i <= 4; i++) {
+        for (j = 1; j <= 4; j++) {
+            matrix_set(adjoint, i, j, MAT_T_CONJ(matrix_get(vectors, j, i)));
+        }
+    }
+    matrix_multiply_reference(product, adjoint, vectors);
+    tests_failed += matrix_assert_equal(product, identity) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+    matrix_destroy(vectors);
+    matrix_destroy(product);
+    matrix_destroy(adjoint);
+    matrix_destroy(identity);
+
+    /* spans several reflectors and QL sweeps per eigenvalue */
+    matrix = matrix_create(n, n);
+    vectors = matrix_create(n, n);
+    product = matrix_create(n, n);
+    scaled = matrix_create(n, n);
+    adjoint = matrix_create(n, n);
+    identity = matrix_create_identity(n);
+    if (matrix == NULL || vectors == NULL || product == NULL || scaled == NULL
+        || adjoint == NULL || identity == NULL)
+        goto test_eigen_hermitian_skip_remaining_tests;
+    if (matrix_fill_random_hermitian(matrix, 7) != 0)
+        goto test_eigen_hermitian_skip_remaining_tests;
+    if (eigen_hermitian(matrix, eigenvalues, vectors) != 0)
+        goto test_eigen_hermitian_skip_remaining_tests;
+
+    printf("  60x60 A V = V D eigen_hermitian test: ");
+    matrix_multiply_reference(product, matrix, vectors);
+    for (i = 1; i <= n; i++) {
+        for (j = 1; j <= n; j++) {
+            matrix_set(scaled, i, j,
+                       MAT_T_MUL(MAT_T(eigenvalues[j - 1]),
+                                 matrix_get(vectors, i, j)));
+        }
+    }
+    tests_failed += matrix_assert_equal(product, scaled) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  60x60 V^H V = I eigen_hermitian test: ");
+    for (i = 1; i <= n; i++) {
+        for (j = 1; j <= n; j++) {
+            matrix_set(adjoint, i, j, MAT_T_CONJ(matrix_get(vectors, j, i)));
+        }
+    }
+    matrix_multiply_reference(product, adjoint, vectors);
+    tests_failed += matrix_assert_equal(product, identity) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  60x60 eigenvalues only eigen_hermitian test: ");
+    if (eigen_hermitian(matrix, values_only, NULL) != 0)
+        goto test_eigen_hermitian_skip_remaining_tests;
+    success = true;
+    for (i = 0; i < n; i++) {
+        success = success && fabs(values_only[i] - eigenvalues[i]) < 1e-10;
+        success = success && (i == 0 || eigenvalues[i - 1] <= eigenvalues[i]);
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: eigenvalues differ or are unsorted" RESET "\n");
+    }
+    tests_left--;
+
+test_eigen_hermitian_skip_remaining_tests:
+    matrix_destroy(matrix);
+    matrix_destroy(vectors);
+    matrix_destroy(product);
+    matrix_destroy(scaled);
+    matrix_destroy(adjoint);
+    matrix_destroy(identity);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_sparsematrix_create(void) {
+    const int test_ct = 4;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    SparseMatrixBuilder *builder = NULL;
+    SparseMatrix *sparse = NULL;
+
+    printf("Testing: sparsematrix_create\n");
+
+    builder = sparsematrixbuilder_create(3, 4, 0);
+    if (builder == NULL)
+        goto test_sparsematrix_create_skip_remaining_tests;
+    if (sparsematrixbuilder_add(builder, 3, 2, MAT_T(4.0)) != 0
+        || sparsematrixbuilder_add(builder, 1, 4, MAT_T(1.0)) != 0
+        || sparsematrixbuilder_add(builder, 1, 1, MAT_T(2.0)) != 0
+        || sparsematrixbuilder_add(builder, 1, 4, MAT_T(3.0)) != 0)
+        goto test_sparsematrix_create_skip_remaining_tests;
+    sparse = sparsematrix_create(builder);
+    if (sparse == NULL)
+        goto test_sparsematrix_create_skip_remaining_tests;
+
+    printf("  duplicates sparsematrix_create test: ");
+    tests_failed += size_t_assert_equal(sparsematrix_nonzeros(sparse), 3) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    printf("  summed value sparsematrix_create test: ");
+    tests_failed += mat_t_assert_equal(sparsematrix_get(sparse, 1, 4),
+                                       MAT_T(4.0))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    printf("  last row sparsematrix_create test: ");
+    tests_failed += mat_t_assert_equal(sparsematrix_get(sparse, 3, 2),
+                                       MAT_T(4.0))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    printf("  missing value sparsematrix_create test: ");
+    tests_failed += mat_t_assert_equal(sparsematrix_get(sparse, 2, 2),
+                                       MAT_T_0)
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+test_sparsematrix_create_skip_remaining_tests:
+    sparsematrixbuilder_destroy(builder);
+    sparsematrix_destroy(sparse);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_sparsematrix_multiply_vector(void) {
+    const int test_ct = 1;
+    const size_t height = 90;
+    const size_t width = 70;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    SparseMatrixBuilder *builder = NULL;
+    SparseMatrix *sparse = NULL;
+    Matrix *dense = NULL;
+    Matrix *x = NULL;
+    Matrix *expected = NULL;
+    Matrix *actual = NULL;
+    mat_t *x_values = NULL;
+    mat_t *y_values = NULL;
+    size_t i;
+
+    printf("Testing: sparsematrix_multiply_vector\n");
+
+    builder = sparsematrixbuilder_create(height, width, 0);
+    x = matrix_create(width, 1);
+    expected = matrix_create(height, 1);
+    actual = matrix_create(height, 1);
+    x_values = malloc(width * sizeof(mat_t));
+    y_values = malloc(height * sizeof(mat_t));
+    if (builder == NULL || x == NULL || expected == NULL || actual == NULL
+        || x_values == NULL || y_values == NULL)
+        goto test_sparsematrix_multiply_vector_skip_remaining_tests;
+    if (sparsematrixbuilder_fill_random(builder, height, width, 600, 8) != 0)
+        goto test_sparsematrix_multiply_vector_skip_remaining_tests;
+    sparse = sparsematrix_create(builder);
+    if (sparse == NULL)
+        goto test_sparsematrix_multiply_vector_skip_remaining_tests;
+    dense = sparsematrix_to_dense(sparse);
+    if (dense == NULL)
+        goto test_sparsematrix_multiply_vector_skip_remaining_tests;
+
+    printf("  90x70 sparsematrix_multiply_vector test: ");
+    matrix_fill_random(x, 9);
+    for (i = 0; i < width; i++) {
+        x_values[i] = matrix_get(x, i + 1, 1);
+    }
+    sparsematrix_multiply_vector(sparse, x_values, y_values);
+    for (i = 0; i < height; i++) {
+        matrix_set(actual, i + 1, 1, y_values[i]);
+    }
+    matrix_multiply_reference(expected, dense, x);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+test_sparsematrix_multiply_vector_skip_remaining_tests:
+    sparsematrixbuilder_destroy(builder);
+    sparsematrix_destroy(sparse);
+    matrix_destroy(dense);
+    matrix_destroy(x);
+    matrix_destroy(expected);
+    matrix_destroy(actual);
+    free(x_values);
+    free(y_values);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_sparsematrix_multiply_vector_parallel(void) {
+    const int test_ct = 1;
+    const size_t size = 10000;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    ThreadPool *pool = NULL;
+    SparseMatrixBuilder *builder = NULL;
+    SparseMatrix *sparse = NULL;
+    mat_t *x = NULL;
+    mat_t *serial = NULL;
+    mat_t *parallel = NULL;
+    bool success = true;
+    size_t i;
+
+    printf("Testing: sparsematrix_multiply_vector_parallel\n");
+
+    pool = threadpool_create(4);
+    builder = sparsematrixbuilder_create(size, size, 0);
+    x = malloc(size * sizeof(mat_t));
+    serial = malloc(size * sizeof(mat_t));
+    parallel = malloc(size * sizeof(mat_t));
+    if (pool == NULL || builder == NULL || x == NULL || serial == NULL
+        || parallel == NULL)
+        goto test_sparsematrix_multiply_vector_parallel_skip_remaining_tests;
+    if (sparsematrixbuilder_fill_random(builder, size, size, 50000, 10) != 0)
+        goto test_sparsematrix_multiply_vector_parallel_skip_remaining_tests;
+    sparse = sparsematrix_create(builder);
+    if (sparse == NULL)
+        goto test_sparsematrix_multiply_vector_parallel_skip_remaining_tests;
+
+    printf("  4 thread sparsematrix_multiply_vector_parallel test: ");
+    for (i = 0; i < size; i++) {
+        x[i] = MAT_T((double)(i % 17) - 8.0);
+    }
+    sparsematrix_multiply_vector(sparse, x, serial);
+    sparsematrix_multiply_vector_parallel(sparse, x, parallel, pool);
+    for (i = 0; i < size && success; i++) {
+        success = MAT_T_EQ(serial[i], parallel[i]);
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: products differ at %lu" RESET "\n",
+               (unsigned long)i - 1);
+    }
+    tests_left--;
+
+test_sparsematrix_multiply_vector_parallel_skip_remaining_tests:
+    threadpool_destroy(pool);
+    sparsematrixbuilder_destroy(builder);
+    sparsematrix_destroy(sparse);
+    free(x);
+    free(serial);
+    free(parallel);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_sparsematrix_dense(void) {
+    const int test_ct = 3;
+    const double values[] = {0.0, 2.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, -3.0};
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *dense = NULL;
+    Matrix *round_trip = NULL;
+    Matrix *b = NULL;
+    Matrix *expected = NULL;
+    Matrix *actual = NULL;
+    SparseMatrix *sparse = NULL;
+
+    printf("Testing: sparsematrix_dense\n");
+
+    dense = matrix_create_from_values(3, 3, values);
+    b = matrix_create(3, 5);
+    expected = matrix_create(3, 5);
+    actual = matrix_create(3, 5);
+    if (dense == NULL || b == NULL || expected == NULL || actual == NULL)
+        goto test_sparsematrix_dense_skip_remaining_tests;
+    sparse = sparsematrix_create_from_dense(dense);
+    if (sparse == NULL)
+        goto test_sparsematrix_dense_skip_remaining_tests;
+
+    printf("  3x3 sparsematrix_create_from_dense test: ");
+    tests_failed += size_t_assert_equal(sparsematrix_nonzeros(sparse), 3) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    printf("  3x3 sparsematrix_to_dense test: ");
+    round_trip = sparsematrix_to_dense(sparse);
+    if (round_trip == NULL)
+        goto test_sparsematrix_dense_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(dense, round_trip) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  3x3 by 3x5 sparsematrix_multiply_dense test: ");
+    matrix_fill_random(b, 11);
+    matrix_multiply_reference(expected, dense, b);
+    sparsematrix_multiply_dense(actual, sparse, b);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+test_sparsematrix_dense_skip_remaining_tests:
+    matrix_destroy(dense);
+    matrix_destroy(round_trip);
+    matrix_destroy(b);
+    matrix_destroy(expected);
+    matrix_destroy(actual);
+    sparsematrix_destroy(sparse);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_lanczos_solve(void) {
+    const int test_ct = 5;
+    const size_t n = 200;
+    const size_t count = 4;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL;
+    Matrix *dense_chain = NULL;
+    Matrix *tridiagonal = NULL;
+    SparseMatrix *chain = NULL;
+    Lanczos *lanczos = NULL;
+    double expected[256];
+    mat_t *av = NULL;
+    const mat_t *v;
+    bool success;
+    size_t i, k;
+
+    printf("Testing: lanczos_solve\n");
+
+    matrix = matrix_create(n, n);
+    av = malloc(256 * sizeof(mat_t));
+    lanczos = lanczos_create(n, count, 0);
+    if (matrix == NULL || av == NULL || lanczos == NULL)
+        goto test_lanczos_solve_skip_remaining_tests;
+    if (matrix_fill_random_hermitian(matrix, 12) != 0
+        || eigen_hermitian(matrix, expected, NULL) != 0)
+        goto test_lanczos_solve_skip_remaining_tests;
+
+    printf("  dense 200x200 lowest 4 lanczos_solve test: ");
+    success = lanczos_solve(lanczos, matvec_dense, matrix, 1e-10, 200) == 0;
+    for (i = 0; i < count && success; i++) {
+        success = fabs(lanczos_eigenvalue(lanczos, i) - expected[i]) < 1e-9;
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: eigenvalues differ" RESET "\n");
+    }
+    tests_left--;
+
+    printf("  dense 200x200 residual lanczos_solve test: ");
+    success = true;
+    for (i = 0; i < count && success; i++) {
+        v = lanczos_eigenvector(lanczos, i);
+        matvec_dense(matrix, v, av);
+        for (k = 0; k < n && success; k++) {
+            success = MAT_T_EQ(av[k], MAT_T_MUL(MAT_T(lanczos_eigenvalue(
+                                                          lanczos, i)),
+                                                v[k]))
+                      && lanczos_residual(lanczos, i) < 1e-8;
+        }
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: A v != lambda v" RESET "\n");
+    }
+    tests_left--;
+
+    printf("  dense 200x200 instrumentation lanczos_solve test: ");
+    if (lanczos_iterations(lanczos) > 0
+        && lanczos_matvecs(lanczos) >= lanczos_iterations(lanczos)) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: %lu iterations, %lu matvecs" RESET "\n",
+               (unsigned long)lanczos_iterations(lanczos),
+               (unsigned long)lanczos_matvecs(lanczos));
+    }
+    tests_left--;
+    lanczos_destroy(lanczos);
+
+    /* the ground state of an even chain is a non-degenerate singlet */
+    printf("  8 site Heisenberg chain lanczos_solve test: ");
+    chain = sparsematrix_create_heisenberg_chain(8);
+    lanczos = lanczos_create(256, 1, 0);
+    if (chain == NULL || lanczos == NULL)
+        goto test_lanczos_solve_skip_remaining_tests;
+    dense_chain = sparsematrix_to_dense(chain);
+    if (dense_chain == NULL
+        || eigen_hermitian(dense_chain, expected, NULL) != 0)
+        goto test_lanczos_solve_skip_remaining_tests;
+    if (lanczos_solve(lanczos, matvec_sparse, chain, 1e-10, 200) != 0) {
+        tests_failed++;
+        printf(RED "Failure: did not converge" RESET "\n");
+    } else {
+        tests_failed += mat_t_assert_equal(
+                            MAT_T(lanczos_eigenvalue(lanczos, 0)),
+                            MAT_T(expected[0]))
+                            != 0
+                        ? 1
+                        : 0;
+    }
+    tests_left--;
+    lanczos_destroy(lanczos);
+
+    /* every eigenpair, so the basis is the whole space */
+    printf("  4x4 all eigenpairs lanczos_solve test: ");
+    tridiagonal = matrix_create(4, 4);
+    lanczos = lanczos_create(4, 4, 0);
+    if (tridiagonal == NULL || lanczos == NULL)
+        goto test_lanczos_solve_skip_remaining_tests;
+    for (i = 1; i <= 4; i++) {
+        matrix_set(tridiagonal, i, i, MAT_T(2.0));
+        if (i < 4) {
+            matrix_set(tridiagonal, i, i + 1, MAT_T(-1.0));
+            matrix_set(tridiagonal, i + 1, i, MAT_T(-1.0));
+        }
+    }
+    success = lanczos_solve(lanczos, matvec_dense, tridiagonal, 1e-10, 20)
+              == 0;
+    for (i = 0; i < 4 && success; i++) {
+        v = lanczos_eigenvector(lanczos, i);
+        matvec_dense(tridiagonal, v, av);
+        for (k = 0; k < 4 && success; k++) {
+            success = MAT_T_EQ(av[k], MAT_T_MUL(MAT_T(lanczos_eigenvalue(
+                                                          lanczos, i)),
+                                                v[k]));
+        }
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: A v != lambda v" RESET "\n");
+    }
+    tests_left--;
+
+test_lanczos_solve_skip_remaining_tests:
+    matrix_destroy(matrix);
+    matrix_destroy(dense_chain);
+    matrix_destroy(tridiagonal);
+    sparsematrix_destroy(chain);
+    lanczos_destroy(lanczos);
+    free(av);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_expm_multiply(void) {
+    const int test_ct = 4;
+    const size_t n = 60;
+#ifdef MAT_T_COMPLEX
+    const mat_t rate = MAT_T_MUL(MAT_T(-1.0), MAT_T_I);
+#else
+    const mat_t rate = MAT_T(-1.0);
+#endif
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL;
+    Matrix *dense_chain = NULL;
+    SparseMatrix *chain = NULL;
+    Expm *expm = NULL;
+    mat_t *psi = NULL;
+    mat_t *expected = NULL;
+    size_t i;
+
+    printf("Testing: expm_multiply\n");
+
+    matrix = matrix_create(n, n);
+    psi = malloc(256 * sizeof(mat_t));
+    expected = malloc(256 * sizeof(mat_t));
+    expm = expm_create(n, 0);
+    if (matrix == NULL || psi == NULL || expected == NULL || expm == NULL)
+        goto test_expm_multiply_skip_remaining_tests;
+    if (matrix_fill_random_hermitian(matrix, 21) != 0)
+        goto test_expm_multiply_skip_remaining_tests;
+    for (i = 0; i < n; i++) {
+        psi[i] = MAT_T(1.0 / sqrt((double)n));
+    }
+    if (expm_multiply_reference(matrix, rate, 0.5, psi, expected) != 0)
+        goto test_expm_multiply_skip_remaining_tests;
+
+    printf("  dense 60x60 expm_multiply test: ");
+    if (expm_multiply(expm, matvec_dense, matrix, rate, 0.5, psi, 1e-10)
+        != 0) {
+        tests_failed++;
+        printf(RED "Failure: did not finish" RESET "\n");
+    } else {
+        tests_failed +=
+            vector_assert_close(expected, psi, n, 1e-8) != 0 ? 1 : 0;
+    }
+    tests_left--;
+
+    printf("  dense 60x60 instrumentation expm_multiply test: ");
+    if (expm_steps(expm) > 0 && expm_matvecs(expm) >= expm_steps(expm)) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: %lu steps, %lu matvecs" RESET "\n",
+               (unsigned long)expm_steps(expm),
+               (unsigned long)expm_matvecs(expm));
+    }
+    tests_left--;
+    expm_destroy(expm);
+
+    /* a small basis over a long time needs several steps */
+    printf("  8 site Heisenberg chain expm_multiply test: ");
+    chain = sparsematrix_create_heisenberg_chain(8);
+    expm = expm_create(256, 10);
+    if (chain == NULL || expm == NULL)
+        goto test_expm_multiply_skip_remaining_tests;
+    dense_chain = sparsematrix_to_dense(chain);
+    if (dense_chain == NULL)
+        goto test_expm_multiply_skip_remaining_tests;
+    /* a Neel state */
+    for (i = 0; i < 256; i++) {
+        psi[i] = MAT_T_0;
+    }
+    psi[0x55] = MAT_T(1.0);
+    if (expm_multiply_reference(dense_chain, rate, 4.0, psi, expected) != 0)
+        goto test_expm_multiply_skip_remaining_tests;
+    if (expm_multiply(expm, matvec_sparse, chain, rate, 4.0, psi, 1e-10)
+            != 0
+        || expm_steps(expm) < 2) {
+        tests_failed++;
+        printf(RED "Failure: %lu steps" RESET "\n",
+               (unsigned long)expm_steps(expm));
+    } else {
+        tests_failed +=
+            vector_assert_close(expected, psi, 256, 1e-8) != 0 ? 1 : 0;
+    }
+    tests_left--;
+
+    /* the zero vector stays put without applying the operator */
+    printf("  zero vector expm_multiply test: ");
+    for (i = 0; i < 256; i++) {
+        psi[i] = MAT_T_0;
+    }
+    if (expm_multiply(expm, matvec_sparse, chain, rate, 4.0, psi, 1e-10) == 0
+        && expm_matvecs(expm) == 0 && MAT_T_EQ(psi[0], MAT_T_0)) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: zero vector changed" RESET "\n");
+    }
+    tests_left--;
+
+test_expm_multiply_skip_remaining_tests:
+    matrix_destroy(matrix);
+    matrix_destroy(dense_chain);
+    sparsematrix_destroy(chain);
+    expm_destroy(expm);
+    free(psi);
+    free(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+static const double nilpotent_values[] = {0.0, 1.0, 0.0, 0.0};
+static const double nilpotent_exponential_values[] = {1.0, 3.0, 0.0, 1.0};
+
+int test_matrix_exponential(void) {
+    const int test_ct = 4;
+    const size_t n = 60;
+#ifdef MAT_T_COMPLEX
+    const mat_t t = MAT_T_MUL(MAT_T(-1.0), MAT_T_I);
+#else
+    const mat_t t = MAT_T(1.0);
+#endif
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL;
+    Matrix *result = NULL;
+    Matrix *expected = NULL;
+    mat_t *column = NULL;
+    mat_t *reference = NULL;
+    mat_t *actual = NULL;
+    double diagonal[2];
+    bool success;
+    size_t i, j;
+
+    printf("Testing: matrix_exponential\n");
+
+    printf("  zero matrix_exponential test: ");
+    matrix = matrix_create(3, 3);
+    result = matrix_create(3, 3);
+    expected = matrix_create_identity(3);
+    if (matrix == NULL || result == NULL || expected == NULL)
+        goto test_matrix_exponential_skip_remaining_tests;
+    if (matrix_exponential(result, matrix, MAT_T(2.0)) != 0)
+        goto test_matrix_exponential_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(expected, result) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+    matrix_destroy(result);
+    matrix_destroy(expected);
+    result = expected = NULL;
+
+    printf("  nilpotent matrix_exponential test: ");
+    matrix = matrix_create_from_values(2, 2, nilpotent_values);
+    expected = matrix_create_from_values(2, 2, nilpotent_exponential_values);
+    if (matrix == NULL || expected == NULL)
+        goto test_matrix_exponential_skip_remaining_tests;
+    /* in place */
+    if (matrix_exponential(matrix, matrix, MAT_T(3.0)) != 0)
+        goto test_matrix_exponential_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(expected, matrix) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(matrix);
+    matrix_destroy(expected);
+    expected = NULL;
+
+    /* a large norm needs squaring */
+    printf("  scaled diagonal matrix_exponential test: ");
+    matrix = matrix_create(2, 2);
+    result = matrix_create(2, 2);
+    if (matrix == NULL || result == NULL)
+        goto test_matrix_exponential_skip_remaining_tests;
+    matrix_set(matrix, 1, 1, MAT_T(10.0));
+    matrix_set(matrix, 2, 2, MAT_T(-20.0));
+    if (matrix_exponential(result, matrix, MAT_T(1.0)) != 0)
+        goto test_matrix_exponential_skip_remaining_tests;
+    diagonal[0] = MAT_T_REAL(matrix_get(result, 1, 1));
+    diagonal[1] = MAT_T_REAL(matrix_get(result, 2, 2));
+    if (fabs(diagonal[0] / exp(10.0) - 1.0) < 1e-12
+        && fabs(diagonal[1] / exp(-20.0) - 1.0) < 1e-12
+        && MAT_T_EQ(matrix_get(result, 1, 2), MAT_T_0)
+        && MAT_T_EQ(matrix_get(result, 2, 1), MAT_T_0)) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: got %g and %g" RESET "\n", diagonal[0],
+               diagonal[1]);
+    }
+    tests_left--;
+    matrix_destroy(matrix);
+    matrix_destroy(result);
+
+    printf("  60x60 Hermitian matrix_exponential test: ");
+    matrix = matrix_create(n, n);
+    result = matrix_create(n, n);
+    column = malloc(n * sizeof(mat_t));
+    reference = malloc(n * n * sizeof(mat_t));
+    actual = malloc(n * n * sizeof(mat_t));
+    if (matrix == NULL || result == NULL || column == NULL
+        || reference == NULL || actual == NULL)
+        goto test_matrix_exponential_skip_remaining_tests;
+    if (matrix_fill_random_hermitian(matrix, 31) != 0)
+        goto test_matrix_exponential_skip_remaining_tests;
+    success = true;
+    for (j = 0; j < n && success; j++) {
+        for (i = 0; i < n; i++) {
+            column[i] = i == j ? MAT_T_1 : MAT_T_0;
+        }
+        success = expm_multiply_reference(matrix, t, 1.0, column,
+                                          reference + j * n)
+                  == 0;
+    }
+    if (!success || matrix_exponential(result, matrix, t) != 0)
+        goto test_matrix_exponential_skip_remaining_tests;
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < n; i++) {
+            actual[j * n + i] = matrix_get(result, i + 1, j + 1);
+        }
+    }
+    tests_failed +=
+        vector_assert_close(reference, actual, n * n, 1e-10) != 0 ? 1 : 0;
+    tests_left--;
+
+test_matrix_exponential_skip_remaining_tests:
+    matrix_destroy(matrix);
+    matrix_destroy(result);
+    matrix_destroy(expected);
+    free(column);
+    free(reference);
+    free(actual);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_exponentialcache_get(void) {
+    const int test_ct = 2;
+    const size_t n = 20;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL;
+    Matrix *result = NULL;
+    Matrix *expected = NULL;
+    ExponentialCache *cache = NULL;
+
+    printf("Testing: exponentialcache_get\n");
+
+    matrix = matrix_create(n, n);
+    result = matrix_create(n, n);
+    expected = matrix_create(n, n);
+    if (matrix == NULL || result == NULL || expected == NULL
+        || matrix_fill_random_hermitian(matrix, 41) != 0)
+        goto test_exponentialcache_get_skip_remaining_tests;
+    cache = exponentialcache_create(matrix, 2);
+    if (cache == NULL)
+        goto test_exponentialcache_get_skip_remaining_tests;
+
+    printf("  repeated t exponentialcache_get test: ");
+    if (matrix_exponential(expected, matrix, MAT_T(0.25)) != 0
+        || exponentialcache_get(cache, result, MAT_T(0.5)) != 0
+        || exponentialcache_get(cache, result, MAT_T(0.25)) != 0
+        || exponentialcache_get(cache, result, MAT_T(0.25)) != 0)
+        goto test_exponentialcache_get_skip_remaining_tests;
+    if (exponentialcache_hits(cache) == 1
+        && exponentialcache_misses(cache) == 2) {
+        tests_failed += matrix_assert_equal(expected, result) != 0 ? 1 : 0;
+    } else {
+        tests_failed++;
+        printf(RED "Failure: %lu hits, %lu misses" RESET "\n",
+               (unsigned long)exponentialcache_hits(cache),
+               (unsigned long)exponentialcache_misses(cache));
+    }
+    tests_left--;
+
+    /* 0.5 was used least recently, so a third t evicts it */
+    printf("  eviction exponentialcache_get test: ");
+    if (exponentialcache_get(cache, result, MAT_T(2.0)) != 0
+        || exponentialcache_get(cache, result, MAT_T(0.25)) != 0
+        || exponentialcache_get(cache, result, MAT_T(0.5)) != 0
+        || matrix_exponential(expected, matrix, MAT_T(0.5)) != 0)
+        goto test_exponentialcache_get_skip_remaining_tests;
+    if (exponentialcache_hits(cache) == 2
+        && exponentialcache_misses(cache) == 4) {
+        tests_failed += matrix_assert_equal(expected, result) != 0 ? 1 : 0;
+    } else {
+        tests_failed++;
+        printf(RED "Failure: %lu hits, %lu misses" RESET "\n",
+               (unsigned long)exponentialcache_hits(cache),
+               (unsigned long)exponentialcache_misses(cache));
+    }
+    tests_left--;
+
+test_exponentialcache_get_skip_remaining_tests:
+    matrix_destroy(matrix);
+    matrix_destroy(result);
+    matrix_destroy(expected);
+    exponentialcache_destroy(cache);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_create_view(void) {
+    const int test_ct = 4;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *parent = NULL;
+    Matrix *a = NULL;
+    Matrix *b = NULL;
+    Matrix *dest = NULL;
+    Matrix *a_copy = NULL;
+    Matrix *b_copy = NULL;
+    Matrix *expected = NULL;
+    Matrix *vectors = NULL;
+    Matrix *vectors_view = NULL;
+    double values[20];
+    double view_values[20];
+
+    printf("Testing: matrix_create_view\n");
+
+    parent = matrix_create(60, 60);
+    if (parent == NULL)
+        goto test_matrix_create_view_skip_remaining_tests;
+    matrix_fill_random(parent, 51);
+
+    printf("  shared storage matrix_create_view test: ");
+    a = matrix_create_view(parent, 2, 3, 20, 30);
+    if (a == NULL)
+        goto test_matrix_create_view_skip_remaining_tests;
+    matrix_set(a, 1, 1, MAT_T(7.0));
+    tests_failed +=
+        mat_t_assert_equal(MAT_T(7.0), matrix_get(parent, 2, 3)) != 0 ? 1 : 0;
+    tests_left--;
+
+    /* views as operands and destination of a product */
+    printf("  matrix_multiply of views test: ");
+    b = matrix_create_view(parent, 25, 31, 30, 20);
+    dest = matrix_create_view(parent, 30, 1, 20, 20);
+    a_copy = matrix_clone(a);
+    b_copy = matrix_clone(b);
+    expected = matrix_create(20, 20);
+    if (b == NULL || dest == NULL || a_copy == NULL || b_copy == NULL
+        || expected == NULL)
+        goto test_matrix_create_view_skip_remaining_tests;
+    matrix_multiply_reference(expected, a_copy, b_copy);
+    if (matrix_multiply(dest, a, b) != 0)
+        goto test_matrix_create_view_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(expected, dest) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  matrix_determinant of a view test: ");
+    matrix_destroy(dest);
+    dest = matrix_create_view(parent, 3, 4, 8, 8);
+    if (dest == NULL)
+        goto test_matrix_create_view_skip_remaining_tests;
+    matrix_destroy(expected);
+    expected = matrix_clone(dest);
+    if (expected == NULL)
+        goto test_matrix_create_view_skip_remaining_tests;
+    tests_failed += mat_t_assert_equal(matrix_determinant(expected),
+                                       matrix_determinant(dest))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    /* a view of a view, written by eigen_hermitian */
+    printf("  eigen_hermitian into a view test: ");
+    matrix_destroy(expected);
+    expected = matrix_create(20, 20);
+    vectors = matrix_create(20, 20);
+    matrix_destroy(b);
+    b = matrix_create_view(parent, 21, 11, 30, 40);
+    if (expected == NULL || vectors == NULL || b == NULL)
+        goto test_matrix_create_view_skip_remaining_tests;
+    vectors_view = matrix_create_view(b, 6, 11, 20, 20);
+    if (vectors_view == NULL || matrix_fill_random_hermitian(expected, 52) != 0
+        || eigen_hermitian(expected, values, vectors) != 0
+        || eigen_hermitian(expected, view_values, vectors_view) != 0)
+        goto test_matrix_create_view_skip_remaining_tests;
+    if (matrix_row(parent, 26) + 20 == matrix_row(vectors_view, 1)) {
+        tests_failed += matrix_assert_equal(vectors, vectors_view) != 0 ? 1
+                                                                        : 0;
+    } else {
+        tests_failed++;
+        printf(RED "Failure: view does not share storage" RESET "\n");
+    }
+    tests_left--;
+
+test_matrix_create_view_skip_remaining_tests:
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(dest);
+    matrix_destroy(vectors_view);
+    matrix_destroy(parent);
+    matrix_destroy(a_copy);
+    matrix_destroy(b_copy);
+    matrix_destroy(expected);
+    matrix_destroy(vectors);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_copy_buffer(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *parent = NULL;
+    Matrix *view = NULL;
+    mat_t buffer[12];
+    mat_t *row, *column;
+    bool success;
+    size_t i;
+
+    printf("Testing: matrix_copy_buffer\n");
+
+    parent = matrix_create(5, 6);
+    if (parent == NULL)
+        goto test_matrix_copy_buffer_skip_remaining_tests;
+    view = matrix_create_view(parent, 2, 2, 3, 4);
+    if (view == NULL)
+        goto test_matrix_copy_buffer_skip_remaining_tests;
+
+    printf("  round trip matrix_copy_buffer test: ");
+    for (i = 0; i < 12; i++) {
+        buffer[i] = MAT_T((double)i);
+    }
+    matrix_copy_from_buffer(view, buffer);
+    for (i = 0; i < 12; i++) {
+        buffer[i] = MAT_T_0;
+    }
+    matrix_copy_to_buffer(view, buffer);
+    success = MAT_T_EQ(matrix_get(parent, 3, 4), MAT_T(6.0))
+              && MAT_T_EQ(matrix_get(parent, 1, 1), MAT_T_0);
+    for (i = 0; i < 12 && success; i++) {
+        success = MAT_T_EQ(buffer[i], MAT_T((double)i));
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: values differ" RESET "\n");
+    }
+    tests_left--;
+
+    printf("  row and column pointer matrix_copy_buffer test: ");
+    row = matrix_row(view, 2);
+    column = matrix_column(view, 3);
+    success = matrix_stride(view) == 6 && MAT_T_EQ(row[0], MAT_T(4.0))
+              && MAT_T_EQ(row[3], MAT_T(7.0))
+              && MAT_T_EQ(column[0], MAT_T(2.0))
+              && MAT_T_EQ(column[2 * matrix_stride(view)], MAT_T(10.0));
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: values differ" RESET "\n");
+    }
+    tests_left--;
+
+test_matrix_copy_buffer_skip_remaining_tests:
+    matrix_destroy(view);
+    matrix_destroy(parent);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+static const double kron_a_values[] = {1.0, 2.0, 3.0, 4.0};
+static const double kron_b_values[] = {0.0, 5.0, 6.0, 7.0};
+static const double kron_values[] = {
+    0.0, 5.0,  0.0,  10.0, 6.0, 7.0,  12.0, 14.0,
+    0.0, 15.0, 0.0,  20.0, 18.0, 21.0, 24.0, 28.0};
+
+int test_matrix_kron(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *a = NULL;
+    Matrix *b = NULL;
+    Matrix *dest = NULL;
+    Matrix *expected = NULL;
+    Matrix *parent = NULL;
+    Matrix *view = NULL;
+
+    printf("Testing: matrix_kron\n");
+
+    a = matrix_create_from_values(2, 2, kron_a_values);
+    b = matrix_create_from_values(2, 2, kron_b_values);
+    dest = matrix_create(4, 4);
+    expected = matrix_create_from_values(4, 4, kron_values);
+    if (a == NULL || b == NULL || dest == NULL || expected == NULL)
+        goto test_matrix_kron_skip_remaining_tests;
+
+    printf("  2x2 by 2x2 matrix_kron test: ");
+    matrix_kron(dest, a, b);
+    tests_failed += matrix_assert_equal(expected, dest) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  into a view matrix_kron test: ");
+    parent = matrix_create(6, 7);
+    if (parent == NULL)
+        goto test_matrix_kron_skip_remaining_tests;
+    view = matrix_create_view(parent, 2, 3, 4, 4);
+    if (view == NULL)
+        goto test_matrix_kron_skip_remaining_tests;
+    matrix_kron(view, a, b);
+    tests_failed += matrix_assert_equal(expected, view) != 0 ? 1 : 0;
+    tests_left--;
+
+test_matrix_kron_skip_remaining_tests:
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(dest);
+    matrix_destroy(expected);
+    matrix_destroy(view);
+    matrix_destroy(parent);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_kronoperator_multiply_vector(void) {
+    const int test_ct = 3;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *factors[10];
+    Matrix *pair = NULL;
+    Matrix *dense = NULL;
+    KronOperator *kron = NULL;
+    mat_t *x = NULL;
+    mat_t *y = NULL;
+    mat_t *expected = NULL;
+    bool success;
+    size_t i;
+
+    printf("Testing: kronoperator_multiply_vector\n");
+
+    for (i = 0; i < 10; i++) {
+        factors[i] = NULL;
+    }
+    x = malloc(1024 * sizeof(mat_t));
+    y = malloc(1024 * sizeof(mat_t));
+    expected = malloc(1024 * sizeof(mat_t));
+    if (x == NULL || y == NULL || expected == NULL)
+        goto test_kronoperator_multiply_vector_skip_remaining_tests;
+
+    /* 2 x 2, 3 x 3 and 4 x 4 factors against their formed product */
+    printf("  3 factor kronoperator_multiply_vector test: ");
+    for (i = 0; i < 3; i++) {
+        factors[i] = matrix_create(i + 2, i + 2);
+        if (factors[i] == NULL)
+            goto test_kronoperator_multiply_vector_skip_remaining_tests;
+        matrix_fill_random(factors[i], 60 + i);
+    }
+    pair = matrix_create(6, 6);
+    dense = matrix_create(24, 24);
+    kron = kronoperator_create(factors, 3);
+    if (pair == NULL || dense == NULL || kron == NULL)
+        goto test_kronoperator_multiply_vector_skip_remaining_tests;
+    matrix_kron(pair, factors[0], factors[1]);
+    matrix_kron(dense, pair, factors[2]);
+    for (i = 0; i < 24; i++) {
+        x[i] = MAT_T((double)i - 10.0);
+    }
+    matvec_dense(dense, x, expected);
+    matvec_kron(kron, x, y);
+    tests_failed += vector_assert_close(expected, y, 24, 1e-12) != 0 ? 1 : 0;
+    tests_left--;
+    kronoperator_destroy(kron);
+    kron = NULL;
+
+    /* X on the fourth of ten qubits flips bit 6 of the index, and the
+     * identities cost nothing */
+    printf("  10 factor kronoperator_multiply_vector test: ");
+    for (i = 0; i < 10; i++) {
+        matrix_destroy(factors[i]);
+        factors[i] = i == 3 ? matrix_create_from_values(2, 2, pauli_x_values)
+                            : matrix_create_identity(2);
+        if (factors[i] == NULL)
+            goto test_kronoperator_multiply_vector_skip_remaining_tests;
+    }
+    kron = kronoperator_create(factors, 10);
+    if (kron == NULL || kronoperator_size(kron) != 1024)
+        goto test_kronoperator_multiply_vector_skip_remaining_tests;
+    for (i = 0; i < 1024; i++) {
+        x[i] = MAT_T((double)i);
+    }
+    kronoperator_multiply_vector(kron, x, y);
+    success = true;
+    for (i = 0; i < 1024 && success; i++) {
+        success = MAT_T_EQ(y[i], MAT_T((double)(i ^ 64)));
+    }
+    if (success) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: wrong permutation" RESET "\n");
+    }
+    tests_left--;
+    kronoperator_destroy(kron);
+    kron = NULL;
+
+    printf("  all identity kronoperator_multiply_vector test: ");
+    matrix_destroy(factors[3]);
+    factors[3] = matrix_create_identity(2);
+    if (factors[3] == NULL)
+        goto test_kronoperator_multiply_vector_skip_remaining_tests;
+    kron = kronoperator_create(factors, 10);
+    if (kron == NULL)
+        goto test_kronoperator_multiply_vector_skip_remaining_tests;
+    kronoperator_multiply_vector(kron, x, y);
+    tests_failed += vector_assert_close(x, y, 1024, 0.0) != 0 ? 1 : 0;
+    tests_left--;
+
+test_kronoperator_multiply_vector_skip_remaining_tests:
+    for (i = 0; i < 10; i++) {
+        matrix_destroy(factors[i]);
+    }
+    matrix_destroy(pair);
+    matrix_destroy(dense);
+    kronoperator_destroy(kron);
+    free(x);
+    free(y);
+    free(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrixarena_allocate(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    MatrixArena *arena = NULL;
+    void *memory;
+    bool success;
+    size_t i;
+
+    printf("Testing: matrixarena_allocate\n");
+
+    arena = matrixarena_create(256);
+    if (arena == NULL)
+        goto test_matrixarena_allocate_skip_remaining_tests;
+
+    /* odd sizes, past the first block */
+    printf("  alignment matrixarena_allocate test: ");
+    success = true;
+    for (i = 1; i <= 40 && success; i++) {
+        memory = matrixarena_allocate(arena, 7 * i);
+        success = memory != NULL
+                  && (size_t)memory % MATRIXARENA_ALIGNMENT == 0;
+    }
+    if (success && matrixarena_capacity(arena) > 256
+        && matrixarena_used(arena) >= 7 * 40) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: misaligned or not grown" RESET "\n");
+    }
+    tests_left--;
+
+    printf("  merging matrixarena_reset test: ");
+    i = matrixarena_capacity(arena);
+    if (matrixarena_reset(arena) == 0 && matrixarena_used(arena) == 0
+        && matrixarena_capacity(arena) == i
+        && matrixarena_allocate(arena, i) != NULL
+        && matrixarena_capacity(arena) == i) {
+        printf(GREEN "Success" RESET "\n");
+    } else {
+        tests_failed++;
+        printf(RED "Failure: blocks not merged" RESET "\n");
+    }
+    tests_left--;
+
+test_matrixarena_allocate_skip_remaining_tests:
+    matrixarena_destroy(arena);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_create_in(void) {
+    const int test_ct = 3;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    MatrixArena *arena = NULL;
+    Matrix *matrix = NULL;
+    Matrix *zeroes = NULL;
+    Matrix *clone;
+    Matrix *in_arena;
+
+    printf("Testing: matrix_create_in\n");
+
+    arena = matrixarena_create(0);
+    matrix = matrix_create(9, 9);
+    zeroes = matrix_create(3, 5);
+    if (arena == NULL || matrix == NULL || zeroes == NULL)
+        goto test_matrix_create_in_skip_remaining_tests;
+    matrix_fill_random(matrix, 71);
+
+    printf("  zeroed and aligned matrix_create_in test: ");
+    in_arena = matrix_create_in(arena, 3, 5);
+    if (in_arena == NULL)
+        goto test_matrix_create_in_skip_remaining_tests;
+    if ((size_t)matrix_row(in_arena, 1) % MATRIXARENA_ALIGNMENT == 0
+        && (size_t)matrix_row(matrix, 1) % MATRIXARENA_ALIGNMENT == 0) {
+        tests_failed += matrix_assert_equal(zeroes, in_arena) != 0 ? 1 : 0;
+    } else {
+        tests_failed++;
+        printf(RED "Failure: values not aligned" RESET "\n");
+    }
+    /* a no-op for matrices in an arena */
+    matrix_destroy(in_arena);
+    tests_left--;
+
+    printf("  matrix_clone_in test: ");
+    clone = matrix_clone_in(arena, matrix);
+    if (clone == NULL)
+        goto test_matrix_create_in_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(matrix, clone) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  matrix_determinant_in test: ");
+    if (matrixarena_reset(arena) != 0)
+        goto test_matrix_create_in_skip_remaining_tests;
+    tests_failed += mat_t_assert_equal(matrix_determinant(matrix),
+                                       matrix_determinant_in(arena, matrix))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+test_matrix_create_in_skip_remaining_tests:
+    matrix_destroy(matrix);
+    matrix_destroy(zeroes);
+    matrixarena_destroy(arena);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_mat2_multiply(void) {
+    const int test_ct = 5;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *a = NULL;
+    Matrix *b = NULL;
+    Matrix *expected = NULL;
+    Matrix *actual = NULL;
+    Mat2 x, y, z;
+
+    printf("Testing: mat2_multiply\n");
+
+    a = matrix_create(2, 2);
+    b = matrix_create(2, 2);
+    expected = matrix_create(2, 2);
+    actual = matrix_create(2, 2);
+    if (a == NULL || b == NULL || expected == NULL || actual == NULL)
+        goto test_mat2_multiply_skip_remaining_tests;
+    matrix_fill_random(a, 1);
+    matrix_fill_random(b, 2);
+    mat2_from_matrix(&x, a);
+    mat2_from_matrix(&y, b);
+
+    printf("  random mat2_multiply test: ");
+    if (matrix_multiply(expected, a, b) != 0)
+        goto test_mat2_multiply_skip_remaining_tests;
+    mat2_multiply(&z, &x, &y);
+    mat2_to_matrix(actual, &z);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  random mat2_determinant test: ");
+    tests_failed += mat_t_assert_equal(matrix_determinant(a),
+                                       mat2_determinant(&x))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    /* a a^-1 = I, inverting in place */
+    printf("  random mat2_inverse test: ");
+    z = x;
+    if (mat2_inverse(&z, &z) != 0)
+        goto test_mat2_multiply_skip_remaining_tests;
+    mat2_multiply(&z, &x, &z);
+    mat2_to_matrix(actual, &z);
+    mat2_identity(&z);
+    mat2_to_matrix(expected, &z);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  singular mat2_inverse test: ");
+    mat2_from_matrix(&x, a);
+    x.values[2] = MAT_T_MUL(MAT_T(2.0), x.values[0]);
+    x.values[3] = MAT_T_MUL(MAT_T(2.0), x.values[1]);
+    tests_failed += size_t_assert_equal(1, mat2_inverse(&y, &x) != 0) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    /* determinant 1e-12, far below MAT_T_PRECISION */
+    printf("  scaled mat2_inverse test: ");
+    mat2_identity(&x);
+    x.values[0] = MAT_T(1e-6);
+    x.values[3] = MAT_T(1e-6);
+    if (mat2_inverse(&y, &x) != 0) {
+        tests_failed++;
+        printf(RED "Failure: reported singular" RESET "\n");
+    } else {
+        mat2_multiply(&z, &x, &y);
+        mat2_to_matrix(actual, &z);
+        mat2_identity(&z);
+        mat2_to_matrix(expected, &z);
+        tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    }
+    tests_left--;
+
+test_mat2_multiply_skip_remaining_tests:
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(expected);
+    matrix_destroy(actual);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_mat4_multiply(void) {
+    const int test_ct = 4;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *a = NULL;
+    Matrix *b = NULL;
+    Matrix *expected = NULL;
+    Matrix *actual = NULL;
+    Mat4 x, y, z;
+
+    printf("Testing: mat4_multiply\n");
+
+    a = matrix_create(4, 4);
+    b = matrix_create(4, 4);
+    expected = matrix_create(4, 4);
+    actual = matrix_create(4, 4);
+    if (a == NULL || b == NULL || expected == NULL || actual == NULL)
+        goto test_mat4_multiply_skip_remaining_tests;
+    matrix_fill_random(a, 3);
+    matrix_fill_random(b, 4);
+    mat4_from_matrix(&x, a);
+    mat4_from_matrix(&y, b);
+
+    /* into the right operand */
+    printf("  random mat4_multiply test: ");
+    if (matrix_multiply(expected, a, b) != 0)
+        goto test_mat4_multiply_skip_remaining_tests;
+    mat4_multiply(&y, &x, &y);
+    mat4_to_matrix(actual, &y);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  random mat4_determinant test: ");
+    tests_failed += mat_t_assert_equal(matrix_determinant(a),
+                                       mat4_determinant(&x))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    printf("  random mat4_inverse test: ");
+    if (mat4_inverse(&z, &x) != 0)
+        goto test_mat4_multiply_skip_remaining_tests;
+    mat4_multiply(&z, &z, &x);
+    mat4_to_matrix(actual, &z);
+    mat4_identity(&z);
+    mat4_to_matrix(expected, &z);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+    /* 1e-6 I, with determinant 1e-24 */
+    printf("  scaled mat4_inverse test: ");
+    mat4_identity(&x);
+    x.values[0] = x.values[5] = x.values[10] = x.values[15] = MAT_T(1e-6);
+    if (mat4_inverse(&z, &x) != 0) {
+        tests_failed++;
+        printf(RED "Failure: reported singular" RESET "\n");
+    } else {
+        mat4_multiply(&z, &z, &x);
+        mat4_to_matrix(actual, &z);
+        mat4_identity(&z);
+        mat4_to_matrix(expected, &z);
+        tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    }
+    tests_left--;
+
+test_mat4_multiply_skip_remaining_tests:
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(expected);
+    matrix_destroy(actual);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_mat4_kron(void) {
+    const int test_ct = 4;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *high = NULL;
+    Matrix *low = NULL;
+    Matrix *expected = NULL;
+    Matrix *actual = NULL;
+    Mat2 g, h, identity;
+    Mat4 a, x, y;
+
+    printf("Testing: mat4_kron\n");
+
+    high = matrix_create_from_values(2, 2, kron_a_values);
+    low = matrix_create_from_values(2, 2, kron_b_values);
+    expected = matrix_create(4, 4);
+    actual = matrix_create(4, 4);
+    if (high == NULL || low == NULL || expected == NULL || actual == NULL)
+        goto test_mat4_kron_skip_remaining_tests;
+    mat2_from_matrix(&g, high);
+    mat2_from_matrix(&h, low);
+    mat2_identity(&identity);
+    matrix_fill_random(actual, 5);
+    mat4_from_matrix(&a, actual);
+
+    printf("  2x2 by 2x2 mat4_kron test: ");
+    matrix_kron(expected, high, low);
+    mat4_kron(&x, &g, &h);
+    mat4_to_matrix(actual, &x);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  mat4_apply_high test: ");
+    mat4_kron(&x, &g, &identity);
+    mat4_multiply(&x, &x, &a);
+    mat4_to_matrix(expected, &x);
+    y = a;
+    mat4_apply_high(&y, &g, &y);
+    mat4_to_matrix(actual, &y);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  mat4_apply_low test: ");
+    mat4_kron(&x, &identity, &h);
+    mat4_multiply(&x, &x, &a);
+    mat4_to_matrix(expected, &x);
+    mat4_apply_low(&y, &h, &a);
+    mat4_to_matrix(actual, &y);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+    /* controlled X is CNOT, which swaps basis states 2 and 3 */
+    printf("  CNOT mat4_controlled test: ");
+    matrix_destroy(high);
+    high = matrix_create_from_values(2, 2, pauli_x_values);
+    if (high == NULL)
+        goto test_mat4_kron_skip_remaining_tests;
+    mat2_from_matrix(&g, high);
+    mat4_controlled(&x, &g);
+    mat4_to_matrix(actual, &x);
+    mat4_identity(&y);
+    y.values[10] = MAT_T_0;
+    y.values[11] = MAT_T_1;
+    y.values[14] = MAT_T_1;
+    y.values[15] = MAT_T_0;
+    mat4_to_matrix(expected, &y);
+    tests_failed += matrix_assert_equal(expected, actual) != 0 ? 1 : 0;
+    tests_left--;
+
+test_mat4_kron_skip_remaining_tests:
+    matrix_destroy(high);
+    matrix_destroy(low);
+    matrix_destroy(expected);
+    matrix_destroy(actual);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_statevector_apply_kq(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state = NULL;
+    Matrix *swap = NULL;
+    Matrix *gate = NULL;
+    Matrix *expected = NULL;
+    size_t qubits[3];
+
+    printf("Testing: statevector_apply_kq\n");
+
+    swap = matrix_create_from_values(4, 4, swap_values);
+    if (swap == NULL)
+        goto test_statevector_apply_kq_skip_remaining_tests;
+
+    printf("  2 qubit statevector_apply_kq test: ");
+    state = statevector_create(3);
+    expected = matrix_create(8, 1);
+    if (state == NULL || expected == NULL)
+        goto test_statevector_apply_kq_skip_remaining_tests;
+    /* |001> -> |100> */
+    statevector_set(state, 0, MAT_T_0);
+    statevector_set(state, 1, MAT_T_1);
+    qubits[0] = 2;
+    qubits[1] = 0;
+    statevector_apply_kq(state, swap, qubits, 2);
+    matrix_set(expected, 5, 1, MAT_T_1);
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+    statevector_destroy(state);
+    matrix_destroy(expected);
+
+    /* controlled swap, control most significant */
+    printf("  3 qubit statevector_apply_kq test: ");
+    state = statevector_create(4);
+    expected = matrix_create(16, 1);
+    gate = matrix_create_identity(8);
+    if (state == NULL || expected == NULL || gate == NULL)
+        goto test_statevector_apply_kq_skip_remaining_tests;
+    matrix_set(gate, 6, 6, MAT_T_0);
+    matrix_set(gate, 7, 7, MAT_T_0);
+    matrix_set(gate, 6, 7, MAT_T_1);
+    matrix_set(gate, 7, 6, MAT_T_1);
+    /* |1010> -> |1100> with control 3 and swapped qubits 2 and 1 */
+    statevector_set(state, 0, MAT_T_0);
+    statevector_set(state, 10, MAT_T_1);
+    qubits[0] = 3;
+    qubits[1] = 2;
+    qubits[2] = 1;
+    statevector_apply_kq(state, gate, qubits, 3);
+    matrix_set(expected, 13, 1, MAT_T_1);
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_statevector_apply_kq_skip_remaining_tests:
+    statevector_destroy(state);
+    matrix_destroy(swap);
+    matrix_destroy(gate);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_circuit_compile(void) {
+    const int test_ct = 3;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Circuit *circuit = NULL;
+    StateVector *state = NULL;
+    Matrix *hadamard = NULL;
+    Matrix *pauli_x = NULL;
+    Matrix *expected = NULL;
+    size_t layer, q;
+
+    printf("Testing: circuit_compile\n");
+
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    pauli_x = matrix_create_from_values(2, 2, pauli_x_values);
+    if (hadamard == NULL || pauli_x == NULL)
+        goto test_circuit_compile_skip_remaining_tests;
+
+    /* H0 H1 CNOT(0, 1) fuse, and X3 cannot join them */
+    printf("  2 qubit fusion circuit_compile test: ");
+    circuit = circuit_create(4);
+    if (circuit == NULL || circuit_add_1q(circuit, hadamard, 0) != 0
+        || circuit_add_1q(circuit, hadamard, 1) != 0
+        || circuit_add_controlled_1q(circuit, pauli_x, 0, 1) != 0
+        || circuit_add_1q(circuit, pauli_x, 3) != 0
+        || circuit_compile(circuit, 2) != 0)
+        goto test_circuit_compile_skip_remaining_tests;
+    tests_failed += size_t_assert_equal(2, circuit_passes(circuit)) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+    circuit_destroy(circuit);
+
+    /* the second H0 moves up past CNOT(1, 2), which it commutes with */
+    printf("  commuting circuit_compile test: ");
+    circuit = circuit_create(3);
+    if (circuit == NULL || circuit_add_1q(circuit, hadamard, 0) != 0
+        || circuit_add_controlled_1q(circuit, pauli_x, 1, 2) != 0
+        || circuit_add_1q(circuit, hadamard, 0) != 0
+        || circuit_compile(circuit, 2) != 0)
+        goto test_circuit_compile_skip_remaining_tests;
+    tests_failed += size_t_assert_equal(2, circuit_passes(circuit)) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+    circuit_destroy(circuit);
+
+    /* layers of H and CNOTs, run gate by gate and compiled */
+    printf("  layered circuit circuit_compile test: ");
+    circuit = circuit_create(6);
+    state = statevector_create(6);
+    expected = matrix_create(64, 1);
+    if (circuit == NULL || state == NULL || expected == NULL)
+        goto test_circuit_compile_skip_remaining_tests;
+    for (layer = 0; layer < 3; layer++) {
+        for (q = 0; q < 6; q++) {
+            if (circuit_add_1q(circuit,
+                               (q + layer) % 3 == 0 ? pauli_x : hadamard, q)
+                != 0)
+                goto test_circuit_compile_skip_remaining_tests;
+        }
+        for (q = layer % 2; q + 1 < 6; q += 2) {
+            if (circuit_add_controlled_1q(circuit, pauli_x, q, q + 1) != 0)
+                goto test_circuit_compile_skip_remaining_tests;
+        }
+    }
+    circuit_run(circuit, state);
+    for (q = 0; q < 64; q++) {
+        matrix_set(expected, q + 1, 1, statevector_get(state, q));
+    }
+    statevector_destroy(state);
+    state = statevector_create(6);
+    if (state == NULL || circuit_compile(circuit, 3) != 0)
+        goto test_circuit_compile_skip_remaining_tests;
+    circuit_run(circuit, state);
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_circuit_compile_skip_remaining_tests:
+    circuit_destroy(circuit);
+    statevector_destroy(state);
+    matrix_destroy(hadamard);
+    matrix_destroy(pauli_x);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_tableau_measure(void) {
+    const int test_ct = 6;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Tableau *tableau = NULL;
+    bool deterministic, agree;
+    int first, outcome;
+    size_t q;
+
+    printf("Testing: tableau_measure\n");
+
+    printf("  |0> tableau_measure test: ");
+    tableau = tableau_create(3, 1);
+    if (tableau == NULL)
+        goto test_tableau_measure_skip_remaining_tests;
+    outcome = tableau_measure(tableau, 1, &deterministic);
+    tests_failed += size_t_assert_equal(1, deterministic && outcome == 0) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+    /* Y|0> = i|1>, and H S S H = H Z H = X */
+    printf("  Pauli and phase tableau_measure test: ");
+    tableau_y(tableau, 0);
+    tableau_h(tableau, 2);
+    tableau_s(tableau, 2);
+    tableau_s(tableau, 2);
+    tableau_h(tableau, 2);
+    tableau_z(tableau, 1);
+    agree = tableau_measure(tableau, 0, &deterministic) == 1 && deterministic;
+    agree = agree && tableau_measure(tableau, 1, &deterministic) == 0
+            && deterministic;
+    agree = agree && tableau_measure(tableau, 2, &deterministic) == 1
+            && deterministic;
+    tests_failed += size_t_assert_equal(1, agree) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  superposition tableau_measure test: ");
+    tableau_h(tableau, 1);
+    first = tableau_measure(tableau, 1, &deterministic);
+    agree = !deterministic;
+    outcome = tableau_measure(tableau, 1, &deterministic);
+    tests_failed += size_t_assert_equal(1, agree && deterministic
+                                               && outcome == first)
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+    tableau_destroy(tableau);
+
+    /* X on one half of a Bell pair anticorrelates the outcomes */
+    printf("  Bell pair tableau_measure test: ");
+    tableau = tableau_create(2, 7);
+    if (tableau == NULL)
+        goto test_tableau_measure_skip_remaining_tests;
+    tableau_h(tableau, 0);
+    tableau_cnot(tableau, 0, 1);
+    tableau_x(tableau, 1);
+    first = tableau_measure(tableau, 0, &deterministic);
+    agree = !deterministic;
+    outcome = tableau_measure(tableau, 1, &deterministic);
+    tests_failed += size_t_assert_equal(1, agree && deterministic
+                                               && outcome != first)
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+    tableau_destroy(tableau);
+
+    /* spans several words of generators */
+    printf("  200 qubit GHZ tableau_measure test: ");
+    tableau = tableau_create(200, 3);
+    if (tableau == NULL)
+        goto test_tableau_measure_skip_remaining_tests;
+    tableau_h(tableau, 0);
+    for (q = 0; q + 1 < 200; q++) {
+        tableau_cnot(tableau, q, q + 1);
+    }
+    first = tableau_measure(tableau, 150, &deterministic);
+    agree = !deterministic;
+    for (q = 0; q < 200; q++) {
+        outcome = tableau_measure(tableau, q, &deterministic);
+        agree = agree && deterministic && outcome == first;
+    }
+    tests_failed += size_t_assert_equal(1, agree) != 0 ? 1 : 0;
+    tests_left--;
+    tableau_destroy(tableau);
+
+    printf("  deterministic sign tableau_measure test: ");
+    tableau = tableau_create(70, 5);
+    if (tableau == NULL)
+        goto test_tableau_measure_skip_remaining_tests;
+    /* spread |-> over qubits in two words, apply S^4 = I, and undo it: the
+     * sign must come back to qubit 65 */
+    tableau_x(tableau, 65);
+    tableau_h(tableau, 65);
+    tableau_cnot(tableau, 65, 3);
+    tableau_cnot(tableau, 3, 40);
+    tableau_s(tableau, 40);
+    tableau_s(tableau, 40);
+    tableau_s(tableau, 40);
+    tableau_s(tableau, 40);
+    tableau_cnot(tableau, 3, 40);
+    tableau_cnot(tableau, 65, 3);
+    tableau_h(tableau, 65);
+    agree = tableau_measure(tableau, 65, &deterministic) == 1 && deterministic;
+    agree = agree && tableau_measure(tableau, 3, &deterministic) == 0
+            && deterministic;
+    agree = agree && tableau_measure(tableau, 40, &deterministic) == 0
+            && deterministic;
+    tests_failed += size_t_assert_equal(1, agree) != 0 ? 1 : 0;
+    tests_left--;
+
+test_tableau_measure_skip_remaining_tests:
+    tableau_destroy(tableau);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_densitymatrix_apply_1q(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state = NULL;
+    DensityMatrix *rho = NULL;
+    DensityMatrix *expected = NULL;
+    Matrix *hadamard = NULL;
+    Matrix *gate = NULL;
+
+    printf("Testing: densitymatrix_apply_1q\n");
+
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    gate = matrix_create(4, 4);
+    state = statevector_create(3);
+    rho = densitymatrix_create(3);
+    if (hadamard == NULL || gate == NULL || state == NULL || rho == NULL)
+        goto test_densitymatrix_apply_1q_skip_remaining_tests;
+    matrix_fill_random(gate, 11);
+
+    /* pure states stay |psi><psi| */
+    printf("  H densitymatrix_apply_1q test: ");
+    statevector_apply_1q(state, hadamard, 1);
+    densitymatrix_apply_1q(rho, hadamard, 1);
+    expected = densitymatrix_create_from_state(state);
+    if (expected == NULL)
+        goto test_densitymatrix_apply_1q_skip_remaining_tests;
+    tests_failed += densitymatrix_assert_equal(expected, rho) != 0 ? 1 : 0;
+    tests_left--;
+    densitymatrix_destroy(expected);
+    expected = NULL;
+
+    printf("  random 2 qubit densitymatrix_apply_2q test: ");
+    statevector_apply_2q(state, gate, 0, 2);
+    densitymatrix_apply_2q(rho, gate, 0, 2);
+    expected = densitymatrix_create_from_state(state);
+    if (expected == NULL)
+        goto test_densitymatrix_apply_1q_skip_remaining_tests;
+    tests_failed += densitymatrix_assert_equal(expected, rho) != 0 ? 1 : 0;
+    tests_left--;
+
+test_densitymatrix_apply_1q_skip_remaining_tests:
+    statevector_destroy(state);
+    densitymatrix_destroy(rho);
+    densitymatrix_destroy(expected);
+    matrix_destroy(hadamard);
+    matrix_destroy(gate);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_densitymatrix_depolarize(void) {
+    const int test_ct = 3;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    const double p = 0.3;
+    const double gamma = 0.2;
+    StateVector *state = NULL;
+    DensityMatrix *rho = NULL;
+    DensityMatrix *expected = NULL;
+    Matrix *hadamard = NULL;
+    Matrix *pauli_x = NULL;
+    Matrix *operators[4] = {NULL, NULL, NULL, NULL};
+    size_t k;
+
+    printf("Testing: densitymatrix_depolarize\n");
+
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    pauli_x = matrix_create_from_values(2, 2, pauli_x_values);
+    state = statevector_create(2);
+    for (k = 0; k < 4; k++) {
+        operators[k] = matrix_create(2, 2);
+    }
+    if (hadamard == NULL || pauli_x == NULL || state == NULL
+        || operators[0] == NULL || operators[1] == NULL
+        || operators[2] == NULL || operators[3] == NULL)
+        goto test_densitymatrix_depolarize_skip_remaining_tests;
+    statevector_apply_1q(state, hadamard, 0);
+    statevector_apply_controlled_1q(state, pauli_x, 0, 1);
+    rho = densitymatrix_create_from_state(state);
+    expected = densitymatrix_create_from_state(state);
+    if (rho == NULL || expected == NULL)
+        goto test_densitymatrix_depolarize_skip_remaining_tests;
+
+    /* sqrt(1 - p) I, sqrt(p / 3) X, Y and Z */
+    printf("  against Kraus densitymatrix_depolarize test: ");
+    matrix_set(operators[0], 1, 1, MAT_T(sqrt(1.0 - p)));
+    matrix_set(operators[0], 2, 2, MAT_T(sqrt(1.0 - p)));
+    matrix_set(operators[1], 1, 2, MAT_T(sqrt(p / 3.0)));
+    matrix_set(operators[1], 2, 1, MAT_T(sqrt(p / 3.0)));
+    matrix_set(operators[3], 1, 1, MAT_T(sqrt(p / 3.0)));
+    matrix_set(operators[3], 2, 2, MAT_T(-sqrt(p / 3.0)));
+#ifdef MAT_T_COMPLEX
+    matrix_set(operators[2], 1, 2, MAT_T_MUL(MAT_T(-sqrt(p / 3.0)), MAT_T_I));
+    matrix_set(operators[2], 2, 1, MAT_T_MUL(MAT_T(sqrt(p / 3.0)), MAT_T_I));
+#else
+    /* Y rho Y with real amplitudes is -(iY) rho (iY), and iY is real */
+    matrix_set(operators[2], 1, 2, MAT_T(sqrt(p / 3.0)));
+    matrix_set(operators[2], 2, 1, MAT_T(-sqrt(p / 3.0)));
+#endif
+    densitymatrix_depolarize(rho, p, 1);
+    if (densitymatrix_apply_kraus_1q(expected, operators, 4, 1) != 0)
+        goto test_densitymatrix_depolarize_skip_remaining_tests;
+    tests_failed += densitymatrix_assert_equal(expected, rho) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  against Kraus densitymatrix_amplitude_damp test: ");
+    for (k = 0; k < 4; k++) {
+        matrix_set(operators[k / 2], k % 2 + 1, k % 2 + 1, MAT_T_0);
+    }
+    matrix_set(operators[0], 1, 1, MAT_T_1);
+    matrix_set(operators[0], 2, 2, MAT_T(sqrt(1.0 - gamma)));
+    matrix_set(operators[1], 1, 2, MAT_T(sqrt(gamma)));
+    matrix_set(operators[1], 2, 1, MAT_T_0);
+    densitymatrix_amplitude_damp(rho, gamma, 0);
+    if (densitymatrix_apply_kraus_1q(expected, operators, 2, 0) != 0)
+        goto test_densitymatrix_depolarize_skip_remaining_tests;
+    tests_failed += densitymatrix_assert_equal(expected, rho) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  trace preserving densitymatrix_depolarize test: ");
+    tests_failed += mat_t_assert_equal(MAT_T_1, densitymatrix_trace(rho)) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+test_densitymatrix_depolarize_skip_remaining_tests:
+    statevector_destroy(state);
+    densitymatrix_destroy(rho);
+    densitymatrix_destroy(expected);
+    matrix_destroy(hadamard);
+    matrix_destroy(pauli_x);
+    for (k = 0; k < 4; k++) {
+        matrix_destroy(operators[k]);
+    }
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_densitymatrix_partial_trace(void) {
+    const int test_ct = 2;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    StateVector *state = NULL;
+    DensityMatrix *rho = NULL;
+    DensityMatrix *reduced = NULL;
+    DensityMatrix *expected = NULL;
+    Matrix *hadamard = NULL;
+    Matrix *pauli_x = NULL;
+    size_t traced[2];
+
+    printf("Testing: densitymatrix_partial_trace\n");
+
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    pauli_x = matrix_create_from_values(2, 2, pauli_x_values);
+    if (hadamard == NULL || pauli_x == NULL)
+        goto test_densitymatrix_partial_trace_skip_remaining_tests;
+
+    /* half of a Bell pair is maximally mixed */
+    printf("  Bell pair densitymatrix_partial_trace test: ");
+    state = statevector_create(2);
+    reduced = densitymatrix_create(1);
+    if (state == NULL || reduced == NULL)
+        goto test_densitymatrix_partial_trace_skip_remaining_tests;
+    statevector_apply_1q(state, hadamard, 0);
+    statevector_apply_controlled_1q(state, pauli_x, 0, 1);
+    rho = densitymatrix_create_from_state(state);
+    if (rho == NULL)
+        goto test_densitymatrix_partial_trace_skip_remaining_tests;
+    traced[0] = 1;
+    densitymatrix_partial_trace(reduced, rho, traced, 1);
+    tests_failed += mat_t_assert_equal(MAT_T(0.5),
+                                       densitymatrix_get(reduced, 1, 1))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+    statevector_destroy(state);
+    densitymatrix_destroy(rho);
+    densitymatrix_destroy(reduced);
+    rho = NULL;
+    reduced = NULL;
+
+    /* |+> (x) Bell pair on qubits 0 and 2 (x) |1>, tracing out 0 and 2 */
+    printf("  product state densitymatrix_partial_trace test: ");
+    state = statevector_create(4);
+    reduced = densitymatrix_create(2);
+    if (state == NULL || reduced == NULL)
+        goto test_densitymatrix_partial_trace_skip_remaining_tests;
+    statevector_apply_1q(state, hadamard, 1);
+    statevector_apply_1q(state, hadamard, 0);
+    statevector_apply_controlled_1q(state, pauli_x, 0, 2);
+    statevector_apply_1q(state, pauli_x, 3);
+    rho = densitymatrix_create_from_state(state);
+    statevector_destroy(state);
+    state = statevector_create(2);
+    if (rho == NULL || state == NULL)
+        goto test_densitymatrix_partial_trace_skip_remaining_tests;
+    statevector_apply_1q(state, hadamard, 0);
+    statevector_apply_1q(state, pauli_x, 1);
+    expected = densitymatrix_create_from_state(state);
+    if (expected == NULL)
+        goto test_densitymatrix_partial_trace_skip_remaining_tests;
+    traced[0] = 2;
+    traced[1] = 0;
+    densitymatrix_partial_trace(reduced, rho, traced, 2);
+    tests_failed += densitymatrix_assert_equal(expected, reduced) != 0 ? 1 : 0;
+    tests_left--;
+
+test_densitymatrix_partial_trace_skip_remaining_tests:
+    statevector_destroy(state);
+    densitymatrix_destroy(rho);
+    densitymatrix_destroy(reduced);
+    densitymatrix_destroy(expected);
+    matrix_destroy(hadamard);
+    matrix_destroy(pauli_x);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_sampler_sample(void) {
+    const int test_ct = 4;
+    const size_t shots = 200003;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    ThreadPool *pool = NULL;
+    ThreadPool *wide_pool = NULL;
+    StateVector *state = NULL;
+    Sampler *sampler = NULL;
+    Matrix *pauli_x = NULL;
+    Matrix *gate = NULL;
+    size_t *results = NULL;
+    size_t *counts = NULL;
+    size_t tally[8];
+    size_t i, bad;
+    double p, norm;
+
+    printf("Testing: sampler_sample\n");
+
+    pool = threadpool_create(4);
+    wide_pool = threadpool_create(8);
+    pauli_x = matrix_create_from_values(2, 2, pauli_x_values);
+    gate = matrix_create(4, 4);
+    state = statevector_create(3);
+    results = malloc(shots * sizeof(size_t));
+    counts = malloc(8 * sizeof(size_t));
+    if (pool == NULL || wide_pool == NULL || pauli_x == NULL || gate == NULL
+        || state == NULL || results == NULL || counts == NULL)
+        goto test_sampler_sample_skip_remaining_tests;
+    matrix_fill_random(gate, 13);
+
+    printf("  basis state sampler_sample test: ");
+    statevector_apply_1q(state, pauli_x, 0);
+    statevector_apply_1q(state, pauli_x, 2);
+    sampler = sampler_create(state);
+    if (sampler == NULL)
+        goto test_sampler_sample_skip_remaining_tests;
+    sampler_sample(sampler, results, 1000, 1, pool);
+    for (i = bad = 0; i < 1000; i++) {
+        bad += results[i] != 5 ? 1 : 0;
+    }
+    tests_failed += size_t_assert_equal(0, bad) != 0 ? 1 : 0;
+    tests_left--;
+    sampler_destroy(sampler);
+    sampler = NULL;
+
+    /* the state is not normalized, so the sampler has to scale it */
+    printf("  threads agree sampler_histogram test: ");
+    statevector_apply_2q(state, gate, 1, 0);
+    statevector_apply_2q(state, gate, 2, 1);
+    sampler = sampler_create(state);
+    if (sampler == NULL)
+        goto test_sampler_sample_skip_remaining_tests;
+    sampler_sample(sampler, results, shots, 7, NULL);
+    if (sampler_histogram(sampler, counts, shots, 7, pool) != 0)
+        goto test_sampler_sample_skip_remaining_tests;
+    for (i = 0; i < 8; i++) {
+        tally[i] = 0;
+    }
+    for (i = 0; i < shots; i++) {
+        tally[results[i]]++;
+    }
+    for (i = bad = 0; i < 8; i++) {
+        bad += tally[i] != counts[i] ? 1 : 0;
+    }
+    tests_failed += size_t_assert_equal(0, bad) != 0 ? 1 : 0;
+    tests_left--;
+
+    /* within 5 standard deviations of the expected count */
+    printf("  frequencies sampler_histogram test: ");
+    norm = statevector_norm(state);
+    for (i = bad = 0; i < 8; i++) {
+        p = MAT_T_ABS2(statevector_get(state, i)) / (norm * norm);
+        if (fabs((double)counts[i] - p * (double)shots)
+            > 5 * sqrt(p * (1 - p) * (double)shots) + 1e-9) {
+            bad++;
+        }
+    }
+    tests_failed += size_t_assert_equal(0, bad) != 0 ? 1 : 0;
+    tests_left--;
+
+    /* fewer blocks than threads, so some workers get no blocks */
+    printf("  fewer blocks than threads sampler_histogram test: ");
+    sampler_sample(sampler, results, 3 * SAMPLER_BLOCK, 11, NULL);
+    if (sampler_histogram(sampler, counts, 3 * SAMPLER_BLOCK, 11, wide_pool)
+        != 0)
+        goto test_sampler_sample_skip_remaining_tests;
+    for (i = 0; i < 8; i++) {
+        tally[i] = 0;
+    }
+    for (i = 0; i < 3 * SAMPLER_BLOCK; i++) {
+        tally[results[i]]++;
+    }
+    for (i = bad = 0; i < 8; i++) {
+        bad += tally[i] != counts[i] ? 1 : 0;
+    }
+    tests_failed += size_t_assert_equal(0, bad) != 0 ? 1 : 0;
+    tests_left--;
+
+test_sampler_sample_skip_remaining_tests:
+    threadpool_destroy(pool);
+    threadpool_destroy(wide_pool);
+    sampler_destroy(sampler);
+    statevector_destroy(state);
+    matrix_destroy(pauli_x);
+    matrix_destroy(gate);
+    free(results);
+    free(counts);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_svd(void) {
+    const int test_ct = 4;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *tall = NULL, *wide = NULL, *product = NULL;
+    Matrix *u = NULL, *v = NULL;
+    double s[3], values[3];
+    bool sorted;
+
+    printf("Testing: matrix_svd\n");
+
+    tall = matrix_create(5, 3);
+    wide = matrix_create(3, 5);
+    u = matrix_create(5, 3);
+    v = matrix_create(3, 3);
+    product = matrix_create(5, 3);
+    if (tall == NULL || wide == NULL || u == NULL || v == NULL
+        || product == NULL)
+        goto test_matrix_svd_skip_remaining_tests;
+    matrix_fill_random(tall, 14);
+    matrix_fill_random(wide, 15);
+
+    printf("  5 x 3 matrix_svd test: ");
+    if (matrix_svd(u, s, v, tall) != 0)
+        goto test_matrix_svd_skip_remaining_tests;
+    matrix_svd_reconstruct(product, u, s, v);
+    tests_failed += matrix_assert_equal(tall, product) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  decreasing singular values matrix_svd test: ");
+    sorted = s[0] >= s[1] && s[1] >= s[2] && s[2] > 0;
+    tests_failed += size_t_assert_equal(1, sorted ? 1 : 0) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(u);
+    matrix_destroy(v);
+    matrix_destroy(product);
+    v = product = NULL;
+
+    /* the wide case factors the conjugate transpose */
+    printf("  3 x 5 matrix_svd test: ");
+    u = matrix_create(3, 3);
+    v = matrix_create(5, 3);
+    product = matrix_create(3, 5);
+    if (u == NULL || v == NULL || product == NULL)
+        goto test_matrix_svd_skip_remaining_tests;
+    if (matrix_svd(u, s, v, wide) != 0)
+        goto test_matrix_svd_skip_remaining_tests;
+    matrix_svd_reconstruct(product, u, s, v);
+    tests_failed += matrix_assert_equal(wide, product) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  values only matrix_svd test: ");
+    if (matrix_svd(NULL, values, NULL, wide) != 0)
+        goto test_matrix_svd_skip_remaining_tests;
+    tests_failed += mat_t_assert_equal(MAT_T(s[0] + s[1] + s[2]),
+                                       MAT_T(values[0] + values[1] + values[2]))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+test_matrix_svd_skip_remaining_tests:
+    matrix_destroy(tall);
+    matrix_destroy(wide);
+    matrix_destroy(u);
+    matrix_destroy(v);
+    matrix_destroy(product);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_mps_apply_2q(void) {
+    const int test_ct = 3;
+    const size_t qubits = 5;
+    const double angle = 0.7;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Mps *mps = NULL;
+    StateVector *state = NULL;
+    Matrix *hadamard = NULL, *rotation = NULL, *cnot = NULL;
+    Matrix *amplitudes = NULL;
+    size_t i;
+
+    printf("Testing: mps_apply_2q\n");
+
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    rotation = matrix_create(2, 2);
+    cnot = matrix_create(4, 4);
+    amplitudes = matrix_create((size_t)1 << qubits, 1);
+    mps = mps_create(qubits, 0, 0);
+    state = statevector_create(qubits);
+    if (hadamard == NULL || rotation == NULL || cnot == NULL
+        || amplitudes == NULL || mps == NULL || state == NULL)
+        goto test_mps_apply_2q_skip_remaining_tests;
+    matrix_set(rotation, 1, 1, MAT_T(cos(angle)));
+    matrix_set(rotation, 1, 2, MAT_T(-sin(angle)));
+    matrix_set(rotation, 2, 1, MAT_T(sin(angle)));
+    matrix_set(rotation, 2, 2, MAT_T(cos(angle)));
+    matrix_set(cnot, 1, 1, MAT_T_1);
+    matrix_set(cnot, 2, 2, MAT_T_1);
+    matrix_set(cnot, 3, 4, MAT_T_1);
+    matrix_set(cnot, 4, 3, MAT_T_1);
+
+    /* neighbours in both orders, and qubits far apart */
+    printf("  against StateVector mps_apply_2q test: ");
+    for (i = 0; i < qubits; i++) {
+        mps_apply_1q(mps, i % 2 ? rotation : hadamard, i);
+        statevector_apply_1q(state, i % 2 ? rotation : hadamard, i);
+    }
+    if (mps_apply_2q(mps, cnot, 1, 2) != 0
+        || mps_apply_2q(mps, cnot, 4, 3) != 0
+        || mps_apply_2q(mps, cnot, 0, 4) != 0
+        || mps_apply_2q(mps, cnot, 3, 1) != 0)
+        goto test_mps_apply_2q_skip_remaining_tests;
+    statevector_apply_2q(state, cnot, 1, 2);
+    statevector_apply_2q(state, cnot, 4, 3);
+    statevector_apply_2q(state, cnot, 0, 4);
+    statevector_apply_2q(state, cnot, 3, 1);
+    mps_apply_1q(mps, rotation, 2);
+    statevector_apply_1q(state, rotation, 2);
+    for (i = 0; i < statevector_size(state); i++) {
+        matrix_set(amplitudes, i + 1, 1, mps_get(mps, i));
+    }
+    tests_failed += statevector_assert_equal(state, amplitudes) != 0 ? 1 : 0;
+    tests_left--;
+    mps_destroy(mps);
+
+    /* a GHZ state needs bond dimension 2 everywhere */
+    printf("  GHZ bond dimension mps_apply_2q test: ");
+    mps = mps_create(40, 0, 0);
+    if (mps == NULL)
+        goto test_mps_apply_2q_skip_remaining_tests;
+    mps_apply_1q(mps, hadamard, 0);
+    for (i = 0; i + 1 < 40; i++) {
+        if (mps_apply_2q(mps, cnot, i, i + 1) != 0)
+            goto test_mps_apply_2q_skip_remaining_tests;
+    }
+    tests_failed += size_t_assert_equal(2, mps_max_bond_dimension(mps)) != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+    mps_destroy(mps);
+
+    /* a Bell pair cut to bond dimension 1 loses half its weight */
+    printf("  truncated mps_apply_2q test: ");
+    mps = mps_create(2, 1, 0);
+    if (mps == NULL)
+        goto test_mps_apply_2q_skip_remaining_tests;
+    mps_apply_1q(mps, hadamard, 0);
+    if (mps_apply_2q(mps, cnot, 0, 1) != 0)
+        goto test_mps_apply_2q_skip_remaining_tests;
+    tests_failed += mat_t_assert_equal(MAT_T(0.5),
+                                       MAT_T(mps_discarded_weight(mps)))
+                            != 0
+                        ? 1
+                        : 0;
+    tests_left--;
+
+test_mps_apply_2q_skip_remaining_tests:
+    mps_destroy(mps);
+    statevector_destroy(state);
+    matrix_destroy(hadamard);
+    matrix_destroy(rotation);
+    matrix_destroy(cnot);
+    matrix_destroy(amplitudes);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_qr(void) {
+    const int test_ct = 5;
+    const size_t heights[3] = {6, 3, 70};
+    const size_t widths[3] = {4, 5, 40};
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL, *q = NULL, *r = NULL, *product = NULL;
+    Matrix *adjoint = NULL, *identity = NULL;
+    Matrix *empty = NULL, *empty_q = NULL, *empty_r = NULL;
+    size_t shape, rank, i, j, bad;
+
+    printf("Testing: matrix_qr\n");
+
+    /* tall, wide, and more than one panel of columns */
+    for (shape = 0; shape < 3; shape++) {
+        printf("  %lu x %lu matrix_qr test: ", (unsigned long)heights[shape],
+               (unsigned long)widths[shape]);
+        rank = heights[shape] < widths[shape] ? heights[shape] : widths[shape];
+        matrix = matrix_create(heights[shape], widths[shape]);
+        q = matrix_create(heights[shape], rank);
+        r = matrix_create(rank, widths[shape]);
+        product = matrix_create(heights[shape], widths[shape]);
+        if (matrix == NULL || q == NULL || r == NULL || product == NULL)
+            goto test_matrix_qr_skip_remaining_tests;
+        matrix_fill_random(matrix, 16 + shape);
+        if (matrix_qr(q, r, matrix) != 0
+            || matrix_multiply(product, q, r) != 0)
+            goto test_matrix_qr_skip_remaining_tests;
+        tests_failed += matrix_assert_equal(matrix, product) != 0 ? 1 : 0;
+        tests_left--;
+        if (shape == 2)
+            break;
+        matrix_destroy(matrix);
+        matrix_destroy(q);
+        matrix_destroy(r);
+        matrix_destroy(product);
+        matrix = q = r = product = NULL;
+    }
+
+    printf("  orthonormal Q matrix_qr test: ");
+    adjoint = matrix_create(rank, heights[2]);
+    identity = matrix_create_identity(rank);
+    matrix_destroy(product);
+    product = matrix_create(rank, rank);
+    if (adjoint == NULL || identity == NULL || product == NULL)
+        goto test_matrix_qr_skip_remaining_tests;
+    for (i = 1; i <= heights[2]; i++) {
+        for (j = 1; j <= rank; j++) {
+            matrix_set(adjoint, j, i, MAT_T_CONJ(matrix_get(q, i, j)));
+        }
+    }
+    if (matrix_multiply(product, adjoint, q) != 0)
+        goto test_matrix_qr_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(identity, product) != 0 ? 1 : 0;
+    tests_left--;
+
+    /* 3 x 0 and 0 x 3, with nothing to factor */
+    printf("  empty matrix_qr test: ");
+    for (shape = bad = 0; shape < 2; shape++) {
+        empty = matrix_create(shape == 0 ? 3 : 0, shape == 0 ? 0 : 3);
+        empty_q = matrix_create(shape == 0 ? 3 : 0, 0);
+        empty_r = matrix_create(0, shape == 0 ? 0 : 3);
+        if (empty == NULL || empty_q == NULL || empty_r == NULL)
+            goto test_matrix_qr_skip_remaining_tests;
+        bad += matrix_qr(empty_q, empty_r, empty) != 0 ? 1 : 0;
+        matrix_destroy(empty);
+        matrix_destroy(empty_q);
+        matrix_destroy(empty_r);
+        empty = empty_q = empty_r = NULL;
+    }
+    tests_failed += size_t_assert_equal(0, bad) != 0 ? 1 : 0;
+    tests_left--;
+
+test_matrix_qr_skip_remaining_tests:
+    matrix_destroy(matrix);
+    matrix_destroy(q);
+    matrix_destroy(r);
+    matrix_destroy(product);
+    matrix_destroy(adjoint);
+    matrix_destroy(identity);
+    matrix_destroy(empty);
+    matrix_destroy(empty_q);
+    matrix_destroy(empty_r);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+/**
+ * Create and destroy one 2x2 matrix per index, counting failures in the
+ * `size_t` `context`.
+ */
+static void test_instrument_create_task(void *context, size_t worker,
+                                        size_t begin, size_t end);
+
+static void test_instrument_create_task(void *context, size_t worker,
+                                        size_t begin, size_t end) {
+    Matrix *matrix;
+    size_t i;
+    (void)worker;
+    for (i = begin; i < end; i++) {
+        matrix = matrix_create(2, 2);
+        if (matrix == NULL) {
+            *(size_t *)context += 1;
+        }
+        matrix_destroy(matrix);
+    }
+}
+
+int test_instrument(void) {
+    const int test_ct = 3;
+    /* every counter stays 0 unless the library is instrumented */
+    const size_t on = instrument_enabled() ? 1 : 0;
+#ifdef MAT_T_COMPLEX
+    const double fma_flops = 8;
+#else
+    const double fma_flops = 2;
+#endif
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    ThreadPool *pool = NULL;
+    InstrumentSnapshot *snapshot = NULL;
+    FILE *file = NULL;
+    Matrix *a = NULL;
+    Matrix *b = NULL;
+    Matrix *c = NULL;
+    Matrix *swapped = NULL;
+    size_t failures = 0;
+    size_t bad;
+
+    printf("Testing: instrument\n");
+
+    pool = threadpool_create(2);
+    a = matrix_create(4, 4);
+    b = matrix_create(4, 4);
+    c = matrix_create(4, 4);
+    swapped = matrix_create(2, 2);
+    file = tmpfile();
+    if (pool == NULL || a == NULL || b == NULL || c == NULL || swapped == NULL
+        || file == NULL)
+        goto test_instrument_skip_remaining_tests;
+    matrix_fill_random(a, 3);
+    matrix_fill_random(b, 4);
+    /* column 2 is 0 on the diagonal, so triangularizing swaps the rows */
+    matrix_set(swapped, 1, 1, MAT_T(1));
+    matrix_set(swapped, 1, 2, MAT_T(1));
+    matrix_set(swapped, 2, 1, MAT_T(1));
+
+    printf("  calls and flops instrument test: ");
+    instrument_reset();
+    if (matrix_multiply(c, a, b) != 0 || matrix_multiply(c, b, a) != 0)
+        goto test_instrument_skip_remaining_tests;
+    matrix_diagonalize(swapped);
+    snapshot = instrumentsnapshot_create();
+    if (snapshot == NULL)
+        goto test_instrument_skip_remaining_tests;
+    bad = 0;
+    bad += instrumentsnapshot_calls(snapshot, INSTRUMENT_MATRIX_MULTIPLY)
+                   != 2 * on
+               ? 1
+               : 0;
+    bad += instrumentsnapshot_calls(snapshot,
+                                    INSTRUMENT_MATRIX_MULTIPLY_ACCUMULATE)
+                   != 2 * on
+               ? 1
+               : 0;
+    bad += instrumentsnapshot_flops(snapshot, INSTRUMENT_MATRIX_MULTIPLY)
+                   != on * 2 * 64 * fma_flops
+               ? 1
+               : 0;
+    bad += instrumentsnapshot_calls(snapshot, INSTRUMENT_MATRIX_DIAGONALIZE)
+                   != on
+               ? 1
+               : 0;
+    bad += instrumentsnapshot_pivot_swaps(snapshot) != on ? 1 : 0;
+    tests_failed += size_t_assert_equal(0, bad) != 0 ? 1 : 0;
+    tests_left--;
+    instrumentsnapshot_destroy(snapshot);
+    snapshot = NULL;
+
+    /* the worker's counters are merged while it lives, and kept after it
+     * exits */
+    printf("  threads merged instrument test: ");
+    instrument_reset();
+    threadpool_parallel_for(pool, 2, 1, test_instrument_create_task,
+                            &failures);
+    snapshot = instrumentsnapshot_create();
+    if (snapshot == NULL || failures != 0)
+        goto test_instrument_skip_remaining_tests;
+    bad = instrumentsnapshot_calls(snapshot, INSTRUMENT_MATRIX_CREATE)
+                  != 2 * on
+              ? 1
+              : 0;
+    instrumentsnapshot_destroy(snapshot);
+    threadpool_destroy(pool);
+    pool = NULL;
+    snapshot = instrumentsnapshot_create();
+    if (snapshot == NULL)
+        goto test_instrument_skip_remaining_tests;
+    bad += instrumentsnapshot_calls(snapshot, INSTRUMENT_MATRIX_CREATE)
+                   != 2 * on
+               ? 1
+               : 0;
+    bad += (instrumentsnapshot_bytes(snapshot, INSTRUMENT_MATRIX_CREATE) > 0)
+                   != (on == 1)
+               ? 1
+               : 0;
+    tests_failed += size_t_assert_equal(0, bad) != 0 ? 1 : 0;
+    tests_left--;
+
+    printf("  dump instrument test: ");
+    bad = instrumentsnapshot_dump(snapshot, file) != 0 ? 1 : 0;
+    bad += ftell(file) <= 0 ? 1 : 0;
+    tests_failed += size_t_assert_equal(0, bad) != 0 ? 1 : 0;
+    tests_left--;
+
+test_instrument_skip_remaining_tests:
+    threadpool_destroy(pool);
+    instrumentsnapshot_destroy(snapshot);
+    if (file != NULL) {
+        fclose(file);
+    }
+    matrix_destroy(a);
+    matrix_destroy(b);
+    matrix_destroy(c);
+    matrix_destroy(swapped);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_matrix_save(void) {
+    const int test_ct = 4;
+    const char *path = "test_matrix_save.tmp";
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Matrix *matrix = NULL;
+    Matrix *view = NULL;
+    Matrix *loaded = NULL;
+    Matrix *gate = NULL;
+    StateVector *state = NULL;
+    StateVector *reloaded = NULL;
+    MatrixWriter *writer = NULL;
+    FILE *file = NULL;
+    mat_t pair[2];
+    unsigned char bytes[8], temp;
+    size_t i, j;
+
+    printf("Testing: matrix_save\n");
+
+    matrix = matrix_create(6, 7);
+    gate = matrix_create(4, 4);
+    state = statevector_create(5);
+    if (matrix == NULL || gate == NULL || state == NULL)
+        goto test_matrix_save_skip_remaining_tests;
+    matrix_fill_random(matrix, 17);
+    matrix_fill_random(gate, 18);
+
+    printf("  view matrix_load test: ");
+    view = matrix_create_view(matrix, 2, 3, 3, 4);
+    if (view == NULL || matrix_save(view, path) != 0)
+        goto test_matrix_save_skip_remaining_tests;
+    loaded = matrix_load(path);
+    if (loaded == NULL)
+        goto test_matrix_save_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(view, loaded) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(loaded);
+    loaded = NULL;
+
+    /* mapped values keep the alignment of the file */
+    printf("  aligned matrix_map test: ");
+    if (matrix_save(matrix, path) != 0)
+        goto test_matrix_save_skip_remaining_tests;
+    loaded = matrix_map(path);
+    if (loaded == NULL)
+        goto test_matrix_save_skip_remaining_tests;
+    if ((size_t)matrix_row(loaded, 1) % MATRIXARENA_ALIGNMENT == 0) {
+        tests_failed += matrix_assert_equal(matrix, loaded) != 0 ? 1 : 0;
+    } else {
+        printf(RED "Failure" RESET ": values misaligned\n");
+        tests_failed++;
+    }
+    tests_left--;
+    matrix_destroy(loaded);
+    loaded = NULL;
+
+    /* rewrite the file in the other byte order */
+    printf("  byte swapped matrix_load test: ");
+    file = fopen(path, "r+b");
+    if (file == NULL || fseek(file, 16, SEEK_SET) != 0
+        || fread(bytes, 1, 1, file) != 1)
+        goto test_matrix_save_skip_remaining_tests;
+    bytes[0] ^= 1;
+    if (fseek(file, 16, SEEK_SET) != 0 || fwrite(bytes, 1, 1, file) != 1)
+        goto test_matrix_save_skip_remaining_tests;
+    for (i = 0; i < 6 * 7 * sizeof(mat_t) / 8; i++) {
+        if (fseek(file, (long)(64 + 8 * i), SEEK_SET) != 0
+            || fread(bytes, 1, 8, file) != 8)
+            goto test_matrix_save_skip_remaining_tests;
+        for (j = 0; j < 4; j++) {
+            temp = bytes[j];
+            bytes[j] = bytes[7 - j];
+            bytes[7 - j] = temp;
+        }
+        if (fseek(file, (long)(64 + 8 * i), SEEK_SET) != 0
+            || fwrite(bytes, 1, 8, file) != 8)
+            goto test_matrix_save_skip_remaining_tests;
+    }
+    fclose(file);
+    file = NULL;
+    loaded = matrix_load(path);
+    if (loaded == NULL)
+        goto test_matrix_save_skip_remaining_tests;
+    tests_failed += matrix_assert_equal(matrix, loaded) != 0 ? 1 : 0;
+    tests_left--;
+    matrix_destroy(loaded);
+    loaded = NULL;
+
+    /* a state written two amplitudes at a time reads back as one */
+    printf("  chunked statevector_load test: ");
+    statevector_apply_2q(state, gate, 3, 1);
+    statevector_apply_2q(state, gate, 4, 0);
+    writer = matrixwriter_create(path, 32, 1);
+    if (writer == NULL)
+        goto test_matrix_save_skip_remaining_tests;
+    for (i = 0; i < 32; i += 2) {
+        pair[0] = statevector_get(state, i);
+        pair[1] = statevector_get(state, i + 1);
+        if (matrixwriter_write(writer, pair, 2) != 0)
+            goto test_matrix_save_skip_remaining_tests;
+    }
+    if (matrixwriter_finish(writer) != 0)
+        goto test_matrix_save_skip_remaining_tests;
+    reloaded = statevector_load(path, NULL);
+    if (reloaded == NULL || statevector_save(state, path) != 0)
+        goto test_matrix_save_skip_remaining_tests;
+    loaded = matrix_load(path);
+    if (loaded == NULL)
+        goto test_matrix_save_skip_remaining_tests;
+    tests_failed += statevector_assert_equal(reloaded, loaded) != 0 ? 1 : 0;
+    tests_left--;
+
+test_matrix_save_skip_remaining_tests:
+    if (file != NULL) {
+        fclose(file);
+    }
+    remove(path);
+    matrixwriter_destroy(writer);
+    statevector_destroy(state);
+    statevector_destroy(reloaded);
+    matrix_destroy(matrix);
+    matrix_destroy(view);
+    matrix_destroy(loaded);
+    matrix_destroy(gate);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_diskstate_run(void) {
+    const int test_ct = 3;
+    const char *path = "test_diskstate_run.tmp";
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    DiskState *disk = NULL;
+    StateVector *state = NULL;
+    Circuit *circuit = NULL;
+    Matrix *hadamard = NULL;
+    Matrix *pauli_x = NULL;
+    Matrix *gate = NULL;
+    Matrix *expected = NULL;
+    size_t layer, q;
+
+    printf("Testing: diskstate_run\n");
+
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    pauli_x = matrix_create_from_values(2, 2, pauli_x_values);
+    gate = matrix_create(4, 4);
+    state = statevector_create(6);
+    expected = matrix_create(64, 1);
+    disk = diskstate_create(path, 6, 3, NULL);
+    if (hadamard == NULL || pauli_x == NULL || gate == NULL || state == NULL
+        || expected == NULL || disk == NULL)
+        goto test_diskstate_run_skip_remaining_tests;
+    matrix_fill_random(gate, 24);
+
+    /* gates within the first chunk's qubits take a single pass */
+    printf("  chunk local diskstate_run test: ");
+    circuit = circuit_create(6);
+    if (circuit == NULL || circuit_add_1q(circuit, hadamard, 0) != 0
+        || circuit_add_1q(circuit, hadamard, 2) != 0
+        || circuit_add_2q(circuit, gate, 2, 1) != 0
+        || circuit_add_controlled_1q(circuit, pauli_x, 0, 1) != 0)
+        goto test_diskstate_run_skip_remaining_tests;
+    circuit_run(circuit, state);
+    for (q = 0; q < 64; q++) {
+        matrix_set(expected, q + 1, 1, statevector_get(state, q));
+    }
+    if (diskstate_run(disk, circuit) != 0)
+        goto test_diskstate_run_skip_remaining_tests;
+    if (diskstate_passes(disk) != 1 || diskstate_swap_passes(disk) != 0
+        || diskstate_bytes_read(disk) != 64 * sizeof(mat_t)
+        || diskstate_bytes_written(disk) != 64 * sizeof(mat_t)) {
+        printf(RED "Failure" RESET ": %lu passes, %lu bytes read\n",
+               (unsigned long)diskstate_passes(disk),
+               (unsigned long)diskstate_bytes_read(disk));
+        tests_failed++;
+    } else {
+        tests_failed += diskstate_assert_equal(disk, expected) != 0 ? 1 : 0;
+    }
+    tests_left--;
+    circuit_destroy(circuit);
+
+    /* gates on the chunk index's qubits swap them into the chunks first */
+    printf("  swapping diskstate_run test: ");
+    circuit = circuit_create(6);
+    if (circuit == NULL)
+        goto test_diskstate_run_skip_remaining_tests;
+    for (layer = 0; layer < 3; layer++) {
+        for (q = 0; q < 6; q++) {
+            if (circuit_add_1q(circuit,
+                               (q + layer) % 3 == 0 ? pauli_x : hadamard, q)
+                != 0)
+                goto test_diskstate_run_skip_remaining_tests;
+        }
+        if (circuit_add_2q(circuit, gate, 5 - layer, layer) != 0
+            || circuit_add_controlled_1q(circuit, pauli_x, layer,
+                                         3 + (layer + 1) % 3)
+                   != 0)
+            goto test_diskstate_run_skip_remaining_tests;
+    }
+    circuit_run(circuit, state);
+    for (q = 0; q < 64; q++) {
+        matrix_set(expected, q + 1, 1, statevector_get(state, q));
+    }
+    if (diskstate_run(disk, circuit) != 0)
+        goto test_diskstate_run_skip_remaining_tests;
+    if (diskstate_swap_passes(disk) == 0) {
+        printf(RED "Failure" RESET ": no swap passes\n");
+        tests_failed++;
+    } else {
+        tests_failed += diskstate_assert_equal(disk, expected) != 0 ? 1 : 0;
+    }
+    tests_left--;
+
+    /* once reordered the file loads as the state */
+    printf("  reordered statevector_load test: ");
+    statevector_destroy(state);
+    state = NULL;
+    if (diskstate_reorder(disk) != 0)
+        goto test_diskstate_run_skip_remaining_tests;
+    state = statevector_load(path, NULL);
+    if (state == NULL)
+        goto test_diskstate_run_skip_remaining_tests;
+    tests_failed += statevector_assert_equal(state, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_diskstate_run_skip_remaining_tests:
+    diskstate_destroy(disk);
+    remove(path);
+    circuit_destroy(circuit);
+    statevector_destroy(state);
+    matrix_destroy(hadamard);
+    matrix_destroy(pauli_x);
+    matrix_destroy(gate);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
+int test_diststate_run(void) {
+    const int test_ct = 3;
+    int tests_left = test_ct;
+    int tests_failed = 0;
+    Transport *transport = NULL;
+    DistState *dist = NULL;
+    StateVector *state = NULL;
+    StateVector *full = NULL;
+    Circuit *circuit = NULL;
+    Matrix *hadamard = NULL;
+    Matrix *pauli_x = NULL;
+    Matrix *gate = NULL;
+    Matrix *expected = NULL;
+    size_t layer, q, total;
+
+    printf("Testing: diststate_run\n");
+
+    hadamard = matrix_create_from_values(2, 2, hadamard_values);
+    pauli_x = matrix_create_from_values(2, 2, pauli_x_values);
+    gate = matrix_create(4, 4);
+    state = statevector_create(6);
+    expected = matrix_create(64, 1);
+    circuit = circuit_create(6);
+    if (hadamard == NULL || pauli_x == NULL || gate == NULL || state == NULL
+        || expected == NULL || circuit == NULL)
+        goto test_diststate_run_skip_remaining_tests;
+    matrix_fill_random(gate, 25);
+    for (layer = 0; layer < 3; layer++) {
+        for (q = 0; q < 6; q++) {
+            if (circuit_add_1q(circuit,
+                               (q + layer) % 3 == 0 ? pauli_x : hadamard, q)
+                != 0)
+                goto test_diststate_run_skip_remaining_tests;
+        }
+        if (circuit_add_2q(circuit, gate, 5 - layer, layer) != 0
+            || circuit_add_controlled_1q(circuit, pauli_x, 4 - layer,
+                                         5 - (layer + 2) % 3)
+                   != 0)
+            goto test_diststate_run_skip_remaining_tests;
+    }
+    circuit_run(circuit, state);
+    for (q = 0; q < 64; q++) {
+        matrix_set(expected, q + 1, 1, statevector_get(state, q));
+    }
+
+    /* ranks forked here leave through the cleanup below once gathered */
+    printf("  4 rank diststate_run test: ");
+    transport = transport_create_local(4);
+    if (transport == NULL)
+        goto test_diststate_run_skip_remaining_tests;
+    dist = diststate_create(transport, 6, NULL);
+    if (dist == NULL || diststate_run(dist, circuit) != 0)
+        goto test_diststate_run_skip_remaining_tests;
+    if (transport_rank(transport) == 0) {
+        full = statevector_create(6);
+        if (full == NULL)
+            goto test_diststate_run_skip_remaining_tests;
+    }
+    if (diststate_gather(dist, full) != 0 || transport_rank(transport) != 0)
+        goto test_diststate_run_skip_remaining_tests;
+    tests_failed += statevector_assert_equal(full, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+    /* X0 is local; H4 first needs qubit 4, swapping half of a 16 amplitude
+     * share */
+    printf("  per gate diststate_gate_bytes test: ");
+    total = 0;
+    for (q = 0; q < circuit_passes(circuit); q++) {
+        total += diststate_gate_bytes(dist, q);
+    }
+    if (diststate_gate_bytes(dist, 0) != 0
+        || diststate_gate_bytes(dist, 4) != 8 * sizeof(mat_t)
+        || total != diststate_bytes_sent(dist) || diststate_swaps(dist) == 0) {
+        printf(RED "Failure" RESET ": %lu bytes sent over %lu swaps\n",
+               (unsigned long)diststate_bytes_sent(dist),
+               (unsigned long)diststate_swaps(dist));
+        tests_failed++;
+    } else {
+        printf(GREEN "Success" RESET "\n");
+    }
+    tests_left--;
+    diststate_destroy(dist);
+    dist = NULL;
+    transport_destroy(transport);
+    transport = NULL;
+
+    /* fused 3 qubit gates over 2 ranks */
+    printf("  2 rank compiled diststate_run test: ");
+    if (circuit_compile(circuit, 3) != 0)
+        goto test_diststate_run_skip_remaining_tests;
+    transport = transport_create_local(2);
+    if (transport == NULL)
+        goto test_diststate_run_skip_remaining_tests;
+    dist = diststate_create(transport, 6, NULL);
+    if (dist == NULL || diststate_run(dist, circuit) != 0
+        || diststate_gather(dist, full) != 0
+        || transport_rank(transport) != 0)
+        goto test_diststate_run_skip_remaining_tests;
+    tests_failed += statevector_assert_equal(full, expected) != 0 ? 1 : 0;
+    tests_left--;
+
+test_diststate_run_skip_remaining_tests:
+    diststate_destroy(dist);
+    if (transport != NULL && transport_rank(transport) != 0) {
+        transport_destroy(transport);
+        _exit(0);
+    }
+    transport_destroy(transport);
+    circuit_destroy(circuit);
+    statevector_destroy(state);
+    statevector_destroy(full);
+    matrix_destroy(hadamard);
+    matrix_destroy(pauli_x);
+    matrix_destroy(gate);
+    matrix_destroy(expected);
+
+    printf("Failed: %i\n", tests_failed);
+    printf("Succeeded: %i\n", test_ct - tests_left - tests_failed);
+    printf("Skipped: %i\n", tests_left);
+
+    return tests_failed;
+}
+
 int main(void) {
     int total_failures = 0;
+    total_failures += test_mat_t();
     total_failures += test_matrix_create();
     total_failures += test_matrix_create_identity();
     total_failures += test_matrix_width();
@@ -547,5 +5068,51 @@ int main(void) {
     total_failures += test_matrix_determinant();
     total_failures += test_matrix_is_diagonal();
     total_failures += test_matrix_diagonalize();
+    total_failures += test_matrix_multiply();
+    total_failures += test_matrix_multiply_accumulate();
+    total_failures += test_statevector_create();
+    total_failures += test_statevector_apply_1q();
+    total_failures += test_statevector_apply_controlled_1q();
+    total_failures += test_statevector_apply_2q();
+    total_failures += test_statevector_apply_controlled_2q();
+    total_failures += test_threadpool_parallel_for();
+    total_failures += test_statevector_create_parallel();
+    total_failures += test_statevector_norm();
+    total_failures += test_statevector_expectation_1q();
+    total_failures += test_lufactor_determinant();
+    total_failures += test_lufactor_solve();
+    total_failures += test_lufactor_inverse();
+    total_failures += test_eigen_hermitian();
+    total_failures += test_sparsematrix_create();
+    total_failures += test_sparsematrix_multiply_vector();
+    total_failures += test_sparsematrix_multiply_vector_parallel();
+    total_failures += test_sparsematrix_dense();
+    total_failures += test_lanczos_solve();
+    total_failures += test_expm_multiply();
+    total_failures += test_matrix_exponential();
+    total_failures += test_exponentialcache_get();
+    total_failures += test_matrix_create_view();
+    total_failures += test_matrix_copy_buffer();
+    total_failures += test_matrix_kron();
+    total_failures += test_kronoperator_multiply_vector();
+    total_failures += test_matrixarena_allocate();
+    total_failures += test_matrix_create_in();
+    total_failures += test_mat2_multiply();
+    total_failures += test_mat4_multiply();
+    total_failures += test_mat4_kron();
+    total_failures += test_statevector_apply_kq();
+    total_failures += test_circuit_compile();
+    total_failures += test_tableau_measure();
+    total_failures += test_densitymatrix_apply_1q();
+    total_failures += test_densitymatrix_depolarize();
+    total_failures += test_densitymatrix_partial_trace();
+    total_failures += test_sampler_sample();
+    total_failures += test_matrix_svd();
+    total_failures += test_mps_apply_2q();
+    total_failures += test_matrix_qr();
+    total_failures += test_instrument();
+    total_failures += test_matrix_save();
+    total_failures += test_diskstate_run();
+    total_failures += test_diststate_run();
     return total_failures;
 }
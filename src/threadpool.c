@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "threadpool.h"
+#include "reporter.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct ThreadPoolWorker {
+    ThreadPool *pool;
+    size_t index;
+    pthread_t thread;
+} ThreadPoolWorker;
+
+struct ThreadPool {
+    size_t threads;
+
+    /* threads - 1 workers; the caller is worker 0 */
+    ThreadPoolWorker *workers;
+    size_t started;
+
+    /* serializes callers of threadpool_parallel_for */
+    pthread_mutex_t submit;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;
+    size_t pending;
+    bool stopping;
+
+    /* current job */
+    ThreadPoolTask task;
+    void *context;
+    size_t count;
+    size_t grain;
+};
+
+/**
+ * Run worker `worker`'s share of the current job.
+ */
+static void threadpool_run_range(ThreadPool *pool, size_t worker);
+
+/**
+ * Wait for jobs and run this worker's share of each until the pool stops.
+ */
+static void *threadpool_worker_main(void *arg);
+
+size_t threadpool_threads(ThreadPool *pool) {
+    return pool == NULL ? 1 : pool->threads;
+}
+
+static void threadpool_run_range(ThreadPool *pool, size_t worker) {
+    const size_t blocks = (pool->count + pool->grain - 1) / pool->grain;
+    size_t begin = worker * blocks / pool->threads * pool->grain;
+    size_t end = (worker + 1) * blocks / pool->threads * pool->grain;
+
+    if (end > pool->count) {
+        end = pool->count;
+    }
+    if (begin < end) {
+        pool->task(pool->context, worker, begin, end);
+    }
+}
+
+static void *threadpool_worker_main(void *arg) {
+    ThreadPoolWorker *worker = arg;
+    ThreadPool *pool = worker->pool;
+    unsigned long seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->stopping && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->mutex);
+        }
+        if (pool->stopping) {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        threadpool_run_range(pool, worker->index);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return NULL;
+}
+
+void threadpool_parallel_for(ThreadPool *pool, size_t count, size_t grain,
+                             ThreadPoolTask task, void *context) {
+    if (grain == 0) {
+        report_logic_error("parallel_for grain must be positive");
+    }
+    if (count == 0) {
+        return;
+    }
+
+    /* not worth waking anyone for a single block */
+    if (pool == NULL || pool->threads == 1 || count <= grain) {
+        task(context, 0, 0, count);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->submit);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->context = context;
+    pool->count = count;
+    pool->grain = grain;
+    pool->pending = pool->threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    threadpool_run_range(pool, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_mutex_unlock(&pool->submit);
+}
+
+ThreadPool *threadpool_create(size_t threads) {
+    ThreadPool *pool;
+    long online;
+    size_t i;
+
+    if (threads == 0) {
+        online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+
+    pool = calloc(1, sizeof(ThreadPool));
+    if (pool == NULL)
+        goto threadpool_create_fail;
+
+    pool->threads = threads;
+    pthread_mutex_init(&pool->submit, NULL);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    pool->workers = calloc(threads, sizeof(ThreadPoolWorker));
+    if (pool->workers == NULL)
+        goto threadpool_create_fail;
+
+    for (i = 1; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (pthread_create(&pool->workers[i].thread, NULL,
+                           threadpool_worker_main, &pool->workers[i])
+            != 0) {
+            report_system_error("could not start worker thread");
+            goto threadpool_create_fail;
+        }
+        pool->started++;
+    }
+
+    return pool;
+threadpool_create_fail:
+    threadpool_destroy(pool);
+    return NULL;
+}
+
+void threadpool_destroy(ThreadPool *pool) {
+    size_t i;
+
+    if (pool != NULL) {
+        pthread_mutex_lock(&pool->mutex);
+        pool->stopping = true;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->mutex);
+
+        for (i = 1; i <= pool->started; i++) {
+            pthread_join(pool->workers[i].thread, NULL);
+        }
+
+        pthread_cond_destroy(&pool->done);
+        pthread_cond_destroy(&pool->start);
+        pthread_mutex_destroy(&pool->mutex);
+        pthread_mutex_destroy(&pool->submit);
+        free(pool->workers);
+        free(pool);
+    }
+}
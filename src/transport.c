@@ -0,0 +1,245 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "transport.h"
+#include "reporter.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct Transport {
+    size_t rank;
+    size_t ranks;
+
+    TransportExchange exchange;
+    void *context;
+
+    size_t bytes_sent;
+
+    /* for a local transport, the socket to each rank (-1 for this one), and
+     * in rank 0 the process of each other rank */
+    int *sockets;
+    pid_t *children;
+};
+
+/**
+ * Exchange bytes with rank `peer` over the socket to it.
+ * Usable as a TransportExchange with a local Transport as context.
+ * Return 0 on success, -1 on failure.
+ */
+static int transport_local_exchange(void *transport, size_t peer,
+                                    const void *send, size_t send_bytes,
+                                    void *receive, size_t receive_bytes);
+
+static int transport_local_exchange(void *transport, size_t peer,
+                                    const void *send, size_t send_bytes,
+                                    void *receive, size_t receive_bytes) {
+    Transport *self = transport;
+    const unsigned char *out = send;
+    unsigned char *in = receive;
+    size_t sent = 0;
+    size_t received = 0;
+    struct pollfd descriptor;
+    ssize_t done;
+
+    /* both ranks send at once, so write and read as the socket allows
+     * rather than fill its buffer and wait on each other */
+    descriptor.fd = self->sockets[peer];
+    while (sent < send_bytes || received < receive_bytes) {
+        descriptor.events = (sent < send_bytes ? POLLOUT : 0)
+                            | (received < receive_bytes ? POLLIN : 0);
+        descriptor.revents = 0;
+        if (poll(&descriptor, 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (sent < send_bytes && (descriptor.revents & POLLOUT)) {
+            done = write(descriptor.fd, out + sent, send_bytes - sent);
+            if (done < 0 && errno != EAGAIN && errno != EINTR)
+                return -1;
+            if (done > 0) {
+                sent += (size_t)done;
+            }
+        }
+        if (received < receive_bytes
+            && (descriptor.revents & (POLLIN | POLLHUP | POLLERR))) {
+            done = read(descriptor.fd, in + received,
+                        receive_bytes - received);
+            /* the peer has gone */
+            if (done == 0)
+                return -1;
+            if (done < 0 && errno != EAGAIN && errno != EINTR)
+                return -1;
+            if (done > 0) {
+                received += (size_t)done;
+            }
+        } else if (descriptor.revents & (POLLHUP | POLLERR)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+size_t transport_rank(Transport *transport) { return transport->rank; }
+
+size_t transport_ranks(Transport *transport) { return transport->ranks; }
+
+int transport_exchange(Transport *transport, size_t peer, const void *send,
+                       size_t send_bytes, void *receive,
+                       size_t receive_bytes) {
+    if (peer >= transport->ranks || peer == transport->rank) {
+        report_logic_error("exchange with an invalid rank");
+    }
+    if (transport->exchange(transport->context, peer, send, send_bytes,
+                            receive, receive_bytes)
+        != 0)
+        return -1;
+    transport->bytes_sent += send_bytes;
+    return 0;
+}
+
+size_t transport_bytes_sent(Transport *transport) {
+    return transport->bytes_sent;
+}
+
+Transport *transport_create(size_t rank, size_t ranks,
+                            TransportExchange exchange, void *context) {
+    Transport *transport;
+
+    if (rank >= ranks) {
+        report_logic_error("rank out of bounds");
+    }
+    transport = calloc(1, sizeof(Transport));
+    if (transport == NULL)
+        return NULL;
+    transport->rank = rank;
+    transport->ranks = ranks;
+    transport->exchange = exchange;
+    transport->context = context;
+    return transport;
+}
+
+Transport *transport_create_local(size_t ranks) {
+    Transport *transport = NULL;
+    /* the two ends of the socket between each pair of ranks */
+    int *pairs = NULL;
+    int ends[2];
+    pid_t child;
+    size_t rank = 0;
+    size_t forked = 0;
+    size_t i, j;
+
+    if (ranks == 0) {
+        report_logic_error("a transport needs a rank");
+    }
+    pairs = malloc(ranks * ranks * sizeof(int));
+    if (pairs == NULL)
+        goto transport_create_local_fail;
+    for (i = 0; i < ranks * ranks; i++) {
+        pairs[i] = -1;
+    }
+    for (i = 0; i < ranks; i++) {
+        for (j = i + 1; j < ranks; j++) {
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+                report_system_error("cannot create socket pair");
+                goto transport_create_local_fail;
+            }
+            pairs[i * ranks + j] = ends[0];
+            pairs[j * ranks + i] = ends[1];
+        }
+    }
+
+    transport = transport_create(0, ranks, transport_local_exchange, NULL);
+    if (transport == NULL)
+        goto transport_create_local_fail;
+    transport->context = transport;
+    transport->sockets = malloc(ranks * sizeof(int));
+    transport->children = calloc(ranks, sizeof(pid_t));
+    if (transport->sockets == NULL || transport->children == NULL)
+        goto transport_create_local_fail;
+
+    /* buffered output would otherwise be written once per rank */
+    fflush(NULL);
+    for (forked = 1; forked < ranks; forked++) {
+        child = fork();
+        if (child < 0) {
+            report_system_error("cannot fork rank");
+            goto transport_create_local_fail;
+        }
+        if (child == 0) {
+            rank = forked;
+            free(transport->children);
+            transport->children = NULL;
+            break;
+        }
+        transport->children[forked] = child;
+    }
+
+    /* keep the socket ends of this rank */
+    transport->rank = rank;
+    for (i = 0; i < ranks; i++) {
+        transport->sockets[i] = pairs[rank * ranks + i];
+        pairs[rank * ranks + i] = -1;
+        if (transport->sockets[i] >= 0) {
+            fcntl(transport->sockets[i], F_SETFL,
+                  fcntl(transport->sockets[i], F_GETFL) | O_NONBLOCK);
+        }
+    }
+    for (i = 0; i < ranks * ranks; i++) {
+        if (pairs[i] >= 0) {
+            close(pairs[i]);
+        }
+    }
+    free(pairs);
+    return transport;
+
+transport_create_local_fail:
+    if (pairs != NULL) {
+        for (i = 0; i < ranks * ranks; i++) {
+            if (pairs[i] >= 0) {
+                close(pairs[i]);
+            }
+        }
+    }
+    free(pairs);
+    if (transport != NULL) {
+        /* ranks forked so far see their sockets close and fail */
+        if (transport->sockets != NULL) {
+            for (i = 0; i < ranks; i++) {
+                transport->sockets[i] = -1;
+            }
+        }
+        transport->ranks = forked;
+        transport_destroy(transport);
+    }
+    return NULL;
+}
+
+void transport_destroy(Transport *transport) {
+    size_t i;
+
+    if (transport != NULL) {
+        if (transport->sockets != NULL) {
+            for (i = 0; i < transport->ranks; i++) {
+                if (transport->sockets[i] >= 0) {
+                    close(transport->sockets[i]);
+                }
+            }
+        }
+        if (transport->children != NULL) {
+            for (i = 1; i < transport->ranks; i++) {
+                if (transport->children[i] > 0) {
+                    waitpid(transport->children[i], NULL, 0);
+                }
+            }
+        }
+        free(transport->sockets);
+        free(transport->children);
+        free(transport);
+    }
+}